@@ -37,6 +37,43 @@ technique Default
 		WorldTransform[0] = (World);
 	}
 }
+
+// Same look as Default, for render::instance_batcher groups:
+// world transform columns come from instance stream (TEXCOORD4..6).
+struct InstancedInput
+{
+	float3 position : POSITION;
+	float4 world0   : TEXCOORD4;
+	float4 world1   : TEXCOORD5;
+	float4 world2   : TEXCOORD6;
+};
+
+float4 InstancedVS(InstancedInput input) : POSITION
+{
+	float4 position = float4(input.position, 1);
+	float4 world = float4(dot(position, input.world0), dot(position, input.world1), dot(position, input.world2), 1);
+	return mul(mul(world, View), Projection);
+}
+
+float4 InstancedPS() : COLOR
+{
+	return float4(1, 1, 1, 1);
+}
+
+technique Instanced
+{
+	pass p0
+	{
+		ZEnable	        = true;
+		ZWriteEnable    = false;
+		FillMode        = WIREFRAME;
+		CullMode        = NONE;
+		AlphaBlendEnable = FALSE;
+
+		VertexShader = compile vs_3_0 InstancedVS();
+		PixelShader  = compile ps_3_0 InstancedPS();
+	}
+}
  
 
 /*
@@ -24,6 +24,35 @@ VS_OUTPUT Lines3dVS(float4 posIn: POSITION, float4 colorIn: COLOR0)
 	return output;
 }
 
+// unit shape, world transform rows (TEXCOORD4..6) and color (TEXCOORD7) come from instance stream.
+struct InstancedInput
+{
+	float3 position : POSITION;
+	float4 color    : COLOR0;
+	float4 world0   : TEXCOORD4;
+	float4 world1   : TEXCOORD5;
+	float4 world2   : TEXCOORD6;
+	float4 tint     : TEXCOORD7;
+};
+
+VS_OUTPUT Lines3dInstancedVS(InstancedInput input)
+{
+	VS_OUTPUT output;
+
+	float4 position = float4(input.position, 1);
+	float4 world = float4(dot(position, input.world0), dot(position, input.world1), dot(position, input.world2), 1);
+	output.pos = mul(world, g_mLVP);
+	output.color = input.color * input.tint;
+
+	return output;
+}
+
+float4 Lines3dInstancedPS(float4 color: COLOR0) : COLOR
+{
+	return color;
+}
+
+
 technique Lines2d
 {
 	pass p0
@@ -83,4 +112,26 @@ technique Lines3d
 
 		VertexShader = compile vs_1_1 Lines3dVS();
 	}
+}
+
+technique Lines3dInstanced
+{
+	pass p0
+	{
+		DISABLE_FOG
+
+		ZEnable	        = true;
+		Lighting        = false;
+		ZWriteEnable    = false;
+		FillMode        = WIREFRAME;
+		CullMode        = NONE;
+			
+		// enable alpha blending
+		AlphaBlendEnable = TRUE;
+		SrcBlend         = SrcAlpha;
+		DestBlend        = InvSrcAlpha;
+
+		VertexShader = compile vs_3_0 Lines3dInstancedVS();
+		PixelShader  = compile ps_3_0 Lines3dInstancedPS();
+	}
 }
\ No newline at end of file
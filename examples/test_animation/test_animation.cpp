@@ -21,11 +21,11 @@ public:
 		m_frame = math::frame::create();
 		m_frame->add( m_mesh );
 
-		TiXmlDocument xml( "media\\1111.XML" );
+		base::xml_document xml;
 
-		if ( xml.LoadFile() )
+		if ( xml.load( "1111.XML" ) )
 		{
-			m_controller.load( xml.FirstChild( "model" )->FirstChild( "node" )->FirstChild( "node" ) );
+			m_controller.load( xml.document().child( "model" ).child( "node" ).child( "node" ) );
 		}
 		
 		m_controller.atach( m_frame );
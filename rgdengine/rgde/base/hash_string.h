@@ -30,6 +30,9 @@ namespace base
 
 		const hash_id& hash() const {return m_hash_value;}
 
+		/// SHA1 of raw data block
+		static hash_id calc_hash(const void* data, size_t size);
+
 	protected:
 		void calc_hash();
 
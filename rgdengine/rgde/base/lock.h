@@ -0,0 +1,29 @@
+#pragma once
+
+namespace base
+{
+	/// Non recursive mutex (critical section on win32, pthread mutex elsewhere).
+	/// Bundled boost has no prebuilt thread library, so engine uses its own.
+	class mutex : boost::noncopyable
+	{
+	public:
+		mutex();
+		~mutex();
+
+		void lock();
+		void unlock();
+
+	private:
+		void* m_impl;
+	};
+
+	class scoped_lock : boost::noncopyable
+	{
+	public:
+		explicit scoped_lock(mutex& m) : m_mutex(m) {m_mutex.lock();}
+		~scoped_lock() {m_mutex.unlock();}
+
+	private:
+		mutex& m_mutex;
+	};
+}
@@ -12,12 +12,16 @@ namespace base
 	public:
 		typedef boost::shared_ptr<Resource> resource_ptr;
 		typedef boost::function <resource_ptr (const Param&)> creator_func;
+		/// reloads resource data in place, so all holders see the new version
+		typedef boost::function <void (Resource&, const Param&)> reload_func;
 
 		resource_manager(creator_func creator, bool hasDefault = false, const Param& p = Param())
 			: m_creator(creator),m_default_param(p), m_has_default(hasDefault)
 		{
 		}
 
+		void set_reload_func(reload_func reloader) {m_reloader = reloader;}
+
 		resource_ptr get(const Param& p) 
 		{
 			resource_map::iterator it = m_resources.find(p);
@@ -29,6 +33,26 @@ namespace base
 			return create(p);
 		}
 
+		/// reloads alive resources which params satisfy pred. returns number of reloaded
+		template<class Pred>
+		unsigned reload_if(Pred pred)
+		{
+			if (m_reloader.empty())
+				return 0;
+
+			unsigned num_reloaded = 0;
+			for (resource_map::iterator it = m_resources.begin(); it != m_resources.end(); ++it)
+			{
+				resource_ptr r = it->second.lock();
+				if (r && pred(it->first))
+				{
+					m_reloader(*r, it->first);
+					++num_reloaded;
+				}
+			}
+			return num_reloaded;
+		}
+
 	private:
 		resource_ptr create(const Param& p)
 		{
@@ -50,6 +74,7 @@ namespace base
 		typedef std::map<Param, resource_wptr> resource_map;
 
 		creator_func m_creator;
+		reload_func	m_reloader;
 		Param		m_default_param; //   
 		bool		m_has_default;
 		resource_map m_resources;
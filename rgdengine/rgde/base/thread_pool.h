@@ -0,0 +1,28 @@
+#pragma once
+
+namespace base
+{
+	/// Fixed set of worker threads for fork-join work inside a frame.
+	/// Calling thread takes part in the work, so pool without workers
+	/// (single processor) runs everything inline.
+	class thread_pool : boost::noncopyable
+	{
+	public:
+		typedef boost::function<void (size_t)> job;
+
+		/// 0 means one worker per processor except the calling one
+		explicit thread_pool(unsigned num_threads = 0);
+		~thread_pool();
+
+		/// number of worker threads
+		unsigned size() const;
+
+		/// calls f(i) for every 0 <= i < count and returns when all calls are done.
+		/// not reentrant, f must not throw
+		void parallel_for(size_t count, const job& f);
+
+	private:
+		struct impl;
+		impl* m_impl;
+	};
+}
@@ -23,6 +23,62 @@ namespace base
 		return true;
 	}
 
+	/** xml document parsed in-situ by pugixml.
+	*  File is read once into own buffer and parsed in place: no per node 
+	*  string allocations and no extra copy of file data. All nodes and 
+	*  strings are valid while document is alive.
+	*/
+	class xml_document : boost::noncopyable
+	{
+	public:
+		explicit xml_document(unsigned int options = pugi::parse_default)
+			: m_parser(options)
+		{
+		}
+
+		bool load(const std::string& filename)
+		{
+			io::readstream_ptr in = io::file_system::get().find(filename);
+
+			if (!in || 0 == in->size())
+				return false;
+
+			m_data.resize(in->size() + 1);
+			in->position(0);
+			in->read((byte*)&m_data[0], in->size());
+			m_data.back() = 0;
+
+			return parse_buffer();
+		}
+
+		bool parse(const std::string& xml)
+		{
+			m_data.assign(xml.begin(), xml.end());
+			m_data.push_back(0);
+
+			return parse_buffer();
+		}
+
+		pugi::xml_node document() const {return m_parser.document();}
+
+		/// first element of document (like TiXmlDocument::RootElement)
+		pugi::xml_node root() const 
+		{
+			return m_parser.document().first_node(pugi::node_element);
+		}
+
+	private:
+		bool parse_buffer()
+		{
+			m_parser.parse(&m_data[0]);
+			return !root().empty();
+		}
+
+	private:
+		std::vector<char> m_data;
+		pugi::xml_parser m_parser;
+	};
+
 	template<typename T> 
 	inline T safe_read(TiXmlHandle hBaseNode,
 						   const std::string& strParameterName,
@@ -235,4 +291,55 @@ namespace base
 
 		color = math::Color(r, g, b, a);
 	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// pugixml versions
+
+	template<typename T> 
+	inline T safe_read_attr(pugi::xml_node node, const char* strAttributeName, const T& defaultValue)
+	{ 
+		pugi::xml_attribute attr = node.attribute(strAttributeName);
+		if (attr.empty())
+			return defaultValue;
+
+		try {
+			return base::lexical_cast<T>(std::string(attr.value())); 
+		} catch(...)
+		{
+			return defaultValue;
+		}
+	}
+
+	inline void read(math::vec4f& v, pugi::xml_node node)
+	{
+		v[0] = node.attribute("x").as_float();
+		v[1] = node.attribute("y").as_float();
+		v[2] = node.attribute("z").as_float();
+		v[3] = node.attribute("w").as_float();
+	}
+
+	inline void read(math::vec3f& v, pugi::xml_node node)
+	{
+		v[0] = node.attribute("x").as_float();
+		v[1] = node.attribute("y").as_float();
+		v[2] = node.attribute("z").as_float();
+	}
+
+	inline void read(math::vec2f& v, pugi::xml_node node)
+	{
+		v[0] = node.attribute("u").as_float();
+		v[1] = node.attribute("v").as_float();
+	}
+
+	inline void read_light_color(math::Color& color, pugi::xml_node node, const char* strParameterName)
+	{
+		pugi::xml_node param = node.child(strParameterName);
+
+		char r = (char)(param.attribute("red").as_float()*255.0f);
+		char g = (char)(param.attribute("green").as_float()*255.0f);
+		char b = (char)(param.attribute("blue").as_float()*255.0f);
+		char a = (char)(param.attribute("alpha").as_float()*255.0f);
+
+		color = math::Color(r, g, b, a);
+	}
 }
\ No newline at end of file
@@ -154,6 +154,12 @@ namespace io
 	read_stream& operator >> (read_stream& rf, math::point3f& point);
 	read_stream& operator >> (read_stream& rf, math::quatf& quat);
 	read_stream& operator >> (read_stream& rf, std::wstring& str);
+
+	/// reads string written by operator << directly into str.
+	/// returns false (and leaves str empty) if stored length exceeds max_size or
+	/// stream ends before length, stream is moved past the string in both cases
+	bool read_string(read_stream& rf, std::string& str, unsigned max_size);
+	bool read_string(read_stream& rf, std::wstring& str, unsigned max_size);
 	//////////////////////////////////////////////////////////////////////////
 	//////////////////////////////////////////////////////////////////////////
 
@@ -2,6 +2,7 @@
 
 #include <rgde/base/singelton.h>
 #include <rgde/io/path.h>
+#include <rgde/io/interned_path.h>
 
 namespace io
 {
@@ -14,12 +15,34 @@ namespace io
 		virtual ~base_file_souce(){}
 
 		virtual int			priority() const = 0;
-		virtual readstream_ptr find(const std::string& file_path) const = 0;
-		virtual bool		is_exist	(const std::string& file_path) const = 0;
+		/// file_path is full normalized path. must be thread safe
+		virtual readstream_ptr find(const interned_path& file_path) const = 0;
+		virtual bool		is_exist	(const interned_path& file_path) const = 0;
+		/// drops cached lookup result for file (call after file was written)
+		virtual void		invalidate(const interned_path& file_path) {}
+
+		/// hot-reload support. sources which can't track changes ignore it
+		virtual bool		enable_watching(const Path& root, bool enable) {return false;}
+		virtual void		poll_changes(std::vector<std::string>& changed) {}
 
 		static file_source_ptr  create_source(const Path& path);
 	};
 
+	/// Receives notifications about modified files (paths relative to root dir).
+	/// Registers itself on construction, so it is safe to use for static objects.
+	class file_change_listener
+	{
+	public:
+		file_change_listener();
+		virtual ~file_change_listener();
+
+		virtual void on_file_changed(const std::string& file_path) = 0;
+
+		/// true if changed file is name given relative to one of search dirs
+		/// (matched by path suffix)
+		static bool is_same_file(const std::string& changed_path, std::string name);
+	};
+
 	class file_system
 	{
 	public:
@@ -27,11 +50,32 @@ namespace io
 		~file_system();
 	
 		const Path&	get_root_dir() const;
+		const interned_path& get_root() const {return m_root;}
 		void		set_root_dir(const Path& path);
 
+		/// sources are expected to be added before loading starts (not thread safe)
 		void		add_file_source(const file_source_ptr& spFileSource);
+
+		/// lookup relative to current root dir (see scope_path, path_add_scoped)
 		readstream_ptr find(const std::string& file_path) const;
 		bool		is_exist	(const std::string& file_path) const;
+		/// file path with current root dir prepended (as used by find)
+		std::string get_full_path(const std::string& file_path) const;
+
+		/// lookup relative to explicit base path. doesn't touch current root dir,
+		/// so it is safe to call from several loading threads
+		readstream_ptr find(const interned_path& base, const std::string& file_path) const;
+		bool		is_exist	(const interned_path& base, const std::string& file_path) const;
+
+		/// drops cached existence of file, must be called after file was created
+		/// or deleted not through file_system
+		void		invalidate_cache(const std::string& full_path);
+
+		/// starts/stops tracking of file changes under root dir
+		void		enable_watching(bool enable);
+		bool		is_watching() const {return m_is_watching;}
+		/// dispatches settled file changes to listeners. does nothing if watching is off
+		void		update();
 
 		static file_system& get();
 
@@ -39,10 +83,13 @@ namespace io
 		typedef std::vector<file_source_ptr> sources_vector;
 		sources_vector m_sources;
 		Path	m_root_path;
+		interned_path m_root;
+		bool	m_is_watching;
 
 		static file_system* ms_instance;
 	};
 
+	/// changes global root dir, use find with explicit base when loading from several threads
 	class scope_path
 	{
 	public:
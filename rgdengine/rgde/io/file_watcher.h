@@ -0,0 +1,40 @@
+#pragma once
+
+namespace io
+{
+	/// Watches directory tree for modified files (used for assets hot-reload).
+	/// Uses inotify on linux, on other platforms watcher is never valid.
+	/// Changes are debounced: file is reported only after it stays untouched
+	/// for debounce_time seconds, so editors saving in several steps
+	/// produce single notification.
+	class file_watcher : boost::noncopyable
+	{
+	public:
+		typedef std::vector<std::string> changes_list;
+
+		explicit file_watcher(const std::string& root_dir, float debounce_time = 0.25f);
+		~file_watcher();
+
+		bool is_valid() const;
+		const std::string& get_root_dir() const {return m_root_dir;}
+
+		/// non blocking. appends paths (relative to root dir, '/' separated)
+		/// of files which changes are settled since last call.
+		void poll(changes_list& changed);
+
+	private:
+		/// created_time > 0 means directory is new and its files are reported as changed
+		void add_watch(const std::string& rel_dir, double created_time);
+		void read_events(double now);
+
+	private:
+		typedef std::map<int, std::string> watch_map;
+		typedef std::map<std::string, double> pending_map;
+
+		std::string m_root_dir;
+		double		m_debounce_time;
+		int			m_handle;
+		watch_map	m_watches;
+		pending_map	m_pending;
+	};
+}
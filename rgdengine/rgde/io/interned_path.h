@@ -0,0 +1,40 @@
+#pragma once
+
+namespace io
+{
+	namespace helpers
+	{
+		/// '/' separators, no empty and "." segments, ".." collapsed where possible,
+		/// no trailing separator: "./Media\\Textures//../a.jpg" -> "Media/a.jpg"
+		std::string normalize_path(const std::string& path);
+
+		/// normalized base + "/" + path
+		std::string join_path(const std::string& base, const std::string& path);
+	}
+
+	/// Immutable normalized path stored once per program in global pool.
+	/// Copying and comparison are pointer operations, so it is cheap to use
+	/// as key of lookup caches. Interning is thread safe, pool is ready before
+	/// static objects are constructed, so they can be interned paths too.
+	class interned_path
+	{
+	public:
+		interned_path();
+		explicit interned_path(const std::string& path);
+
+		const std::string& str() const	{return *m_path;}
+		const char* c_str() const		{return m_path->c_str();}
+		bool empty() const				{return m_path->empty();}
+
+		/// interned normalized this + "/" + path
+		interned_path join(const std::string& path) const;
+
+		bool operator==(const interned_path& p) const {return m_path == p.m_path;}
+		bool operator!=(const interned_path& p) const {return m_path != p.m_path;}
+		/// pool order, not lexicographical
+		bool operator<(const interned_path& p) const {return m_path < p.m_path;}
+
+	private:
+		const std::string* m_path;
+	};
+}
@@ -12,10 +12,11 @@ namespace math
 		typedef math::interpolator<math::vec3f> scale_interpolator;
 
 	public:
-		frame_animation( TiXmlNode* pXmlNode = 0, math::frame_ptr frame = frame_ptr());
+		frame_animation( pugi::xml_node xml_node = pugi::xml_node(), math::frame_ptr frame = frame_ptr());
 		virtual ~frame_animation(){}
 
-		bool load( TiXmlNode* pXmlNode );
+		/// reads "animation" child of xml_node
+		bool load( pugi::xml_node xml_node );
 
 		float weight() const;
 		void  weight(float w);
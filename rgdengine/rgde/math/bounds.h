@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#	define RGDE_BOUNDS_SSE
+#	include <xmmintrin.h>
+#endif
+
+namespace math
+{
+	/// Extends min/max by count points, first one at data, next ones stride bytes
+	/// apart (position member of vertices, at least 3 floats). SSE version keeps
+	/// all three axes in one register and reads 4 floats per point, so the last
+	/// point is read by scalar code and never read past.
+	inline void extend_bounds(const void* data, size_t count, size_t stride, float min[3], float max[3])
+	{
+		const char* p = static_cast<const char*>(data);
+		size_t i = 0;
+
+#ifdef RGDE_BOUNDS_SSE
+		if (count > 1 && stride >= 3 * sizeof(float))
+		{
+			__m128 min0 = _mm_setr_ps(min[0], min[1], min[2], 0);
+			__m128 max0 = _mm_setr_ps(max[0], max[1], max[2], 0);
+			__m128 min1 = min0, max1 = max0;
+
+			// two accumulators, so min/max of next point don't wait for previous one
+			for (; i + 2 < count; i += 2)
+			{
+				const __m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(p + i * stride));
+				const __m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(p + (i + 1) * stride));
+				min0 = _mm_min_ps(min0, a);
+				max0 = _mm_max_ps(max0, a);
+				min1 = _mm_min_ps(min1, b);
+				max1 = _mm_max_ps(max1, b);
+			}
+
+			float result[4];
+			_mm_storeu_ps(result, _mm_min_ps(min0, min1));
+			min[0] = result[0]; min[1] = result[1]; min[2] = result[2];
+			_mm_storeu_ps(result, _mm_max_ps(max0, max1));
+			max[0] = result[0]; max[1] = result[1]; max[2] = result[2];
+		}
+#endif
+
+		for (; i < count; ++i)
+		{
+			const float* point = reinterpret_cast<const float*>(p + i * stride);
+			for (int k = 0; k < 3; ++k)
+			{
+				if (point[k] < min[k]) min[k] = point[k];
+				if (point[k] > max[k]) max[k] = point[k];
+			}
+		}
+	}
+
+	/// min/max of points (see extend_bounds), false if there are none
+	inline bool compute_bounds(const void* data, size_t count, size_t stride, float min[3], float max[3])
+	{
+		if (0 == count)
+			return false;
+
+		const float* first = static_cast<const float*>(data);
+		for (int k = 0; k < 3; ++k)
+			min[k] = max[k] = first[k];
+
+		extend_bounds(static_cast<const char*>(data) + stride, count - 1, stride, min, max);
+		return true;
+	}
+}
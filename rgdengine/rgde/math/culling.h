@@ -0,0 +1,200 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#	define RGDE_CULLING_SSE
+#	include <xmmintrin.h>
+#endif
+
+namespace math
+{
+	/// frustum planes as used by math::frustum: (A,B,C,D), normalized, pointing inside
+	typedef float frustum_planes[6][4];
+
+	/// Bounding spheres in structure of arrays layout, so frustum test
+	/// processes 4 spheres per iteration.
+	struct sphere_soa
+	{
+		std::vector<float> x, y, z, r;
+
+		size_t size() const {return x.size();}
+
+		void clear()
+		{
+			x.resize(0); y.resize(0); z.resize(0); r.resize(0);
+		}
+
+		void reserve(size_t num)
+		{
+			x.reserve(num); y.reserve(num); z.reserve(num); r.reserve(num);
+		}
+
+		void add(float cx, float cy, float cz, float radius)
+		{
+			x.push_back(cx); y.push_back(cy); z.push_back(cz); r.push_back(radius);
+		}
+
+		/// sphere which passes any frustum test (objects without bounds).
+		/// max is in parentheses because of windows.h macro
+		void add_infinite()
+		{
+			add(0, 0, 0, (std::numeric_limits<float>::max)());
+		}
+	};
+
+	/// Axis aligned boxes (center, half size) in structure of arrays layout.
+	struct box_soa
+	{
+		std::vector<float> x, y, z;
+		std::vector<float> ex, ey, ez;
+
+		size_t size() const {return x.size();}
+
+		void clear()
+		{
+			x.resize(0); y.resize(0); z.resize(0);
+			ex.resize(0); ey.resize(0); ez.resize(0);
+		}
+
+		void reserve(size_t num)
+		{
+			x.reserve(num); y.reserve(num); z.reserve(num);
+			ex.reserve(num); ey.reserve(num); ez.reserve(num);
+		}
+
+		void add(float cx, float cy, float cz, float hx, float hy, float hz)
+		{
+			x.push_back(cx); y.push_back(cy); z.push_back(cz);
+			ex.push_back(hx); ey.push_back(hy); ez.push_back(hz);
+		}
+	};
+
+	/// visible[i] = 1 if sphere i intersects frustum, 0 otherwise.
+	/// returns number of visible spheres. same result as frustum::test_sphere
+	inline unsigned cull_spheres(const frustum_planes& planes, const sphere_soa& spheres, std::vector<unsigned char>& visible)
+	{
+		const size_t num = spheres.size();
+		visible.resize(num);
+		if (0 == num)
+			return 0;
+
+		unsigned num_visible = 0;
+		size_t i = 0;
+
+#ifdef RGDE_CULLING_SSE
+		const float* px = &spheres.x[0];
+		const float* py = &spheres.y[0];
+		const float* pz = &spheres.z[0];
+		const float* pr = &spheres.r[0];
+
+		for (; i + 4 <= num; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(px + i);
+			__m128 y = _mm_loadu_ps(py + i);
+			__m128 z = _mm_loadu_ps(pz + i);
+			__m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(pr + i));
+
+			// lane stays set while sphere is not behind any plane
+			__m128 inside = _mm_cmpeq_ps(x, x);
+			for (int p = 0; p < 6; ++p)
+			{
+				__m128 d = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p][0])), _mm_mul_ps(y, _mm_set1_ps(planes[p][1]))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(planes[p][2])), _mm_set1_ps(planes[p][3])));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(d, neg_r));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			visible[i + 0] = (unsigned char)( mask       & 1);
+			visible[i + 1] = (unsigned char)((mask >> 1) & 1);
+			visible[i + 2] = (unsigned char)((mask >> 2) & 1);
+			visible[i + 3] = (unsigned char)((mask >> 3) & 1);
+			num_visible += visible[i] + visible[i + 1] + visible[i + 2] + visible[i + 3];
+		}
+#endif
+
+		for (; i < num; ++i)
+		{
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p)
+			{
+				float d = planes[p][0] * spheres.x[i] + planes[p][1] * spheres.y[i] +
+						  planes[p][2] * spheres.z[i] + planes[p][3];
+				inside = d > -spheres.r[i];
+			}
+			visible[i] = inside ? 1 : 0;
+			num_visible += visible[i];
+		}
+
+		return num_visible;
+	}
+
+	/// visible[i] = 1 if box i intersects (or conservatively may intersect) frustum.
+	/// returns number of visible boxes
+	inline unsigned cull_boxes(const frustum_planes& planes, const box_soa& boxes, std::vector<unsigned char>& visible)
+	{
+		const size_t num = boxes.size();
+		visible.resize(num);
+		if (0 == num)
+			return 0;
+
+		// projected box radius on plane normal uses |normal|
+		float abs_planes[6][3];
+		for (int p = 0; p < 6; ++p)
+			for (int c = 0; c < 3; ++c)
+				abs_planes[p][c] = planes[p][c] < 0 ? -planes[p][c] : planes[p][c];
+
+		unsigned num_visible = 0;
+		size_t i = 0;
+
+#ifdef RGDE_CULLING_SSE
+		for (; i + 4 <= num; i += 4)
+		{
+			__m128 x  = _mm_loadu_ps(&boxes.x[i]);
+			__m128 y  = _mm_loadu_ps(&boxes.y[i]);
+			__m128 z  = _mm_loadu_ps(&boxes.z[i]);
+			__m128 ex = _mm_loadu_ps(&boxes.ex[i]);
+			__m128 ey = _mm_loadu_ps(&boxes.ey[i]);
+			__m128 ez = _mm_loadu_ps(&boxes.ez[i]);
+
+			__m128 inside = _mm_cmpeq_ps(x, x);
+			for (int p = 0; p < 6; ++p)
+			{
+				__m128 d = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p][0])), _mm_mul_ps(y, _mm_set1_ps(planes[p][1]))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(planes[p][2])), _mm_set1_ps(planes[p][3])));
+				__m128 r = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(abs_planes[p][0])), _mm_mul_ps(ey, _mm_set1_ps(abs_planes[p][1]))),
+					_mm_mul_ps(ez, _mm_set1_ps(abs_planes[p][2])));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			visible[i + 0] = (unsigned char)( mask       & 1);
+			visible[i + 1] = (unsigned char)((mask >> 1) & 1);
+			visible[i + 2] = (unsigned char)((mask >> 2) & 1);
+			visible[i + 3] = (unsigned char)((mask >> 3) & 1);
+			num_visible += visible[i] + visible[i + 1] + visible[i + 2] + visible[i + 3];
+		}
+#endif
+
+		for (; i < num; ++i)
+		{
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p)
+			{
+				float d = planes[p][0] * boxes.x[i] + planes[p][1] * boxes.y[i] +
+						  planes[p][2] * boxes.z[i] + planes[p][3];
+				float r = abs_planes[p][0] * boxes.ex[i] + abs_planes[p][1] * boxes.ey[i] +
+						  abs_planes[p][2] * boxes.ez[i];
+				inside = d + r > 0;
+			}
+			visible[i] = inside ? 1 : 0;
+			num_visible += visible[i];
+		}
+
+		return num_visible;
+	}
+}
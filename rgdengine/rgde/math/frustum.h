@@ -1,5 +1,7 @@
 #pragma once
 
+#include <rgde/math/culling.h>
+
 namespace math
 {
 	class base_camera;
@@ -20,6 +22,9 @@ namespace math
 		/// This takes the center and half the length of the cube.
 		bool test_box( float x, float y, float z, float size ) const;
 
+		/// planes for batched tests (see cull_spheres, cull_boxes)
+		const frustum_planes& planes() const {return m_Frustum;}
+
 	private:
 		/// This holds the A B C and D values for each side of our frustum.
 		float m_Frustum[6][4];
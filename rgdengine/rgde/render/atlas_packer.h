@@ -0,0 +1,225 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+namespace render
+{
+	/// place of source image in texture atlas, uv of source maps to
+	/// offset + uv * scale in atlas page
+	struct atlas_region
+	{
+		unsigned	page;
+		/// page texture, used as sort key by sprite batching
+		const void* page_texture;
+		float		offset[2];
+		float		scale[2];
+	};
+
+	/// Skyline bottom-left rectangle packer of one atlas page. Top edge of packed
+	/// area is kept as list of horizontal segments, rectangle is put where its top
+	/// is lowest, ties are broken by narrowest segment (less wasted space).
+	/// Independent from render device, so it can be tested without D3D.
+	class skyline_packer
+	{
+	public:
+		skyline_packer(unsigned width = 0, unsigned height = 0)
+		{
+			reset(width, height);
+		}
+
+		void reset(unsigned width, unsigned height)
+		{
+			m_width = width;
+			m_height = height;
+			m_used = 0;
+			m_nodes.clear();
+			node n = {0, 0, width};
+			m_nodes.push_back(n);
+		}
+
+		unsigned get_width() const {return m_width;}
+		unsigned get_height() const {return m_height;}
+		/// part of page area taken by packed rectangles
+		float occupancy() const
+		{
+			return m_width && m_height ? (float)((double)m_used / ((double)m_width * m_height)) : 0;
+		}
+
+		/// returns false if rectangle doesn't fit
+		bool insert(unsigned width, unsigned height, unsigned& x, unsigned& y)
+		{
+			if (0 == width || 0 == height)
+				return false;
+
+			size_t best = m_nodes.size();
+			unsigned best_top = ~0u, best_width = ~0u, best_y = 0;
+
+			for (size_t i = 0; i < m_nodes.size(); ++i)
+			{
+				unsigned top;
+				if (!fit(i, width, height, top))
+					continue;
+
+				if (top + height < best_top || (top + height == best_top && m_nodes[i].width < best_width))
+				{
+					best = i;
+					best_top = top + height;
+					best_width = m_nodes[i].width;
+					best_y = top;
+				}
+			}
+
+			if (best == m_nodes.size())
+				return false;
+
+			x = m_nodes[best].x;
+			y = best_y;
+			add(best, x, y + height, width);
+			m_used += (unsigned long long)width * height;
+			return true;
+		}
+
+	private:
+		struct node
+		{
+			unsigned x, y, width;
+		};
+
+		/// rectangle with left edge at node i lies on top of highest node under it
+		bool fit(size_t i, unsigned width, unsigned height, unsigned& top) const
+		{
+			if (m_nodes[i].x + width > m_width)
+				return false;
+
+			top = 0;
+			unsigned left = width;
+			for (size_t j = i; left > 0; ++j)
+			{
+				if (j == m_nodes.size())
+					return false;
+
+				top = (std::max)(top, m_nodes[j].y);
+				if (top + height > m_height)
+					return false;
+
+				left -= (std::min)(left, m_nodes[j].width);
+			}
+			return true;
+		}
+
+		/// new segment covers nodes under rectangle, neighbours of equal height are merged
+		void add(size_t i, unsigned x, unsigned y, unsigned width)
+		{
+			node n = {x, y, width};
+			m_nodes.insert(m_nodes.begin() + i, n);
+
+			for (size_t j = i + 1; j < m_nodes.size();)
+			{
+				const unsigned end = x + width;
+				if (m_nodes[j].x >= end)
+					break;
+
+				const unsigned shrink = end - m_nodes[j].x;
+				if (m_nodes[j].width <= shrink)
+				{
+					m_nodes.erase(m_nodes.begin() + j);
+					continue;
+				}
+
+				m_nodes[j].x += shrink;
+				m_nodes[j].width -= shrink;
+				break;
+			}
+
+			for (size_t j = 0; j + 1 < m_nodes.size();)
+			{
+				if (m_nodes[j].y == m_nodes[j + 1].y)
+				{
+					m_nodes[j].width += m_nodes[j + 1].width;
+					m_nodes.erase(m_nodes.begin() + j + 1);
+				}
+				else
+					++j;
+			}
+		}
+
+	private:
+		std::vector<node>	m_nodes;
+		unsigned			m_width;
+		unsigned			m_height;
+		unsigned long long	m_used;
+	};
+
+	/// position of image packed by pack_atlas, page is ~0 if image is bigger than page
+	struct atlas_place
+	{
+		unsigned page;
+		unsigned x, y;
+	};
+
+	namespace atlas_detail
+	{
+		struct size_less
+		{
+			const std::vector<std::pair<unsigned, unsigned> >* sizes;
+
+			/// higher first, then wider, then by index to keep result stable
+			bool operator()(unsigned a, unsigned b) const
+			{
+				const std::pair<unsigned, unsigned>& sa = (*sizes)[a];
+				const std::pair<unsigned, unsigned>& sb = (*sizes)[b];
+				if (sa.second != sb.second)
+					return sa.second > sb.second;
+				if (sa.first != sb.first)
+					return sa.first > sb.first;
+				return a < b;
+			}
+		};
+	}
+
+	/// Packs all images (width, height) at once, which packs tighter than adding them
+	/// one by one: images are sorted by height and put into first page they fit.
+	/// padding is kept around every image against filtering bleed.
+	/// returns number of pages
+	inline unsigned pack_atlas(const std::vector<std::pair<unsigned, unsigned> >& sizes, unsigned page_width,
+							   unsigned page_height, unsigned padding, std::vector<atlas_place>& places)
+	{
+		std::vector<unsigned> order(sizes.size());
+		for (size_t i = 0; i < order.size(); ++i)
+			order[i] = (unsigned)i;
+
+		atlas_detail::size_less less = {&sizes};
+		std::sort(order.begin(), order.end(), less);
+
+		std::vector<skyline_packer> pages;
+		places.resize(sizes.size());
+
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			const unsigned index = order[i];
+			const unsigned width = sizes[index].first + padding * 2;
+			const unsigned height = sizes[index].second + padding * 2;
+
+			atlas_place& place = places[index];
+			place.page = ~0u;
+			if (width > page_width || height > page_height)
+				continue;
+
+			for (size_t p = 0; p <= pages.size() && place.page == ~0u; ++p)
+			{
+				if (p == pages.size())
+					pages.push_back(skyline_packer(page_width, page_height));
+
+				if (pages[p].insert(width, height, place.x, place.y))
+				{
+					place.page = (unsigned)p;
+					place.x += padding;
+					place.y += padding;
+				}
+			}
+		}
+
+		return (unsigned)pages.size();
+	}
+}
@@ -197,15 +197,7 @@ namespace render
 
 		effect::parameter* get_param(const std::string& name) const
 		{
-			const effect::params_map& params = m_effect->get_params();
-			effect::params_map::const_iterator it = params.find(name);
-
-			effect::parameter* result = NULL;
-
-			if(it != params.end())
-				result = it->second;
-
-			return result;
+			return m_effect->get_param(effect::get_param_id(name));
 		}
 
 		void addFunctor(const Functor& f)
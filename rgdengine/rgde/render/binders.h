@@ -15,10 +15,15 @@ namespace render
 {
 	class material;
 	typedef boost::shared_ptr<class effect> effect_ptr;
+	struct object_transforms;
 
 	dynamic_binder_ptr createDynamicBinder(const effect_ptr& effect,
 										   const material& mat,
 										   std::string& techniqueName);
 
 	static_binder_ptr createStaticBinder(const effect_ptr& effect);
+
+	/// camera dependent matrices of frame which is bound next, dynamic binders
+	/// read them instead of computing (see transform_cache). pass 0 to reset
+	void setObjectTransforms(const math::frame* frame, const object_transforms* transforms);
 }
\ No newline at end of file
@@ -117,6 +117,11 @@ namespace render
 		typedef std::map <std::string, parameter*> params_map;
 		typedef std::list <technique*> techniques_list;
 
+		/// interned parameter semantic, same for all effects.
+		/// resolve once and use get_param(id) instead of get_params()[name]
+		typedef unsigned param_id;
+		static param_id get_param_id(const std::string& semantic);
+
 		friend effect_ptr;
 	protected:
 		virtual bool load(const std::string& filename) = 0;
@@ -128,11 +133,14 @@ namespace render
 
 		///////////////////////////////////////////////////
 
+		/// uploads changed parameter values, pass begin does it too
 		virtual void commit_changes() = 0;
 		virtual void onLostDevice() = 0;
 		virtual void onResetDevice() = 0;
 		virtual const std::string& name() const= 0;
 		virtual params_map& get_params() = 0;
+		/// parameter with given id or NULL, array lookup
+		virtual parameter* get_param(param_id id) = 0;
 		virtual techniques_list& get_technics() = 0;
 		virtual technique* find_technique(const std::string& name) = 0;
 	};
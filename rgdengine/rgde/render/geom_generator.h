@@ -1,9 +1,126 @@
 #pragma once
 
+#include <map>
+
 #include <rgde/render/geometry.h>
+#include <rgde/render/transform_cache.h>
 
 namespace render
 {
+	/// Generated shape with its parameters (arguments of Generator::CreateXXX),
+	/// key of shared geometries cache and element of generated batches
+	struct shape
+	{
+		enum type
+		{
+			box,
+			grid,
+			cylinder,
+			cone,
+			sphere,
+			hemis,
+			torus,
+			octa,
+			tetra
+		};
+
+		enum {max_params = 7};
+
+		type	kind;
+		float	params[max_params];
+
+		explicit shape(type t) : kind(t)
+		{
+			std::fill(params, params + max_params, 0.0f);
+		}
+
+		static shape make_box(const math::vec3f& size = math::vec3f(1.0f, 1.0f, 1.0f), const math::vec3f& center = math::vec3f(0, 0, 0))
+		{
+			shape s(box);
+			s.set_vec(0, size);
+			s.set_vec(3, center);
+			return s;
+		}
+
+		static shape make_grid(int x_resolution, int z_resolution, float x_scale = 1.0f, float z_scale = 1.0f,
+							   const math::vec3f& center = math::vec3f(0, 0, 0))
+		{
+			shape s(grid);
+			s.params[0] = (float)x_resolution;
+			s.params[1] = (float)z_resolution;
+			s.params[2] = x_scale;
+			s.params[3] = z_scale;
+			s.set_vec(4, center);
+			return s;
+		}
+
+		static shape make_cylinder(int radial_segments = 16, int height_segments = 16, float radius = 1.0f, float height = 1.0f,
+								   const math::vec3f& center = math::vec3f(0, 0, 0))
+		{
+			shape s(cylinder);
+			s.params[0] = (float)radial_segments;
+			s.params[1] = (float)height_segments;
+			s.params[2] = radius;
+			s.params[3] = height;
+			s.set_vec(4, center);
+			return s;
+		}
+
+		static shape make_cone(int steps)
+		{
+			shape s(cone);
+			s.params[0] = (float)steps;
+			return s;
+		}
+
+		static shape make_sphere(int steps_lng, int steps_lat)
+		{
+			shape s(sphere);
+			s.params[0] = (float)steps_lng;
+			s.params[1] = (float)steps_lat;
+			return s;
+		}
+
+		static shape make_hemis(int steps_lng, int steps_lat)
+		{
+			shape s(hemis);
+			s.params[0] = (float)steps_lng;
+			s.params[1] = (float)steps_lat;
+			return s;
+		}
+
+		static shape make_torus(float radius_major, float radius_minor, int steps_major, int steps_minor)
+		{
+			shape s(torus);
+			s.params[0] = radius_major;
+			s.params[1] = radius_minor;
+			s.params[2] = (float)steps_major;
+			s.params[3] = (float)steps_minor;
+			return s;
+		}
+
+		static shape make_octa()	{return shape(octa);}
+		static shape make_tetra()	{return shape(tetra);}
+
+		int get_int(int i) const				{return (int)params[i];}
+		math::vec3f get_vec(int first) const	{return math::vec3f(params[first], params[first + 1], params[first + 2]);}
+
+		bool operator<(const shape& s) const
+		{
+			if (kind != s.kind)
+				return kind < s.kind;
+			return std::lexicographical_compare(params, params + max_params, s.params, s.params + max_params);
+		}
+
+	private:
+		void set_vec(int first, const math::vec3f& v)
+		{
+			params[first] = v[0];
+			params[first + 1] = v[1];
+			params[first + 2] = v[2];
+		}
+	};
+
 	template<class Vertex, bool Use32Indexes = false>
 	class Generator
 	{
@@ -123,9 +240,7 @@ namespace render
 			setFace(indices, 10, 5, 4, 7);
 			setFace(indices, 11, 7, 6, 5);
 
-			pResult->unlock_vb();
-			pResult->unlock_ib();
-			pResult->getBBox();//To rebuild BBox and BSphere
+			optimize(pResult);
 
 			return pResult;
 		}
@@ -137,6 +252,7 @@ namespace render
 			geometry_ptr pResult(new geometry);
 
 			GenerateGrid(pResult, nXResolution, nZResolution, fXScale, fZScale, CenterPos);
+			optimize(pResult);
 
 			return pResult;
 		}
@@ -144,16 +260,18 @@ namespace render
 		static geometry_ptr CreateCylinder(int nRadialSegments = 16, int nHeightSegments = 16, float fRadius = 1.0f, float fHeight = 1.0f,
 										const math::vec3f& CenterPosition = math::vec3f(0.0f, 0.0f, 0.0f))
 		{
-			geometry_ptr pResult = CreateGrid(nRadialSegments + 1, 3 + nHeightSegments);
+			geometry_ptr pResult(new geometry);
 
 			GenerateCylinder(pResult, nRadialSegments, nHeightSegments, fRadius, fHeight, CenterPosition);
+			optimize(pResult);
 
 			return pResult;
 		}
 		
 		static geometry_ptr CreateCone(int nStep)
 		{
-			geometry_ptr pResult = CreateGrid(nStep + 1, 3);
+			geometry_ptr pResult(new geometry);
+			GenerateGrid(pResult, nStep + 1, 3);
 
 			geometry::vertexies& vertices = pResult->lock_vb();
 			geometry::indexies&  indices  = pResult->lock_ib();
@@ -167,16 +285,15 @@ namespace render
 				vertices[nVertCnt++].position = math::vec3f(0, 0, 0);
 			}
 
-			pResult->unlock_vb();
-			pResult->unlock_ib();
-			pResult->getBBox();
+			optimize(pResult);
 
 			return pResult;
 		}
 
 		static geometry_ptr CreateSphere(int nStepLng, int nStepLat)
 		{
-			geometry_ptr pResult = CreateGrid(nStepLng + 1, (nStepLat/2) + 1);
+			geometry_ptr pResult(new geometry);
+			GenerateGrid(pResult, nStepLng + 1, (nStepLat/2) + 1);
 
 			geometry::vertexies& vertices = pResult->lock_vb();
 			geometry::indexies&  indices  = pResult->lock_ib();
@@ -188,16 +305,15 @@ namespace render
 				for(int j = 0; j < (nStepLat/2) + 1; j++)
 					vertices[nVertCnt++].position = math::makeRot<math::Matrix33f>(math::AxisAnglef(i*fUnitLng, 0, 1, 0))*math::makeRot<math::Matrix33f>(math::AxisAnglef(j*fUnitLat, 1, 0, 0))*math::vec3f(0, 1, 0);
 
-			pResult->unlock_vb();
-			pResult->unlock_ib();
-			pResult->getBBox();
+			optimize(pResult);
 
 			return pResult;
 		}
 
 		static geometry_ptr CreateHemis(int nStepLng, int nStepLat)
 		{
-			geometry_ptr pResult = CreateGrid(nStepLng + 1, (nStepLat/4) + 2);
+			geometry_ptr pResult(new geometry);
+			GenerateGrid(pResult, nStepLng + 1, (nStepLat/4) + 2);
 
 			geometry::vertexies& vertices = pResult->lock_vb();
 			geometry::indexies&  indices  = pResult->lock_ib();
@@ -213,16 +329,15 @@ namespace render
 				vertices[nVertCnt++].position = math::vec3f(0, 0, 0);
 			}
 
-			pResult->unlock_vb();
-			pResult->unlock_ib();
-			pResult->getBBox();
+			optimize(pResult);
 
 			return pResult;
 		}
 
 		static geometry_ptr CreateTorus(float fRadMajor, float fRadMinor, int nStepMajor, int nStepMinor)
 		{
-			geometry_ptr pResult = CreateGrid(nStepMajor + 1, nStepMinor + 1);
+			geometry_ptr pResult(new geometry);
+			GenerateGrid(pResult, nStepMajor + 1, nStepMinor + 1);
 
 			geometry::vertexies& vertices = pResult->lock_vb();
 			geometry::indexies&  indices  = pResult->lock_ib();
@@ -237,9 +352,7 @@ namespace render
 													math::makeRot<math::Matrix33f>(math::AxisAnglef(j*fUnitMinor, 1, 0, 0))*
 													math::vec3f(0, fRadMinor, 0);
 
-			pResult->unlock_vb();
-			pResult->unlock_ib();
-			pResult->getBBox();
+			optimize(pResult);
 
 			return pResult;
 		}
@@ -270,9 +383,7 @@ namespace render
 			setFace(indices, 6, 2, 5, 3);
 			setFace(indices, 7, 3, 5, 0);
 
-			pResult->unlock_vb();
-			pResult->unlock_ib();
-			pResult->getBBox();
+			optimize(pResult);
 
 			return pResult;
 		}
@@ -297,15 +408,173 @@ namespace render
 			setFace(indices, 2, 0, 3, 2);
 			setFace(indices, 3, 1, 2, 3);
 
-			pResult->unlock_vb();
-			pResult->unlock_ib();
-			pResult->getBBox();
+			optimize(pResult);
 
 			return pResult;
 		}
 
+		/// new geometry of shape
+		static geometry_ptr Create(const shape& s)
+		{
+			switch (s.kind)
+			{
+			case shape::box:		return CreateBox(s.get_vec(0), s.get_vec(3));
+			case shape::grid:		return CreateGrid(s.get_int(0), s.get_int(1), s.params[2], s.params[3], s.get_vec(4));
+			case shape::cylinder:	return CreateCylinder(s.get_int(0), s.get_int(1), s.params[2], s.params[3], s.get_vec(4));
+			case shape::cone:		return CreateCone(s.get_int(0));
+			case shape::sphere:		return CreateSphere(s.get_int(0), s.get_int(1));
+			case shape::hemis:		return CreateHemis(s.get_int(0), s.get_int(1));
+			case shape::torus:		return CreateTorus(s.params[0], s.params[1], s.get_int(2), s.get_int(3));
+			case shape::octa:		return CreateOcta();
+			default:				return CreateTetra();
+			}
+		}
+
+		/// geometry of shape shared by all users of the same shape and parameters,
+		/// it lives while someone holds it and must not be changed
+		static geometry_ptr GetShared(const shape& s)
+		{
+			typedef std::map<shape, boost::weak_ptr<geometry> > geometry_cache;
+			static geometry_cache cache;
+
+			geometry_ptr g = cache[s].lock();
+			if (!g)
+			{
+				g = Create(s);
+				cache[s] = g;
+			}
+			return g;
+		}
+
+		/// Several shapes, each with own transformation, in one vertex and index
+		/// buffer. Indices are rebased into the whole buffer, so all shapes are
+		/// drawn by one call, and every shape keeps own range to be drawn alone.
+		class batch
+		{
+		public:
+			/// part of buffers made by one shape
+			struct range
+			{
+				unsigned first_vertex;
+				unsigned num_vertices;
+				unsigned first_index;
+				unsigned num_triangles;
+			};
+
+			batch() : m_geometry(new geometry), m_built_vertices(0), m_changed(false) {}
+
+			/// appends transformed shape (normals are transformed by inverse transpose
+			/// of transform, so they stay perpendicular under non-uniform scale, and
+			/// renormalized). returns index of its range, -1 if the batch can't
+			/// address more vertices with its index size
+			int add(const shape& s, const math::matrix44f& transform)
+			{
+				const geometry_ptr source = GetShared(s);
+				const typename geometry::vertexies& src_vb = source->getVB();
+				const typename geometry::indexies& src_ib = source->getIB();
+
+				typename geometry::vertexies& vb = m_geometry->lock_vb();
+				typename geometry::indexies& ib = m_geometry->lock_ib();
+
+				const size_t max_index = (typename geometry::indexies::value_type)(-1);
+				if (!src_vb.empty() && vb.size() + src_vb.size() - 1 > max_index)
+					return -1;
+
+				range r;
+				r.first_vertex = (unsigned)vb.size();
+				r.num_vertices = (unsigned)src_vb.size();
+				r.first_index = (unsigned)ib.size();
+				r.num_triangles = (unsigned)src_ib.size() / 3;
+
+				// element (row, col) is at col * 4 + row
+				float it[16];
+				transform_cache::inverse_transpose(transform.getData(), it);
+
+				for (size_t i = 0; i < src_vb.size(); ++i)
+				{
+					Vertex v = src_vb[i];
+					const math::point3f p = transform * math::point3f(v.position[0], v.position[1], v.position[2]);
+					const float* s = v.normal.getData();
+					math::vec3f n(it[0] * s[0] + it[4] * s[1] + it[8] * s[2],
+								  it[1] * s[0] + it[5] * s[1] + it[9] * s[2],
+								  it[2] * s[0] + it[6] * s[1] + it[10] * s[2]);
+					if (math::lengthSquared(n) > 0)
+						math::normalize(n);
+
+					v.position = math::vec3f(p[0], p[1], p[2]);
+					v.normal = n;
+					vb.push_back(v);
+				}
+
+				for (size_t i = 0; i < src_ib.size(); ++i)
+					ib.push_back((typename geometry::indexies::value_type)(src_ib[i] + r.first_vertex));
+
+				m_ranges.push_back(r);
+				m_changed = true;
+				return (int)m_ranges.size() - 1;
+			}
+
+			/// uploads shapes added since last build, is called by render if needed
+			void build()
+			{
+				if (!m_changed || m_ranges.empty())
+					return;
+
+				m_geometry->unlock_vb_appended(m_built_vertices);
+				m_geometry->unlock_ib();
+				m_built_vertices = m_geometry->get_num_verts();
+				m_changed = false;
+			}
+
+			void clear()
+			{
+				m_geometry->lock_vb().resize(0);
+				m_geometry->lock_ib().resize(0);
+				m_ranges.resize(0);
+				m_built_vertices = 0;
+				m_changed = true;
+			}
+
+			/// all shapes by one draw call
+			void render()
+			{
+				build();
+				if (!m_ranges.empty())
+					m_geometry->render(TriangleList, (unsigned)m_geometry->getIndexNum() / 3);
+			}
+
+			/// one shape of batch
+			void render(int index)
+			{
+				build();
+				const range& r = m_ranges[index];
+				m_geometry->render(TriangleList, 0, r.first_vertex, r.num_vertices, r.first_index, r.num_triangles);
+			}
+
+			size_t size() const								{return m_ranges.size();}
+			const range& get_range(int index) const			{return m_ranges[index];}
+			const geometry_ptr& get_geometry() const		{return m_geometry;}
+
+		private:
+			geometry_ptr		m_geometry;
+			std::vector<range>	m_ranges;
+			/// vertices uploaded by last build, the next ones are appended
+			int					m_built_vertices;
+			bool				m_changed;
+		};
 
 		private:
+			/// generated vertices are written by grid position, so meshes are
+			/// optimized (see optimizer::optimize) only when they are complete
+			static void optimize(geometry_ptr pGeometry)
+			{
+				optimizer::optimize(pGeometry->lock_vb(), pGeometry->lock_ib());
+
+				pGeometry->unlock_vb();
+				pGeometry->unlock_ib();
+				pGeometry->getBBox();
+			}
+
 			static void setFace(typename geometry::indexies& array, unsigned face_number, unsigned i1, unsigned i2, unsigned i3)
 			{
 				array[face_number*3 + 0] = i1;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <rgde/render/vertices.h>
+#include <rgde/render/mesh_converter.h>
 
 namespace render
 {
@@ -25,6 +26,71 @@ namespace render
 		virtual void render(primitive_type ePrimType, unsigned int nPrimNum) = 0;		
 	};
 
+	/// Bounds of geometry vertices, computed when they are requested after vertices
+	/// have changed. Vertices appended to already bounded ones (see invalidate_from)
+	/// only extend the box, so append-only dynamic buffers don't scan old vertices again
+	class lazy_bounds
+	{
+	public:
+		lazy_bounds() : m_bounded(0), m_valid(true) {}
+
+		/// all vertices have changed
+		void invalidate()
+		{
+			m_bounded = 0;
+			m_valid = false;
+		}
+
+		/// vertices before first are the same as when bounds were computed
+		void invalidate_from(size_t first)
+		{
+			if (first < m_bounded)
+				m_bounded = first;
+			m_valid = false;
+		}
+
+		/// precomputed bounds of count vertices (mesh caches)
+		void set(const math::aaboxf& bbox, const math::spheref& bsphere, size_t count)
+		{
+			m_bbox = bbox;
+			m_bsphere = bsphere;
+			m_bounded = count;
+			m_valid = true;
+		}
+
+		template<typename VertexType>
+		void update(const std::vector<VertexType>& vb)
+		{
+			if (m_valid && m_bounded == vb.size())
+				return;
+
+			if (0 == m_bounded || m_bounded > vb.size() || m_bbox.isEmpty())
+			{
+				calcBVolumes(vb, m_bbox, m_bsphere);
+			}
+			else if (m_bounded < vb.size())
+			{
+				math::point3f min = m_bbox.getMin(), max = m_bbox.getMax();
+				math::extend_bounds(&vb[m_bounded].position[0], vb.size() - m_bounded, sizeof(VertexType), min.getData(), max.getData());
+				m_bbox = math::aaboxf(min, max);
+				calcBSphere(m_bbox, m_bsphere);
+			}
+
+			m_bounded = vb.size();
+			m_valid = true;
+		}
+
+		const math::aaboxf& bbox() const		{ return m_bbox; }
+		const math::spheref& bsphere() const	{ return m_bsphere; }
+
+	private:
+		math::aaboxf	m_bbox;
+		math::spheref	m_bsphere;
+		/// leading vertices bounded by m_bbox
+		size_t			m_bounded;
+		bool			m_valid;
+	};
+
     template<class Vertex>
 	class geometry
 	{
@@ -35,7 +101,6 @@ namespace render
 			m_spImpl(base_geometry::create(Vertex::get_decl(), is_dynamic)),
 			m_bIsDynamic(is_dynamic)
 		{			
-			m_bChanged = false;
 		}
 
 		bool is_dynamic() const {return m_bIsDynamic;}
@@ -121,54 +186,47 @@ namespace render
 
 		void unlock()
 		{
-			const size_t nVertexSize = sizeof(Vertex);
-			const size_t nSize = m_vVertexes.size() * nVertexSize;
-			m_spImpl->update(&m_vVertexes[0], nSize, nVertexSize);
-			m_bChanged = true;
+			upload();
+			m_bounds.invalidate();
 		}
 
-		const math::aaboxf& getBBox()
+		/// vertices before first are unchanged since previous unlock (only appended),
+		/// bounds are extended by the new ones
+		void unlock_appended(size_t first)
 		{
-			if ( m_bChanged )
-			{
+			upload();
+			m_bounds.invalidate_from(first);
+		}
 
-				for ( int i = 0; i < m_vVertexes.size(); ++i )
-				{
-					math::point3f point = m_vVertexes[ i ].position ;
-					math::extendVolume( m_AABB, point );
-				}
-				math::vec3f cent = (m_AABB.getMin()+m_AABB.getMax())*0.5f;
-				m_Sphere.setCenter( cent );
-				m_Sphere.setRadius( math::length( cent ) );
-				m_bChanged = false;
-			}
-			return m_AABB;
+		/// bounds are computed on first request after vertices have changed
+		const math::aaboxf& getBBox() const
+		{
+			m_bounds.update(m_vVertexes);
+			return m_bounds.bbox();
 		}
 
-		const math::spheref& getBSphere()
+		const math::spheref& getBSphere() const
 		{
-			if ( m_bChanged )
-			{
-				for ( int i = 0; i < m_vVertexes.size(); ++i )
-				{
-					math::point3f point = m_vVertexes[ i ].position ;
-					math::extendVolume( m_AABB, point );
-				}
-				math::vec3f cent = (m_AABB.getMin()+m_AABB.getMax())*0.5f;
-				m_Sphere.setCenter( cent );
-				m_Sphere.setRadius( math::length( cent ) );
-				m_bChanged = false;
-			}
-			return m_Sphere;
+			m_bounds.update(m_vVertexes);
+			return m_bounds.bsphere();
+		}
+
+	private:
+		void upload()
+		{
+			if (m_vVertexes.empty())
+				return;
+
+			const size_t nVertexSize = sizeof(Vertex);
+			const size_t nSize = m_vVertexes.size() * nVertexSize;
+			m_spImpl->update(&m_vVertexes[0], nSize, nVertexSize);
 		}
 
 	private:
 		bool						m_bIsDynamic;
 		vertexies					m_vVertexes;
 		std::auto_ptr<base_geometry>	m_spImpl;
-		math::aaboxf				m_AABB;
-		math::spheref				m_Sphere;
-		bool						m_bChanged;
+		mutable lazy_bounds			m_bounds;
 	};
 
 
@@ -183,134 +241,53 @@ namespace render
 		virtual void render(primitive_type ePrimType, unsigned nBaseVertexIndex, 
 							unsigned min_index, unsigned nNumVertices, 
 							unsigned nStartIndex, unsigned nPrimitiveCount) = 0;
+		/// draws whole buffers count times, instances (count elements of stride bytes)
+		/// are passed in vertex stream 1 as TEXCOORD4.. (see render::instance_data).
+		/// needs vertex shader 3.0 device
+		virtual void render_instanced(primitive_type ePrimType, unsigned nNumVertices, unsigned nPrimitiveCount,
+									  const void* instances, unsigned stride, unsigned count) = 0;
+		/// following updateVB data is in packed format decl (vertex::PackedMeshVertex), 
+		/// geometry draws it with own decoding vertex shader: position = bias + position * scale.
+		/// decl == 0 returns to vertex format geometry was created with.
+		/// returns false if device can't decode packed vertices.
+		/// decoder works only for fixed function passes: render doesn't draw packed
+		/// vertices while vertex shader is set (see has_vertex_shader)
+		virtual bool set_packing(const vertex::vertex_decl decl, const float scale[3], const float bias[3]) = 0;
+		/// vertex shader is set on device (by current effect pass),
+		/// packed vertices can't be drawn with it
+		virtual bool has_vertex_shader() const = 0;
+		/// indices are taken from static buffer shared by all geometries:
+		/// 0 1 2, 0 2 3 of every 4 vertices, up to 0x10000 vertices.
+		/// own index buffer is released and updateIB is ignored
+		virtual void use_quad_indices() = 0;
 	};
 
-	template<class Vertex, bool Use32Indexes>
-	class indexed_geometry
+	/// packed format of vertex in mesh caches (see MeshConverter), only MeshVertex has one
+	template<class Vertex>
+	struct packed_layout
 	{
-	};
+		struct type {};
 
-	template< typename VertexType>
-	class XmlVertexReader
-	{
-	public:
-		static void Read( TiXmlElement*, VertexType& );
+		static vertex::vertex_decl get_decl() {return 0;}
+		static void unpack(const std::vector<type>&, const packing::position_box&, std::vector<Vertex>&) {}
 	};
 
-#define START_VERTEX_READER(type) \
-	template<> class XmlVertexReader<type>\
-	{\
-	public:\
-	static void Read(TiXmlElement*, type&);\
-	};\
-	\
-	inline void XmlVertexReader<type>::Read(TiXmlElement* node, type& vertex)\
-	{
-#define END_VERTEX_READER	}
-
-	void readColor( TiXmlElement* node, math::Color& color);
-	void readPosition( TiXmlElement* node, math::vec3f& position);
-	void readTangent( TiXmlElement* node, math::vec3f& tangent);
-	void readBinormal( TiXmlElement* node, math::vec3f& binormal);
-	void readNormal( TiXmlElement* node, math::vec3f& normal);
-	void readTexCoords( TiXmlElement* node, math::vec2f& tex);
-	void readTexCoords2( TiXmlElement* node, math::vec2f& tex0, math::vec2f& tex1);
-	void readWeights( TiXmlElement* node, math::vec4f& weights);
-
-
-	#define READ_COLOR		readColor(node, vertex.color);
-	#define READ_POSITION	readPosition(node, vertex.position);
-	#define READ_TANGENT	readTangent(node, vertex.tangent);
-	#define READ_BINORMAL	readBinormal(node, vertex.binormal);
-	#define READ_NORMAL		readNormal(node, vertex.normal);
-	#define READ_TEXCOORD	readTexCoords(node, vertex.tex);
-	#define READ_TEXCOORD2	readTexCoords2(node, vertex.tex0, vertex.tex1 );
-	#define READ_WEIGHTS	readWeights(node, vertex.weights);
-
-	START_VERTEX_READER( vertex::PositionNormalColoredTexturedBinormalTangent )
-		READ_POSITION
-		READ_NORMAL
-		READ_COLOR
-		READ_TANGENT
-		READ_BINORMAL
-		READ_TEXCOORD
-	END_VERTEX_READER
-
-	START_VERTEX_READER( vertex::PositionNormalTextured2TangentBinorm )
-		READ_POSITION
-		READ_NORMAL
-		READ_TEXCOORD2
-		READ_TANGENT
-		READ_BINORMAL		
-	END_VERTEX_READER
-
-	START_VERTEX_READER( vertex::PositionSkinnedNormalColoredTextured2TangentBinorm )
-		READ_POSITION
-		READ_NORMAL
-		READ_COLOR
-		READ_TANGENT
-		READ_BINORMAL
-		READ_TEXCOORD2
-		READ_WEIGHTS
-	END_VERTEX_READER
-
-	template<typename IndexType>
-	void readIBFromXml(TiXmlNode* root_geom_node, std::vector<IndexType>& ib)
+	template<>
+	struct packed_layout<vertex::MeshVertex>
 	{
-		if (0 == root_geom_node) return;
-
-		TiXmlElement *elem = root_geom_node->FirstChildElement("faces");		
-
-		int ninds;
-		elem->Attribute("num", &ninds);           
-		ib.reserve(ninds * 3);
-
-		for(TiXmlElement* ev = elem->FirstChildElement("face");
-			ev != NULL; ev = ev->NextSiblingElement("face")) 
-		{		
-			int x,y,z;
-
-			ev->Attribute("a", &x);
-			ev->Attribute("b", &y);
-			ev->Attribute("c", &z);
+		typedef vertex::PackedMeshVertex type;
 
-			ib.push_back((unsigned int)x);
-			ib.push_back((unsigned int)y);
-			ib.push_back((unsigned int)z);
-		}
-	}
-
-	template<typename VertexType>
-	void readVBFromXml(TiXmlNode* root_geom_node, std::vector<VertexType>& vb)
-	{
-		TiXmlElement* elem = root_geom_node->FirstChildElement("vertices");
-		if (0 == elem) return;
-		
-		TiXmlElement* ev = elem->FirstChildElement("vertex");
-		if (0 == ev) return;
-
-		int vertex_count;
-		elem->Attribute( "num", &vertex_count ); 
-		vb.resize( vertex_count );
-
-		for ( std::vector<VertexType>::iterator vi = vb.begin(); vi != vb.end() && 0 != ev; ++vi)
+		static vertex::vertex_decl get_decl() {return type::get_decl();}
+		static void unpack(const std::vector<type>& packed, const packing::position_box& box, std::vector<vertex::MeshVertex>& vb)
 		{
-			XmlVertexReader< VertexType >::Read( ev, (*vi) );
-			ev = ev->NextSiblingElement("vertex");
+			packing::unpack(packed, box, vb);
 		}
-	}
-
+	};
 
-	template<typename IndexType, typename VertexType>
-		void loadGeomDataFromXmlEl( 
-		TiXmlNode* root_geom_node, 
-		std::vector<VertexType>& vb, 
-		std::vector<IndexType>& ib
-		)
+	template<class Vertex, bool Use32Indexes>
+	class indexed_geometry
 	{
-		readIBFromXml(root_geom_node, ib);
-		readVBFromXml(root_geom_node, vb);
-	}
+	};
 
 	template<typename IndexType, typename VertexType>
 		void loadGeomDataFromXmlFile( 
@@ -324,14 +301,8 @@ namespace render
 		io::readstream_ptr in = fs.find(xml_filename);
 		if (in && in->size() > 0)
 		{
-			unsigned int size = in->size();
 			io::stream_to_vector(data, in);
-
-			TiXmlDocument xml;//( xml_filename );
-			xml.Parse((const char*)&(data[0]));
-			//if ( !xml.LoadFile() ) return;
-
-			loadGeomDataFromXmlEl( xml.FirstChild( "mesh" ), vb, ib );
+			loadGeomDataFromXmlData(data, vb, ib);
 		}
 	}
 
@@ -345,9 +316,8 @@ namespace render
 		typedef Vertex vertex_type;
 
 		indexed_geometry(bool is_dynamic = false) 
-			: m_spImpl(IIndexedGeometry::create(Vertex::get_decl(), false, is_dynamic))
+			: m_spImpl(IIndexedGeometry::create(Vertex::get_decl(), true, is_dynamic))
 		{
-			m_bChanged = false;
 		}
 
 		void render(primitive_type ePrimType, unsigned nBaseVertexIndex, 
@@ -373,14 +343,18 @@ namespace render
 			m_spImpl->render(ePrimType, 0, 0, nPrimitiveCount*4, 6*nStartPrimitive, nPrimitiveCount );
 		}
 
+		void render_instanced(primitive_type ePrimType, unsigned nPrimitiveCount, const void* instances, unsigned stride, unsigned count)
+		{
+			m_spImpl->render_instanced(ePrimType, (unsigned)m_vVertexes.size(), nPrimitiveCount, instances, stride, count);
+		}
+
 		void load( const std::string& xml_filename )
 		{
 			loadGeomDataFromXmlFile(xml_filename, m_vVertexes, m_vIndexes);
+			optimizer::optimize(m_vVertexes, m_vIndexes);
 
 			unlock_vb();
 			unlock_ib();
-
-			updateBVolumes();
 		}
 
 		vertexies& lock_vb() {return m_vVertexes;}
@@ -390,7 +364,17 @@ namespace render
 		{
 			const size_t nVertexSize = sizeof(Vertex);
 			const size_t nSize = m_vVertexes.size() * nVertexSize;
-			m_bChanged = true;
+			m_bounds.invalidate();
+			m_spImpl->updateVB(&m_vVertexes[0], nSize, nVertexSize);
+		}
+
+		/// vertices before first are unchanged since previous unlock (only appended),
+		/// bounds are extended by the new ones
+		void unlock_vb_appended(size_t first)
+		{
+			const size_t nVertexSize = sizeof(Vertex);
+			const size_t nSize = m_vVertexes.size() * nVertexSize;
+			m_bounds.invalidate_from(first);
 			m_spImpl->updateVB(&m_vVertexes[0], nSize, nVertexSize);
 		}
 
@@ -400,30 +384,17 @@ namespace render
 
 		void unlock_ib() 
 		{
-			m_spImpl->updateIB(&m_vIndexes[0], m_vIndexes.size()*sizeof(unsigned int);)
+			m_spImpl->updateIB(&m_vIndexes[0], m_vIndexes.size()*sizeof(unsigned int));
 		}
 
 		int getIndexNum() const					{ return (int)m_vIndexes.size(); }
 		int get_num_verts() const				{ return (int)m_vVertexes.size(); }
 
-		const math::aaboxf& getBBox() const		{ return m_AABB; }
-		const math::spheref& getBSphere() const { return m_Sphere; }
+		/// bounds are computed on first request after vertices have changed
+		const math::aaboxf& getBBox() const		{ m_bounds.update(m_vVertexes); return m_bounds.bbox(); }
+		const math::spheref& getBSphere() const { m_bounds.update(m_vVertexes); return m_bounds.bsphere(); }
 
-		void updateBVolumes()
-		{
-			if ( !m_bChanged ) return;
-
-			size_t nNumVerts = m_vVertexes.size();
-			for(size_t i = 0; i < nNumVerts; i++)
-			{
-				const math::point3f& point = m_vVertexes[i].position;
-				math::extendVolume(m_AABB, point);
-			}
-			math::vec3f cent = (m_AABB.getMin()+m_AABB.getMax())*0.5f;
-			m_Sphere.setCenter( cent );
-			m_Sphere.setRadius( math::length( cent ) );
-			m_bChanged = false;
-		}
+		void updateBVolumes()					{ m_bounds.update(m_vVertexes); }
 
 	private:
 		void load( TiXmlNode* root_geom_node )
@@ -435,9 +406,7 @@ namespace render
 		vertexies						m_vVertexes;
 		std::auto_ptr<IIndexedGeometry>	m_spImpl;
 		indexies							m_vIndexes;
-		math::aaboxf					m_AABB;
-		math::spheref					m_Sphere;
-		bool							m_bChanged;
+		mutable lazy_bounds				m_bounds;
 	};
 
 
@@ -448,104 +417,128 @@ namespace render
 		typedef std::vector<Vertex>			vertexies;
 		typedef std::vector<unsigned short>	indexies;
 		typedef Vertex vertex_type;
+		typedef typename packed_layout<Vertex>::type packed_vertex;
 
 		indexed_geometry(bool is_dynamic = false) 
 			: m_spImpl(IIndexedGeometry::create(Vertex::get_decl(), false, is_dynamic))
 		{			
-			m_bChanged = false;
+			m_has_source = false;
+			m_packed = false;
 		}
 
 		void render(primitive_type ePrimType, unsigned nBaseVertexIndex, 
 					unsigned min_index, unsigned nNumVertices, 
 					unsigned nStartIndex, unsigned nPrimitiveCount)
 		{
+			check_packing();
 			m_spImpl->render(ePrimType, nBaseVertexIndex, min_index, 
 				nNumVertices, nStartIndex, nPrimitiveCount); //TODO
 		}
 
 		void render(primitive_type ePrimType, unsigned nPrimitiveCount)
 		{
+			check_packing();
 			unsigned int nNumVertices = (unsigned int)m_vVertexes.size();
 			m_spImpl->render(ePrimType, 0, 0, nNumVertices, 0, nPrimitiveCount);
 		}
 
 		void render(primitive_type ePrimType, unsigned nStartPrimitive, unsigned nPrimitiveCount)
 		{
+			check_packing();
 			//TODO for other primitive types
 			m_spImpl->render(ePrimType, 0, 0, nPrimitiveCount*4, 6*nStartPrimitive, nPrimitiveCount );
 		}
 
-		void load_from_xml(const std::string& filename)
+		/// instanced decoder replaces vertex shader of instanced technique
+		void render_instanced(primitive_type ePrimType, unsigned nPrimitiveCount, const void* instances, unsigned stride, unsigned count)
 		{
-
-		}
-
-		void loadFromBinary(const std::string& filename)
-		{
-
+			m_spImpl->render_instanced(ePrimType, (unsigned)m_vVertexes.size(), nPrimitiveCount, instances, stride, count);
 		}
 
+		/// loads binary mesh cache if it is up to date with xml, 
+		/// otherwise parses and optimizes xml and (re)generates the cache next to it
 		void load( const std::string& filename )
 		{
-			std::vector<byte> data;
 			io::file_system& fs = io::file_system::get();
 
-			bool use_binary = false;
+			std::vector<byte> xml_data;
+			io::readstream_ptr xml_in = fs.find(filename);
+			if (xml_in && xml_in->size() > 0)
+				io::stream_to_vector(xml_data, xml_in);
 
-			//first try to find binary file
-			std::string bin_filename = filename + ".mesh";
-			io::readstream_ptr bin_in = fs.find(bin_filename);
-			if (!bin_in)
-			{
-				bin_filename = io::helpers::get_shot_filename(filename);
-				bin_filename += ".mesh";
-				bin_in = fs.find(bin_filename);
-			}
+			const mesh_cache::hash_id source_hash = mesh_cache::calc_source_hash(xml_data);
+			const std::string cache_filename = mesh_cache::get_cache_filename(filename);
+
+			m_source_hash = source_hash;
+			m_has_source = !xml_data.empty();
 
 			bool loaded = false;
+			math::aaboxf bbox;
+			math::spheref bsphere;
+			if (io::readstream_ptr cache_in = fs.find(cache_filename))
+			{
+				loaded = mesh_cache::load(*cache_in, get_source_hash(), 
+										  m_vVertexes, m_vPacked, m_vIndexes, bbox, bsphere);
+			}
 
-			if (bin_in && bin_in->size() > 0)
+			if (loaded)
 			{
-				uint vertex_size = 0;//Vertex size
-				uint vdata_size = 0;//Vertex Data Size
-				(*bin_in) >> vertex_size >> vdata_size;
-				if (vertex_size == sizeof(Vertex))
-				{					
-					//Vertex Data
-					m_vVertexes.resize(vdata_size/vertex_size);
-					bin_in->read((byte*)&(m_vVertexes[0]), vdata_size);
-
-					(*bin_in) >> vertex_size >> vdata_size;
-					if (vertex_size == sizeof(unsigned short))
-					{
-						m_vIndexes.resize(vdata_size/vertex_size);
-						bin_in->read((byte*)&(m_vIndexes[0]), vdata_size);
-						loaded = true;
-					}
-				}
+				unlock_ib();
+				upload_cached_vb(bbox);
+				m_bounds.set(bbox, bsphere, m_vVertexes.size()); // bounds are precomputed in cache
+				return;
 			}
 
-			if (!loaded)
-				loadGeomDataFromXmlFile(filename, m_vVertexes, m_vIndexes);
+			mesh_converter::parse(xml_data, m_vVertexes, m_vIndexes, bbox, bsphere);
 
 			unlock_ib();
-			unlock_vb();
+			upload_vb();
+			m_bounds.set(bbox, bsphere, m_vVertexes.size());
 
-			updateBVolumes();
+			if (!m_vVertexes.empty())
+			{
+				const std::string cache_path = fs.get_full_path(cache_filename);
+				mesh_converter::save(cache_path, source_hash, m_vVertexes, m_vIndexes, bbox, bsphere);
+				fs.invalidate_cache(cache_path);
+			}
+		}
+
+		/// loads simplified level generated by MeshConverter (mesh_cache::get_lod_cache_filename).
+		/// source_hash is hash of xml level was generated from, 0 accepts any.
+		/// returns false if there is no level cache or it is out of date
+		bool load_lod(const std::string& filename, unsigned level, const mesh_cache::hash_id* source_hash)
+		{
+			io::readstream_ptr cache_in = io::file_system::get().find(mesh_cache::get_lod_cache_filename(filename, level));
+			math::aaboxf bbox;
+			math::spheref bsphere;
+			if (!cache_in || !mesh_cache::load(*cache_in, source_hash, m_vVertexes, m_vPacked, m_vIndexes, bbox, bsphere))
+				return false;
+
+			unlock_ib();
+			upload_cached_vb(bbox);
+			m_bounds.set(bbox, bsphere, m_vVertexes.size());
+			return true;
 		}
 
+		/// hash of xml geometry was loaded from, 0 if it was loaded from cache only
+		const mesh_cache::hash_id* get_source_hash() const {return m_has_source ? &m_source_hash : 0;}
+
 		vertexies& lock_vb() {return m_vVertexes;}
 		const vertexies& getVB() const {return m_vVertexes;}
 
+		/// vertices of packed geometry are uploaded unpacked
 		void unlock_vb()
 		{
-			if (!m_vVertexes.empty())
-			{
-				const size_t nVertexSize = sizeof(Vertex);
-				const size_t nSize = m_vVertexes.size() * nVertexSize;
-				m_spImpl->updateVB(&m_vVertexes[0], nSize, nVertexSize);
-				m_bChanged = true;
-			}
+			upload_vb();
+			m_bounds.invalidate();
+		}
+
+		/// vertices before first are unchanged since previous unlock (only appended),
+		/// bounds are extended by the new ones
+		void unlock_vb_appended(size_t first)
+		{
+			upload_vb();
+			m_bounds.invalidate_from(first);
 		}
 
 		indexies& lock_ib(){return m_vIndexes;}
@@ -557,30 +550,76 @@ namespace render
 				m_spImpl->updateIB(&m_vIndexes[0], m_vIndexes.size()*sizeof(unsigned short));
 		}
 
+		/// vertices are drawn as quads with shared index buffer (see IIndexedGeometry::use_quad_indices),
+		/// indices of quad n start at 6 * n
+		void use_quad_indices()
+		{
+			indexies().swap(m_vIndexes);
+			m_spImpl->use_quad_indices();
+		}
+
 		int getIndexNum() const					{ return (int)m_vIndexes.size(); }
 		int get_num_verts() const				{ return (int)m_vVertexes.size(); }
 
-		const math::aaboxf& getBBox() const		{ return m_AABB; }
-		const math::spheref& getBSphere() const { return m_Sphere; }
+		/// bounds are computed on first request after vertices have changed
+		const math::aaboxf& getBBox() const		{ m_bounds.update(m_vVertexes); return m_bounds.bbox(); }
+		const math::spheref& getBSphere() const { m_bounds.update(m_vVertexes); return m_bounds.bsphere(); }
+
+		void updateBVolumes()					{ m_bounds.update(m_vVertexes); }
+
+		/// device buffer holds packed vertices
+		bool is_packed() const {return m_packed;}
 
-		void updateBVolumes()
+	private:
+		/// packed geometry drawn by pass with own vertex shader is uploaded
+		/// unpacked from CPU copy and stays unpacked
+		void check_packing()
 		{
-			if ( !m_bChanged ) return;
+			if (m_packed && m_spImpl->has_vertex_shader())
+				upload_vb();
+		}
 
-			size_t nNumVerts = m_vVertexes.size();
-			for(size_t i = 0; i < nNumVerts; i++)
+		void upload_vb()
+		{
+			if (m_packed)
 			{
-				//TODO: need more effective solution!
-				math::point3f point(m_vVertexes[i].position[0], 
-					m_vVertexes[i].position[1], 
-					m_vVertexes[i].position[2]);
+				m_spImpl->set_packing(0, 0, 0);
+				m_packed = false;
+			}
 
-				math::extendVolume(m_AABB, point);
+			if (!m_vVertexes.empty())
+			{
+				const size_t nVertexSize = sizeof(Vertex);
+				const size_t nSize = m_vVertexes.size() * nVertexSize;
+				m_spImpl->updateVB(&m_vVertexes[0], nSize, nVertexSize);
 			}
-			math::vec3f cent = (m_AABB.getMin()+m_AABB.getMax())*0.5f;
-			m_Sphere.setCenter( cent );
-			m_Sphere.setRadius( math::length( cent ) );
-			m_bChanged = false;
+		}
+
+		/// packed cache stays packed on device if it can decode it,
+		/// CPU copy is unpacked in any case (bounds, occluders, lock_vb).
+		/// packed positions are decoded with bbox of cache
+		void upload_cached_vb(const math::aaboxf& bbox)
+		{
+			if (m_vPacked.empty())
+			{
+				upload_vb();
+				return;
+			}
+
+			const packing::position_box box = packing::make_box(bbox.getMin().getData(), bbox.getMax().getData());
+			packed_layout<Vertex>::unpack(m_vPacked, box, m_vVertexes);
+
+			if (m_spImpl->set_packing(packed_layout<Vertex>::get_decl(), box.scale, box.bias))
+			{
+				m_spImpl->updateVB(&m_vPacked[0], m_vPacked.size() * sizeof(packed_vertex), sizeof(packed_vertex));
+				m_packed = true;
+			}
+			else
+			{
+				upload_vb();
+			}
+
+			std::vector<packed_vertex>().swap(m_vPacked);
 		}
 
 	private:
@@ -593,8 +632,11 @@ namespace render
 		vertexies						m_vVertexes;
 		std::auto_ptr<IIndexedGeometry>	m_spImpl;
 		indexies						m_vIndexes;
-		math::aaboxf					m_AABB;
-		math::spheref					m_Sphere;
-		bool							m_bChanged;
+		mutable lazy_bounds				m_bounds;
+		mesh_cache::hash_id				m_source_hash;
+		bool							m_has_source;
+		/// packed vertices read from cache until upload
+		std::vector<packed_vertex>		m_vPacked;
+		bool							m_packed;
 	};
 }
\ No newline at end of file
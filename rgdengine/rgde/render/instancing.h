@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+
+#include <rgde/render/render_queue.h>
+
+namespace render
+{
+	/// per instance vertex stream element: world transform as 3 columns of 4x4 matrix
+	/// (last column of render device matrix is always 0,0,0,1).
+	/// vertex shader computes world position as dot(float4(pos, 1), rows[i])
+	struct instance_data
+	{
+		float rows[3][4];
+
+		void set(const float* world)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				rows[j][0] = world[j];
+				rows[j][1] = world[4 + j];
+				rows[j][2] = world[8 + j];
+				rows[j][3] = world[12 + j];
+			}
+		}
+	};
+
+	/// Splits batch of render queue items into runs sharing geometry and material.
+	/// Long runs are drawn with one instanced draw call, per instance transforms
+	/// are gathered into stream built on CPU. Other items are drawn one by one.
+	/// Independent from render device, so it can be tested with null backend.
+	class instance_batcher
+	{
+	public:
+		struct group
+		{
+			const void* geometry;
+			const void* state;
+			size_t		count;
+		};
+
+		class backend
+		{
+		public:
+			virtual ~backend() {}
+			/// items and instances have group.count elements
+			virtual void draw_instanced(const group& g, const render_queue::item* items, const instance_data* instances) = 0;
+			virtual void draw_single(const render_queue::item& item) = 0;
+		};
+
+		explicit instance_batcher(size_t min_instances = 4)
+			: m_min_instances(min_instances < 2 ? 2 : min_instances)
+		{
+			reset_statistics();
+		}
+
+		void set_min_instances(size_t num) {m_min_instances = num < 2 ? 2 : num;}
+		size_t get_min_instances() const {return m_min_instances;}
+
+		/// items should be sorted by render_queue, so equal geometries are neighbours
+		void submit(const render_queue::item* items, size_t count, backend& b)
+		{
+			for (size_t begin = 0; begin < count;)
+			{
+				const render_queue::item& first = items[begin];
+				size_t end = begin + 1;
+
+				if (first.geometry && first.world)
+				{
+					while (end < count && items[end].geometry == first.geometry &&
+						   items[end].state == first.state && items[end].world)
+						++end;
+				}
+
+				const size_t num = end - begin;
+				if (num >= m_min_instances)
+				{
+					m_instances.resize(num);
+					for (size_t i = 0; i < num; ++i)
+						m_instances[i].set(items[begin + i].world);
+
+					group g = {first.geometry, first.state, num};
+					b.draw_instanced(g, &items[begin], &m_instances[0]);
+
+					++m_num_instanced_draws;
+					m_num_instances += num;
+				}
+				else
+				{
+					for (size_t i = begin; i < end; ++i)
+						b.draw_single(items[i]);
+
+					m_num_single_draws += num;
+				}
+
+				begin = end;
+			}
+		}
+
+		void reset_statistics()
+		{
+			m_num_instanced_draws = 0;
+			m_num_instances = 0;
+			m_num_single_draws = 0;
+		}
+
+		size_t get_num_instanced_draws() const {return m_num_instanced_draws;}
+		size_t get_num_instances() const {return m_num_instances;}
+		size_t get_num_single_draws() const {return m_num_single_draws;}
+
+	private:
+		size_t m_min_instances;
+		std::vector<instance_data> m_instances;
+
+		size_t m_num_instanced_draws;
+		size_t m_num_instances;
+		size_t m_num_single_draws;
+	};
+}
@@ -5,38 +5,126 @@
 
 namespace render
 {
+	/// Debug lines. Boxes, spheres, arrows and quads are instances of unit shapes
+	/// (transform and color per instance), drawn with hardware instancing when device
+	/// supports it and expanded into lines otherwise. Shapes added between begin_group
+	/// and end_group are kept and drawn for given number of frames or until group is
+	/// removed, other shapes are drawn once. Shapes of disabled category are not stored.
 	class lines3d : public rendererable
 	{
 	public:
+		/// debug layers toggled by enable()
+		enum category
+		{
+			general = 0,
+			particles,
+			emitters,
+			transforms,
+			user = 8,
+			max_categories = 32
+		};
+
+		typedef unsigned group_id;
+
 		explicit lines3d(unsigned long priority = 10);
-	
+
 		typedef vertex::position_colored Point;
 
-		void add_line( const math::vec3f& point1, const math::vec3f& point2, 
-			const math::Color& color = 0xffffffff );
+		void enable(unsigned category, bool flag);
+		bool is_enabled(unsigned category) const { return 0 != (m_enabled & (1u << category)); }
+
+		/// following shapes are kept in new group, frames = 0 keeps them until remove_group
+		group_id begin_group(unsigned frames = 0);
+		void end_group();
+		void remove_group(group_id id);
+		void clear_groups();
+
+		void add_line( const math::vec3f& point1, const math::vec3f& point2,
+			const math::Color& color = 0xffffffff, unsigned category = general );
 		void add_box( const math::matrix44f& m, const math::vec3f& size,
-			const math::Color& color = 0xffffffff );
+			const math::Color& color = 0xffffffff, unsigned category = general );
 
 		void add_box(const math::matrix44f& m, const math::aaboxf& box,
-			const math::Color& color = 0xffffffff );
+			const math::Color& color = 0xffffffff, unsigned category = general );
 
-		void add_box(const math::vec3f& size, const math::Color& color = 0xffffffff );
-		void add_box(const math::aaboxf& box, const math::Color& color = 0xffffffff );
+		void add_box(const math::vec3f& size, const math::Color& color = 0xffffffff, unsigned category = general );
+		void add_box(const math::aaboxf& box, const math::Color& color = 0xffffffff, unsigned category = general );
 
 		void add_arrow( const math::matrix44f& m, const math::point3f& dir,
-			const math::Color& color = 0xffffffff );
-		void add_sphere(const math::matrix44f& m, float rad, int angle );
-		void add_quad (const math::vec3f& center, const math::vec2f& size, float spin);
+			const math::Color& color = 0xffffffff, unsigned category = general );
+		/// emitter cone: two arcs of angle degrees from pole
+		void add_sphere(const math::matrix44f& m, float rad, int angle, unsigned category = general );
+		/// three great circles
+		void add_sphere(const math::matrix44f& m, float rad, const math::Color& color, unsigned category = general );
+		/// camera facing quad
+		void add_quad (const math::vec3f& center, const math::vec2f& size, float spin, unsigned category = general );
 
 	protected:
 		void render();
 
+	private:
+		enum shape
+		{
+			box_shape,
+			sphere_shape,
+			arrow_shape,
+			quad_shape,
+			num_shapes
+		};
+
+		/// world transform rows (see instance_data) and color of unit shape,
+		/// instance stream elements TEXCOORD4..7
+		struct shape_instance
+		{
+			float rows[3][4];
+			float color[4];
+		};
+
+		/// shapes of frame or of group, categories are kept for groups only
+		struct batch
+		{
+			std::vector<Point>			lines;
+			std::vector<unsigned char>	line_categories;
+			std::vector<shape_instance>	shapes[num_shapes];
+			std::vector<unsigned char>	shape_categories[num_shapes];
+		};
+
+		struct group
+		{
+			group_id	id;
+			/// frames left to draw, 0 - until removed
+			unsigned	frames;
+			batch		shapes;
+		};
+
+		batch& target() { return m_open ? m_open->shapes : m_frame; }
+
+		/// unit shape transformed by m * (axes, origin)
+		void add_shape(shape s, const math::matrix44f& m, const math::vec3f axes[3], const math::vec3f& origin,
+					   const math::Color& color, unsigned category);
+		void create_shapes();
+		/// enabled shapes of groups are added to frame, expired groups are removed
+		void gather_groups();
+		/// instances as lines, when device has no instancing
+		void expand(shape s, const std::vector<shape_instance>& instances, std::vector<Point>& lines) const;
+
 	protected:
 		effect_ptr		m_effect;
+		effect::technique* m_technique;
+		effect::technique* m_instanced;
+		effect::parameter* m_lvp;
 		unsigned long	m_priority;			///> drawing priority
 
 		typedef geometry<vertex::position_colored> geometry;
 		geometry m_geometry;
-		std::vector<vertex::position_colored>* m_vertices;
+
+		typedef indexed_geometry<vertex::position_colored, false> shape_geometry;
+		shape_geometry	m_shapes[num_shapes];
+
+		batch			m_frame;
+		std::list<group> m_groups;
+		group*			m_open;
+		group_id		m_last_group;
+		unsigned		m_enabled;
 	};
 } //~ namespace utility
\ No newline at end of file
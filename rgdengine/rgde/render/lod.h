@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+
+namespace render
+{
+	namespace lod
+	{
+		/// projected size of bounding sphere: sphere diameter relative to viewport height.
+		/// proj_scale is cot(fovy / 2), element (1, 1) of projection matrix.
+		/// camera inside sphere gives 1 (full detail)
+		inline float projected_size(float radius, float distance, float proj_scale)
+		{
+			if (distance <= radius || distance <= 0)
+				return 1.0f;
+
+			const float size = radius * proj_scale / distance;
+			return size > 1.0f ? 1.0f : size;
+		}
+
+		inline float projected_size(const float center[3], float radius, const float eye[3], float proj_scale)
+		{
+			const float dx = center[0] - eye[0];
+			const float dy = center[1] - eye[1];
+			const float dz = center[2] - eye[2];
+			return projected_size(radius, std::sqrt(dx*dx + dy*dy + dz*dz), proj_scale);
+		}
+
+		/// Chooses detail level by projected size. Level 0 is full detail, level i (i > 0)
+		/// is used while projected size is below its threshold. Thresholds are widened
+		/// by hysteresis in direction of switch, so object near threshold doesn't flicker
+		/// between two levels. Independent from render device, so it can be tested without D3D.
+		class selector
+		{
+		public:
+			explicit selector(float hysteresis = 0.1f)
+				: m_hysteresis(hysteresis)
+			{
+			}
+
+			/// adds coarser level. thresholds must decrease (first one is below 1 and
+			/// every next one is below previous), otherwise level is not added and false is returned
+			bool add_level(float max_size)
+			{
+				if (max_size <= 0 || max_size >= get_threshold(get_num_levels() - 1))
+					return false;
+
+				m_thresholds.push_back(max_size);
+				return true;
+			}
+			void clear() {m_thresholds.clear();}
+
+			/// number of levels including full detail
+			unsigned get_num_levels() const {return (unsigned)m_thresholds.size() + 1;}
+			float get_threshold(unsigned level) const {return level > 0 ? m_thresholds[level - 1] : 1.0f;}
+
+			void set_hysteresis(float h) {m_hysteresis = h;}
+			float get_hysteresis() const {return m_hysteresis;}
+
+			/// current is level selected last frame
+			unsigned select(float size, unsigned current) const
+			{
+				const unsigned num = (unsigned)m_thresholds.size();
+				unsigned level = current > num ? num : current;
+
+				// finer level only when size is clearly above current level threshold
+				while (level > 0 && size >= m_thresholds[level - 1] * (1 + m_hysteresis))
+					--level;
+
+				// coarser level only when size is clearly below next level threshold
+				while (level < num && size < m_thresholds[level] * (1 - m_hysteresis))
+					++level;
+
+				return level;
+			}
+
+		private:
+			std::vector<float>	m_thresholds;
+			float				m_hysteresis;
+		};
+
+		/// default threshold of generated level (each level has about half of triangles)
+		inline float default_threshold(unsigned level)
+		{
+			return 0.5f / (float)(1 << level);
+		}
+
+		/// simplification error allowed for generated level: distance which is about
+		/// max_pixels on screen of given height when level is selected by default threshold
+		inline float default_max_distance(float radius, unsigned level, float screen_height = 1080, float max_pixels = 2)
+		{
+			return max_pixels * 2 * radius / (default_threshold(level) * screen_height);
+		}
+	}
+}
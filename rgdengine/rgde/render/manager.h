@@ -1,12 +1,23 @@
 #pragma once
 
 #include <rgde/math/transform.h>
+#include <rgde/math/frustum.h>
+
+#include <rgde/base/thread_pool.h>
+#include <rgde/core/timer.h>
 
 #include <rgde/render/texture.h>
 #include <rgde/render/font.h>
 #include <rgde/render/effect.h>
 #include <rgde/render/material.h>
 #include <rgde/render/binders.h>
+#include <rgde/render/render_queue.h>
+#include <rgde/render/instancing.h>
+#include <rgde/render/transform_cache.h>
+#include <rgde/render/occlusion.h>
+#include <rgde/render/lod.h>
+
+#include <rgde/scene/live_tree.h>
 
 namespace render
 {
@@ -19,6 +30,8 @@ namespace render
 	};
 
 	class mesh;
+	class rendererable;
+	struct renderable_info;
 
 	class render_manager
 	{
@@ -35,6 +48,25 @@ namespace render
 		void enableVolumes( bool flag )		{ m_volumes = flag; }
 		bool isVolumeDrawing() const		{ return m_volumes; }
 
+		/// objects sharing geometry and material are drawn with hardware instancing
+		/// when device supports it (vertex shader 3.0)
+		void enableInstancing( bool flag )	{ m_instancing = flag; }
+		bool isInstancing() const			{ return m_instancing; }
+
+		/// frame statistics overlay drawn with default font after scene
+		void enableStatistics( bool flag )	{ m_statistics = flag; }
+		bool isStatisticsDrawing() const	{ return m_statistics; }
+
+		/// objects in frustum are tested against depth of nearest occluders
+		/// (see renderable_info::occluder) rasterized on CPU
+		void enableOcclusion( bool flag )	{ m_occlusion = flag; }
+		bool isOcclusion() const			{ return m_occlusion; }
+		/// max number of occluders rasterized per camera
+		void setMaxOccluders( unsigned num ) { m_max_occluders = num; }
+		const instance_batcher& getInstanceBatcher() const { return m_batcher; }
+		/// workers of culling stage, render thread may use them for other jobs
+		base::thread_pool& getThreadPool()	{ return m_pool; }
+
 		effect_ptr& getDefaultEffect();
 		font_ptr&   getDefaultFont();
 
@@ -44,6 +76,13 @@ namespace render
 
 		material_ptr get_default_material();
 
+		/// renderables which bounding sphere intersects volume. bounds are
+		/// taken at last renderScene, objects without bounds are not returned.
+		/// ray is origin + t * dir, 0 <= t <= max_dist.
+		/// queries don't modify manager, so they may run concurrently
+		void query_sphere(const math::point3f& center, float radius, std::vector<rendererable*>& result) const;
+		void query_aabb(const math::aaboxf& box, std::vector<rendererable*>& result) const;
+		void query_ray(const math::point3f& origin, const math::vec3f& dir, float max_dist, std::vector<rendererable*>& result) const;
 
 	private:
 		void add(rendererable* r);
@@ -51,11 +90,25 @@ namespace render
 
 		void createBinder();
 
+		/// gathers world bounding spheres of visible renderables and moves them in spatial index
+		void updateBounds();
+		/// culls and sorts objects for one camera, runs on worker threads
+		void prepareView(size_t index);
+		/// passes largest projected size over views to renderables streaming textures
+		void requestTextureDetail(size_t num_views);
+
 	protected:
 		typedef std::vector<rendererable*> Renderables;
 		Renderables m_lRenderables;
 
 		bool			  m_volumes;
+		bool			  m_instancing;
+		bool			  m_statistics;
+		bool			  m_occlusion;
+		unsigned		  m_max_occluders;
+		/// measures CPU stages of renderScene
+		core::timer		  m_stage_timer;
+		instance_batcher  m_batcher;
 
 		effect_ptr        m_default_sffect;
 		font_ptr          m_default_font;
@@ -66,6 +119,72 @@ namespace render
 		texture_ptr       m_flat_normal_texture;				
 
 		static_binder_ptr     m_static_binder;
+
+		/// bounded renderables, fat boxes are updated incrementally every frame
+		scene::live_tree	  m_tree;
+		/// visible renderables of current frame and their world bounding spheres
+		Renderables			  m_objects;
+		math::sphere_soa	  m_spheres;
+		/// indices of objects without bounds, they are never culled
+		std::vector<unsigned> m_unbounded;
+
+		/// per object data shared by all cameras. renderable_info and materials
+		/// are read once per frame on render thread, workers only use this copy
+		struct object_info
+		{
+			const renderable_info*	info;
+			unsigned				priority;
+			render_queue::layer		layer;
+			/// instancing key and world transform, 0 if object is drawn alone
+			const void*				geometry;
+			const float*			world;
+			/// occlusion data, 0 if object is not occluder or has no bounds
+			const occluder_mesh*	occluder;
+			const math::aaboxf*		bbox;
+			/// detail levels and their instancing keys, 0 if object has one level
+			const lod::selector*	lods;
+			const void* const*		lod_geometries;
+			/// object requests texture detail (see renderable_info::detail_func)
+			bool					streamed;
+		};
+		std::vector<object_info> m_infos;
+
+		/// visibility and sorted draw list of one camera
+		struct camera_view
+		{
+			math::frustum	frustum;
+			math::vec3f		position;
+			math::matrix44f	view;
+			math::matrix44f	proj;
+			render_queue	queue;
+			/// camera dependent matrices of queue items, same order
+			transform_cache	transforms;
+			Renderables		candidates;
+			unsigned		num_visible;
+
+			/// bounded candidates, their spheres and results of batched frustum test
+			std::vector<unsigned>		candidate_objects;
+			math::sphere_soa			candidate_spheres;
+			std::vector<unsigned char>	candidate_visible;
+
+			/// objects passed frustum test and their squared distances
+			std::vector<unsigned> visible;
+			std::vector<float>	  distances;
+			/// projected sizes of drawn objects by object index (0 if not drawn),
+			/// filled while texture streaming is active
+			std::vector<float>	  sizes;
+			/// nearest occluders as (distance, object) pairs
+			std::vector<std::pair<float, unsigned> > occluders;
+			occlusion_buffer	  occlusion;
+			unsigned			  num_occluded;
+		};
+		std::vector<camera_view> m_views;
+		/// texture streaming is active in current frame
+		bool				  m_stream_textures;
+		const void*			  m_view_technique;
+		const void*			  m_view_material;
+
+		base::thread_pool	  m_pool;
 	};
 
 	typedef base::singelton<render_manager> TheRenderManager;
@@ -78,14 +197,34 @@ namespace render
 		material_ptr				 material;
 		boost::function<void (void)> render_func;
 		boost::function<void (void)> debug_render_func;
+		/// objects with same not null geometry and material may be drawn with
+		/// one instanced call of any of them (see instance_batcher)
+		const void*					 geometry;
+		boost::function<void (const instance_data*, unsigned)> instanced_render_func;
 		render::effect_ptr			 shader;
 		bool						 has_volumes;
 		math::aaboxf				 bbox;
 		math::spheref				 bsphere;
+		/// simplified geometry drawn into occlusion buffer, 0 if object hides nothing.
+		/// must stay valid while object is registered
+		const occluder_mesh*		 occluder;
+		/// detail levels selected by projected size of bounding sphere for every
+		/// camera, 0 if object has one level. lod_geometries are instancing keys
+		/// of levels (used instead of geometry), must stay valid while object is registered
+		const lod::selector*		 lods;
+		const void* const*			 lod_geometries;
+		/// level to draw, set by render manager before render_func and instanced_render_func
+		mutable unsigned			 lod;
+		/// called once per frame while texture streaming is active with largest
+		/// projected size of bounding sphere over cameras (see lod::projected_size),
+		/// object requests detail of its textures here
+		boost::function<void (float)> detail_func;
 	};
 
 	class rendererable
 	{
+		friend class render_manager;
+
 	public:
 		rendererable(unsigned priority = 1);
 		virtual ~rendererable();
@@ -105,5 +244,13 @@ namespace render
 	private:
 		bool	 m_visible;
 		unsigned m_render_priority;
+
+		scene::live_tree::proxy_id m_tree_proxy;
+		/// index in render_manager bounds of current frame, -1 if not visible
+		unsigned m_bounds_index;
+		/// detail levels selected last frame by first cameras (hysteresis of lod::selector),
+		/// each camera is prepared by one worker
+		enum { max_lod_views = 8 };
+		unsigned char m_lod_levels[max_lod_views];
 	};
 }
\ No newline at end of file
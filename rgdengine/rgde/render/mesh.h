@@ -3,6 +3,7 @@
 #include <rgde/math/transform.h>
 #include <rgde/render/manager.h>
 #include <rgde/render/geometry.h>
+#include <rgde/render/lod.h>
 
 namespace render
 {
@@ -25,6 +26,13 @@ namespace render
 		typedef std::vector<material_ptr>					materials_list;
 		typedef std::vector<IndexedSubMeshInfo>			sub_meshes;
 
+		struct lod_level
+		{
+			geometry_ptr	geometry;
+			unsigned int	prim_num;
+		};
+		typedef std::vector<lod_level>						lod_levels;
+
 		mesh();
 		~mesh();
 
@@ -42,9 +50,36 @@ namespace render
 
 		void setEffect(effect_ptr shader);
 
+		/// adds coarser level drawn while projected size of mesh (bounding sphere
+		/// diameter / viewport height) is below max_size. levels go from finer to coarser,
+		/// level with max_size not below threshold of previous one is skipped with warning.
+		/// levels generated by MeshConverter are added by load with default thresholds
+		void add_lod(const std::string& filename, float max_size);
+		/// removes all levels except full detail one
+		void clear_lods();
+
+		unsigned int	get_num_lods() const		{return m_lods.empty() ? 1 : (unsigned)m_lods.size();}
+		/// level drawn last (levels are chosen for every camera by render_manager)
+		unsigned int	get_current_lod() const		{return current_lod_index();}
+		lod::selector&	get_lod_selector()			{return m_lod_selector;}
+
+		/// mesh hides objects behind it (see render_manager::enableOcclusion).
+		/// coarsest detail level is drawn into occlusion buffer
+		void			set_occluder(bool flag);
+		bool			is_occluder() const			{return m_is_occluder;}
+
 	protected:
 		virtual const renderable_info&	get_renderable_info() const;
 		void			render();
+		void			render_instanced(const instance_data* instances, unsigned count);
+		/// textures of materials are drawn over projected size of mesh
+		/// (largest over cameras, see renderable_info::detail_func)
+		void			request_texture_detail(float size) const;
+		/// level set by render_manager for object being drawn
+		unsigned int	current_lod_index() const;
+		const lod_level& current_lod() const		{return m_lods[current_lod_index()];}
+		/// points occluder data to coarsest level
+		void			update_occluder();
 
 	protected:
 		std::string		m_file_name;
@@ -55,6 +90,15 @@ namespace render
 
 		unsigned int	m_prim_num;
 		primitive_type	m_prim_type;
+
+		/// all levels, 0 is m_geometry
+		lod_levels		m_lods;
+		lod::selector	m_lod_selector;
+		/// instancing keys of levels (see renderable_info::lod_geometries)
+		mutable std::vector<const void*> m_lod_geometries;
+
+		bool			m_is_occluder;
+		occluder_mesh	m_occluder;
 	};
 
 	typedef boost::intrusive_ptr<mesh> mesh_ptr;
@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////////
+// description: binary mesh cache. Generated from xml mesh on first load 
+//   and stored next to it as "<name>.xml.mesh". Contains vertex/index data 
+//   ready to upload and precomputed bounds. Cache is tied to the source xml 
+//   by SHA1 of its content, so stale caches are regenerated automatically.
+//   MeshConverter may store vertices packed (vertex::PackedMeshVertex, 
+//   see vertex_packing.h), such caches have their own magic.
+//   Has no render device dependencies - used by MeshConverter tool too.
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <rgde/io/file.h>
+#include <rgde/base/hash_string.h>
+
+namespace render
+{
+	namespace mesh_cache
+	{
+		typedef base::hash_string::hash_id hash_id;
+
+		const unsigned file_magic	= 0x4D534752; // "RGSM"
+		const unsigned packed_magic	= 0x50534752; // "RGSP"
+		const unsigned file_version	= 1;
+
+		struct header
+		{
+			header();
+
+			bool is_packed() const { return packed_magic == magic; }
+
+			unsigned		magic;
+			unsigned		version;
+			hash_id			source_hash;
+
+			unsigned		vertex_size;
+			unsigned		vertex_count;
+			unsigned		index_size;
+			unsigned		index_count;
+
+			math::aaboxf	bbox;
+			math::spheref	bsphere;
+		};
+
+		std::string get_cache_filename(const std::string& xml_filename);
+		/// simplified level generated by MeshConverter: "<name>.xml.lod<level>.mesh",
+		/// level starts from 1 and has the same source hash as main cache
+		std::string get_lod_cache_filename(const std::string& xml_filename, unsigned level);
+		hash_id calc_source_hash(const std::vector<byte>& xml_data);
+
+		/// returns false if stream is not a mesh cache of known version
+		bool read_header(io::read_stream& in, header& h);
+		void write_header(io::write_stream& out, const header& h);
+
+		template<typename Vertex, typename Index>
+		bool load_data(io::read_stream& in, const header& h, const hash_id* source_hash,
+					   std::vector<Vertex>& vb, std::vector<Index>& ib,
+					   math::aaboxf& bbox, math::spheref& bsphere)
+		{
+			if (source_hash && !(h.source_hash == *source_hash))
+				return false;
+
+			if (h.vertex_size != sizeof(Vertex) || h.index_size != sizeof(Index))
+				return false;
+
+			// counts of corrupt cache are checked against rest of stream before
+			// anything is allocated, products can't overflow after that
+			const unsigned long position = in.position();
+			const unsigned long size = in.size();
+			if (position > size)
+				return false;
+
+			const unsigned long rest = size - position;
+			if (h.vertex_count > rest / h.vertex_size)
+				return false;
+
+			const unsigned long vdata_size = (unsigned long)h.vertex_count * h.vertex_size;
+			if (h.index_count > (rest - vdata_size) / h.index_size)
+				return false;
+
+			const unsigned long idata_size = (unsigned long)h.index_count * h.index_size;
+
+			vb.resize(h.vertex_count);
+			if (!vb.empty())
+				in.read((byte*)&vb[0], vdata_size);
+
+			ib.resize(h.index_count);
+			if (!ib.empty())
+				in.read((byte*)&ib[0], idata_size);
+
+			bbox = h.bbox;
+			bsphere = h.bsphere;
+
+			return true;
+		}
+
+		/// loads cached mesh data, packed caches are rejected. 
+		/// source_hash == 0 means any source is accepted (xml is absent)
+		template<typename Vertex, typename Index>
+		bool load(io::read_stream& in, const hash_id* source_hash,
+				  std::vector<Vertex>& vb, std::vector<Index>& ib,
+				  math::aaboxf& bbox, math::spheref& bsphere)
+		{
+			header h;
+			if (!read_header(in, h) || h.is_packed())
+				return false;
+
+			return load_data(in, h, source_hash, vb, ib, bbox, bsphere);
+		}
+
+		/// loads plain or packed cache, vertices go to vb or packed_vb
+		/// and the other one is cleared. Packed positions are decoded with bbox
+		template<typename Vertex, typename Packed, typename Index>
+		bool load(io::read_stream& in, const hash_id* source_hash,
+				  std::vector<Vertex>& vb, std::vector<Packed>& packed_vb, std::vector<Index>& ib,
+				  math::aaboxf& bbox, math::spheref& bsphere)
+		{
+			header h;
+			if (!read_header(in, h))
+				return false;
+
+			if (h.is_packed())
+			{
+				vb.clear();
+				return load_data(in, h, source_hash, packed_vb, ib, bbox, bsphere);
+			}
+
+			packed_vb.clear();
+			return load_data(in, h, source_hash, vb, ib, bbox, bsphere);
+		}
+
+		/// packed - vb holds packed vertices
+		template<typename Vertex, typename Index>
+		void save(io::write_stream& out, const hash_id& source_hash,
+				  const std::vector<Vertex>& vb, const std::vector<Index>& ib,
+				  const math::aaboxf& bbox, const math::spheref& bsphere,
+				  bool packed = false)
+		{
+			header h;
+			h.magic			= packed ? packed_magic : file_magic;
+			h.source_hash	= source_hash;
+			h.vertex_size	= sizeof(Vertex);
+			h.vertex_count	= (unsigned)vb.size();
+			h.index_size	= sizeof(Index);
+			h.index_count	= (unsigned)ib.size();
+			h.bbox			= bbox;
+			h.bsphere		= bsphere;
+
+			write_header(out, h);
+
+			if (!vb.empty())
+				out.write((const byte*)&vb[0], h.vertex_count * h.vertex_size);
+
+			if (!ib.empty())
+				out.write((const byte*)&ib[0], h.index_count * h.index_size);
+		}
+	}
+}
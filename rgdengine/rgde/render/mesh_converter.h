@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////////
+// description: conversion of xml mesh into binary mesh cache (see mesh_cache.h):
+//   parsing, optimization for vertex cache and fetch, bounds, packing of
+//   vertices and simplified detail levels. indexed_geometry::load converts
+//   meshes without up to date cache with it, MeshConverter tool converts
+//   them offline. Has no render device dependencies.
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <rgde/io/file.h>
+#include <rgde/math/bounds.h>
+#include <rgde/render/lod.h>
+#include <rgde/render/mesh_xml.h>
+#include <rgde/render/mesh_cache.h>
+#include <rgde/render/mesh_optimizer.h>
+#include <rgde/render/mesh_simplifier.h>
+#include <rgde/render/vertex_packing.h>
+
+namespace render
+{
+	/// sphere around box center which contains the box
+	inline void calcBSphere(const math::aaboxf& bbox, math::spheref& bsphere)
+	{
+		const math::point3f cent = (bbox.getMin() + bbox.getMax()) * 0.5f;
+		bsphere.setCenter( cent );
+		bsphere.setRadius( math::length( math::vec3f(bbox.getMax() - cent) ) );
+	}
+
+	/// bounding box and sphere (around box center) of vertex positions
+	template<typename VertexType>
+	void calcBVolumes(const std::vector<VertexType>& vb, math::aaboxf& bbox, math::spheref& bsphere)
+	{
+		math::point3f min, max;
+		if (vb.empty() || !math::compute_bounds(&vb[0].position[0], vb.size(), sizeof(VertexType), min.getData(), max.getData()))
+			bbox = math::aaboxf();
+		else
+			bbox = math::aaboxf(min, max);
+
+		calcBSphere(bbox, bsphere);
+	}
+
+	namespace mesh_converter
+	{
+		/// packed mesh is rejected if decoding moves texture coordinates more than
+		/// max_tex_error (half floats of large tiled coordinates) or turns tangent frame
+		/// more than max_angle degrees (binormal is rebuilt, so skewed frames are lost)
+		const float max_tex_error = 1.0f / 1024;
+		const float max_angle = 2.0f;
+		/// of bounding box diagonal
+		const float max_position_error = 1.0f / 16384;
+
+		/// parses xml mesh (xml_data is zero terminated in place) and optimizes it,
+		/// bounds are computed for optimized vertices
+		template<typename Vertex, typename Index>
+		optimizer::report parse(std::vector<byte>& xml_data, std::vector<Vertex>& vb, std::vector<Index>& ib,
+								math::aaboxf& bbox, math::spheref& bsphere)
+		{
+			vb.clear();
+			ib.clear();
+			loadGeomDataFromXmlData(xml_data, vb, ib);
+
+			const optimizer::report r = optimizer::optimize(vb, ib);
+			calcBVolumes(vb, bbox, bsphere);
+			return r;
+		}
+
+		/// decoding error of vertices packed in bbox (vertex::PackedMeshVertex)
+		inline packing::error measure_packing(const std::vector<vertex::MeshVertex>& vb, const math::aaboxf& bbox)
+		{
+			const packing::position_box box = packing::make_box(bbox.getMin().getData(), bbox.getMax().getData());
+			std::vector<vertex::PackedMeshVertex> packed;
+			packing::pack(vb, box, packed);
+
+			std::vector<vertex::MeshVertex> decoded;
+			packing::unpack(packed, box, decoded);
+			return packing::measure(vb, decoded);
+		}
+
+		/// decoding error is within limits above
+		inline bool is_packing_acceptable(const packing::error& e, const math::aaboxf& bbox)
+		{
+			const math::vec3f extent = bbox.getMax() - bbox.getMin();
+			const float diagonal = math::length(extent);
+			return e.tex <= max_tex_error
+				&& e.normal <= max_angle && e.tangent <= max_angle && e.binormal <= max_angle
+				&& e.position <= diagonal * max_position_error;
+		}
+
+		/// writes cache file, returns false if it can't be created
+		template<typename Vertex, typename Index>
+		bool save(const std::string& filename, const mesh_cache::hash_id& source_hash,
+				  const std::vector<Vertex>& vb, const std::vector<Index>& ib,
+				  const math::aaboxf& bbox, const math::spheref& bsphere)
+		{
+			io::write_file out(filename);
+			if (!out.is_valid())
+				return false;
+
+			mesh_cache::save(out, source_hash, vb, ib, bbox, bsphere);
+			return true;
+		}
+
+		/// writes cache file with vertices packed in bbox (vertex::PackedMeshVertex)
+		template<typename Index>
+		bool save_packed(const std::string& filename, const mesh_cache::hash_id& source_hash,
+						 const std::vector<vertex::MeshVertex>& vb, const std::vector<Index>& ib,
+						 const math::aaboxf& bbox, const math::spheref& bsphere)
+		{
+			io::write_file out(filename);
+			if (!out.is_valid())
+				return false;
+
+			std::vector<vertex::PackedMeshVertex> packed;
+			packing::pack(vb, packing::make_box(bbox.getMin().getData(), bbox.getMax().getData()), packed);
+			mesh_cache::save(out, source_hash, packed, ib, bbox, bsphere, true);
+			return true;
+		}
+
+		/// writes simplified levels (see mesh_cache::get_lod_cache_filename), each with
+		/// about half of triangles of previous one. generation stops when simplifier
+		/// can't reduce mesh noticeably. returns number of written levels
+		template<typename Index>
+		unsigned generate_lods(const std::string& xml_filename, const mesh_cache::hash_id& source_hash,
+							   const std::vector<vertex::MeshVertex>& vb, const std::vector<Index>& ib,
+							   const math::aaboxf& bbox, const math::spheref& bsphere, unsigned num_levels, bool pack)
+		{
+			size_t prev_tris = ib.size() / 3;
+			unsigned level = 1;
+			for (; level <= num_levels; ++level)
+			{
+				// error is limited to a couple of pixels at level default threshold
+				const double max_distance = lod::default_max_distance(bsphere.getRadius(), level);
+
+				std::vector<Index> lod_ib;
+				simplifier::simplify(vb, ib, (ib.size() / 3) >> level, lod_ib, max_distance * max_distance);
+
+				const size_t tris = lod_ib.size() / 3;
+				if (0 == tris || tris * 10 > prev_tris * 9)
+					break;
+
+				// unused vertices are removed by vertex fetch ordering
+				std::vector<vertex::MeshVertex> lod_vb(vb);
+				optimizer::optimize(lod_vb, lod_ib);
+
+				// bounds of full detail level are kept, so culling doesn't depend on level
+				// and packed positions of all levels are quantized in the same box
+				const std::string filename = mesh_cache::get_lod_cache_filename(xml_filename, level);
+				if (!(pack ? save_packed(filename, source_hash, lod_vb, lod_ib, bbox, bsphere)
+						   : save(filename, source_hash, lod_vb, lod_ib, bbox, bsphere)))
+					break;
+
+				prev_tris = tris;
+			}
+			return level - 1;
+		}
+	}
+}
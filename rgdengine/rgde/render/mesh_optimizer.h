@@ -0,0 +1,447 @@
+//////////////////////////////////////////////////////////////////////////
+// description: offline and load time index and vertex order optimization.
+//   Bitwise equal vertices are welded, triangles are reordered for post
+//   transform vertex cache (Forsyth's linear-speed algorithm), then split
+//   into clusters which are sorted to draw outward facing parts first
+//   (Sander et al. fast triangle reordering), and vertices are placed in
+//   order of first use. Triangles keep their winding.
+//   Works with any vertex format with "position" member and has no render
+//   device dependencies - used by geometry loading and MeshConverter tool.
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <rgde/render/mesh_simplifier.h>
+
+#include <cstring>
+
+namespace render
+{
+	namespace optimizer
+	{
+		/// FIFO post transform cache used to measure ACMR
+		const unsigned fifo_cache_size = 16;
+		/// clusters may raise ACMR by this factor for overdraw sorting
+		const float default_overdraw_threshold = 1.05f;
+
+		/// average cache miss ratio: vertices transformed per triangle with FIFO cache
+		/// of cache_size. 3 is worst, about 0.5 is reachable for regular grids
+		template <typename Index>
+		float acmr(const std::vector<Index>& ib, size_t num_vertices, unsigned cache_size = fifo_cache_size)
+		{
+			if (ib.size() < 3)
+				return 0;
+
+			// vertex is in cache if it was missed within last cache_size misses
+			std::vector<unsigned> stamp(num_vertices, 0);
+			unsigned time = cache_size + 1;
+			for (size_t i = 0; i < ib.size(); ++i)
+			{
+				if (time - stamp[ib[i]] > cache_size)
+					stamp[ib[i]] = time++;
+			}
+			return (float)(time - cache_size - 1) / (ib.size() / 3);
+		}
+
+		namespace detail
+		{
+			/// LRU cache of vertex scoring, larger than FIFO of hardware
+			const unsigned lru_size = 32;
+
+			inline float vertex_score(int cache_position, unsigned live_triangles)
+			{
+				if (0 == live_triangles)
+					return -1.0f;
+
+				float score = 0;
+				if (cache_position >= 0)
+				{
+					// vertices of last triangle are scored lower, so strips are not favoured
+					if (cache_position < 3)
+						score = 0.75f;
+					else
+						score = std::pow(1.0f - (cache_position - 3) / (float)(lru_size - 3), 1.5f);
+				}
+
+				// vertices with few triangles left are finished first
+				return score + 2.0f * std::pow((float)live_triangles, -0.5f);
+			}
+
+			/// orders vertex indices by bytes of vertices, equal vertices by index
+			template <typename Vertex>
+			struct bitwise_less
+			{
+				const std::vector<Vertex>* vb;
+
+				bool operator()(unsigned a, unsigned b) const
+				{
+					const int c = std::memcmp(&(*vb)[a], &(*vb)[b], sizeof(Vertex));
+					return c < 0 || (0 == c && a < b);
+				}
+			};
+
+			template <typename Vertex>
+			void position(const Vertex& v, double* p)
+			{
+				p[0] = v.position[0];
+				p[1] = v.position[1];
+				p[2] = v.position[2];
+			}
+
+			struct cluster
+			{
+				unsigned begin, end;
+				float	 order;
+
+				bool operator<(const cluster& c) const {return order > c.order;}
+			};
+		}
+
+		/// Merges bitwise equal vertices into the first of them and drops triangles
+		/// which become degenerate. Merged vertices are left unreferenced, see
+		/// optimize_vertex_fetch. Returns number of merged vertices.
+		template <typename Vertex, typename Index>
+		size_t weld_vertices(const std::vector<Vertex>& vb, std::vector<Index>& ib)
+		{
+			std::vector<unsigned> order(vb.size());
+			for (size_t i = 0; i < order.size(); ++i)
+				order[i] = (unsigned)i;
+
+			detail::bitwise_less<Vertex> less = {&vb};
+			std::sort(order.begin(), order.end(), less);
+
+			size_t merged = 0;
+			std::vector<unsigned> remap(vb.size());
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				if (i > 0 && 0 == std::memcmp(&vb[order[i]], &vb[order[i - 1]], sizeof(Vertex)))
+				{
+					remap[order[i]] = remap[order[i - 1]];
+					++merged;
+				}
+				else
+					remap[order[i]] = order[i];
+			}
+
+			if (0 == merged)
+				return 0;
+
+			size_t result = 0;
+			for (size_t t = 0; t + 2 < ib.size(); t += 3)
+			{
+				const Index a = (Index)remap[ib[t]], b = (Index)remap[ib[t + 1]], c = (Index)remap[ib[t + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+
+				ib[result++] = a;
+				ib[result++] = b;
+				ib[result++] = c;
+			}
+			ib.resize(result);
+			return merged;
+		}
+
+		/// Reorders triangles so their vertices are reused from post transform cache.
+		/// Next triangle is the best scored one of vertices in cache, vertex score grows
+		/// with cache position recency and with fewer triangles left to draw.
+		template <typename Index>
+		void optimize_vertex_cache(std::vector<Index>& ib, size_t num_vertices)
+		{
+			using namespace detail;
+
+			const size_t num_triangles = ib.size() / 3;
+			if (num_triangles < 2)
+				return;
+
+			// live triangles of every vertex are first live[v] entries of its adjacency range
+			std::vector<unsigned> live(num_vertices, 0);
+			for (size_t i = 0; i < num_triangles * 3; ++i)
+				++live[ib[i]];
+
+			std::vector<unsigned> offsets(num_vertices + 1, 0);
+			for (size_t v = 0; v < num_vertices; ++v)
+				offsets[v + 1] = offsets[v] + live[v];
+
+			std::vector<unsigned> adjacency(num_triangles * 3);
+			std::vector<unsigned> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < num_triangles * 3; ++i)
+				adjacency[fill[ib[i]]++] = (unsigned)(i / 3);
+
+			std::vector<int>   cache_position(num_vertices, -1);
+			std::vector<float> vertex_scores(num_vertices);
+			for (size_t v = 0; v < num_vertices; ++v)
+				vertex_scores[v] = vertex_score(-1, live[v]);
+
+			std::vector<float> triangle_scores(num_triangles);
+			std::vector<bool>  emitted(num_triangles, false);
+			const unsigned none = ~0u;
+			unsigned best = none;
+			float best_score = -1;
+			for (size_t t = 0; t < num_triangles; ++t)
+			{
+				triangle_scores[t] = vertex_scores[ib[t * 3]] + vertex_scores[ib[t * 3 + 1]] + vertex_scores[ib[t * 3 + 2]];
+				if (triangle_scores[t] > best_score)
+				{
+					best_score = triangle_scores[t];
+					best = (unsigned)t;
+				}
+			}
+
+			std::vector<unsigned> cache, next_cache;
+			cache.reserve(lru_size + 3);
+			next_cache.reserve(lru_size + 3);
+
+			std::vector<Index> result;
+			result.reserve(num_triangles * 3);
+			size_t scan = 0;
+
+			while (result.size() < num_triangles * 3)
+			{
+				// nothing left around cached vertices, continue from first triangle not drawn
+				if (none == best)
+				{
+					while (emitted[scan])
+						++scan;
+					best = (unsigned)scan;
+				}
+
+				emitted[best] = true;
+				next_cache.resize(0);
+				for (int k = 0; k < 3; ++k)
+				{
+					const unsigned v = ib[best * 3 + k];
+					result.push_back((Index)v);
+					next_cache.push_back(v);
+
+					// drawn triangle is moved out of live part of adjacency range
+					unsigned* tris = &adjacency[offsets[v]];
+					for (unsigned j = 0; j < live[v]; ++j)
+					{
+						if (tris[j] == best)
+						{
+							std::swap(tris[j], tris[live[v] - 1]);
+							break;
+						}
+					}
+					--live[v];
+				}
+
+				for (size_t i = 0; i < cache.size(); ++i)
+				{
+					const unsigned v = cache[i];
+					if (v != next_cache[0] && v != next_cache[1] && v != next_cache[2])
+						next_cache.push_back(v);
+				}
+
+				// rescore vertices of cache, including ones pushed out of it
+				for (size_t i = 0; i < next_cache.size(); ++i)
+				{
+					const unsigned v = next_cache[i];
+					cache_position[v] = i < lru_size ? (int)i : -1;
+
+					const float score = vertex_score(cache_position[v], live[v]);
+					const float delta = score - vertex_scores[v];
+					vertex_scores[v] = score;
+
+					for (unsigned j = 0; j < live[v]; ++j)
+						triangle_scores[adjacency[offsets[v] + j]] += delta;
+				}
+
+				if (next_cache.size() > lru_size)
+					next_cache.resize(lru_size);
+				cache.swap(next_cache);
+
+				best = none;
+				best_score = -1;
+				for (size_t i = 0; i < cache.size(); ++i)
+				{
+					const unsigned v = cache[i];
+					for (unsigned j = 0; j < live[v]; ++j)
+					{
+						const unsigned t = adjacency[offsets[v] + j];
+						if (triangle_scores[t] > best_score)
+						{
+							best_score = triangle_scores[t];
+							best = t;
+						}
+					}
+				}
+			}
+
+			ib.swap(result);
+		}
+
+		/// Reorders clusters of cache optimized triangles to reduce overdraw: clusters
+		/// facing away from mesh center are drawn first, so they hide inner parts.
+		/// Clusters start where cache was flushed anyway, and are split further while
+		/// their ACMR stays within threshold of ACMR of whole run.
+		template <typename Vertex, typename Index>
+		void optimize_overdraw(std::vector<Index>& ib, const std::vector<Vertex>& vb,
+							   float threshold = default_overdraw_threshold, unsigned cache_size = fifo_cache_size)
+		{
+			using namespace detail;
+
+			const unsigned num_triangles = (unsigned)(ib.size() / 3);
+			if (num_triangles < 2)
+				return;
+
+			std::vector<unsigned> stamp(vb.size(), 0);
+			unsigned time = cache_size + 1;
+
+			// misses of triangle t, cache state is kept in stamp and time
+			std::vector<unsigned char> misses(num_triangles);
+			for (unsigned t = 0; t < num_triangles; ++t)
+			{
+				misses[t] = 0;
+				for (int k = 0; k < 3; ++k)
+				{
+					if (time - stamp[ib[t * 3 + k]] > cache_size)
+					{
+						stamp[ib[t * 3 + k]] = time++;
+						++misses[t];
+					}
+				}
+			}
+
+			// runs between flushes (all three vertices missed)
+			std::vector<unsigned> runs;
+			for (unsigned t = 0; t < num_triangles; ++t)
+				if (0 == t || 3 == misses[t])
+					runs.push_back(t);
+			runs.push_back(num_triangles);
+
+			std::vector<cluster> clusters;
+			for (size_t r = 0; r + 1 < runs.size(); ++r)
+			{
+				unsigned run_misses = 0;
+				for (unsigned t = runs[r]; t < runs[r + 1]; ++t)
+					run_misses += misses[t];
+				const float limit = threshold * run_misses / (runs[r + 1] - runs[r]);
+
+				// split run where ACMR of cluster from cold cache gets low enough
+				cluster c = {runs[r], runs[r], 0};
+				unsigned cluster_misses = 0;
+				time += cache_size + 1;
+				for (unsigned t = runs[r]; t < runs[r + 1]; ++t)
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						if (time - stamp[ib[t * 3 + k]] > cache_size)
+						{
+							stamp[ib[t * 3 + k]] = time++;
+							++cluster_misses;
+						}
+					}
+
+					c.end = t + 1;
+					if (c.end < runs[r + 1] && cluster_misses <= limit * (c.end - c.begin))
+					{
+						clusters.push_back(c);
+						c.begin = c.end;
+						cluster_misses = 0;
+						time += cache_size + 1;
+					}
+				}
+				clusters.push_back(c);
+			}
+
+			if (clusters.size() < 2)
+				return;
+
+			// area weighted centroids and normals of clusters and of mesh
+			std::vector<double> centroids(clusters.size() * 3, 0), normals(clusters.size() * 3, 0);
+			double center[3] = {0, 0, 0}, area = 0;
+			for (size_t i = 0; i < clusters.size(); ++i)
+			{
+				double* cc = &centroids[i * 3];
+				double* cn = &normals[i * 3];
+				double cluster_area = 0;
+				for (unsigned t = clusters[i].begin; t < clusters[i].end; ++t)
+				{
+					double p0[3], p1[3], p2[3], n[3];
+					position(vb[ib[t * 3]], p0);
+					position(vb[ib[t * 3 + 1]], p1);
+					position(vb[ib[t * 3 + 2]], p2);
+					simplifier::normal(p0, p1, p2, n);
+
+					const double a = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					for (int k = 0; k < 3; ++k)
+					{
+						cc[k] += (p0[k] + p1[k] + p2[k]) * a / 3;
+						cn[k] += n[k];
+					}
+					cluster_area += a;
+				}
+
+				for (int k = 0; k < 3; ++k)
+					center[k] += cc[k];
+				area += cluster_area;
+
+				if (cluster_area > 0)
+					for (int k = 0; k < 3; ++k)
+						cc[k] /= cluster_area;
+			}
+
+			if (area <= 0)
+				return;
+
+			for (int k = 0; k < 3; ++k)
+				center[k] /= area;
+
+			for (size_t i = 0; i < clusters.size(); ++i)
+			{
+				const double* cc = &centroids[i * 3];
+				const double* cn = &normals[i * 3];
+				const double length = std::sqrt(cn[0] * cn[0] + cn[1] * cn[1] + cn[2] * cn[2]);
+				const double d = (cc[0] - center[0]) * cn[0] + (cc[1] - center[1]) * cn[1] + (cc[2] - center[2]) * cn[2];
+				clusters[i].order = length > 0 ? (float)(d / length) : 0;
+			}
+
+			std::stable_sort(clusters.begin(), clusters.end());
+
+			std::vector<Index> result;
+			result.reserve(ib.size());
+			for (size_t i = 0; i < clusters.size(); ++i)
+				result.insert(result.end(), ib.begin() + clusters[i].begin * 3, ib.begin() + clusters[i].end * 3);
+
+			ib.swap(result);
+		}
+
+		/// places vertices in order of first use, unreferenced vertices are removed
+		template <typename Vertex, typename Index>
+		void optimize_vertex_fetch(std::vector<Vertex>& vb, std::vector<Index>& ib)
+		{
+			simplifier::compact(vb, ib);
+		}
+
+		struct report
+		{
+			float  acmr_before;
+			float  acmr_after;
+			size_t vertices_before;
+			size_t vertices_after;
+			size_t triangles;
+		};
+
+		/// all stages in order: weld, vertex cache, overdraw, vertex fetch.
+		/// overdraw_threshold <= 0 skips overdraw ordering
+		template <typename Vertex, typename Index>
+		report optimize(std::vector<Vertex>& vb, std::vector<Index>& ib,
+						float overdraw_threshold = default_overdraw_threshold)
+		{
+			report r;
+			r.vertices_before = vb.size();
+			r.acmr_before = acmr(ib, vb.size());
+
+			weld_vertices(vb, ib);
+			optimize_vertex_cache(ib, vb.size());
+			if (overdraw_threshold > 0)
+				optimize_overdraw(ib, vb, overdraw_threshold);
+			optimize_vertex_fetch(vb, ib);
+
+			r.vertices_after = vb.size();
+			r.triangles = ib.size() / 3;
+			r.acmr_after = acmr(ib, vb.size());
+			return r;
+		}
+	}
+}
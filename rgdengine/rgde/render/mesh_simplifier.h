@@ -0,0 +1,320 @@
+//////////////////////////////////////////////////////////////////////////
+// description: offline mesh simplifier for generated detail levels.
+//   Quadric error metric edge collapse of indexed triangle list. Edges are
+//   collapsed into one of their vertices, so vertex data is not changed and
+//   levels can be built from any vertex format with "position" member.
+//   Seam vertices (equal position, different attributes) and open borders
+//   are locked to keep texture mapping and silhouette of open meshes.
+//   Has no render device dependencies - used by MeshConverter tool.
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <cmath>
+#include <cfloat>
+
+namespace render
+{
+	namespace simplifier
+	{
+		/// symmetric 4x4 error quadric of plane set
+		struct quadric
+		{
+			double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+			quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+
+			/// plane a*x + b*y + c*z + d = 0 with unit normal
+			void add_plane(double a, double b, double c, double d)
+			{
+				a2 += a*a; ab += a*b; ac += a*c; ad += a*d;
+				b2 += b*b; bc += b*c; bd += b*d;
+				c2 += c*c; cd += c*d;
+				d2 += d*d;
+			}
+
+			quadric& operator+=(const quadric& q)
+			{
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+				b2 += q.b2; bc += q.bc; bd += q.bd;
+				c2 += q.c2; cd += q.cd;
+				d2 += q.d2;
+				return *this;
+			}
+
+			/// sum of squared distances of point to planes
+			double error(const double p[3]) const
+			{
+				const double x = p[0], y = p[1], z = p[2];
+				return a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x
+					 + b2*y*y + 2*bc*y*z + 2*bd*y
+					 + c2*z*z + 2*cd*z
+					 + d2;
+			}
+		};
+
+		/// not normalized normal of triangle
+		inline void normal(const double* p0, const double* p1, const double* p2, double* n)
+		{
+			const double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			const double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		}
+
+		/// candidate collapse from -> to, outdated entries are skipped by version
+		struct collapse
+		{
+			double	 cost;
+			unsigned from, to;
+			unsigned from_version, to_version;
+
+			bool operator<(const collapse& c) const {return cost > c.cost;}
+		};
+
+		/// Reduces triangle list to about target_triangles triangles. Collapses stop
+		/// earlier when error exceeds max_error or no valid collapse is left. Error is sum
+		/// of squared distances to planes of source triangles around collapsed vertex. result gets indices of remaining triangles into the same vb.
+		template <typename Vertex, typename Index>
+		void simplify(const std::vector<Vertex>& vb, const std::vector<Index>& ib, size_t target_triangles,
+					  std::vector<Index>& result, double max_error = DBL_MAX)
+		{
+			typedef std::vector<unsigned> uints;
+
+			const size_t num_verts = vb.size();
+			const size_t num_tris = ib.size() / 3;
+
+			result.clear();
+			if (num_tris <= target_triangles || 0 == num_verts)
+			{
+				result.assign(ib.begin(), ib.begin() + num_tris * 3);
+				return;
+			}
+
+			std::vector<double> pos(num_verts * 3);
+			for (size_t v = 0; v < num_verts; ++v)
+				for (int i = 0; i < 3; ++i)
+					pos[v * 3 + i] = vb[v].position[i];
+
+			// vertices sharing position (attribute seams) are locked
+			std::vector<bool> locked(num_verts, false);
+			{
+				typedef std::map<std::vector<double>, unsigned> positions;
+				positions first;
+				for (size_t v = 0; v < num_verts; ++v)
+				{
+					std::vector<double> key(&pos[v * 3], &pos[v * 3] + 3);
+					std::pair<positions::iterator, bool> r = first.insert(std::make_pair(key, (unsigned)v));
+					if (!r.second)
+						locked[v] = locked[r.first->second] = true;
+				}
+			}
+
+			uints tris(ib.begin(), ib.begin() + num_tris * 3);
+			std::vector<bool> removed(num_tris, false);
+			std::vector<uints> vertex_tris(num_verts);
+			for (size_t t = 0; t < num_tris; ++t)
+				for (int i = 0; i < 3; ++i)
+					vertex_tris[tris[t * 3 + i]].push_back((unsigned)t);
+
+			// border edges (used by single triangle) lock their vertices
+			{
+				std::map<std::pair<unsigned, unsigned>, unsigned> edges;
+				for (size_t t = 0; t < num_tris; ++t)
+				{
+					for (int i = 0; i < 3; ++i)
+					{
+						unsigned a = tris[t * 3 + i], b = tris[t * 3 + (i + 1) % 3];
+						if (a > b) std::swap(a, b);
+						++edges[std::make_pair(a, b)];
+					}
+				}
+
+				for (std::map<std::pair<unsigned, unsigned>, unsigned>::const_iterator it = edges.begin();
+					 it != edges.end(); ++it)
+				{
+					if (1 == it->second)
+						locked[it->first.first] = locked[it->first.second] = true;
+				}
+			}
+
+			std::vector<quadric> quadrics(num_verts);
+			for (size_t t = 0; t < num_tris; ++t)
+			{
+				const double* p0 = &pos[tris[t * 3] * 3];
+				const double* p1 = &pos[tris[t * 3 + 1] * 3];
+				const double* p2 = &pos[tris[t * 3 + 2] * 3];
+
+				double n[3];
+				normal(p0, p1, p2, n);
+				const double len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+				if (len <= 0)
+					continue;
+
+				const double a = n[0] / len, b = n[1] / len, c = n[2] / len;
+				const double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+
+				quadric q;
+				q.add_plane(a, b, c, d);
+				for (int i = 0; i < 3; ++i)
+					quadrics[tris[t * 3 + i]] += q;
+			}
+
+			std::priority_queue<collapse> heap;
+			std::vector<unsigned> versions(num_verts, 0);
+
+			#define RGDE_PUSH_COLLAPSE(u, v)											\
+				if (!locked[u])															\
+				{																		\
+					quadric q = quadrics[u];											\
+					q += quadrics[v];													\
+					collapse c = {q.error(&pos[(v) * 3]), u, v, versions[u], versions[v]}; \
+					heap.push(c);														\
+				}
+
+			for (size_t t = 0; t < num_tris; ++t)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					const unsigned a = tris[t * 3 + i], b = tris[t * 3 + (i + 1) % 3];
+					RGDE_PUSH_COLLAPSE(a, b);
+					RGDE_PUSH_COLLAPSE(b, a);
+				}
+			}
+
+			size_t alive = num_tris;
+			uints neighbours;
+
+			while (alive > target_triangles && !heap.empty())
+			{
+				const collapse c = heap.top();
+				heap.pop();
+
+				if (c.cost > max_error)
+					break;
+
+				if (c.from_version != versions[c.from] || c.to_version != versions[c.to])
+					continue;
+
+				const unsigned u = c.from, v = c.to;
+				uints& u_tris = vertex_tris[u];
+
+				// edge must still exist and no remaining triangle may flip or degenerate
+				bool connected = false, valid = true;
+				for (size_t i = 0; i < u_tris.size() && valid; ++i)
+				{
+					const unsigned t = u_tris[i];
+					const unsigned* tri = &tris[t * 3];
+					if (tri[0] == v || tri[1] == v || tri[2] == v)
+					{
+						connected = true;
+						continue;
+					}
+
+					const double* p[3];
+					const double* q[3];
+					for (int k = 0; k < 3; ++k)
+					{
+						p[k] = &pos[tri[k] * 3];
+						q[k] = tri[k] == u ? &pos[v * 3] : p[k];
+					}
+
+					double n0[3], n1[3];
+					normal(p[0], p[1], p[2], n0);
+					normal(q[0], q[1], q[2], n1);
+					const double l0 = n0[0]*n0[0] + n0[1]*n0[1] + n0[2]*n0[2];
+					const double l1 = n1[0]*n1[0] + n1[1]*n1[1] + n1[2]*n1[2];
+					const double d = n0[0]*n1[0] + n0[1]*n1[1] + n0[2]*n1[2];
+					valid = l1 > 0 && d > 0.2 * std::sqrt(l0 * l1);
+				}
+
+				if (!connected || !valid)
+					continue;
+
+				// move u triangles to v, triangles with both die
+				uints& v_tris = vertex_tris[v];
+				for (size_t i = 0; i < u_tris.size(); ++i)
+				{
+					const unsigned t = u_tris[i];
+					unsigned* tri = &tris[t * 3];
+					if (tri[0] == v || tri[1] == v || tri[2] == v)
+					{
+						removed[t] = true;
+						--alive;
+						for (int k = 0; k < 3; ++k)
+						{
+							if (tri[k] == u)
+								continue;
+							uints& other = vertex_tris[tri[k]];
+							other.erase(std::remove(other.begin(), other.end(), t), other.end());
+						}
+					}
+					else
+					{
+						for (int k = 0; k < 3; ++k)
+							if (tri[k] == u)
+								tri[k] = v;
+						v_tris.push_back(t);
+					}
+				}
+				u_tris.clear();
+
+				quadrics[v] += quadrics[u];
+				++versions[u];
+				++versions[v];
+
+				// edges of u and v are outdated now, v gets new costs to and from neighbours
+				neighbours.clear();
+				for (size_t i = 0; i < v_tris.size(); ++i)
+					for (int k = 0; k < 3; ++k)
+						if (tris[v_tris[i] * 3 + k] != v)
+							neighbours.push_back(tris[v_tris[i] * 3 + k]);
+
+				std::sort(neighbours.begin(), neighbours.end());
+				neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+				for (size_t i = 0; i < neighbours.size(); ++i)
+				{
+					RGDE_PUSH_COLLAPSE(v, neighbours[i]);
+					RGDE_PUSH_COLLAPSE(neighbours[i], v);
+				}
+			}
+
+			#undef RGDE_PUSH_COLLAPSE
+
+			result.reserve(alive * 3);
+			for (size_t t = 0; t < num_tris; ++t)
+			{
+				if (!removed[t])
+					for (int k = 0; k < 3; ++k)
+						result.push_back((Index)tris[t * 3 + k]);
+			}
+		}
+		/// removes vertices not referenced by ib, remaps indices
+		template <typename Vertex, typename Index>
+		void compact(std::vector<Vertex>& vb, std::vector<Index>& ib)
+		{
+			const unsigned unused = ~0u;
+			std::vector<unsigned> remap(vb.size(), unused);
+
+			std::vector<Vertex> used;
+			used.reserve(vb.size());
+			for (size_t i = 0; i < ib.size(); ++i)
+			{
+				unsigned& r = remap[ib[i]];
+				if (unused == r)
+				{
+					r = (unsigned)used.size();
+					used.push_back(vb[ib[i]]);
+				}
+				ib[i] = (Index)r;
+			}
+
+			vb.swap(used);
+		}
+	}
+}
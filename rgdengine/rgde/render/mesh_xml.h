@@ -0,0 +1,153 @@
+//////////////////////////////////////////////////////////////////////////
+// description: reading of xml meshes into vertex and index arrays.
+//   Has no render device dependencies - used by MeshConverter tool too
+//   (see mesh_converter.h).
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <rgde/render/vertices.h>
+
+namespace render
+{
+	template< typename VertexType>
+	class XmlVertexReader
+	{
+	public:
+		static void Read( TiXmlElement*, VertexType& );
+	};
+
+#define START_VERTEX_READER(type) \
+	template<> class XmlVertexReader<type>\
+	{\
+	public:\
+	static void Read(TiXmlElement*, type&);\
+	};\
+	\
+	inline void XmlVertexReader<type>::Read(TiXmlElement* node, type& vertex)\
+	{
+#define END_VERTEX_READER	}
+
+	void readColor( TiXmlElement* node, math::Color& color);
+	void readPosition( TiXmlElement* node, math::vec3f& position);
+	void readTangent( TiXmlElement* node, math::vec3f& tangent);
+	void readBinormal( TiXmlElement* node, math::vec3f& binormal);
+	void readNormal( TiXmlElement* node, math::vec3f& normal);
+	void readTexCoords( TiXmlElement* node, math::vec2f& tex);
+	void readTexCoords2( TiXmlElement* node, math::vec2f& tex0, math::vec2f& tex1);
+	void readWeights( TiXmlElement* node, math::vec4f& weights);
+
+
+	#define READ_COLOR		readColor(node, vertex.color);
+	#define READ_POSITION	readPosition(node, vertex.position);
+	#define READ_TANGENT	readTangent(node, vertex.tangent);
+	#define READ_BINORMAL	readBinormal(node, vertex.binormal);
+	#define READ_NORMAL		readNormal(node, vertex.normal);
+	#define READ_TEXCOORD	readTexCoords(node, vertex.tex);
+	#define READ_TEXCOORD2	readTexCoords2(node, vertex.tex0, vertex.tex1 );
+	#define READ_WEIGHTS	readWeights(node, vertex.weights);
+
+	START_VERTEX_READER( vertex::PositionNormalColoredTexturedBinormalTangent )
+		READ_POSITION
+		READ_NORMAL
+		READ_COLOR
+		READ_TANGENT
+		READ_BINORMAL
+		READ_TEXCOORD
+	END_VERTEX_READER
+
+	START_VERTEX_READER( vertex::PositionNormalTextured2TangentBinorm )
+		READ_POSITION
+		READ_NORMAL
+		READ_TEXCOORD2
+		READ_TANGENT
+		READ_BINORMAL		
+	END_VERTEX_READER
+
+	START_VERTEX_READER( vertex::PositionSkinnedNormalColoredTextured2TangentBinorm )
+		READ_POSITION
+		READ_NORMAL
+		READ_COLOR
+		READ_TANGENT
+		READ_BINORMAL
+		READ_TEXCOORD2
+		READ_WEIGHTS
+	END_VERTEX_READER
+
+	template<typename IndexType>
+	void readIBFromXml(TiXmlNode* root_geom_node, std::vector<IndexType>& ib)
+	{
+		if (0 == root_geom_node) return;
+
+		TiXmlElement *elem = root_geom_node->FirstChildElement("faces");		
+
+		int ninds;
+		elem->Attribute("num", &ninds);           
+		ib.reserve(ninds * 3);
+
+		for(TiXmlElement* ev = elem->FirstChildElement("face");
+			ev != NULL; ev = ev->NextSiblingElement("face")) 
+		{		
+			int x,y,z;
+
+			ev->Attribute("a", &x);
+			ev->Attribute("b", &y);
+			ev->Attribute("c", &z);
+
+			ib.push_back((unsigned int)x);
+			ib.push_back((unsigned int)y);
+			ib.push_back((unsigned int)z);
+		}
+	}
+
+	template<typename VertexType>
+	void readVBFromXml(TiXmlNode* root_geom_node, std::vector<VertexType>& vb)
+	{
+		TiXmlElement* elem = root_geom_node->FirstChildElement("vertices");
+		if (0 == elem) return;
+		
+		TiXmlElement* ev = elem->FirstChildElement("vertex");
+		if (0 == ev) return;
+
+		int vertex_count;
+		elem->Attribute( "num", &vertex_count ); 
+		vb.resize( vertex_count );
+
+		for ( typename std::vector<VertexType>::iterator vi = vb.begin(); vi != vb.end() && 0 != ev; ++vi)
+		{
+			XmlVertexReader< VertexType >::Read( ev, (*vi) );
+			ev = ev->NextSiblingElement("vertex");
+		}
+	}
+
+
+	template<typename IndexType, typename VertexType>
+		void loadGeomDataFromXmlEl( 
+		TiXmlNode* root_geom_node, 
+		std::vector<VertexType>& vb, 
+		std::vector<IndexType>& ib
+		)
+	{
+		readIBFromXml(root_geom_node, ib);
+		readVBFromXml(root_geom_node, vb);
+	}
+
+	/// xml_data is zero terminated in place before parsing
+	template<typename IndexType, typename VertexType>
+		void loadGeomDataFromXmlData( 
+				std::vector<byte>& xml_data,
+				std::vector<VertexType>& vb, 
+				std::vector<IndexType>& ib
+				)
+	{
+		if (xml_data.empty())
+			return;
+
+		if (xml_data.back() != 0)
+			xml_data.push_back(0);
+
+		TiXmlDocument xml;
+		xml.Parse((const char*)&(xml_data[0]));
+
+		loadGeomDataFromXmlEl( xml.FirstChild( "mesh" ), vb, ib );
+	}
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <rgde/render/transform_cache.h>
+
+namespace render
+{
+	/// occluder triangles: positions (3 floats) with byte stride, 16 bit triangle list
+	struct occluder_mesh
+	{
+		const float*			positions;
+		unsigned				stride;
+		unsigned				num_verts;
+		const unsigned short*	indices;
+		unsigned				num_indices;
+	};
+
+	/// Low resolution depth buffer rasterized on CPU from few large occluders.
+	/// Bounding boxes are tested against it before submission: box is hidden when
+	/// its nearest depth is behind occluders in every pixel of its screen rectangle.
+	/// Occluders write depth of pixels which centers they cover, so box rectangle
+	/// is widened by one pixel to keep objects peeking out from silhouettes visible.
+	/// Depth is z/w of render device (0 near, 1 far), rows of 4 pixels are
+	/// processed with SSE. Independent from render device, so it can be tested without D3D.
+	class occlusion_buffer
+	{
+	public:
+		explicit occlusion_buffer(unsigned width = 256, unsigned height = 128)
+		{
+			resize(width, height);
+		}
+
+		/// width is rounded up to multiple of 4
+		void resize(unsigned width, unsigned height)
+		{
+			m_width = (width + 3) & ~3u;
+			m_height = height > 0 ? height : 1;
+			m_depth.assign(m_width * m_height, 1.0f);
+		}
+
+		unsigned get_width() const {return m_width;}
+		unsigned get_height() const {return m_height;}
+		const float* get_depth() const {return &m_depth[0];}
+		/// triangles rasterized since clear
+		unsigned get_num_triangles() const {return m_num_triangles;}
+
+		/// clears depth to far plane, view_proj is 16 floats in render device layout
+		void clear(const float* view_proj)
+		{
+			for (int i = 0; i < 16; ++i)
+				m_view_proj[i] = view_proj[i];
+
+			m_depth.assign(m_depth.size(), 1.0f);
+			m_num_triangles = 0;
+		}
+
+		/// world is 16 floats, 0 means identity
+		void add_occluder(const occluder_mesh& mesh, const float* world)
+		{
+			float m[16];
+			object_matrix(world, m);
+
+			m_clip.resize(mesh.num_verts);
+			const char* p = reinterpret_cast<const char*>(mesh.positions);
+			for (unsigned i = 0; i < mesh.num_verts; ++i, p += mesh.stride)
+				transform(m, reinterpret_cast<const float*>(p), m_clip[i]);
+
+			for (unsigned i = 0; i + 2 < mesh.num_indices; i += 3)
+			{
+				const unsigned a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+				if (a < mesh.num_verts && b < mesh.num_verts && c < mesh.num_verts)
+					rasterize(m_clip[a], m_clip[b], m_clip[c]);
+			}
+		}
+
+		/// box is given in object space by min and max corners, world is 16 floats
+		/// (0 means identity). returns false if box is surely hidden
+		bool test_box(const float* min, const float* max, const float* world) const
+		{
+			float m[16];
+			object_matrix(world, m);
+
+			float x0 = (float)m_width, y0 = (float)m_height, x1 = 0, y1 = 0, z = 1.0f;
+			for (int i = 0; i < 8; ++i)
+			{
+				const float corner[3] = {i & 1 ? max[0] : min[0], i & 2 ? max[1] : min[1], i & 4 ? max[2] : min[2]};
+				clip_vertex v;
+				transform(m, corner, v);
+
+				// box crosses near plane - camera may be inside
+				if (v.z < 0 || v.w <= 0)
+					return true;
+
+				float s[3];
+				to_screen(v, s);
+				if (s[0] < x0) x0 = s[0];
+				if (s[0] > x1) x1 = s[0];
+				if (s[1] < y0) y0 = s[1];
+				if (s[1] > y1) y1 = s[1];
+				if (s[2] < z) z = s[2];
+			}
+
+			if (x0 < 0) x0 = 0;
+			if (y0 < 0) y0 = 0;
+			if (x1 > (float)m_width) x1 = (float)m_width;
+			if (y1 > (float)m_height) y1 = (float)m_height;
+			if (x0 >= x1 || y0 >= y1)
+				return false;
+
+			// all touched pixels and one more around
+			const unsigned px0 = x0 >= 1 ? (unsigned)x0 - 1 : 0;
+			const unsigned py0 = y0 >= 1 ? (unsigned)y0 - 1 : 0;
+			const unsigned px1 = (std::min)((unsigned)std::ceil(x1) + 1, m_width);
+			const unsigned py1 = (std::min)((unsigned)std::ceil(y1) + 1, m_height);
+
+			for (unsigned y = py0; y < py1; ++y)
+			{
+				const float* row = &m_depth[y * m_width];
+#ifdef RGDE_TRANSFORMS_SSE
+				const __m128 box_z = _mm_set1_ps(z);
+				unsigned x = px0 & ~3u;
+				for (; x < px1; x += 4)
+				{
+					int mask = _mm_movemask_ps(_mm_cmple_ps(box_z, _mm_loadu_ps(row + x)));
+					// columns outside of rectangle
+					if (x < px0) mask &= 0xF << (px0 - x);
+					if (x + 4 > px1) mask &= 0xF >> (x + 4 - px1);
+					if (mask)
+						return true;
+				}
+#else
+				for (unsigned x = px0; x < px1; ++x)
+					if (z <= row[x])
+						return true;
+#endif
+			}
+			return false;
+		}
+
+	private:
+		struct clip_vertex
+		{
+			float x, y, z, w;
+		};
+
+		void object_matrix(const float* world, float* m) const
+		{
+			if (world)
+				transform_cache::multiply(m_view_proj, world, m);
+			else
+				for (int i = 0; i < 16; ++i)
+					m[i] = m_view_proj[i];
+		}
+
+		static void transform(const float* m, const float* p, clip_vertex& v)
+		{
+			v.x = m[0] * p[0] + m[4] * p[1] + m[8]  * p[2] + m[12];
+			v.y = m[1] * p[0] + m[5] * p[1] + m[9]  * p[2] + m[13];
+			v.z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+			v.w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+		}
+
+		/// pixel coordinates (y down) and depth
+		void to_screen(const clip_vertex& v, float* s) const
+		{
+			const float inv_w = 1.0f / v.w;
+			s[0] = (v.x * inv_w * 0.5f + 0.5f) * m_width;
+			s[1] = (0.5f - v.y * inv_w * 0.5f) * m_height;
+			s[2] = v.z * inv_w;
+		}
+
+		static clip_vertex lerp(const clip_vertex& a, const clip_vertex& b, float t)
+		{
+			clip_vertex v = {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t};
+			return v;
+		}
+
+		/// clips triangle by near plane (z >= 0) and draws result as fan
+		void rasterize(const clip_vertex& a, const clip_vertex& b, const clip_vertex& c)
+		{
+			const clip_vertex* in[3] = {&a, &b, &c};
+			clip_vertex poly[4];
+			int num = 0;
+
+			for (int i = 0; i < 3; ++i)
+			{
+				const clip_vertex& p = *in[i];
+				const clip_vertex& q = *in[(i + 1) % 3];
+				if (p.z >= 0)
+					poly[num++] = p;
+				if ((p.z >= 0) != (q.z >= 0))
+					poly[num++] = lerp(p, q, p.z / (p.z - q.z));
+			}
+
+			if (num < 3)
+				return;
+
+			float s[4][3];
+			for (int i = 0; i < num; ++i)
+				to_screen(poly[i], s[i]);
+
+			for (int i = 2; i < num; ++i)
+				draw(s[0], s[i - 1], s[i]);
+
+			++m_num_triangles;
+		}
+
+		/// fills pixels which centers are inside of triangle with nearest depth
+		void draw(const float* v0, const float* v1, const float* v2)
+		{
+			float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v1[1] - v0[1]) * (v2[0] - v0[0]);
+			if (area < 0)
+			{
+				std::swap(v1, v2);
+				area = -area;
+			}
+			if (area <= 0)
+				return;
+
+			float fx0 = v0[0], fx1 = v0[0], fy0 = v0[1], fy1 = v0[1];
+			const float* v[2] = {v1, v2};
+			for (int i = 0; i < 2; ++i)
+			{
+				if (v[i][0] < fx0) fx0 = v[i][0];
+				if (v[i][0] > fx1) fx1 = v[i][0];
+				if (v[i][1] < fy0) fy0 = v[i][1];
+				if (v[i][1] > fy1) fy1 = v[i][1];
+			}
+
+			if (fx1 <= 0 || fy1 <= 0 || fx0 >= (float)m_width || fy0 >= (float)m_height)
+				return;
+
+			const int x0 = fx0 > 0 ? (int)fx0 : 0;
+			const int y0 = fy0 > 0 ? (int)fy0 : 0;
+			const int x1 = fx1 < (float)m_width ? (int)fx1 + 1 : (int)m_width;
+			const int y1 = fy1 < (float)m_height ? (int)fy1 + 1 : (int)m_height;
+
+			// edge functions, non negative inside: e0 is opposite to v0 etc.
+			const float a0 = v1[1] - v2[1], b0 = v2[0] - v1[0];
+			const float a1 = v2[1] - v0[1], b1 = v0[0] - v2[0];
+			const float a2 = v0[1] - v1[1], b2 = v1[0] - v0[0];
+
+			const float inv_area = 1.0f / area;
+			const float dz1 = (v1[2] - v0[2]) * inv_area;
+			const float dz2 = (v2[2] - v0[2]) * inv_area;
+
+#ifdef RGDE_TRANSFORMS_SSE
+			const int start_x = x0 & ~3;
+			const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 va0 = _mm_set1_ps(a0), va1 = _mm_set1_ps(a1), va2 = _mm_set1_ps(a2);
+			const __m128 step0 = _mm_set1_ps(a0 * 4), step1 = _mm_set1_ps(a1 * 4), step2 = _mm_set1_ps(a2 * 4);
+			const __m128 vz0 = _mm_set1_ps(v0[2]), vdz1 = _mm_set1_ps(dz1), vdz2 = _mm_set1_ps(dz2);
+
+			for (int y = y0; y < y1; ++y)
+			{
+				const float py = y + 0.5f;
+				const __m128 px = _mm_add_ps(_mm_set1_ps((float)start_x), offsets);
+
+				__m128 w0 = _mm_add_ps(_mm_mul_ps(va0, _mm_sub_ps(px, _mm_set1_ps(v1[0]))), _mm_set1_ps(b0 * (py - v1[1])));
+				__m128 w1 = _mm_add_ps(_mm_mul_ps(va1, _mm_sub_ps(px, _mm_set1_ps(v2[0]))), _mm_set1_ps(b1 * (py - v2[1])));
+				__m128 w2 = _mm_add_ps(_mm_mul_ps(va2, _mm_sub_ps(px, _mm_set1_ps(v0[0]))), _mm_set1_ps(b2 * (py - v0[1])));
+
+				float* row = &m_depth[y * m_width];
+				for (int x = start_x; x < x1; x += 4)
+				{
+					const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+													 _mm_cmpge_ps(w2, zero));
+					if (_mm_movemask_ps(inside))
+					{
+						const __m128 z = _mm_add_ps(vz0, _mm_add_ps(_mm_mul_ps(w1, vdz1), _mm_mul_ps(w2, vdz2)));
+						const __m128 old = _mm_loadu_ps(row + x);
+						const __m128 nearest = _mm_min_ps(old, z);
+						_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+					}
+
+					w0 = _mm_add_ps(w0, step0);
+					w1 = _mm_add_ps(w1, step1);
+					w2 = _mm_add_ps(w2, step2);
+				}
+			}
+#else
+			for (int y = y0; y < y1; ++y)
+			{
+				const float py = y + 0.5f;
+				float* row = &m_depth[y * m_width];
+				for (int x = x0; x < x1; ++x)
+				{
+					const float px = x + 0.5f;
+					const float w0 = a0 * (px - v1[0]) + b0 * (py - v1[1]);
+					const float w1 = a1 * (px - v2[0]) + b1 * (py - v2[1]);
+					const float w2 = a2 * (px - v0[0]) + b2 * (py - v0[1]);
+					if (w0 < 0 || w1 < 0 || w2 < 0)
+						continue;
+
+					const float z = v0[2] + w1 * dz1 + w2 * dz2;
+					if (z < row[x])
+						row[x] = z;
+				}
+			}
+#endif
+		}
+
+	private:
+		unsigned			m_width;
+		unsigned			m_height;
+		std::vector<float>	m_depth;
+		float				m_view_proj[16];
+		unsigned			m_num_triangles;
+		std::vector<clip_vertex> m_clip;
+	};
+}
@@ -31,8 +31,10 @@ namespace particles
 		void texture_tiling(int rows, int columns_total, int rows_total);
 
 	protected:
+		/// quads drawn by one call with 16 bit indices
+		enum { max_batch_particles = 0x10000 / 4 };
+
 		particles_t		m_particles;
-		unsigned long	m_reserved_size; ///>  ,    
 
 	private:
 		render::effect_ptr		m_effect;
@@ -2,15 +2,19 @@
 
 #include <rgde/math/camera.h>
 #include <rgde/render/font.h>
+#include <rgde/render/statistics.h>
+#include <rgde/core/timer.h>
 
 namespace render
 {
 	class device_object;
 	class lines3d;
 	class lines2d;
+	class gpu_timer;
 
 	typedef boost::shared_ptr<lines2d> lines2d_ptr;
 	typedef boost::shared_ptr<lines3d> lines3d_ptr;
+	typedef boost::shared_ptr<gpu_timer> gpu_timer_ptr;
 
 	class render_device
 	{
@@ -31,14 +35,52 @@ namespace render
 		void					set_shader_flags(unsigned long flag)	{m_shaderFlags = flag;}
 		unsigned long			get_shader_flags() const				{return m_shaderFlags;}
 
+		/// counters are gathered into current frame, end_frame stores it into history
+		/// and reads GPU time of earlier frames
+		void					begin_frame();
+		void					end_frame();
+
+		/// one draw call
 		void					add_statistics( unsigned verts, unsigned tris);
+		void					add_state_change()					{++m_statistics.current().state_changes;}
+		void					add_technique_begin()				{++m_statistics.current().technique_begins;}
+		void					add_upload(unsigned bytes)			{m_statistics.current().upload_bytes += bytes;}
+		void					add_dynamic_upload(unsigned bytes)	{add_upload(bytes); m_statistics.current().dynamic_upload_bytes += bytes;}
+		void					add_dynamic_discard()				{++m_statistics.current().dynamic_discards;}
+		void					add_stage_time(render_stage stage, float ms) {m_statistics.current().stage_ms[stage] += ms;}
+		/// clears counters of current frame
 		void					reset_statistics();
 
-		inline unsigned			get_tris()	const {return m_triangles;}
-		inline unsigned			get_verts()	const {return m_verts;}
+		/// counters of last finished frame
+		inline unsigned			get_tris()	const {return last_frame().tris;}
+		inline unsigned			get_verts()	const {return last_frame().verts;}
+
+		/// frustum culling results of one camera
+		void					add_culling_statistics(unsigned visible, unsigned culled);
+		inline unsigned			get_visible_objects() const {return last_frame().visible_objects;}
+		inline unsigned			get_culled_objects()  const {return last_frame().culled_objects;}
+
+		/// occlusion culling results of one camera
+		void					add_occlusion_statistics(unsigned occluded, unsigned occluder_tris);
+		inline unsigned			get_occluded_objects() const {return last_frame().occluded_objects;}
+
+		/// triangles of full detail and of drawn detail level of meshes with levels
+		void					add_lod_statistics(unsigned full_tris, unsigned drawn_tris);
+		inline unsigned			get_lod_saved_tris() const {return last_frame().lod_full_tris - last_frame().lod_tris;}
+
+		const statistics_history& get_statistics_history() const {return m_statistics;}
+		/// number of frames kept in history, drops stored frames
+		void					set_statistics_capacity(size_t frames) {m_statistics.set_capacity(frames);}
+		/// writes history as JSON if filename ends with ".json", as CSV otherwise
+		bool					save_statistics(const std::string& filename) const;
 
 		math::vec2f				getBackBufferSize();		
 
+		/// hardware instancing (stream frequency) needs vertex shader 3.0
+		bool					supports_instancing() const;
+		/// packed vertex formats (USHORT4N, SHORT4N, FLOAT16_2) with vertex shader 2.0
+		bool					supports_packed_vertices() const;
+
 		void					draw_wired_floor(float size, unsigned num = 20, const math::Color& color = math::Green);
 
 		float                   get_fps(float abs_time) const;
@@ -65,8 +107,11 @@ namespace render
 		unsigned long			m_shaderFlags;
 		math::camera_ptr		m_cam;
 
-		unsigned				m_verts;
-		unsigned				m_triangles;
+		const frame_statistics&	last_frame() const;
+
+		statistics_history		m_statistics;
+		core::timer				m_frame_timer;
+		gpu_timer_ptr			m_gpu_timer;
 
 		typedef std::list<device_object* > device_objects;
 		device_objects			m_objects;
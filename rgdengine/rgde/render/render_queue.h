@@ -0,0 +1,172 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <rgde/render/sort_keys.h>
+
+namespace render
+{
+	/// Per camera list of draw items ordered by 64 bit sort keys.
+	/// Opaque layers (grouped by state and geometry, front to back inside group):
+	///   | layer 2 | priority 14 | technique 8 | material 16 | geometry 12 | depth 12 |
+	/// Transparent layer (back to front):
+	///   | layer 2 | priority 14 | inverted depth 24 | technique 8 | material 16 |
+	/// Post transparent layer keeps submission order inside priority.
+	/// Keys are built once per item with precomputed depth and sorted with LSD radix sort.
+	/// Independent from render device, so it can be tested and measured without D3D.
+	class render_queue
+	{
+	public:
+		typedef render::sort_key sort_key;
+
+		enum layer
+		{
+			solid			 = 0,
+			transparent		 = 1,
+			post_transparent = 2
+		};
+
+		struct item
+		{
+			sort_key	key;
+			/// objects with equal not null state are drawn in one batch (solid layer only)
+			const void*	state;
+			/// objects with equal not null geometry in one batch can be instanced
+			const void*	geometry;
+			/// world transform, 16 floats in render device layout
+			const float* world;
+			const void*	data;
+			/// detail level of object chosen for this camera
+			unsigned	lod;
+		};
+
+		/// executes sorted items. batch is a run of items sharing state,
+		/// so technique/material are bound once per batch
+		class backend
+		{
+		public:
+			virtual ~backend() {}
+			virtual void draw_batch(const item* items, size_t count) = 0;
+		};
+
+		void clear()
+		{
+			m_items.resize(0);
+			m_techniques.clear();
+			m_materials.clear();
+			m_geometries.clear();
+		}
+
+		void reserve(size_t num)
+		{
+			m_items.reserve(num);
+			m_sorted.reserve(num);
+			m_keys.reserve(num);
+			m_temp.reserve(num);
+		}
+
+		/// depth is distance (or squared distance) to camera, must be >= 0.
+		/// geometry is shared vertex data identity for instancing, 0 if object can't be instanced.
+		/// geometry of every detail level must differ, so levels are not instanced together
+		void add(layer l, unsigned priority, const void* technique, const void* material, float depth, const void* data,
+				 const void* geometry = 0, const float* world = 0, unsigned lod = 0)
+		{
+			const sort_key prio = priority > 0x3FFF ? 0x3FFF : priority;
+			const sort_key tech = m_techniques.get(technique) & 0xFF;
+			const sort_key mat	= m_materials.get(material) & 0xFFFF;
+			const sort_key dist = depth_bits(depth);
+
+			item i;
+			i.key = ((sort_key)l << 62) | (prio << 48);
+
+			switch (l)
+			{
+			case solid:
+				i.key |= (tech << 40) | (mat << 24) | ((m_geometries.get(geometry) & 0xFFF) << 12) | (dist >> 12);
+				break;
+			case transparent:
+				i.key |= ((0xFFFFFF - dist) << 24) | (tech << 16) | mat;
+				break;
+			default:
+				break;
+			}
+
+			i.state = l == solid ? material : 0;
+			i.geometry = l == solid ? geometry : 0;
+			i.world = world;
+			i.data = data;
+			i.lod = lod;
+			m_items.push_back(i);
+		}
+
+		/// stable radix sort by keys
+		void sort()
+		{
+			const size_t num = m_items.size();
+			if (num < 2)
+				return;
+
+			m_keys.resize(num);
+			m_temp.resize(num);
+			for (size_t i = 0; i < num; ++i)
+			{
+				m_keys[i].key = m_items[i].key;
+				m_keys[i].index = (unsigned)i;
+			}
+
+			const key_index* sorted = radix_sort(&m_keys[0], &m_temp[0], num);
+
+			m_sorted.resize(num);
+			for (size_t i = 0; i < num; ++i)
+				m_sorted[i] = m_items[sorted[i].index];
+			m_items.swap(m_sorted);
+		}
+
+		/// returns number of batches
+		size_t execute(backend& b) const
+		{
+			const size_t num = m_items.size();
+			size_t num_batches = 0;
+
+			for (size_t begin = 0; begin < num; ++num_batches)
+			{
+				const void* state = m_items[begin].state;
+				size_t end = begin + 1;
+
+				if (state)
+					while (end < num && m_items[end].state == state)
+						++end;
+
+				b.draw_batch(&m_items[begin], end - begin);
+				begin = end;
+			}
+
+			return num_batches;
+		}
+
+		size_t size() const {return m_items.size();}
+		bool empty() const {return m_items.empty();}
+		const item& operator[](size_t i) const {return m_items[i];}
+
+		static layer get_layer(sort_key key) {return (layer)(key >> 62);}
+
+	private:
+		/// bits of non negative float keep order, 24 most significant are enough
+		static sort_key depth_bits(float depth)
+		{
+			union { float f; unsigned u; } bits;
+			bits.f = depth > 0 ? depth : 0;
+			return bits.u >> 8;
+		}
+
+	private:
+		std::vector<item> m_items;
+		std::vector<item> m_sorted;
+		std::vector<key_index> m_keys;
+		std::vector<key_index> m_temp;
+		state_ids		  m_techniques;
+		state_ids		  m_materials;
+		state_ids		  m_geometries;
+	};
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+namespace render
+{
+	typedef unsigned long long sort_key;
+
+	/// sort key of item and index of item
+	struct key_index
+	{
+		sort_key key;
+		unsigned index;
+	};
+
+	/// Stable LSD radix sort of (key, index) pairs, 8 bit digits. All histograms
+	/// are built in one pass, digits equal for all keys are skipped, so keys using
+	/// few bits cost few passes. temp must have num elements. returns sorted array,
+	/// which is keys or temp
+	inline key_index* radix_sort(key_index* keys, key_index* temp, size_t num)
+	{
+		if (num < 2)
+			return keys;
+
+		size_t counts[8][256] = {0};
+		for (size_t i = 0; i < num; ++i)
+		{
+			sort_key key = keys[i].key;
+			for (int d = 0; d < 8; ++d, key >>= 8)
+				++counts[d][key & 0xFF];
+		}
+
+		key_index* src = keys;
+		key_index* dst = temp;
+
+		for (int d = 0; d < 8; ++d)
+		{
+			const unsigned shift = d * 8;
+			size_t* digit_counts = counts[d];
+
+			if (digit_counts[(src[0].key >> shift) & 0xFF] == num)
+				continue;
+
+			size_t offset = 0;
+			for (int v = 0; v < 256; ++v)
+			{
+				size_t c = digit_counts[v];
+				digit_counts[v] = offset;
+				offset += c;
+			}
+
+			for (size_t i = 0; i < num; ++i)
+				dst[digit_counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+			std::swap(src, dst);
+		}
+
+		return src;
+	}
+
+	/// Small ids of state pointers (textures, materials) for sort keys.
+	/// ids are given in order of appearance, 0 is null state.
+	/// open addressing table, neighbour items usually share state,
+	/// so last lookup is remembered
+	class state_ids
+	{
+	public:
+		state_ids() : num_ids(0), last_state(0), last_id(0) {}
+
+		void clear()
+		{
+			slot empty = {0, 0};
+			slots.assign(slots.empty() ? 64 : slots.size(), empty);
+			num_ids = 0;
+			last_state = 0;
+			last_id = 0;
+		}
+
+		unsigned get(const void* state)
+		{
+			if (state == last_state)
+				return last_id;
+
+			last_state = state;
+			last_id = 0 == state ? 0 : find(state);
+			return last_id;
+		}
+
+		unsigned size() const {return num_ids;}
+
+	private:
+		struct slot
+		{
+			const void* state;
+			unsigned	id;
+		};
+
+		unsigned find(const void* state)
+		{
+			if ((num_ids + 1) * 2 > slots.size())
+				grow();
+
+			const size_t mask = slots.size() - 1;
+			size_t i = hash(state) & mask;
+			for (; slots[i].state; i = (i + 1) & mask)
+			{
+				if (slots[i].state == state)
+					return slots[i].id;
+			}
+
+			slots[i].state = state;
+			slots[i].id = ++num_ids;
+			return num_ids;
+		}
+
+		static size_t hash(const void* state)
+		{
+			size_t h = (size_t)state;
+			h ^= h >> 16;
+			h *= 0x45D9F3B;
+			h ^= h >> 16;
+			return h;
+		}
+
+		void grow()
+		{
+			std::vector<slot> old;
+			old.swap(slots);
+
+			slot empty = {0, 0};
+			slots.assign(old.empty() ? 64 : old.size() * 2, empty);
+
+			const size_t mask = slots.size() - 1;
+			for (size_t j = 0; j < old.size(); ++j)
+			{
+				if (!old[j].state)
+					continue;
+
+				size_t i = hash(old[j].state) & mask;
+				while (slots[i].state)
+					i = (i + 1) & mask;
+				slots[i] = old[j];
+			}
+		}
+
+	private:
+		std::vector<slot> slots;
+		unsigned	num_ids;
+		const void* last_state;
+		unsigned	last_id;
+	};
+}
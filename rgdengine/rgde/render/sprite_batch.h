@@ -0,0 +1,200 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+
+#include <rgde/render/sort_keys.h>
+#include <rgde/render/atlas_packer.h>
+
+namespace render
+{
+	/// Draw order and vertices of sprite list. Sprites are ordered by priority,
+	/// then grouped by texture with radix sort of packed keys:
+	///   | priority 32 | texture id 32 |
+	/// Order is kept between frames, so quad of modified sprite can be rebuilt
+	/// in place while its priority and texture stay the same.
+	/// Sprite needs members pos, size, spin, priority, color, rect (get_top_left etc.)
+	/// and texture with get(). Vertex needs position.set(x, y, z, w), tex and color.
+	/// Independent from render device, so it can be tested and measured without D3D.
+	/// With atlas, texture of sprite found in it is replaced by atlas page: sprites of
+	/// different source textures on one page share run, their uv are remapped into page
+	/// while building vertices, sprite itself is not changed.
+	class sprite_batch
+	{
+	public:
+		/// sorted sprites with same texture
+		struct run
+		{
+			const void* texture;
+			unsigned	start;
+			unsigned	count;
+		};
+		typedef std::vector<run> runs;
+
+		template <typename Sprite>
+		void sort(const Sprite* sprites, size_t num)
+		{
+			sort(sprites, num, (const no_atlas*)0);
+		}
+
+		/// atlas needs find(texture) returning const atlas_region* or 0
+		template <typename Sprite, typename Atlas>
+		void sort(const Sprite* sprites, size_t num, const Atlas* atlas)
+		{
+			m_keys.resize(num);
+			m_temp.resize(num);
+			m_states.resize(num);
+			m_textures.clear();
+
+			for (size_t i = 0; i < num; ++i)
+			{
+				const Sprite& s = sprites[i];
+				state& st = m_states[i];
+				st.priority = priority_bits(s.priority);
+				st.source = s.texture.get();
+				st.region = atlas && st.source && in_unit_square(s.rect) ? atlas->find(s.texture.get()) : 0;
+				st.texture = st.region ? st.region->page_texture : st.source;
+
+				m_keys[i].key = ((sort_key)st.priority << 32) | m_textures.get(st.texture);
+				m_keys[i].index = (unsigned)i;
+			}
+
+			const key_index* sorted = num > 0 ? radix_sort(&m_keys[0], &m_temp[0], num) : 0;
+
+			m_order.resize(num);
+			m_slots.resize(num);
+			m_runs.resize(0);
+			for (size_t i = 0; i < num; ++i)
+			{
+				const unsigned index = sorted[i].index;
+				m_order[i] = index;
+				m_slots[index] = (unsigned)i;
+
+				const void* texture = m_states[index].texture;
+				if (m_runs.empty() || m_runs.back().texture != texture)
+				{
+					run r = {texture, (unsigned)i, 0};
+					m_runs.push_back(r);
+				}
+				++m_runs.back().count;
+			}
+		}
+
+		size_t size() const {return m_order.size();}
+		const runs& get_runs() const {return m_runs;}
+		/// index of sprite drawn at slot
+		unsigned get_sprite(size_t slot) const {return m_order[slot];}
+		/// position of sprite in draw order
+		unsigned get_slot(size_t sprite) const {return m_slots[sprite];}
+		/// place of sprite texture in atlas, 0 if sprite uses its own texture
+		const atlas_region* get_region(size_t sprite) const {return m_states[sprite].region;}
+
+		/// sprite keeps its place in draw order (same priority and texture as at sort)
+		template <typename Sprite>
+		bool same_order(const Sprite& s, size_t index) const
+		{
+			return index < m_states.size() && m_states[index].source == s.texture.get() &&
+				   m_states[index].priority == priority_bits(s.priority) &&
+				   (!m_states[index].region || in_unit_square(s.rect));
+		}
+
+		/// quads of slots [begin, end) in draw order, vertices are 4 per slot.
+		/// sprite position and size are multiplied by scale
+		template <typename Sprite, typename Vertex>
+		void build(const Sprite* sprites, size_t begin, size_t end, float scale_x, float scale_y, Vertex* vertices) const
+		{
+			for (size_t slot = begin; slot < end; ++slot)
+			{
+				const unsigned index = m_order[slot];
+				build_quad(sprites[index], scale_x, scale_y, vertices + slot * 4, m_states[index].region);
+			}
+		}
+
+		/// top left, top right, bottom right, bottom left corners of rotated sprite,
+		/// uv are remapped into atlas page if region is given
+		template <typename Sprite, typename Vertex>
+		static void build_quad(const Sprite& s, float scale_x, float scale_y, Vertex* v, const atlas_region* region = 0)
+		{
+			const float hx = s.size[0] * scale_x * 0.5f;
+			const float hy = s.size[1] * scale_y * 0.5f;
+			const float x = s.pos[0] * scale_x;
+			const float y = s.pos[1] * scale_y;
+
+			// offsets of right and bottom edges, most sprites are not rotated
+			float rx = hx, ry = 0, bx = 0, by = hy;
+			if (0 != s.spin)
+			{
+				const float cosa = std::cos(s.spin);
+				const float sina = std::sin(s.spin);
+				rx = hx * cosa;
+				ry = hx * sina;
+				bx = -hy * sina;
+				by = hy * cosa;
+			}
+
+			v[0].position.set(x - rx - bx, y - ry - by, 0, 0);
+			v[0].tex = s.rect.get_top_left();
+			v[0].color = s.color;
+
+			v[1].position.set(x + rx - bx, y + ry - by, 0, 0);
+			v[1].tex = s.rect.get_top_right();
+			v[1].color = s.color;
+
+			v[2].position.set(x + rx + bx, y + ry + by, 0, 0);
+			v[2].tex = s.rect.get_bottom_right();
+			v[2].color = s.color;
+
+			v[3].position.set(x - rx + bx, y - ry + by, 0, 0);
+			v[3].tex = s.rect.get_bottom_left();
+			v[3].color = s.color;
+
+			if (region)
+			{
+				for (int i = 0; i < 4; ++i)
+				{
+					v[i].tex[0] = region->offset[0] + v[i].tex[0] * region->scale[0];
+					v[i].tex[1] = region->offset[1] + v[i].tex[1] * region->scale[1];
+				}
+			}
+		}
+
+	private:
+		struct no_atlas
+		{
+			template <typename Texture>
+			const atlas_region* find(const Texture&) const {return 0;}
+		};
+
+		static unsigned priority_bits(unsigned long long priority)
+		{
+			return priority > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned)priority;
+		}
+
+		/// tiled sprites (uv out of [0, 1]) can't be drawn from atlas page
+		template <typename Rect>
+		static bool in_unit_square(const Rect& r)
+		{
+			const float u0 = r.get_top_left()[0], v0 = r.get_top_left()[1];
+			const float u1 = r.get_bottom_right()[0], v1 = r.get_bottom_right()[1];
+			return u0 >= 0 && u0 <= 1 && v0 >= 0 && v0 <= 1 && u1 >= 0 && u1 <= 1 && v1 >= 0 && v1 <= 1;
+		}
+
+		/// priority and texture of sprite at last sort,
+		/// texture is atlas page if source texture is in atlas
+		struct state
+		{
+			unsigned	priority;
+			const void* source;
+			const void* texture;
+			const atlas_region* region;
+		};
+
+		std::vector<key_index> m_keys;
+		std::vector<key_index> m_temp;
+		std::vector<state>	   m_states;
+		std::vector<unsigned>  m_order;
+		std::vector<unsigned>  m_slots;
+		runs				   m_runs;
+		state_ids			   m_textures;
+	};
+}
@@ -7,6 +7,8 @@
 #include <rgde/render/render_device.h>
 #include <rgde/render/manager.h>
 #include <rgde/render/geometry.h>
+#include <rgde/render/sprite_batch.h>
+#include <rgde/render/texture_atlas.h>
 
 namespace render
 {
@@ -30,10 +32,59 @@ namespace render
 			unsigned long uPriority_ = 0 );
 	};
 
+	typedef std::vector<sprite> sprites_vector;
+
+	/// Sprites kept between frames. Layer sorts sprites and builds their vertices
+	/// only when sprites are added or modified. Static layer keeps vertices in
+	/// managed buffer and rebuilds only quads of modified sprites while their
+	/// priority and texture are not changed, dynamic layer is meant for sprites
+	/// changed every frame: it is rebuilt completely, large ones on worker threads.
+	class sprite_layer : boost::noncopyable
+	{
+	public:
+		sprite_layer(bool is_static, int order);
+
+		/// returns index of sprite in layer
+		size_t			add(const sprite& s);
+		const sprite&	get(size_t index) const		{ return m_sprites[index]; }
+		/// sprite may be changed until next update
+		sprite&			modify(size_t index);
+		void			clear();
+
+		/// direct access, layer is rebuilt completely
+		sprites_vector&	sprites()					{ m_rebuild = true; return m_sprites; }
+		size_t			size() const				{ return m_sprites.size(); }
+
+		bool			is_static() const			{ return m_static; }
+		int				get_order() const			{ return m_order; }
+
+		void			hide()						{ m_visible = false; }
+		void			show()						{ m_visible = true; }
+		bool			visible() const				{ return m_visible; }
+
+	private:
+		friend class sprite_manager;
+
+		typedef indexed_geometry<vertex::PositionTransformedColoredTextured, false> geometry;
+
+		sprites_vector	m_sprites;
+		sprite_batch	m_batch;
+		geometry		m_geometry;
+		/// sprites changed since last update
+		std::vector<unsigned> m_modified;
+		/// sprites were added or removed, order must be rebuilt
+		bool			m_rebuild;
+		bool			m_static;
+		bool			m_visible;
+		int				m_order;
+	};
+
+	typedef boost::shared_ptr<sprite_layer> sprite_layer_ptr;
+
 	class sprite_manager : public device_object, public rendererable
 	{
 	public:
-		typedef std::vector<sprite> sprites_vector;
+		typedef render::sprites_vector sprites_vector;
 		typedef sprites_vector::iterator sprites_iter;
 
 		sprite_manager(int priority = 0);
@@ -41,7 +92,8 @@ namespace render
 	
 		void blending(bool bAditive) { m_aditive = bAditive; }
 
-		inline sprites_vector& sprites() { return m_sprites; }
+		/// sprites added by add(), they are drawn once
+		inline sprites_vector& sprites() { return m_immediate->sprites(); }
 		inline unsigned get_num_rendered() { return m_sprites_rendered; }
 
 		inline math::vec2f& origin() { return m_origin; }
@@ -49,30 +101,48 @@ namespace render
 
 		virtual void add(const sprite& s);
 
+		/// layers are drawn by order, sprites added by add() have order 0
+		/// and are drawn after layers with the same order
+		sprite_layer_ptr create_layer(bool is_static = true, int order = 0);
+		void			 remove_layer(const sprite_layer_ptr& layer);
+
+		/// sorts and builds vertices of changed layers
 		void update();
 
+		/// sprites of textures from atlas are drawn from its pages, few draw calls
+		/// for many textures. layers are rebuilt when textures are added to atlas
+		void set_atlas(const texture_atlas_ptr& atlas);
+		const texture_atlas_ptr& get_atlas() const { return m_atlas; }
+
 	protected:
 		void render();		
+		void render_layer(sprite_layer& layer);
+		void update_layer(sprite_layer& layer);
+		/// vertices of one chunk of large layer, runs on worker thread
+		void build_chunk(const sprite_layer& layer, vertex::PositionTransformedColoredTextured* vertices, size_t chunk);
 		
 		virtual void onLostDevice();
 		virtual void onResetDevice();
 
 	protected:
+		/// layers with more sprites are built on worker threads by chunks
+		enum { parallel_sprites = 8192, chunk_sprites = 2048 };
+		/// quads drawn by one call with 16 bit indices
+		enum { max_batch_sprites = 0x10000 / 4 };
+
 		bool m_aditive;
 
-		sprites_vector m_sprites;						// 
+		/// all layers sorted by order, m_immediate is last of layers with its order
+		std::vector<sprite_layer_ptr> m_layers;
+		sprite_layer_ptr m_immediate;				// ,   add
 		unsigned m_sprites_rendered;				///      
 
 		effect_ptr  m_effect;
 
-		typedef indexed_geometry<vertex::PositionTransformedColoredTextured, false> geometry;
-		geometry m_geometry;						/// 
+		texture_atlas_ptr m_atlas;
+		unsigned m_atlas_version;					/// atlas version layers were built with
 
-		unsigned m_reserved_size;					///  ,    
 
-		bool m_sorted;								///       
-		bool m_updated;							///     / 
-		
 		const math::vec2f m_screen_size;			//  ,      
 		math::vec2f m_scale;						//           
 		math::vec2f m_origin;
@@ -80,10 +150,7 @@ namespace render
 		effect::technique *m_additive_tech;
 		effect::technique *m_modulate_tech;
 		effect::parameter *m_texture_param;
-
-		///        
-		std::vector<unsigned> m_equal_priorities_num;	///       
 	};
 
 	typedef base::singelton<sprite_manager> TheSpriteManager;
-}
\ No newline at end of file
+}
\ No newline at end of file
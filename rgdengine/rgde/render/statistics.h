@@ -0,0 +1,292 @@
+#pragma once
+
+#include <vector>
+#include <ostream>
+#include <cstring>
+
+namespace render
+{
+	/// CPU stages of render_manager::renderScene
+	enum render_stage
+	{
+		stage_bounds,	///< bounds and spatial index update
+		stage_views,	///< culling and sorting of all camera views
+		stage_submit,	///< drawing of render queues
+		num_render_stages
+	};
+
+	/// counters of one rendered frame
+	struct frame_statistics
+	{
+		enum { max_cameras = 8 };
+
+		unsigned frame;
+
+		unsigned draw_calls;
+		/// pass begins, each applies render states of pass
+		unsigned state_changes;
+		unsigned technique_begins;
+		/// bytes copied into vertex and index buffers
+		unsigned upload_bytes;
+		/// part of upload_bytes written into shared dynamic buffers, and
+		/// discards of these buffers when they got full
+		unsigned dynamic_upload_bytes;
+		unsigned dynamic_discards;
+		unsigned verts;
+		unsigned tris;
+
+		/// triangles of meshes with detail levels: full and drawn
+		unsigned lod_full_tris;
+		unsigned lod_tris;
+
+		/// objects summed over all cameras
+		unsigned visible_objects;
+		unsigned culled_objects;
+		/// objects in frustum hidden by occluders and rasterized occluder triangles
+		unsigned occluded_objects;
+		unsigned occluder_tris;
+
+		unsigned num_cameras;
+		unsigned camera_visible[max_cameras];
+		unsigned camera_culled[max_cameras];
+
+		float stage_ms[num_render_stages];
+		/// time from previous frame end
+		float frame_ms;
+		/// GPU time of frame, arrives few frames later. negative if not measured
+		float gpu_ms;
+
+		void reset(unsigned frame_number)
+		{
+			memset(this, 0, sizeof(*this));
+			frame = frame_number;
+			gpu_ms = -1.0f;
+		}
+	};
+
+	/// Ring buffer of statistics of last frames. Current frame is filled by render
+	/// device and stored by end_frame, oldest frames are overwritten.
+	/// Independent from render device, so it can be tested without D3D.
+	class statistics_history
+	{
+	public:
+		explicit statistics_history(size_t capacity = 120)
+			: m_frame(0)
+		{
+			set_capacity(capacity);
+		}
+
+		/// drops stored frames
+		void set_capacity(size_t capacity)
+		{
+			m_frames.resize(capacity > 0 ? capacity : 1);
+			m_next = 0;
+			m_size = 0;
+			m_current.reset(m_frame);
+		}
+
+		size_t capacity() const {return m_frames.size();}
+		/// number of stored frames
+		size_t size() const {return m_size;}
+
+		frame_statistics& current() {return m_current;}
+		const frame_statistics& current() const {return m_current;}
+
+		/// stores current frame and starts next one
+		void end_frame()
+		{
+			m_frames[m_next] = m_current;
+			m_next = (m_next + 1) % m_frames.size();
+			if (m_size < m_frames.size())
+				++m_size;
+
+			m_current.reset(++m_frame);
+		}
+
+		/// stored frame, age 0 is last one
+		const frame_statistics& get(size_t age) const
+		{
+			return m_frames[(m_next + m_frames.size() - 1 - age) % m_frames.size()];
+		}
+
+		/// stored frame by number, 0 if it was overwritten
+		frame_statistics* find(unsigned frame)
+		{
+			const unsigned age = m_frame - 1 - frame;
+			if (frame >= m_frame || age >= m_size)
+				return 0;
+			return &m_frames[(m_next + m_frames.size() - 1 - age) % m_frames.size()];
+		}
+
+		/// average of stored frames, gpu time is averaged over measured frames only
+		frame_statistics average() const
+		{
+			frame_statistics avg;
+			avg.reset(m_frame);
+			if (0 == m_size)
+				return avg;
+
+			double sum[num_counters] = {0};
+			double stage_sum[num_render_stages] = {0};
+			double camera_sum[frame_statistics::max_cameras][2] = {{0}};
+			double frame_sum = 0, gpu_sum = 0;
+			unsigned gpu_num = 0;
+
+			for (size_t i = 0; i < m_size; ++i)
+			{
+				const frame_statistics& f = get(i);
+				for (int c = 0; c < num_counters; ++c)
+					sum[c] += f.*counters()[c].value;
+				for (int s = 0; s < num_render_stages; ++s)
+					stage_sum[s] += f.stage_ms[s];
+				for (unsigned c = 0; c < f.num_cameras && c < frame_statistics::max_cameras; ++c)
+				{
+					camera_sum[c][0] += f.camera_visible[c];
+					camera_sum[c][1] += f.camera_culled[c];
+				}
+				frame_sum += f.frame_ms;
+				if (f.gpu_ms >= 0)
+				{
+					gpu_sum += f.gpu_ms;
+					++gpu_num;
+				}
+			}
+
+			for (int c = 0; c < num_counters; ++c)
+				avg.*counters()[c].value = (unsigned)(sum[c] / m_size + 0.5);
+			for (int s = 0; s < num_render_stages; ++s)
+				avg.stage_ms[s] = (float)(stage_sum[s] / m_size);
+			for (unsigned c = 0; c < avg.num_cameras && c < frame_statistics::max_cameras; ++c)
+			{
+				avg.camera_visible[c] = (unsigned)(camera_sum[c][0] / m_size + 0.5);
+				avg.camera_culled[c] = (unsigned)(camera_sum[c][1] / m_size + 0.5);
+			}
+			avg.frame_ms = (float)(frame_sum / m_size);
+			avg.gpu_ms = gpu_num > 0 ? (float)(gpu_sum / gpu_num) : -1.0f;
+			return avg;
+		}
+
+		/// stored frames, oldest first, one row per frame with header row
+		void write_csv(std::ostream& out) const
+		{
+			const unsigned cameras = max_cameras();
+
+			out << "frame,frame_ms,gpu_ms";
+			for (int s = 0; s < num_render_stages; ++s)
+				out << "," << stage_name(s) << "_ms";
+			for (int c = 0; c < num_counters; ++c)
+				out << "," << counters()[c].name;
+			for (unsigned c = 0; c < cameras; ++c)
+				out << ",camera" << c << "_visible,camera" << c << "_culled";
+			out << "\n";
+
+			for (size_t i = m_size; i-- > 0;)
+			{
+				const frame_statistics& f = get(i);
+				out << f.frame << "," << f.frame_ms << "," << f.gpu_ms;
+				for (int s = 0; s < num_render_stages; ++s)
+					out << "," << f.stage_ms[s];
+				for (int c = 0; c < num_counters; ++c)
+					out << "," << f.*counters()[c].value;
+				for (unsigned c = 0; c < cameras; ++c)
+				{
+					if (c < f.num_cameras)
+						out << "," << f.camera_visible[c] << "," << f.camera_culled[c];
+					else
+						out << ",,";
+				}
+				out << "\n";
+			}
+		}
+
+		/// stored frames, oldest first: {"frames": [{...}, ...]}
+		void write_json(std::ostream& out) const
+		{
+			out << "{\"frames\": [";
+			for (size_t i = m_size; i-- > 0;)
+			{
+				const frame_statistics& f = get(i);
+				out << (i + 1 == m_size ? "\n" : ",\n");
+				out << "  {\"frame\": " << f.frame << ", \"frame_ms\": " << f.frame_ms << ", \"gpu_ms\": ";
+				if (f.gpu_ms >= 0)
+					out << f.gpu_ms;
+				else
+					out << "null";
+
+				out << ", \"stages_ms\": {";
+				for (int s = 0; s < num_render_stages; ++s)
+					out << (s > 0 ? ", " : "") << "\"" << stage_name(s) << "\": " << f.stage_ms[s];
+				out << "}";
+
+				for (int c = 0; c < num_counters; ++c)
+					out << ", \"" << counters()[c].name << "\": " << f.*counters()[c].value;
+
+				out << ", \"cameras\": [";
+				for (unsigned c = 0; c < f.num_cameras && c < frame_statistics::max_cameras; ++c)
+				{
+					out << (c > 0 ? ", " : "") << "{\"visible\": " << f.camera_visible[c]
+						<< ", \"culled\": " << f.camera_culled[c] << "}";
+				}
+				out << "]}";
+			}
+			out << "\n]}\n";
+		}
+
+		static const char* stage_name(int stage)
+		{
+			static const char* names[num_render_stages] = {"bounds", "views", "submit"};
+			return stage >= 0 && stage < num_render_stages ? names[stage] : "unknown";
+		}
+
+	private:
+		typedef unsigned frame_statistics::* counter_ptr;
+
+		struct counter
+		{
+			const char* name;
+			counter_ptr value;
+		};
+
+		enum { num_counters = 15 };
+
+		/// plain counters, in output order
+		static const counter* counters()
+		{
+			static const counter list[num_counters] = {
+				{"draw_calls",		 &frame_statistics::draw_calls},
+				{"state_changes",	 &frame_statistics::state_changes},
+				{"technique_begins", &frame_statistics::technique_begins},
+				{"upload_bytes",	 &frame_statistics::upload_bytes},
+				{"dynamic_upload_bytes", &frame_statistics::dynamic_upload_bytes},
+				{"dynamic_discards", &frame_statistics::dynamic_discards},
+				{"verts",			 &frame_statistics::verts},
+				{"tris",			 &frame_statistics::tris},
+				{"lod_full_tris",	 &frame_statistics::lod_full_tris},
+				{"lod_tris",		 &frame_statistics::lod_tris},
+				{"visible_objects",	 &frame_statistics::visible_objects},
+				{"culled_objects",	 &frame_statistics::culled_objects},
+				{"occluded_objects", &frame_statistics::occluded_objects},
+				{"occluder_tris",	 &frame_statistics::occluder_tris},
+				{"num_cameras",		 &frame_statistics::num_cameras}
+			};
+			return list;
+		}
+
+		/// largest camera count of stored frames
+		unsigned max_cameras() const
+		{
+			unsigned num = 0;
+			for (size_t i = 0; i < m_size; ++i)
+				if (get(i).num_cameras > num)
+					num = get(i).num_cameras;
+			return num < frame_statistics::max_cameras ? num : frame_statistics::max_cameras;
+		}
+
+	private:
+		std::vector<frame_statistics> m_frames;
+		frame_statistics m_current;
+		size_t	 m_next;
+		size_t	 m_size;
+		unsigned m_frame;
+	};
+}
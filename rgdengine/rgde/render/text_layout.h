@@ -0,0 +1,392 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cmath>
+
+#include <rgde/render/atlas_packer.h>
+
+namespace render
+{
+	/// text format flags, same values as font::FontFormat
+	enum text_format
+	{
+		text_center		 = 0x001,
+		text_right		 = 0x002,
+		text_vcenter	 = 0x004,
+		text_bottom		 = 0x008,
+		text_word_break	 = 0x010,
+		text_single_line = 0x020,
+		text_expand_tabs = 0x040,
+		text_no_clip	 = 0x100
+	};
+
+	/// rasterized glyph, metrics are in pixels
+	struct glyph
+	{
+		float	 advance;
+		/// offset of bitmap left edge from pen position
+		int		 left;
+		/// height of bitmap top edge above baseline
+		int		 top;
+		unsigned width;
+		unsigned height;
+		unsigned page;
+		/// u0, v0, u1, v1 of bitmap in page
+		float	 uv[4];
+	};
+
+	/// Glyphs of one font placed into pages by skyline packer. Bitmaps are
+	/// rasterized and uploaded by owner, cache only gives them place.
+	class glyph_cache
+	{
+	public:
+		explicit glyph_cache(unsigned page_size = 256, unsigned padding = 1)
+			: m_page_size(page_size)
+			, m_padding(padding)
+		{
+		}
+
+		const glyph* find(wchar_t c) const
+		{
+			glyphs::const_iterator it = m_glyphs.find(c);
+			return it == m_glyphs.end() ? 0 : &it->second;
+		}
+
+		/// places bitmap of new glyph at x, y of its page (page may be new, see
+		/// get_num_pages). returns 0 if bitmap is larger than page
+		const glyph* add(wchar_t c, float advance, int left, int top, unsigned width, unsigned height,
+						 unsigned& x, unsigned& y)
+		{
+			glyph g = {advance, left, top, width, height, 0, {0, 0, 0, 0}};
+			x = y = 0;
+
+			if (width > 0 && height > 0)
+			{
+				const unsigned w = width + m_padding * 2, h = height + m_padding * 2;
+				if (w > m_page_size || h > m_page_size)
+					return 0;
+
+				while (g.page < m_pages.size() && !m_pages[g.page].insert(w, h, x, y))
+					++g.page;
+
+				if (g.page == m_pages.size())
+				{
+					m_pages.push_back(skyline_packer(m_page_size, m_page_size));
+					m_pages.back().insert(w, h, x, y);
+				}
+
+				x += m_padding;
+				y += m_padding;
+				g.uv[0] = (float)x / m_page_size;
+				g.uv[1] = (float)y / m_page_size;
+				g.uv[2] = (float)(x + width) / m_page_size;
+				g.uv[3] = (float)(y + height) / m_page_size;
+			}
+
+			glyph& placed = m_glyphs[c];
+			placed = g;
+			return &placed;
+		}
+
+		size_t		size() const			{ return m_glyphs.size(); }
+		unsigned	get_num_pages() const	{ return (unsigned)m_pages.size(); }
+		unsigned	get_page_size() const	{ return m_page_size; }
+
+	private:
+		typedef std::map<wchar_t, glyph> glyphs;
+
+		glyphs						m_glyphs;
+		std::vector<skyline_packer> m_pages;
+		unsigned					m_page_size;
+		unsigned					m_padding;
+	};
+
+	/// glyph bitmap placed relative to layout rectangle, in pixels
+	struct glyph_quad
+	{
+		float	 x, y, w, h;
+		float	 uv[4];
+		unsigned page;
+	};
+
+	/// laid out text
+	struct text_layout
+	{
+		std::vector<glyph_quad> quads;
+		/// extent of text lines
+		float width;
+		float height;
+		/// all glyphs were found, incomplete layout should not be cached
+		bool  complete;
+	};
+
+	namespace text_detail
+	{
+		/// pen advance of character, tabs are expanded to 8 spaces stops
+		template <typename Glyphs>
+		float advance(wchar_t c, float pen, int flags, Glyphs& glyphs)
+		{
+			if (L'\r' == c || L'\n' == c)
+				return 0;
+
+			if (L'\t' == c)
+			{
+				const glyph* space = glyphs(L' ');
+				const float space_width = space ? space->advance : 0;
+				if (!(flags & text_expand_tabs) || space_width <= 0)
+					return space_width;
+
+				const float tab = space_width * 8;
+				return (std::floor(pen / tab) + 1) * tab - pen;
+			}
+
+			const glyph* g = glyphs(c);
+			return g ? g->advance : 0;
+		}
+
+		/// width of characters [begin, end) without trailing spaces
+		template <typename Glyphs>
+		float measure(const wchar_t* text, size_t begin, size_t end, int flags, Glyphs& glyphs)
+		{
+			while (end > begin && (L' ' == text[end - 1] || L'\t' == text[end - 1] || L'\r' == text[end - 1]))
+				--end;
+
+			float pen = 0;
+			for (size_t i = begin; i < end; ++i)
+				pen += advance(text[i], pen, flags, glyphs);
+			return pen;
+		}
+
+		struct line
+		{
+			size_t begin;
+			size_t end;
+		};
+	}
+
+	/// Lays text out in rectangle of width x height pixels as font::render does
+	/// with the same flags: lines are broken at '\n' and, with word break, between
+	/// words; lines are aligned and glyphs are clipped by rectangle unless text_no_clip.
+	/// Zero width or height means rectangle is unbounded in that direction.
+	/// Glyphs is functor returning const glyph* of character, 0 if font has none.
+	template <typename Glyphs>
+	void layout_text(const wchar_t* text, size_t length, float width, float height, int flags,
+					 float line_height, float ascent, Glyphs& glyphs, text_layout& layout)
+	{
+		using namespace text_detail;
+
+		layout.quads.resize(0);
+		layout.width = 0;
+		layout.height = 0;
+		layout.complete = true;
+
+		const bool single_line = 0 != (flags & text_single_line);
+		const bool wrap = 0 != (flags & text_word_break) && width > 0 && !single_line;
+
+		// line breaking
+		std::vector<line> lines;
+		line current = {0, 0};
+		size_t last_break = length;
+		float pen = 0;
+
+		for (size_t i = 0; i < length; ++i)
+		{
+			const wchar_t c = text[i];
+			if (L'\n' == c && !single_line)
+			{
+				current.end = i;
+				lines.push_back(current);
+				current.begin = i + 1;
+				last_break = length;
+				pen = 0;
+				continue;
+			}
+
+			const float a = advance(c, pen, flags, glyphs);
+			if (wrap && L' ' != c && pen + a > width && last_break != length)
+			{
+				current.end = last_break;
+				lines.push_back(current);
+
+				current.begin = last_break + 1;
+				while (current.begin < i && L' ' == text[current.begin])
+					++current.begin;
+
+				last_break = length;
+				pen = 0;
+				for (size_t j = current.begin; j < i; ++j)
+					pen += advance(text[j], pen, flags, glyphs);
+			}
+
+			if (L' ' == c || L'\t' == c)
+				last_break = i;
+
+			pen += advance(c, pen, flags, glyphs);
+		}
+
+		current.end = length;
+		lines.push_back(current);
+
+		// placement
+		layout.height = lines.size() * line_height;
+
+		float top = 0;
+		if (height > 0 && (flags & text_bottom))
+			top = height - layout.height;
+		else if (height > 0 && (flags & text_vcenter))
+			top = std::floor((height - layout.height) * 0.5f + 0.5f);
+
+		const bool clip_x = width > 0 && !(flags & text_no_clip);
+		const bool clip_y = height > 0 && !(flags & text_no_clip);
+
+		for (size_t l = 0; l < lines.size(); ++l)
+		{
+			const line& ln = lines[l];
+			const float line_width = measure(text, ln.begin, ln.end, flags, glyphs);
+			layout.width = (std::max)(layout.width, line_width);
+
+			float left = 0;
+			if (width > 0 && (flags & text_right))
+				left = width - line_width;
+			else if (width > 0 && (flags & text_center))
+				left = std::floor((width - line_width) * 0.5f + 0.5f);
+
+			const float baseline = top + l * line_height + ascent;
+
+			pen = 0;
+			for (size_t i = ln.begin; i < ln.end; ++i)
+			{
+				const wchar_t c = text[i];
+				const float a = advance(c, pen, flags, glyphs);
+
+				const glyph* g = L'\t' == c || L'\r' == c ? 0 : glyphs(c);
+				if (!g && L'\t' != c && L'\r' != c)
+					layout.complete = false;
+
+				if (g && g->width > 0 && g->height > 0)
+				{
+					glyph_quad q;
+					q.x = left + pen + g->left;
+					q.y = baseline - g->top;
+					q.w = (float)g->width;
+					q.h = (float)g->height;
+					q.page = g->page;
+					for (int k = 0; k < 4; ++k)
+						q.uv[k] = g->uv[k];
+
+					// clipped part of bitmap is cut from uv too
+					const float du = (q.uv[2] - q.uv[0]) / q.w, dv = (q.uv[3] - q.uv[1]) / q.h;
+					if (clip_x && q.x < 0)				{ q.uv[0] -= q.x * du; q.w += q.x; q.x = 0; }
+					if (clip_x && q.x + q.w > width)	{ q.uv[2] -= (q.x + q.w - width) * du; q.w = width - q.x; }
+					if (clip_y && q.y < 0)				{ q.uv[1] -= q.y * dv; q.h += q.y; q.y = 0; }
+					if (clip_y && q.y + q.h > height)	{ q.uv[3] -= (q.y + q.h - height) * dv; q.h = height - q.y; }
+
+					if (q.w > 0 && q.h > 0)
+						layout.quads.push_back(q);
+				}
+
+				pen += a;
+			}
+		}
+	}
+
+	/// Layouts of strings kept between frames, so unchanged text is not laid out
+	/// again. Layouts not used for some frames are dropped.
+	class layout_cache
+	{
+	public:
+		layout_cache() : m_frame(0), m_size(0) {}
+
+		/// layout of the same text, size and flags made earlier, 0 if there is none
+		const text_layout* find(const std::wstring& text, float width, float height, int flags)
+		{
+			texts::iterator it = m_texts.find(text);
+			if (it == m_texts.end())
+				return 0;
+
+			for (size_t i = 0; i < it->second.size(); ++i)
+			{
+				entry& e = it->second[i];
+				if (e.width == width && e.height == height && e.flags == flags)
+				{
+					e.last_frame = m_frame;
+					return &e.layout;
+				}
+			}
+			return 0;
+		}
+
+		/// place for new layout, it is filled by caller
+		text_layout& add(const std::wstring& text, float width, float height, int flags)
+		{
+			entry e;
+			e.layout.width = 0;
+			e.layout.height = 0;
+			e.layout.complete = false;
+			e.width = width;
+			e.height = height;
+			e.flags = flags;
+			e.last_frame = m_frame;
+
+			std::vector<entry>& entries = m_texts[text];
+			entries.push_back(e);
+			++m_size;
+			return entries.back().layout;
+		}
+
+		/// starts next frame, layouts not used for max_age frames are dropped
+		void next_frame(unsigned max_age)
+		{
+			++m_frame;
+			if (m_frame % 64)
+				return;
+
+			for (texts::iterator it = m_texts.begin(); it != m_texts.end();)
+			{
+				std::vector<entry>& entries = it->second;
+				for (size_t i = 0; i < entries.size();)
+				{
+					if (m_frame - entries[i].last_frame > max_age)
+					{
+						entries[i] = entries.back();
+						entries.pop_back();
+						--m_size;
+					}
+					else
+						++i;
+				}
+
+				if (entries.empty())
+					m_texts.erase(it++);
+				else
+					++it;
+			}
+		}
+
+		size_t size() const { return m_size; }
+
+		void clear()
+		{
+			m_texts.clear();
+			m_size = 0;
+		}
+
+	private:
+		struct entry
+		{
+			text_layout layout;
+			float		width;
+			float		height;
+			int			flags;
+			unsigned	last_frame;
+		};
+
+		typedef std::map<std::wstring, std::vector<entry> > texts;
+
+		texts		m_texts;
+		unsigned	m_frame;
+		size_t		m_size;
+	};
+}
@@ -121,5 +121,29 @@ namespace render
 		virtual	bool		  has_alpha()  const = 0;
 
 		virtual const std::string& get_filename() const = 0;
+
+		/// texture is drawn over screen_pixels pixels (larger side) this frame.
+		/// cooked textures stream mip levels by largest request, others ignore it
+		virtual void		  request_detail(float screen_pixels) {}
 	};
+
+	/// Mip streaming of cooked textures ("<name>.tex" made by TextureCooker, see
+	/// texture_cooker.h). Levels finer than needed for requested sizes are not loaded,
+	/// resident levels of all textures are kept within budget (see texture_streaming.h)
+	namespace texture_streaming
+	{
+		void	set_budget(size_t bytes);
+		size_t	get_budget();
+		/// bytes of finer levels loaded per update, at least one texture is loaded
+		void	set_upload_limit(size_t bytes);
+		size_t	get_upload_limit();
+
+		/// there are streamed textures
+		bool	is_active();
+		size_t	get_resident_bytes();
+
+		/// plans levels by requests since previous update, then drops and loads levels.
+		/// called by render_manager once per frame after renderables are gathered
+		void	update();
+	}
 }
\ No newline at end of file
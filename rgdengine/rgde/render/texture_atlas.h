@@ -0,0 +1,59 @@
+#pragma once
+
+#include <rgde/render/texture.h>
+#include <rgde/render/atlas_packer.h>
+
+namespace render
+{
+	/// Small 2d textures copied into shared A8R8G8B8 pages, so sprites of different
+	/// textures can be drawn by one call (see sprite_batch). Borders of every copy
+	/// are extended into padding, and pages have only mip levels which fit into
+	/// padding, so filtering doesn't bleed neighbour images.
+	/// Source textures stay usable, atlas holds them so their addresses are not reused.
+	class texture_atlas : boost::noncopyable
+	{
+	public:
+		explicit texture_atlas(unsigned page_size = 1024, unsigned padding = 4);
+
+		/// returns false if texture is not 2d, larger than half of page or can't be copied
+		bool add(const texture_ptr& source);
+		/// textures are packed from higher to lower, which packs tighter than adding
+		/// them one by one. returns number of added textures
+		unsigned add(const std::vector<texture_ptr>& sources);
+
+		/// 0 if texture is not in atlas
+		const atlas_region* find(const texture* source) const;
+
+		unsigned		get_num_pages() const			{ return (unsigned)m_pages.size(); }
+		const texture_ptr& get_page(unsigned index) const { return m_pages[index].texture; }
+		/// part of page area taken by images and their padding
+		float			get_occupancy(unsigned index) const { return m_pages[index].packer.occupancy(); }
+
+		/// changed when textures are added, users of atlas rebuild their uv
+		unsigned		get_version() const				{ return m_version; }
+
+	private:
+		struct page
+		{
+			skyline_packer	packer;
+			texture_ptr		texture;
+			bool			dirty;
+		};
+
+		bool insert(const texture_ptr& source);
+		/// rebuilds mip levels of changed pages
+		void update_pages();
+
+	private:
+		typedef std::map<const texture*, atlas_region> regions;
+
+		std::vector<page>		 m_pages;
+		regions					 m_regions;
+		std::vector<texture_ptr> m_sources;
+		unsigned				 m_page_size;
+		unsigned				 m_padding;
+		unsigned				 m_version;
+	};
+
+	typedef boost::shared_ptr<texture_atlas> texture_atlas_ptr;
+}
@@ -0,0 +1,614 @@
+//////////////////////////////////////////////////////////////////////////
+// description: offline texture cooking, used by TextureCooker tool.
+//   Mip chain is generated by box filter, levels are block compressed
+//   (DXT1, DXT5) or kept as A8R8G8B8 and stored in cooked texture file
+//   "<name>.tex" next to the source: header, level table, level data from
+//   coarsest to finest. Runtime reads levels separately, so they can be
+//   streamed by on screen size (see texture_streaming.h).
+//   Has no render device or engine dependencies.
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace render
+{
+	namespace cooker
+	{
+		enum format
+		{
+			format_argb8	= 0,
+			format_dxt1		= 1,
+			format_dxt5		= 2
+		};
+
+		const unsigned file_magic	= 0x54534752; // "RGST"
+		const unsigned file_version	= 1;
+		/// magic, version, format, width, height, levels, source hash
+		const unsigned fixed_header_size = 32;
+		const unsigned level_entry_size = 16;
+		const unsigned max_levels = 16;
+
+		/// BGRA bytes (A8R8G8B8 in memory), rows from top
+		struct image
+		{
+			unsigned width;
+			unsigned height;
+			std::vector<unsigned char> pixels;
+
+			image() : width(0), height(0) {}
+			image(unsigned w, unsigned h) : width(w), height(h), pixels(w * h * 4) {}
+
+			unsigned char* at(unsigned x, unsigned y) {return &pixels[(y * width + x) * 4];}
+			const unsigned char* at(unsigned x, unsigned y) const {return &pixels[(y * width + x) * 4];}
+		};
+
+		/// level placement in file
+		struct level_info
+		{
+			unsigned offset;
+			unsigned size;
+			unsigned width;
+			unsigned height;
+		};
+
+		struct header
+		{
+			unsigned			magic;
+			unsigned			version;
+			unsigned			format;
+			unsigned			width;
+			unsigned			height;
+			/// hash of source file, lets cooker skip unchanged sources
+			unsigned long long	source_hash;
+			/// finest level first
+			std::vector<level_info> levels;
+		};
+
+		struct cooked_level
+		{
+			unsigned width;
+			unsigned height;
+			std::vector<unsigned char> data;
+		};
+
+		inline unsigned level_dim(unsigned size, unsigned level)
+		{
+			size >>= level;
+			return size > 0 ? size : 1;
+		}
+
+		/// full chain down to 1x1
+		inline unsigned num_levels(unsigned width, unsigned height)
+		{
+			unsigned levels = 1;
+			for (unsigned size = width > height ? width : height; size > 1; size >>= 1)
+				++levels;
+			return levels;
+		}
+
+		inline bool is_compressed(format f) {return format_argb8 != f;}
+
+		/// bytes of one row of pixels or 4x4 blocks
+		inline unsigned row_pitch(format f, unsigned width)
+		{
+			if (!is_compressed(f))
+				return width * 4;
+			return (width + 3) / 4 * (format_dxt1 == f ? 8 : 16);
+		}
+
+		/// rows of pixels or 4x4 blocks
+		inline unsigned num_rows(format f, unsigned height)
+		{
+			return is_compressed(f) ? (height + 3) / 4 : height;
+		}
+
+		inline unsigned level_bytes(format f, unsigned width, unsigned height)
+		{
+			return row_pitch(f, width) * num_rows(f, height);
+		}
+
+		inline bool has_alpha(const image& img)
+		{
+			for (size_t i = 3; i < img.pixels.size(); i += 4)
+				if (img.pixels[i] != 255)
+					return true;
+			return false;
+		}
+
+		/// FNV-1a
+		inline unsigned long long hash(const unsigned char* data, size_t size)
+		{
+			unsigned long long h = 14695981039346656037ULL;
+			for (size_t i = 0; i < size; ++i)
+			{
+				h ^= data[i];
+				h *= 1099511628211ULL;
+			}
+			return h;
+		}
+
+		/// next level by 2x2 box filter, odd or unit side is filtered along the other one only
+		inline void downsample(const image& src, image& dst)
+		{
+			dst = image(level_dim(src.width, 1), level_dim(src.height, 1));
+			const unsigned sx = src.width > 1 ? 2 : 1;
+			const unsigned sy = src.height > 1 ? 2 : 1;
+
+			for (unsigned y = 0; y < dst.height; ++y)
+			{
+				for (unsigned x = 0; x < dst.width; ++x)
+				{
+					unsigned sum[4] = {0, 0, 0, 0};
+					for (unsigned j = 0; j < sy; ++j)
+					{
+						for (unsigned i = 0; i < sx; ++i)
+						{
+							const unsigned px = x * sx + i < src.width ? x * sx + i : src.width - 1;
+							const unsigned py = y * sy + j < src.height ? y * sy + j : src.height - 1;
+							const unsigned char* p = src.at(px, py);
+							for (int c = 0; c < 4; ++c)
+								sum[c] += p[c];
+						}
+					}
+
+					const unsigned n = sx * sy;
+					unsigned char* d = dst.at(x, y);
+					for (int c = 0; c < 4; ++c)
+						d[c] = (unsigned char)((sum[c] + n / 2) / n);
+				}
+			}
+		}
+
+		namespace detail
+		{
+			inline unsigned short pack565(const float c[3])
+			{
+				// c is b, g, r
+				const int b = (int)(c[0] * 31 / 255 + 0.5f);
+				const int g = (int)(c[1] * 63 / 255 + 0.5f);
+				const int r = (int)(c[2] * 31 / 255 + 0.5f);
+				return (unsigned short)(((r < 0 ? 0 : (r > 31 ? 31 : r)) << 11) |
+										((g < 0 ? 0 : (g > 63 ? 63 : g)) << 5) |
+										(b < 0 ? 0 : (b > 31 ? 31 : b)));
+			}
+
+			inline void unpack565(unsigned short v, int c[3])
+			{
+				const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+				c[0] = (b << 3) | (b >> 2);
+				c[1] = (g << 2) | (g >> 4);
+				c[2] = (r << 3) | (r >> 2);
+			}
+
+			/// 4 colors of block with c0 > c1, 3 colors and black otherwise
+			inline void color_palette(unsigned short c0, unsigned short c1, int palette[4][3])
+			{
+				unpack565(c0, palette[0]);
+				unpack565(c1, palette[1]);
+				for (int k = 0; k < 3; ++k)
+				{
+					if (c0 > c1)
+					{
+						palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+						palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+					}
+					else
+					{
+						palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+						palette[3][k] = 0;
+					}
+				}
+			}
+
+			inline void alpha_palette(int a0, int a1, int palette[8])
+			{
+				palette[0] = a0;
+				palette[1] = a1;
+				if (a0 > a1)
+				{
+					for (int i = 1; i < 7; ++i)
+						palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+				}
+				else
+				{
+					for (int i = 1; i < 5; ++i)
+						palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+					palette[6] = 0;
+					palette[7] = 255;
+				}
+			}
+
+			inline void write16(unsigned char* out, unsigned v)
+			{
+				out[0] = (unsigned char)v;
+				out[1] = (unsigned char)(v >> 8);
+			}
+
+			inline unsigned read16(const unsigned char* in)
+			{
+				return in[0] | (in[1] << 8);
+			}
+
+			/// 4x4 pixels of image, edges are replicated
+			inline void read_block(const image& img, unsigned bx, unsigned by, unsigned char block[64])
+			{
+				for (unsigned y = 0; y < 4; ++y)
+				{
+					for (unsigned x = 0; x < 4; ++x)
+					{
+						const unsigned px = bx * 4 + x < img.width ? bx * 4 + x : img.width - 1;
+						const unsigned py = by * 4 + y < img.height ? by * 4 + y : img.height - 1;
+						const unsigned char* p = img.at(px, py);
+						for (int c = 0; c < 4; ++c)
+							block[(y * 4 + x) * 4 + c] = p[c];
+					}
+				}
+			}
+		}
+
+		/// DXT1 color block in four color mode. Endpoints are ends of colors range along
+		/// their principal axis, inset by 1/16 of range, pixels take nearest palette color
+		inline void compress_color_block(const unsigned char block[64], unsigned char out[8])
+		{
+			float mean[3] = {0, 0, 0};
+			for (int i = 0; i < 16; ++i)
+				for (int k = 0; k < 3; ++k)
+					mean[k] += block[i * 4 + k] / 16.0f;
+
+			float cov[6] = {0, 0, 0, 0, 0, 0};
+			for (int i = 0; i < 16; ++i)
+			{
+				const float d[3] = {block[i * 4] - mean[0], block[i * 4 + 1] - mean[1], block[i * 4 + 2] - mean[2]};
+				cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+				cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+			}
+
+			// principal axis by power iteration, green is weighted most by eye
+			float axis[3] = {0.3f, 0.6f, 0.3f};
+			for (int iteration = 0; iteration < 8; ++iteration)
+			{
+				const float a[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+									cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+									cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+				const float length = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+				if (length < 1e-6f)
+					break;
+				for (int k = 0; k < 3; ++k)
+					axis[k] = a[k] / length;
+			}
+
+			float min_t = 1e30f, max_t = -1e30f;
+			for (int i = 0; i < 16; ++i)
+			{
+				const float t = (block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1]
+							  + (block[i * 4 + 2] - mean[2]) * axis[2];
+				min_t = t < min_t ? t : min_t;
+				max_t = t > max_t ? t : max_t;
+			}
+
+			const float inset = (max_t - min_t) / 16;
+			float e0[3], e1[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				e0[k] = mean[k] + axis[k] * (max_t - inset);
+				e1[k] = mean[k] + axis[k] * (min_t + inset);
+			}
+
+			unsigned short c0 = detail::pack565(e0), c1 = detail::pack565(e1);
+			if (c0 < c1)
+			{
+				const unsigned short t = c0;
+				c0 = c1;
+				c1 = t;
+			}
+
+			unsigned indices = 0;
+			if (c0 != c1)
+			{
+				int palette[4][3];
+				detail::color_palette(c0, c1, palette);
+				for (int i = 0; i < 16; ++i)
+				{
+					int best = 0, best_distance = 0x7FFFFFFF;
+					for (int p = 0; p < 4; ++p)
+					{
+						int distance = 0;
+						for (int k = 0; k < 3; ++k)
+						{
+							const int d = block[i * 4 + k] - palette[p][k];
+							distance += d * d;
+						}
+						if (distance < best_distance)
+						{
+							best_distance = distance;
+							best = p;
+						}
+					}
+					indices |= (unsigned)best << (2 * i);
+				}
+			}
+
+			detail::write16(out, c0);
+			detail::write16(out + 2, c1);
+			detail::write16(out + 4, indices & 0xFFFF);
+			detail::write16(out + 6, indices >> 16);
+		}
+
+		/// DXT5 alpha block in eight value mode between block minimum and maximum
+		inline void compress_alpha_block(const unsigned char block[64], unsigned char out[8])
+		{
+			int a0 = 0, a1 = 255;
+			for (int i = 0; i < 16; ++i)
+			{
+				a0 = block[i * 4 + 3] > a0 ? block[i * 4 + 3] : a0;
+				a1 = block[i * 4 + 3] < a1 ? block[i * 4 + 3] : a1;
+			}
+
+			out[0] = (unsigned char)a0;
+			out[1] = (unsigned char)a1;
+			for (int i = 2; i < 8; ++i)
+				out[i] = 0;
+			if (a0 == a1)
+				return;
+
+			int palette[8];
+			detail::alpha_palette(a0, a1, palette);
+
+			unsigned long long indices = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				int best = 0, best_distance = 256;
+				for (int p = 0; p < 8; ++p)
+				{
+					const int d = block[i * 4 + 3] > palette[p] ? block[i * 4 + 3] - palette[p] : palette[p] - block[i * 4 + 3];
+					if (d < best_distance)
+					{
+						best_distance = d;
+						best = p;
+					}
+				}
+				indices |= (unsigned long long)best << (3 * i);
+			}
+
+			for (int i = 0; i < 6; ++i)
+				out[2 + i] = (unsigned char)(indices >> (8 * i));
+		}
+
+		inline void decompress_color_block(const unsigned char in[8], unsigned char block[64])
+		{
+			int palette[4][3];
+			detail::color_palette((unsigned short)detail::read16(in), (unsigned short)detail::read16(in + 2), palette);
+			const unsigned indices = detail::read16(in + 4) | (detail::read16(in + 6) << 16);
+			for (int i = 0; i < 16; ++i)
+			{
+				const int p = (indices >> (2 * i)) & 3;
+				for (int k = 0; k < 3; ++k)
+					block[i * 4 + k] = (unsigned char)palette[p][k];
+				block[i * 4 + 3] = 255;
+			}
+		}
+
+		inline void decompress_alpha_block(const unsigned char in[8], unsigned char block[64])
+		{
+			int palette[8];
+			detail::alpha_palette(in[0], in[1], palette);
+
+			unsigned long long indices = 0;
+			for (int i = 0; i < 6; ++i)
+				indices |= (unsigned long long)in[2 + i] << (8 * i);
+
+			for (int i = 0; i < 16; ++i)
+				block[i * 4 + 3] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+		}
+
+		/// level data in file layout: rows of pixels or 4x4 blocks
+		inline void compress(const image& img, format f, std::vector<unsigned char>& out)
+		{
+			out.resize(level_bytes(f, img.width, img.height));
+			if (!is_compressed(f))
+			{
+				if (!out.empty())
+					std::copy(img.pixels.begin(), img.pixels.end(), out.begin());
+				return;
+			}
+
+			const unsigned block_size = format_dxt1 == f ? 8 : 16;
+			const unsigned blocks_x = (img.width + 3) / 4, blocks_y = (img.height + 3) / 4;
+			unsigned char block[64];
+			for (unsigned by = 0; by < blocks_y; ++by)
+			{
+				for (unsigned bx = 0; bx < blocks_x; ++bx)
+				{
+					detail::read_block(img, bx, by, block);
+					unsigned char* dst = &out[(by * blocks_x + bx) * block_size];
+					if (format_dxt5 == f)
+					{
+						compress_alpha_block(block, dst);
+						dst += 8;
+					}
+					compress_color_block(block, dst);
+				}
+			}
+		}
+
+		inline void decompress(const unsigned char* data, format f, unsigned width, unsigned height, image& img)
+		{
+			img = image(width, height);
+			if (!is_compressed(f))
+			{
+				std::copy(data, data + width * height * 4, img.pixels.begin());
+				return;
+			}
+
+			const unsigned block_size = format_dxt1 == f ? 8 : 16;
+			const unsigned blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+			unsigned char block[64];
+			for (unsigned by = 0; by < blocks_y; ++by)
+			{
+				for (unsigned bx = 0; bx < blocks_x; ++bx)
+				{
+					const unsigned char* src = data + (by * blocks_x + bx) * block_size;
+					if (format_dxt5 == f)
+					{
+						decompress_color_block(src + 8, block);
+						decompress_alpha_block(src, block);
+					}
+					else
+					{
+						decompress_color_block(src, block);
+					}
+
+					for (unsigned y = 0; y < 4 && by * 4 + y < height; ++y)
+						for (unsigned x = 0; x < 4 && bx * 4 + x < width; ++x)
+							for (int c = 0; c < 4; ++c)
+								img.at(bx * 4 + x, by * 4 + y)[c] = block[(y * 4 + x) * 4 + c];
+				}
+			}
+		}
+
+		/// root mean square difference of all channels
+		inline float rmse(const image& a, const image& b)
+		{
+			if (a.pixels.size() != b.pixels.size() || a.pixels.empty())
+				return 0;
+
+			double sum = 0;
+			for (size_t i = 0; i < a.pixels.size(); ++i)
+			{
+				const double d = (double)a.pixels[i] - b.pixels[i];
+				sum += d * d;
+			}
+			return (float)std::sqrt(sum / a.pixels.size());
+		}
+
+		/// mip chain of top (finest first), every level compressed in format.
+		/// compressed formats need sides of top level to be multiple of 4
+		inline void cook(const image& top, format f, std::vector<cooked_level>& levels)
+		{
+			const unsigned count = num_levels(top.width, top.height);
+			levels.resize(count);
+
+			image current = top;
+			for (unsigned level = 0; level < count; ++level)
+			{
+				if (level > 0)
+				{
+					image next;
+					downsample(current, next);
+					current.pixels.swap(next.pixels);
+					current.width = next.width;
+					current.height = next.height;
+				}
+
+				levels[level].width = current.width;
+				levels[level].height = current.height;
+				compress(current, f, levels[level].data);
+			}
+		}
+
+		namespace detail
+		{
+			inline void write32(std::vector<unsigned char>& out, unsigned v)
+			{
+				for (int i = 0; i < 4; ++i)
+					out.push_back((unsigned char)(v >> (8 * i)));
+			}
+
+			inline unsigned read32(const unsigned char* in)
+			{
+				return in[0] | (in[1] << 8) | (in[2] << 16) | ((unsigned)in[3] << 24);
+			}
+		}
+
+		/// bytes of header with level table
+		inline unsigned header_size(unsigned levels)
+		{
+			return fixed_header_size + levels * level_entry_size;
+		}
+
+		/// cooked texture file, levels data is stored from coarsest to finest
+		inline void write_file(format f, const std::vector<cooked_level>& levels, unsigned long long source_hash,
+							   std::vector<unsigned char>& out)
+		{
+			out.clear();
+			detail::write32(out, file_magic);
+			detail::write32(out, file_version);
+			detail::write32(out, f);
+			detail::write32(out, levels.empty() ? 0 : levels[0].width);
+			detail::write32(out, levels.empty() ? 0 : levels[0].height);
+			detail::write32(out, (unsigned)levels.size());
+			detail::write32(out, (unsigned)source_hash);
+			detail::write32(out, (unsigned)(source_hash >> 32));
+
+			unsigned offset = header_size((unsigned)levels.size());
+			std::vector<unsigned> offsets(levels.size());
+			for (size_t i = levels.size(); i-- > 0; )
+			{
+				offsets[i] = offset;
+				offset += (unsigned)levels[i].data.size();
+			}
+
+			for (size_t i = 0; i < levels.size(); ++i)
+			{
+				detail::write32(out, offsets[i]);
+				detail::write32(out, (unsigned)levels[i].data.size());
+				detail::write32(out, levels[i].width);
+				detail::write32(out, levels[i].height);
+			}
+
+			for (size_t i = levels.size(); i-- > 0; )
+				out.insert(out.end(), levels[i].data.begin(), levels[i].data.end());
+		}
+
+		/// number of levels from fixed part of header, 0 if it is not a cooked texture
+		inline unsigned read_num_levels(const unsigned char* data, size_t size)
+		{
+			if (size < fixed_header_size || detail::read32(data) != file_magic || detail::read32(data + 4) != file_version)
+				return 0;
+
+			const unsigned levels = detail::read32(data + 20);
+			return levels <= max_levels ? levels : 0;
+		}
+
+		/// parses header with level table. returns false if data is not a cooked
+		/// texture of known version or its table is inconsistent. file_size - size
+		/// of whole file, levels must fit into it
+		inline bool read_header(const unsigned char* data, size_t size, size_t file_size, header& h)
+		{
+			const unsigned levels = read_num_levels(data, size);
+			if (0 == levels || size < header_size(levels))
+				return false;
+
+			h.magic = detail::read32(data);
+			h.version = detail::read32(data + 4);
+			h.format = detail::read32(data + 8);
+			h.width = detail::read32(data + 12);
+			h.height = detail::read32(data + 16);
+			h.source_hash = detail::read32(data + 24) | ((unsigned long long)detail::read32(data + 28) << 32);
+
+			if (h.format > format_dxt5)
+				return false;
+
+			h.levels.resize(levels);
+			for (unsigned i = 0; i < levels; ++i)
+			{
+				const unsigned char* entry = data + fixed_header_size + i * level_entry_size;
+				level_info& l = h.levels[i];
+				l.offset = detail::read32(entry);
+				l.size = detail::read32(entry + 4);
+				l.width = detail::read32(entry + 8);
+				l.height = detail::read32(entry + 12);
+
+				if (l.width != level_dim(h.width, i) || l.height != level_dim(h.height, i) ||
+					l.size != level_bytes((format)h.format, l.width, l.height) ||
+					(size_t)l.offset + l.size > file_size)
+					return false;
+			}
+			return true;
+		}
+	}
+}
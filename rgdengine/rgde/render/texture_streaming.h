@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <cstddef>
+
+namespace render
+{
+	namespace streaming
+	{
+		/// Coarsest level whose larger side still covers screen_pixels, so texture
+		/// drawn over that many pixels isn't magnified. screen_pixels <= 0 (texture
+		/// isn't drawn) gives the coarsest level
+		inline unsigned desired_level(unsigned width, unsigned height, unsigned num_levels, float screen_pixels)
+		{
+			if (0 == num_levels)
+				return 0;
+			if (screen_pixels <= 0)
+				return num_levels - 1;
+
+			const unsigned size = width > height ? width : height;
+			unsigned level = 0;
+			while (level + 1 < num_levels && (float)(size >> (level + 1)) >= screen_pixels)
+				++level;
+			return level;
+		}
+
+		/// Mip levels of streamed texture. Levels from resident one to the coarsest
+		/// are in memory, levels from base_level are loaded with texture and never dropped.
+		struct texture_state
+		{
+			unsigned width;
+			unsigned height;
+			/// bytes of each level, finest first
+			std::vector<unsigned> level_bytes;
+			unsigned base_level;
+			/// largest on screen size requested since last plan, pixels
+			float screen_pixels;
+			unsigned resident;
+			/// set by plan
+			unsigned target;
+
+			texture_state() : width(0), height(0), base_level(0), screen_pixels(0), resident(0), target(0) {}
+
+			unsigned num_levels() const {return (unsigned)level_bytes.size();}
+
+			/// bytes of levels from first one to the coarsest
+			size_t bytes(unsigned first) const
+			{
+				size_t sum = 0;
+				for (unsigned level = first; level < level_bytes.size(); ++level)
+					sum += level_bytes[level];
+				return sum;
+			}
+
+			/// texels of level per requested screen pixel, "infinite" if texture isn't drawn
+			float oversampling(unsigned level) const
+			{
+				const unsigned size = width > height ? width : height;
+				const float texels = (float)(size >> level ? size >> level : 1);
+				return screen_pixels > 0 ? texels / screen_pixels : 1e30f + texels;
+			}
+		};
+
+		namespace detail
+		{
+			struct drop_candidate
+			{
+				float			oversampling;
+				texture_state*	texture;
+
+				/// priority_queue top is the most oversampled one
+				bool operator<(const drop_candidate& c) const {return oversampling < c.oversampling;}
+			};
+		}
+
+		/// Plans target levels within memory budget. Texture needs desired level of its
+		/// requested size, finer resident levels are kept while they fit (so levels don't
+		/// flicker when size changes a bit). Over budget finest levels are dropped from
+		/// the textures with most texels per screen pixel first, not drawn ones go first.
+		/// Base levels are never dropped, so result may be above budget.
+		/// returns planned bytes
+		inline size_t plan(const std::vector<texture_state*>& textures, size_t budget)
+		{
+			size_t total = 0;
+			std::priority_queue<detail::drop_candidate> candidates;
+
+			for (size_t i = 0; i < textures.size(); ++i)
+			{
+				texture_state& t = *textures[i];
+				const unsigned desired = desired_level(t.width, t.height, t.num_levels(), t.screen_pixels);
+				t.target = desired < t.resident ? desired : t.resident;
+				if (t.target > t.base_level)
+					t.target = t.base_level;
+
+				total += t.bytes(t.target);
+				if (t.target < t.base_level)
+				{
+					const detail::drop_candidate c = {t.oversampling(t.target + 1), &t};
+					candidates.push(c);
+				}
+			}
+
+			while (total > budget && !candidates.empty())
+			{
+				texture_state& t = *candidates.top().texture;
+				candidates.pop();
+
+				total -= t.level_bytes[t.target];
+				++t.target;
+
+				if (t.target < t.base_level)
+				{
+					const detail::drop_candidate c = {t.oversampling(t.target + 1), &t};
+					candidates.push(c);
+				}
+			}
+
+			return total;
+		}
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#	define RGDE_TRANSFORMS_SSE
+#	include <xmmintrin.h>
+#endif
+
+namespace render
+{
+	/// camera dependent matrices of one object, column major (math::matrix44f memory)
+	struct object_transforms
+	{
+		float world_view_proj[16];
+		float world_view[16];
+		/// inverse transposed world view, for normals
+		float world_view_it[16];
+	};
+
+	/// Camera dependent matrices of all objects drawn through one camera.
+	/// Computed in one pass into contiguous array, so dynamic binder reads them
+	/// by object index instead of multiplying and inverting matrices per bind.
+	/// Independent from render device, so it can be tested without D3D.
+	class transform_cache
+	{
+	public:
+		void clear()
+		{
+			m_worlds.resize(0);
+			m_transforms.resize(0);
+		}
+
+		void reserve(size_t num)
+		{
+			m_worlds.reserve(num);
+			m_transforms.reserve(num);
+		}
+
+		/// world is 16 floats, 0 means identity. returns object index
+		unsigned add(const float* world)
+		{
+			m_worlds.push_back(world);
+			return (unsigned)m_worlds.size() - 1;
+		}
+
+		/// computes matrices of all added objects
+		void compute(const float* view, const float* proj)
+		{
+			float view_proj[16];
+			multiply(proj, view, view_proj);
+
+			const size_t num = m_worlds.size();
+			m_transforms.resize(num);
+
+			for (size_t i = 0; i < num; ++i)
+			{
+				const float* world = m_worlds[i] ? m_worlds[i] : identity();
+				object_transforms& t = m_transforms[i];
+
+				multiply(view, world, t.world_view);
+				multiply(view_proj, world, t.world_view_proj);
+				inverse_transpose(t.world_view, t.world_view_it);
+			}
+		}
+
+		size_t size() const {return m_transforms.size();}
+		const object_transforms& operator[](size_t i) const {return m_transforms[i];}
+
+		/// matrices of single object, for objects drawn outside of cache
+		static void compute(const float* view, const float* proj, const float* world, object_transforms& t)
+		{
+			multiply(view, world, t.world_view);
+			multiply(proj, t.world_view, t.world_view_proj);
+			inverse_transpose(t.world_view, t.world_view_it);
+		}
+
+		/// r = a * b, column major. r must not alias a or b
+		static void multiply(const float* a, const float* b, float* r)
+		{
+#ifdef RGDE_TRANSFORMS_SSE
+			const __m128 a0 = _mm_loadu_ps(a);
+			const __m128 a1 = _mm_loadu_ps(a + 4);
+			const __m128 a2 = _mm_loadu_ps(a + 8);
+			const __m128 a3 = _mm_loadu_ps(a + 12);
+
+			for (int j = 0; j < 16; j += 4)
+			{
+				__m128 c = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[j])),	  _mm_mul_ps(a1, _mm_set1_ps(b[j + 1]))),
+					_mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[j + 2])), _mm_mul_ps(a3, _mm_set1_ps(b[j + 3]))));
+				_mm_storeu_ps(r + j, c);
+			}
+#else
+			for (int j = 0; j < 16; j += 4)
+				for (int i = 0; i < 4; ++i)
+					r[j + i] = a[i] * b[j] + a[4 + i] * b[j + 1] + a[8 + i] * b[j + 2] + a[12 + i] * b[j + 3];
+#endif
+		}
+
+		/// r = transpose(inverse(m)). affine matrices (usual case) take 3x3 path.
+		/// singular matrix gives identity
+		static void inverse_transpose(const float* m, float* r)
+		{
+			if (0 == m[3] && 0 == m[7] && 0 == m[11] && 1 == m[15])
+			{
+				// cofactors of upper 3x3 divided by determinant = transposed inverse
+				const float c00 = m[5] * m[10] - m[9] * m[6];
+				const float c01 = m[9] * m[2]  - m[1] * m[10];
+				const float c02 = m[1] * m[6]  - m[5] * m[2];
+				const float det = m[0] * c00 + m[4] * c01 + m[8] * c02;
+				if (0 == det)
+				{
+					set_identity(r);
+					return;
+				}
+				const float inv = 1.0f / det;
+
+				// element (row, col) is at col * 4 + row
+				r[0]  = c00 * inv;
+				r[4]  = c01 * inv;
+				r[8]  = c02 * inv;
+				r[1]  = (m[8] * m[6]  - m[4] * m[10]) * inv;
+				r[5]  = (m[0] * m[10] - m[8] * m[2])  * inv;
+				r[9]  = (m[4] * m[2]  - m[0] * m[6])  * inv;
+				r[2]  = (m[4] * m[9]  - m[8] * m[5])  * inv;
+				r[6]  = (m[8] * m[1]  - m[0] * m[9])  * inv;
+				r[10] = (m[0] * m[5]  - m[4] * m[1])  * inv;
+
+				// last row is -(inverse(A) * t), where inverse(A) = transpose of r 3x3
+				r[3]  = -(r[0] * m[12] + r[1] * m[13] + r[2]  * m[14]);
+				r[7]  = -(r[4] * m[12] + r[5] * m[13] + r[6]  * m[14]);
+				r[11] = -(r[8] * m[12] + r[9] * m[13] + r[10] * m[14]);
+				r[12] = r[13] = r[14] = 0;
+				r[15] = 1;
+				return;
+			}
+
+			// general case: r = cofactor matrix / determinant
+			float c[16];
+			for (int col = 0; col < 4; ++col)
+				for (int row = 0; row < 4; ++row)
+					c[col * 4 + row] = cofactor(m, row, col);
+
+			const float det = m[0] * c[0] + m[4] * c[4] + m[8] * c[8] + m[12] * c[12];
+			if (0 == det)
+			{
+				set_identity(r);
+				return;
+			}
+
+			const float inv = 1.0f / det;
+			for (int i = 0; i < 16; ++i)
+				r[i] = c[i] * inv;
+		}
+
+	private:
+		static const float* identity()
+		{
+			static const float m[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+			return m;
+		}
+
+		static void set_identity(float* r)
+		{
+			const float* m = identity();
+			for (int i = 0; i < 16; ++i)
+				r[i] = m[i];
+		}
+
+		/// signed minor of element (row, col)
+		static float cofactor(const float* m, int row, int col)
+		{
+			int rows[3], cols[3];
+			for (int i = 0, n = 0; i < 4; ++i)
+				if (i != row) rows[n++] = i;
+			for (int i = 0, n = 0; i < 4; ++i)
+				if (i != col) cols[n++] = i;
+
+			#define RGDE_AT(r, c) m[cols[c] * 4 + rows[r]]
+			const float minor =
+				RGDE_AT(0, 0) * (RGDE_AT(1, 1) * RGDE_AT(2, 2) - RGDE_AT(1, 2) * RGDE_AT(2, 1)) -
+				RGDE_AT(0, 1) * (RGDE_AT(1, 0) * RGDE_AT(2, 2) - RGDE_AT(1, 2) * RGDE_AT(2, 0)) +
+				RGDE_AT(0, 2) * (RGDE_AT(1, 0) * RGDE_AT(2, 1) - RGDE_AT(1, 1) * RGDE_AT(2, 0));
+			#undef RGDE_AT
+
+			return (row + col) % 2 ? -minor : minor;
+		}
+
+	private:
+		std::vector<const float*>		m_worlds;
+		std::vector<object_transforms>	m_transforms;
+	};
+}
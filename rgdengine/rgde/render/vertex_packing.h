@@ -0,0 +1,301 @@
+//////////////////////////////////////////////////////////////////////////
+// description: compressed vertex layout of meshes (vertex::PackedMeshVertex).
+//   Positions are quantized to 16 bit inside mesh bounding box, normal and
+//   tangent are octahedral encoded into 16 bit pairs, binormal is rebuilt
+//   from them with stored sign, texture coordinates are half floats.
+//   Vertex declaration types (USHORT4N, SHORT4N, FLOAT16_2) convert data to
+//   floats, decoding vertex shader of geometry scales position into the box.
+//   Works with any vertex format with position, normal, tangent, binormal,
+//   tex0 and tex1 members and has no render device dependencies - used by
+//   geometry loading and MeshConverter tool.
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+namespace render
+{
+	namespace packing
+	{
+		/// IEEE 754 half float, rounded to nearest even, finite values above 65504 are clamped
+		inline unsigned short float_to_half(float value)
+		{
+			union { float f; unsigned u; } bits;
+			bits.f = value;
+
+			const unsigned sign = (bits.u >> 16) & 0x8000;
+			const unsigned abs = bits.u & 0x7FFFFFFF;
+
+			if (abs >= 0x7F800000)
+				return (unsigned short)(sign | (abs > 0x7F800000 ? 0x7E00 : 0x7C00));	// nan, infinity
+			if (abs >= 0x477FF000)
+				return (unsigned short)(sign | 0x7BFF);		// rounds above max half
+			if (abs < 0x33000000)
+				return (unsigned short)sign;				// rounds to zero
+
+			unsigned half, rest, middle;
+			if (abs < 0x38800000)
+			{
+				// subnormal half, value = mantissa * 2^(exponent - 150)
+				const unsigned mantissa = (abs & 0x7FFFFF) | 0x800000;
+				const unsigned shift = 126 - (abs >> 23);
+				half = mantissa >> shift;
+				rest = mantissa & ((1u << shift) - 1);
+				middle = 1u << (shift - 1);
+			}
+			else
+			{
+				// exponent is rebiased from 127 to 15, carry of rounding goes into exponent
+				half = (abs - 0x38000000) >> 13;
+				rest = abs & 0x1FFF;
+				middle = 0x1000;
+			}
+
+			if (rest > middle || (rest == middle && (half & 1)))
+				++half;
+			return (unsigned short)(sign | half);
+		}
+
+		inline float half_to_float(unsigned short half)
+		{
+			const unsigned sign = (half & 0x8000u) << 16;
+			const unsigned exponent = (half >> 10) & 0x1F;
+			const unsigned mantissa = half & 0x3FF;
+
+			if (0 == exponent)
+			{
+				const float value = mantissa * (1.0f / 16777216.0f);
+				return sign ? -value : value;
+			}
+
+			union { float f; unsigned u; } bits;
+			if (31 == exponent)
+				bits.u = sign | 0x7F800000 | (mantissa << 13);
+			else
+				bits.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+			return bits.f;
+		}
+
+		/// [-1, 1] to signed normalized short, as SHORT2N/SHORT4N declaration types read it
+		inline short to_snorm(float value)
+		{
+			value = value < -1 ? -1 : (value > 1 ? 1 : value);
+			return (short)(value * 32767 + (value >= 0 ? 0.5f : -0.5f));
+		}
+
+		inline float from_snorm(short value)
+		{
+			const float v = value / 32767.0f;
+			return v < -1 ? -1 : v;
+		}
+
+		/// octahedral map of unit vector, lower hemisphere is folded over diagonals
+		inline void decode_octahedral(const short e[2], float v[3])
+		{
+			float x = from_snorm(e[0]), y = from_snorm(e[1]);
+			const float z = 1 - std::fabs(x) - std::fabs(y);
+			const float t = z < 0 ? -z : 0;
+			x += x >= 0 ? -t : t;
+			y += y >= 0 ? -t : t;
+
+			const float length = std::sqrt(x * x + y * y + z * z);
+			v[0] = x / length;
+			v[1] = y / length;
+			v[2] = z / length;
+		}
+
+		/// v needs not be normalized. of four roundings of projected point
+		/// the one decoded closest to v is taken
+		inline void encode_octahedral(const float v[3], short e[2])
+		{
+			const float l1 = std::fabs(v[0]) + std::fabs(v[1]) + std::fabs(v[2]);
+			if (l1 <= 0)
+			{
+				e[0] = 0;
+				e[1] = 0;
+				return;
+			}
+
+			float x = v[0] / l1, y = v[1] / l1;
+			if (v[2] < 0)
+			{
+				const float fx = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+				y = (1 - std::fabs(x)) * (y >= 0 ? 1 : -1);
+				x = fx;
+			}
+
+			const float fx = std::floor(x * 32767), fy = std::floor(y * 32767);
+			float best = -2;
+			for (int i = 0; i < 4; ++i)
+			{
+				const float cx = fx + (i & 1), cy = fy + (i >> 1);
+				if (cx < -32767 || cx > 32767 || cy < -32767 || cy > 32767)
+					continue;
+
+				const short candidate[2] = {(short)cx, (short)cy};
+				float d[3];
+				decode_octahedral(candidate, d);
+				const float dot = (d[0] * v[0] + d[1] * v[1] + d[2] * v[2]) / l1;
+				if (dot > best)
+				{
+					best = dot;
+					e[0] = candidate[0];
+					e[1] = candidate[1];
+				}
+			}
+		}
+
+		/// decoding of quantized positions: position = bias + q / 65535 * scale
+		struct position_box
+		{
+			float bias[3];
+			float scale[3];
+		};
+
+		inline position_box make_box(const float min[3], const float max[3])
+		{
+			position_box box;
+			for (int k = 0; k < 3; ++k)
+			{
+				box.bias[k] = min[k];
+				box.scale[k] = max[k] > min[k] ? max[k] - min[k] : 0;
+			}
+			return box;
+		}
+
+		template <typename Vertex, typename Packed>
+		void pack(const Vertex& v, const position_box& box, Packed& p)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				const float q = box.scale[k] > 0 ? (v.position[k] - box.bias[k]) / box.scale[k] : 0;
+				p.position[k] = (unsigned short)((q < 0 ? 0 : (q > 1 ? 1 : q)) * 65535 + 0.5f);
+			}
+
+			const float normal[3] = {v.normal[0], v.normal[1], v.normal[2]};
+			const float tangent[3] = {v.tangent[0], v.tangent[1], v.tangent[2]};
+			encode_octahedral(normal, &p.frame[0]);
+			encode_octahedral(tangent, &p.frame[2]);
+
+			// binormal = sign * cross(normal, tangent), sign is kept in position w
+			const float c[3] = {normal[1] * tangent[2] - normal[2] * tangent[1],
+								normal[2] * tangent[0] - normal[0] * tangent[2],
+								normal[0] * tangent[1] - normal[1] * tangent[0]};
+			const float d = c[0] * v.binormal[0] + c[1] * v.binormal[1] + c[2] * v.binormal[2];
+			p.position[3] = d < 0 ? 0 : 65535;
+
+			for (int k = 0; k < 2; ++k)
+			{
+				p.tex0[k] = float_to_half(v.tex0[k]);
+				p.tex1[k] = float_to_half(v.tex1[k]);
+			}
+		}
+
+		/// the same decoding shader does
+		template <typename Vertex, typename Packed>
+		void unpack(const Packed& p, const position_box& box, Vertex& v)
+		{
+			for (int k = 0; k < 3; ++k)
+				v.position[k] = box.bias[k] + p.position[k] / 65535.0f * box.scale[k];
+
+			float n[3], t[3];
+			decode_octahedral(&p.frame[0], n);
+			decode_octahedral(&p.frame[2], t);
+
+			const float sign = p.position[3] ? 1.0f : -1.0f;
+			for (int k = 0; k < 3; ++k)
+			{
+				v.normal[k] = n[k];
+				v.tangent[k] = t[k];
+				v.binormal[k] = sign * (n[(k + 1) % 3] * t[(k + 2) % 3] - n[(k + 2) % 3] * t[(k + 1) % 3]);
+			}
+
+			for (int k = 0; k < 2; ++k)
+			{
+				v.tex0[k] = half_to_float(p.tex0[k]);
+				v.tex1[k] = half_to_float(p.tex1[k]);
+			}
+		}
+
+		template <typename Vertex, typename Packed>
+		void pack(const std::vector<Vertex>& vb, const position_box& box, std::vector<Packed>& packed)
+		{
+			packed.resize(vb.size());
+			for (size_t i = 0; i < vb.size(); ++i)
+				pack(vb[i], box, packed[i]);
+		}
+
+		template <typename Vertex, typename Packed>
+		void unpack(const std::vector<Packed>& packed, const position_box& box, std::vector<Vertex>& vb)
+		{
+			vb.resize(packed.size());
+			for (size_t i = 0; i < packed.size(); ++i)
+				unpack(packed[i], box, vb[i]);
+		}
+
+		/// largest differences between source and decoded vertices
+		struct error
+		{
+			/// distance in mesh units
+			float position;
+			/// angles in degrees, zero source vectors are skipped
+			float normal;
+			float tangent;
+			float binormal;
+			/// texture coordinate difference
+			float tex;
+
+			error() : position(0), normal(0), tangent(0), binormal(0), tex(0) {}
+		};
+
+		namespace detail
+		{
+			template <typename A, typename B>
+			float angle(const A& a, const B& b)
+			{
+				// atan2 keeps precision of small angles, acos of dot doesn't
+				const float c[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+				const float sine = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+				const float cosine = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+				if (0 == sine && 0 == cosine)
+					return 0;
+
+				return std::atan2(sine, cosine) * 57.2957795f;
+			}
+
+			inline void update(float& max, float value)
+			{
+				if (value > max)
+					max = value;
+			}
+		}
+
+		template <typename Vertex>
+		error measure(const std::vector<Vertex>& source, const std::vector<Vertex>& decoded)
+		{
+			error e;
+			for (size_t i = 0; i < source.size() && i < decoded.size(); ++i)
+			{
+				const Vertex& s = source[i];
+				const Vertex& d = decoded[i];
+
+				float distance = 0;
+				for (int k = 0; k < 3; ++k)
+					distance += (s.position[k] - d.position[k]) * (s.position[k] - d.position[k]);
+				detail::update(e.position, std::sqrt(distance));
+
+				detail::update(e.normal, detail::angle(s.normal, d.normal));
+				detail::update(e.tangent, detail::angle(s.tangent, d.tangent));
+				detail::update(e.binormal, detail::angle(s.binormal, d.binormal));
+
+				for (int k = 0; k < 2; ++k)
+				{
+					detail::update(e.tex, std::fabs(s.tex0[k] - d.tex0[k]));
+					detail::update(e.tex, std::fabs(s.tex1[k] - d.tex1[k]));
+				}
+			}
+			return e;
+		}
+	}
+}
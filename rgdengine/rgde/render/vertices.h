@@ -270,4 +270,18 @@ namespace  vertex
 	};
 
 	typedef PositionNormalTextured2TangentBinorm MeshVertex;
+
+	/// MeshVertex compressed to 24 bytes, see render/vertex_packing.h.
+	/// Needs vertex shader to decode position, normal and tangent.
+	struct PackedMeshVertex : public TCustomVertex<PackedMeshVertex>
+	{
+		/// quantized in mesh bounding box, w - binormal sign (0 or 65535)
+		unsigned short	position[4];
+		/// octahedral normal (xy) and tangent (zw)
+		short			frame[4];
+		/// half floats
+		unsigned short	tex0[2];
+		unsigned short	tex1[2];
+		static const vertex_decl get_decl();
+	};
 }
\ No newline at end of file
@@ -1,345 +1,632 @@
-/******************************************************************************
-@file    live_tree.h
-@author  Neonic
-@mail    gaba@male.ru
-@project RGDE
-@date    12.05.2006
-@desc     AABB 
- ******************************************************************************/
-
-//Neonic: octree
-
 #pragma once
 
-#pragma warning(disable : 4244)	// type conversion warning.
-#pragma warning(disable : 4305)	// truncation from 'const double' to 'float'
-#pragma warning(disable : 4800)	// warning C4800: forcing value to bool 'true' or 'false' (performance warning)
+#include <cmath>
+#include <vector>
 
-#include <rgde/base/smart_ptr_helpers.h>
+#include <rgde/math/culling.h>
 
-namespace live_tree
+namespace scene
 {
-	using namespace math;
-
-	// used axis
-	enum eAxis {
-		AXIS_X				= 1,
-		AXIS_Y				= 2,
-		AXIS_Z				= 4,
-	};
-
-	class CFlags {
-	public:
-		CFlags( unsigned flags=0 ) : m_Flags(flags) {};
-		const unsigned&			getFlags( void ) const					{ return m_Flags; };
-		bool					getFlags( unsigned flags )				{ return (m_Flags & flags); };
-		void					setFlags( unsigned flags )				{ m_Flags = flags; };
-		void					changeFlags( unsigned flags, bool b )	{
-			if(b)	m_Flags |= flags;
-			else	m_Flags &= ~flags;
-		};
-
-	private:
-		unsigned			m_Flags;
-	};
-
-	class TreeObject;
-	class CTBranch;
-	class CTRoot;
-
-	typedef boost::intrusive_ptr<TreeObject> PObject;
-
-	typedef std::vector<PObject>			Array;
-	typedef std::map<PObject, point3f>		Sorted;
-
-	///     (out),   (in)
-	bool calc_progression( const int &in, int &out );
-
-
-	////////////////////////////////////////////////////////////////////////
-	// 
-	// TreeObject
-	//
-	////////////////////////////////////////////////////////////////////////
-
-	class TreeObject
-		: virtual public base::refcounted
+	/// axis aligned box in plain floats, so tree does not depend on math types
+	struct aabb
 	{
-	public:
-
-		TreeObject( void );
-		virtual ~TreeObject( void ) ;
-
-		// get object AABB
-		aaboxf					getAABB( void );
-		// get object dynamic AABB. sure you call this func then object dynamic, otherwise it fail.
-		aaboxf					getDynamicAABB( void );
-		// set object dimensions as aabb
-		void					setAABB( const aaboxf& aabb );
-		// get object position
-		const point3f&			get_pos( void ) const;
-		// set object position
-		void					set_pos( const point3f& pos );
-		// get object extents
-		const point3f&			getExt( void ) const;
-		// set object extents
-		void					setExt( const point3f& ext );
-		// inject object into selected tree
-		void					inject( CTRoot* p );
-		// eject object from tree
-		void					eject( void );
-		// move object in tree. sure you inject object before, otherwise it fail
-		void					move( const point3f& pos );
-		// set object tree root
-		void					setRoot( CTRoot* p );
-		// get object tree root
-		CTRoot*					getRoot( void );
-		// debug draw
-		void					draw( void );
-		// eject object from tree
-//		void					remSelf( void );
-	// dynamic positioning
-		// func make object dynamic. you must position object before make them dynamic.
-		// in case of many changes in tree do next in query: create obj, set pos, make dynamic, inject
-		void					makeDynamic( void );
-		// convert back to static from dynamic. it can happen only before Approximate() in dynamic begin.
-		bool					makeStatic( void );
-		// test for dynamic enabled
-		bool					is_dynamic( void );
-		// get last updated pos
-		point3f					getOldPos( void );
-		// update pos from current
-		void					updatePos( void );
+		float min[3];
+		float max[3];
 
-	private:
-		CTRoot*				m_root;
+		static aabb from_sphere(float x, float y, float z, float r)
+		{
+			aabb box = {{x - r, y - r, z - r}, {x + r, y + r, z + r}};
+			return box;
+		}
 
-		point3f*			m_pPosOld;
-		point3f				m_Position;
-		point3f				m_Ext;
+		bool contains(const aabb& box) const
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				if (box.min[i] < min[i] || box.max[i] > max[i])
+					return false;
+			}
+			return true;
+		}
+
+		bool overlaps(const aabb& box) const
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				if (box.min[i] > max[i] || box.max[i] < min[i])
+					return false;
+			}
+			return true;
+		}
+
+		/// half of surface area, insertion cost metric
+		float area() const
+		{
+			float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+			return dx * dy + dy * dz + dz * dx;
+		}
 
+		static aabb merge(const aabb& a, const aabb& b)
+		{
+			aabb box;
+			for (int i = 0; i < 3; ++i)
+			{
+				box.min[i] = a.min[i] < b.min[i] ? a.min[i] : b.min[i];
+				box.max[i] = a.max[i] > b.max[i] ? a.max[i] : b.max[i];
+			}
+			return box;
+		}
 	};
 
-
-	////////////////////////////////////////////////////////////////////////
-	// 
-	// CTBranch
-	//
-	////////////////////////////////////////////////////////////////////////
-
-	class CTBranch
+	inline bool sphere_overlaps(const aabb& box, float x, float y, float z, float r)
 	{
-	public:
-		CTBranch( void );
-		~CTBranch( void );
-
-		// test branch for object containment
-		bool					isContainer( void );
-		// test branch for branches containment
-		bool					isBranch( void );
-		// test for both containments. also used as canDelete answer
-		bool					isEmpty( void );
-		// get object container
-		Array&					getArray( void );
-		// get parent branch
-		CTBranch*				get_parent( void );
-		// set parent branch
-		void					set_parent( CTBranch* p );
-		// get branch pointer. test them for existance before use
-		CTBranch*				getBranch( unsigned iIndex );
-		// call branch. create branch if it not exist
-		CTBranch*				call( unsigned iIndex );
-		// eject contained branch
-		void					eject( CTBranch* pBranch );
-		// clear both containments
-		void					clear( void );
-		// debug draw
-		void					draw( void );
-
-	private:
-
-		//		union
-//		{
-			//  
-			CTBranch*			m_Branches[8];
-			//   - : upperlevel-downlevel, top-bottom, right-left
-			// left equal X+ axis, top equal Y+ axis, upperlevel equal Z+ axis
-			// 0 -     =0, 7 -     =1
-			//     X>Y>Z
-//			CTBase				*m_lbd, *m_rbd, *m_ltd, *m_rtd,
-//								*m_lbu, *m_rbu, *m_ltu, *m_rtu;
-//		};
-		/// child nodes count
-		int					m_iUsed;
-		Array				m_Array;
-		CTBranch*			m_pParent;
-	};
-
-
-	////////////////////////////////////////////////////////////////////////
-	// 
-	// CTRoot
-	//
-	////////////////////////////////////////////////////////////////////////
-
-	class CTRoot
-		: virtual public base::refcounted
+		const float c[3] = {x, y, z};
+		float d2 = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			float d = c[i] < box.min[i] ? box.min[i] - c[i] : (c[i] > box.max[i] ? c[i] - box.max[i] : 0);
+			d2 += d * d;
+		}
+		return d2 <= r * r;
+	}
+
+	/// segment origin + t * dir, 0 <= t <= max_t, against sphere
+	inline bool ray_hits_sphere(const float origin[3], const float dir[3], float max_t, float x, float y, float z, float r)
+	{
+		const float m[3] = {origin[0] - x, origin[1] - y, origin[2] - z};
+		const float a = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+		const float b = m[0] * dir[0] + m[1] * dir[1] + m[2] * dir[2];
+		const float c = m[0] * m[0] + m[1] * m[1] + m[2] * m[2] - r * r;
+
+		if (c <= 0)
+			return true;		// starts inside
+		if (b > 0 || a == 0)
+			return false;		// points away
+
+		// nearest root of a*t^2 + 2*b*t + c = 0
+		const float disc = b * b - a * c;
+		if (disc < 0)
+			return false;
+		return -b - std::sqrt(disc) <= max_t * a;
+	}
+
+	/// Dynamic AABB tree (incrementally updated BVH).
+	/// Leaves store enlarged ("fat") boxes, so object moving inside its fat box
+	/// costs only one containment test. Escaped objects are reinserted with
+	/// surface area heuristic and tree is kept balanced by rotations.
+	/// Queries call f(proxy_id) for every leaf which fat box passes the test,
+	/// so caller makes exact test with real bounds if it needs.
+	/// Fat box of moving object is also stretched along its last frame
+	/// displacement, so steadily moving objects are reinserted rarely.
+	class live_tree
 	{
 	public:
-		// ext is maximum tree extents, base is minimum container size
-		CTRoot( unsigned _ext=2147483647, unsigned _base=8, int LimitDivisions =-1 );
-		virtual ~CTRoot( void );
-
-		// clear main (static) branch
-		void					clear( void );
-		// test object containment in selected branch. function is obsolete
-//		bool					test_obj_in_branch( PObject pBranch, PObject obj );
-		// get tree base
-		unsigned				getBase( void );
-		// get tree extents
-		int						getExt( void );
-		// get main branch
-		CTBranch*				getBranch( void );
-		// set main branch
-		void					setBranch( CTBranch* p );
-		// debug draw
-		void					draw( void );
-
-	// next funcs produce 'static/immediate' effect in action
-	// overwrite all of them if you need 'Another' correct workflow
-		// inject object
-		virtual void			inject( PObject obj, aaboxf* pAABB =0 );
-		// eject object
-		virtual void			eject( PObject obj, aaboxf* pAABB =0 );
-		// eject object now in any case
-		virtual void			ejectNow( PObject obj );
-		// set object new position
-		virtual void			set_pos( PObject obj, const point3f pos );
-		// set object new extents
-		virtual void			setExt( PObject obj, const point3f ext );
-		// move object to new position
-		virtual void			move( PObject obj, const point3f& pos );
-
-		// get current query status for dynamic. static tree always finalized
-		virtual bool			isApproximated( void ) { return 0; };
-
-		class CCollector
+		typedef int proxy_id;
+		enum { null_proxy = -1 };
+
+		/// margin is fat box enlargement relative to object size
+		explicit live_tree(float margin = 0.2f)
+			: m_root(null_proxy),
+			  m_free(null_proxy),
+			  m_num_proxies(0),
+			  m_margin(margin)
 		{
-		public:
-			CCollector( CTRoot* pRoot, const aaboxf& aabb, PObject exclude =0);
-			Array&				operator()( void );
-		
-		private:
-			void				parse( CTBranch* pBranch, const point3f& cnt, const float& ext );
-			void				collect( CTBranch* pBranch );
-			void				call( CTBranch* pBranch, const unsigned& iIndex, const point3f& cnt, const float& ext );
+		}
 
-			PObject		m_pExcludeObject;
-			CTRoot*		m_root;
-			aaboxf		m_AABB;
+		void clear()
+		{
+			m_nodes.resize(0);
+			m_root = null_proxy;
+			m_free = null_proxy;
+			m_num_proxies = 0;
+		}
 
-		public:
-			Array		m_Array;
-		};
+		proxy_id create(const aabb& box, void* data)
+		{
+			proxy_id id = allocate();
+			node& n = m_nodes[id];
+			n.box = fatten(box);
+			n.data = data;
+			n.height = 0;
+			center(box, n.last_center);
+
+			insert_leaf(id);
+			++m_num_proxies;
+			return id;
+		}
+
+		void destroy(proxy_id id)
+		{
+			remove_leaf(id);
+			release(id);
+			--m_num_proxies;
+		}
 
-		class CInjector
+		/// returns true if object left its fat box and was reinserted
+		bool move(proxy_id id, const aabb& box)
 		{
-		public:
-			CInjector( PObject p, CTRoot* pRoot, const aaboxf& aabb, int LimitDivisions =-1);
-			bool				operator()( void );
-		
-		private:
-			bool				parse( CTBranch* pBranch, const point3f& cnt, const float& ext, const unsigned& division );
-			bool				inject( CTBranch* pBranch, const unsigned& division );
+			node& n = m_nodes[id];
+
+			float c[3], displacement[3];
+			center(box, c);
+			for (int i = 0; i < 3; ++i)
+			{
+				displacement[i] = c[i] - n.last_center[i];
+				n.last_center[i] = c[i];
+			}
+
+			if (n.box.contains(box))
+				return false;
+
+			remove_leaf(id);
+
+			aabb fat = fatten(box);
+			for (int i = 0; i < 3; ++i)
+			{
+				const float d = displacement[i] * predict_frames();
+				if (d < 0)
+					fat.min[i] += d;
+				else
+					fat.max[i] += d;
+			}
+			m_nodes[id].box = fat;
+
+			insert_leaf(id);
+			return true;
+		}
+
+		void*		get_data(proxy_id id) const		{return m_nodes[id].data;}
+		const aabb&	get_fat_aabb(proxy_id id) const	{return m_nodes[id].box;}
+		size_t		size() const					{return m_num_proxies;}
+		bool		empty() const					{return 0 == m_num_proxies;}
+		int			get_height() const				{return m_root == null_proxy ? 0 : m_nodes[m_root].height;}
+
+		template <class F>
+		void query_aabb(const aabb& box, F& f) const
+		{
+			query_stack stack;
+			stack.push(m_root);
+			while (!stack.empty())
+			{
+				proxy_id id = stack.pop();
+				if (id == null_proxy)
+					continue;
+
+				const node& n = m_nodes[id];
+				if (!n.box.overlaps(box))
+					continue;
+
+				if (n.is_leaf())
+					f(id);
+				else
+				{
+					stack.push(n.child1);
+					stack.push(n.child2);
+				}
+			}
+		}
+
+		template <class F>
+		void query_sphere(float x, float y, float z, float r, F& f) const
+		{
+			query_stack stack;
+			stack.push(m_root);
+			while (!stack.empty())
+			{
+				proxy_id id = stack.pop();
+				if (id == null_proxy)
+					continue;
+
+				const node& n = m_nodes[id];
+				if (!sphere_overlaps(n.box, x, y, z, r))
+					continue;
+
+				if (n.is_leaf())
+					f(id);
+				else
+				{
+					stack.push(n.child1);
+					stack.push(n.child2);
+				}
+			}
+		}
+
+		/// planes as in math::frustum (pointing inside). planes which node is
+		/// completely in front of are not tested for its children
+		template <class F>
+		void query_frustum(const math::frustum_planes& planes, F& f) const
+		{
+			query_stack stack;
+			stack.push(m_root, 0x3F);
+			while (!stack.empty())
+			{
+				unsigned mask = stack.top_mask();
+				proxy_id id = stack.pop();
+				if (id == null_proxy)
+					continue;
+
+				const node& n = m_nodes[id];
+				bool culled = false;
+				for (int p = 0; p < 6 && !culled; ++p)
+				{
+					if (0 == (mask & (1 << p)))
+						continue;
+
+					float d = 0, r = 0;
+					for (int i = 0; i < 3; ++i)
+					{
+						float c = (n.box.min[i] + n.box.max[i]) * 0.5f;
+						float e = (n.box.max[i] - n.box.min[i]) * 0.5f;
+						d += planes[p][i] * c;
+						r += (planes[p][i] < 0 ? -planes[p][i] : planes[p][i]) * e;
+					}
+					d += planes[p][3];
+
+					if (d + r <= 0)
+						culled = true;
+					else if (d - r > 0)
+						mask &= ~(1u << p);
+				}
+				if (culled)
+					continue;
+
+				if (n.is_leaf())
+					f(id);
+				else
+				{
+					stack.push(n.child1, mask);
+					stack.push(n.child2, mask);
+				}
+			}
+		}
+
+		/// segment origin + t * dir, 0 <= t <= max_t. dir does not need to be normalized
+		template <class F>
+		void query_ray(const float origin[3], const float dir[3], float max_t, F& f) const
+		{
+			query_stack stack;
+			stack.push(m_root);
+			while (!stack.empty())
+			{
+				proxy_id id = stack.pop();
+				if (id == null_proxy)
+					continue;
+
+				const node& n = m_nodes[id];
+				if (!ray_hits(n.box, origin, dir, max_t))
+					continue;
+
+				if (n.is_leaf())
+					f(id);
+				else
+				{
+					stack.push(n.child1);
+					stack.push(n.child2);
+				}
+			}
+		}
 
-			PObject		m_pObject;
-			CTRoot*		m_root;
-			aaboxf		m_AABB;
-			int			m_LimitDivisions;
+	private:
+		struct node
+		{
+			aabb	 box;
+			float	 last_center[3];
+			void*	 data;
+			proxy_id parent;	///< next free node for released nodes
+			proxy_id child1;
+			proxy_id child2;
+			int		 height;	///< 0 for leaves, -1 for released nodes
+
+			bool is_leaf() const {return child1 == null_proxy;}
 		};
 
-		class CEjector
+		/// traversal stack, doesn't allocate for trees of usual height
+		class query_stack
 		{
 		public:
-			CEjector( PObject p, CTRoot* pRoot, const aaboxf& aabb, int LimitDivisions =-1 );
-			bool				operator()( void );
-		
+			query_stack() : m_size(0) {}
+
+			void push(proxy_id id, unsigned mask = 0)
+			{
+				entry e = {id, mask};
+				if (m_size < fixed_size)
+					m_fixed[m_size] = e;
+				else
+					m_extra.push_back(e);
+				++m_size;
+			}
+
+			proxy_id pop()
+			{
+				--m_size;
+				if (m_size < fixed_size)
+					return m_fixed[m_size].id;
+
+				proxy_id id = m_extra.back().id;
+				m_extra.pop_back();
+				return id;
+			}
+
+			unsigned top_mask() const
+			{
+				return m_size <= fixed_size ? m_fixed[m_size - 1].mask : m_extra.back().mask;
+			}
+
+			bool empty() const {return 0 == m_size;}
+
 		private:
-			bool				parse( CTBranch* pBranch, const point3f& cnt, const float& ext, const unsigned& division );
-			bool				eject( CTBranch* pBranch );
+			enum { fixed_size = 64 };
 
-			PObject		m_pObject;
-			CTRoot*		m_root;
-			aaboxf		m_AABB;
-			int			m_LimitDivisions;
-		};
+			struct entry
+			{
+				proxy_id id;
+				unsigned mask;
+			};
 
-	private:
-		unsigned		m_iBase;
-		int				m_iExt,
-						m_LimitDivisions;
-		CTBranch*		m_pBranch;
+			entry				m_fixed[fixed_size];
+			std::vector<entry>	m_extra;
+			size_t				m_size;
+		};
 
-		unsigned		m_iObjInTree,				// number of objects in tree
-						m_iDeepLevel;				// most deep level
-	};
+		/// how many frames of motion fat box covers
+		static float predict_frames() {return 4.0f;}
 
-	////////////////////////////////////////////////////////////////////////
-	// 
-	// CDynamicTreeRoot
-	//	dynamic tree with query
-	////////////////////////////////////////////////////////////////////////
+		static void center(const aabb& box, float c[3])
+		{
+			for (int i = 0; i < 3; ++i)
+				c[i] = (box.min[i] + box.max[i]) * 0.5f;
+		}
 
-	class CDynamicTreeRoot
-		: public CTRoot
-	{
-	public:
-		CDynamicTreeRoot( unsigned _ext=2147483647, unsigned _base=8, int LimitDivisions =-1 );
-
-		// Neonic: write override for clear... if it needed
-
-		// inject object
-		void					inject( PObject obj );
-		// eject object
-		void					eject( PObject obj );
-		// eject object now in any case. correctly eject dynamic object
-		void					ejectNow( PObject obj );
-		// set object new position
-		void					set_pos( PObject obj, const point3f pos );
-		// set object new extents
-		void					setExt( PObject obj, const point3f ext );
-		// move object to new position
-		void					move( PObject obj, const point3f& pos );
-		// process approximation with deferred queryes before asking position.
-		virtual void			approximate( void );
-		// process objects finalizationt. you can make object static after this query(use isApproximated())
-		virtual void			finalize( void );
-		// get current query status: approximated or finalized
-		bool					isApproximated( void );
-		// get container with object, who updated/moved at last cycle
-		Array&					getDynamicObjects( void );
+		static bool ray_hits(const aabb& box, const float origin[3], const float dir[3], float max_t)
+		{
+			float t0 = 0, t1 = max_t;
+			for (int i = 0; i < 3; ++i)
+			{
+				if (dir[i] == 0)
+				{
+					if (origin[i] < box.min[i] || origin[i] > box.max[i])
+						return false;
+					continue;
+				}
+
+				float inv = 1.0f / dir[i];
+				float tn = (box.min[i] - origin[i]) * inv;
+				float tf = (box.max[i] - origin[i]) * inv;
+				if (tn > tf)
+				{
+					float t = tn; tn = tf; tf = t;
+				}
+
+				if (tn > t0) t0 = tn;
+				if (tf < t1) t1 = tf;
+				if (t0 > t1)
+					return false;
+			}
+			return true;
+		}
+
+		aabb fatten(const aabb& box) const
+		{
+			float size = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				float s = box.max[i] - box.min[i];
+				if (s > size) size = s;
+			}
+
+			const float m = size * m_margin + 0.01f;
+			aabb fat = box;
+			for (int i = 0; i < 3; ++i)
+			{
+				fat.min[i] -= m;
+				fat.max[i] += m;
+			}
+			return fat;
+		}
+
+		proxy_id allocate()
+		{
+			proxy_id id = m_free;
+			if (id == null_proxy)
+			{
+				id = (proxy_id)m_nodes.size();
+				m_nodes.push_back(node());
+			}
+			else
+				m_free = m_nodes[id].parent;
+
+			node& n = m_nodes[id];
+			n.data = 0;
+			n.parent = null_proxy;
+			n.child1 = null_proxy;
+			n.child2 = null_proxy;
+			n.height = 0;
+			return id;
+		}
+
+		void release(proxy_id id)
+		{
+			m_nodes[id].parent = m_free;
+			m_nodes[id].height = -1;
+			m_free = id;
+		}
 
-	private:
-		// eject object in case of their state.
-		void					ejectDynamic( PObject obj );
-		// inject object in case of their state
-		void					injectDynamic( PObject obj );
-
-		bool			m_isApproximated;
-		Array			m_arrayEject, m_arrayInject, m_arrayDynamic;
-		Sorted			m_sortMove, m_sortChange;
-	};
+		void insert_leaf(proxy_id leaf)
+		{
+			if (m_root == null_proxy)
+			{
+				m_root = leaf;
+				m_nodes[leaf].parent = null_proxy;
+				return;
+			}
+
+			// descend to sibling with smallest growth of total area
+			const aabb box = m_nodes[leaf].box;
+			proxy_id index = m_root;
+			while (!m_nodes[index].is_leaf())
+			{
+				const node& n = m_nodes[index];
+				const float area = n.box.area();
+				const float combined = aabb::merge(n.box, box).area();
+
+				const float cost = 2 * combined;
+				const float inherited = 2 * (combined - area);
+
+				const float cost1 = child_cost(n.child1, box) + inherited;
+				const float cost2 = child_cost(n.child2, box) + inherited;
+
+				if (cost < cost1 && cost < cost2)
+					break;
+
+				index = cost1 < cost2 ? n.child1 : n.child2;
+			}
+
+			const proxy_id sibling = index;
+			const proxy_id old_parent = m_nodes[sibling].parent;
+			const proxy_id new_parent = allocate();
+
+			node& p = m_nodes[new_parent];
+			p.parent = old_parent;
+			p.box = aabb::merge(box, m_nodes[sibling].box);
+			p.height = m_nodes[sibling].height + 1;
+			p.child1 = sibling;
+			p.child2 = leaf;
+
+			m_nodes[sibling].parent = new_parent;
+			m_nodes[leaf].parent = new_parent;
+
+			if (old_parent == null_proxy)
+				m_root = new_parent;
+			else if (m_nodes[old_parent].child1 == sibling)
+				m_nodes[old_parent].child1 = new_parent;
+			else
+				m_nodes[old_parent].child2 = new_parent;
+
+			refit(new_parent);
+		}
+
+		float child_cost(proxy_id child, const aabb& box) const
+		{
+			const node& c = m_nodes[child];
+			const float combined = aabb::merge(c.box, box).area();
+			return c.is_leaf() ? combined : combined - c.box.area();
+		}
 
-	////////////////////////////////////////////////////////////////////////
-	// 
-	// TStaticTreeRoot
-	//	static tree without query
-	////////////////////////////////////////////////////////////////////////
+		void remove_leaf(proxy_id leaf)
+		{
+			if (leaf == m_root)
+			{
+				m_root = null_proxy;
+				return;
+			}
+
+			const proxy_id parent = m_nodes[leaf].parent;
+			const proxy_id grand_parent = m_nodes[parent].parent;
+			const proxy_id sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+			if (grand_parent == null_proxy)
+			{
+				m_root = sibling;
+				m_nodes[sibling].parent = null_proxy;
+				release(parent);
+				return;
+			}
+
+			if (m_nodes[grand_parent].child1 == parent)
+				m_nodes[grand_parent].child1 = sibling;
+			else
+				m_nodes[grand_parent].child2 = sibling;
+			m_nodes[sibling].parent = grand_parent;
+			release(parent);
+
+			refit(grand_parent);
+		}
+
+		/// walks to root restoring boxes and heights, balancing on the way
+		void refit(proxy_id index)
+		{
+			while (index != null_proxy)
+			{
+				index = balance(index);
+
+				node& n = m_nodes[index];
+				const node& c1 = m_nodes[n.child1];
+				const node& c2 = m_nodes[n.child2];
+				n.height = 1 + (c1.height > c2.height ? c1.height : c2.height);
+				n.box = aabb::merge(c1.box, c2.box);
+
+				index = n.parent;
+			}
+		}
+
+		/// rotates higher grandchild up if children heights differ by more than one.
+		/// returns index of node which is now at the place of a
+		proxy_id balance(proxy_id a)
+		{
+			node& na = m_nodes[a];
+			if (na.is_leaf() || na.height < 2)
+				return a;
+
+			const proxy_id b = na.child1;
+			const proxy_id c = na.child2;
+			const int diff = m_nodes[c].height - m_nodes[b].height;
+
+			if (diff > 1)
+				return rotate(a, c, b);
+			if (diff < -1)
+				return rotate(a, b, c);
+			return a;
+		}
+
+		/// lifts child up to place of a, other stays child of a
+		proxy_id rotate(proxy_id a, proxy_id up, proxy_id other)
+		{
+			node& na = m_nodes[a];
+			node& nu = m_nodes[up];
+
+			const proxy_id f = nu.child1;
+			const proxy_id g = nu.child2;
+
+			nu.child1 = a;
+			nu.parent = na.parent;
+			na.parent = up;
+
+			if (nu.parent == null_proxy)
+				m_root = up;
+			else if (m_nodes[nu.parent].child1 == a)
+				m_nodes[nu.parent].child1 = up;
+			else
+				m_nodes[nu.parent].child2 = up;
+
+			// higher grandchild stays under up, lower one goes to a
+			proxy_id keep = f, give = g;
+			if (m_nodes[f].height < m_nodes[g].height)
+			{
+				keep = g;
+				give = f;
+			}
+
+			nu.child2 = keep;
+			na.child1 = other;
+			na.child2 = give;
+			m_nodes[give].parent = a;
+
+			const node& no = m_nodes[other];
+			const node& ng = m_nodes[give];
+			na.box = aabb::merge(no.box, ng.box);
+			na.height = 1 + (no.height > ng.height ? no.height : ng.height);
+
+			nu.box = aabb::merge(na.box, m_nodes[keep].box);
+			nu.height = 1 + (na.height > m_nodes[keep].height ? na.height : m_nodes[keep].height);
+
+			return up;
+		}
 
-	class TStaticTreeRoot
-		: public CTRoot
-	{
-	public:
+	private:
+		std::vector<node>	m_nodes;
+		proxy_id			m_root;
+		proxy_id			m_free;
+		size_t				m_num_proxies;
+		float				m_margin;
 	};
-
-}; //live_tree
\ No newline at end of file
+}
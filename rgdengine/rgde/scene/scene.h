@@ -2,10 +2,12 @@
 
 #include <rgde/io/io.h>
 #include <rgde/base/singelton.h>
+#include <rgde/scene/live_tree.h>
 
 namespace math
 {
 	typedef boost::intrusive_ptr<class frame> frame_ptr;
+	class frustum;
 }
 
 namespace scene
@@ -27,14 +29,44 @@ namespace scene
 
 		void debug_draw( );
 
+		typedef std::vector<math::frame*> frames_list;
+
+		/// registers frame in spatial index with bounding sphere of radius around its world position
+		void inject(const math::frame_ptr& frame, float radius);
+		void eject(const math::frame_ptr& frame);
+		/// moves injected frames in index, called once per application update
+		void update_index();
+
+		/// injected frames which bounding spheres intersect volume.
+		/// ray is origin + t * dir, 0 <= t <= max_dist
+		void query_sphere(const math::point3f& center, float radius, frames_list& result) const;
+		void query_aabb(const math::aaboxf& box, frames_list& result) const;
+		void query_ray(const math::point3f& origin, const math::vec3f& dir, float max_dist, frames_list& result) const;
+		void query_frustum(const math::frustum& frustum, frames_list& result) const;
+
 	protected:
 		void aux_draw( math::frame_ptr frame );
 		virtual void to_stream(io::write_stream& wf) const;
 		virtual void from_stream(io::read_stream& rf);
 
+	private:
+		struct indexed_frame
+		{
+			math::frame_ptr			 frame;
+			float					 radius;
+			math::point3f			 center;
+			live_tree::proxy_id		 proxy;
+		};
+		typedef std::list<indexed_frame> indexed_frames;
+
+		struct collector;
+
 	private:
 		std::list<scene_manager_ptr> m_managers;
 		math::frame_ptr			 m_root;
+
+		live_tree				 m_index;
+		indexed_frames			 m_indexed;
 	};
 
 	typedef base::singelton<Scene> TheScene;
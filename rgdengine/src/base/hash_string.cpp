@@ -102,14 +102,19 @@ namespace base
 	}
 
 	void hash_string::calc_hash()
+	{
+		m_hash_value = calc_hash(m_string.c_str(), m_string.size());
+	}
+
+	hash_string::hash_id hash_string::calc_hash(const void* data, size_t size)
 	{
 		CSHA1 sha1;
 
 		sha1.Reset();
-		sha1.update((unsigned char *)m_string.c_str(), m_string.size());
+		sha1.update((unsigned char *)data, size);
 		sha1.Final();
 
-		m_hash_value = sha1.GetHash();
+		return sha1.GetHash();
 	}
 }
 //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,58 @@
+#include "precompiled.h"
+
+#include <rgde/base/lock.h>
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <pthread.h>
+#endif
+
+namespace base
+{
+#ifdef _WIN32
+	mutex::mutex()
+		: m_impl(new CRITICAL_SECTION)
+	{
+		InitializeCriticalSection((CRITICAL_SECTION*)m_impl);
+	}
+
+	mutex::~mutex()
+	{
+		DeleteCriticalSection((CRITICAL_SECTION*)m_impl);
+		delete (CRITICAL_SECTION*)m_impl;
+	}
+
+	void mutex::lock()
+	{
+		EnterCriticalSection((CRITICAL_SECTION*)m_impl);
+	}
+
+	void mutex::unlock()
+	{
+		LeaveCriticalSection((CRITICAL_SECTION*)m_impl);
+	}
+#else
+	mutex::mutex()
+		: m_impl(new pthread_mutex_t)
+	{
+		pthread_mutex_init((pthread_mutex_t*)m_impl, 0);
+	}
+
+	mutex::~mutex()
+	{
+		pthread_mutex_destroy((pthread_mutex_t*)m_impl);
+		delete (pthread_mutex_t*)m_impl;
+	}
+
+	void mutex::lock()
+	{
+		pthread_mutex_lock((pthread_mutex_t*)m_impl);
+	}
+
+	void mutex::unlock()
+	{
+		pthread_mutex_unlock((pthread_mutex_t*)m_impl);
+	}
+#endif
+}
@@ -0,0 +1,202 @@
+#include "precompiled.h"
+
+#include <rgde/base/thread_pool.h>
+#include <rgde/base/lock.h>
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <pthread.h>
+#	include <semaphore.h>
+#	include <unistd.h>
+#endif
+
+namespace base
+{
+	namespace
+	{
+#ifdef _WIN32
+		typedef HANDLE thread_handle;
+
+		class semaphore : boost::noncopyable
+		{
+		public:
+			semaphore() : m_handle(CreateSemaphore(0, 0, LONG_MAX, 0)) {}
+			~semaphore() {CloseHandle(m_handle);}
+
+			void post(unsigned count) {ReleaseSemaphore(m_handle, count, 0);}
+			void wait() {WaitForSingleObject(m_handle, INFINITE);}
+
+		private:
+			HANDLE m_handle;
+		};
+
+		unsigned get_num_processors()
+		{
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwNumberOfProcessors;
+		}
+#else
+		typedef pthread_t thread_handle;
+
+		class semaphore : boost::noncopyable
+		{
+		public:
+			semaphore() {sem_init(&m_sem, 0, 0);}
+			~semaphore() {sem_destroy(&m_sem);}
+
+			void post(unsigned count)
+			{
+				for (unsigned i = 0; i < count; ++i)
+					sem_post(&m_sem);
+			}
+
+			void wait()
+			{
+				while (0 != sem_wait(&m_sem))
+					;
+			}
+
+		private:
+			sem_t m_sem;
+		};
+
+		unsigned get_num_processors()
+		{
+			long num = sysconf(_SC_NPROCESSORS_ONLN);
+			return num > 0 ? (unsigned)num : 1;
+		}
+#endif
+	}
+
+	/// workers sleep on work semaphore, every wake up means one pass over
+	/// current job and one post of done semaphore
+	struct thread_pool::impl
+	{
+		std::vector<thread_handle> threads;
+		semaphore	work;
+		semaphore	done;
+		mutex		lock;
+
+		const job*	current;
+		size_t		count;
+		size_t		next;
+		bool		quit;
+
+		impl() : current(0), count(0), next(0), quit(false) {}
+
+		bool take(size_t& index)
+		{
+			scoped_lock l(lock);
+			if (next >= count)
+				return false;
+			index = next++;
+			return true;
+		}
+
+		void run()
+		{
+			size_t index;
+			while (take(index))
+				(*current)(index);
+		}
+
+		void worker()
+		{
+			for (;;)
+			{
+				work.wait();
+				if (quit)
+					break;
+				run();
+				done.post(1);
+			}
+		}
+
+#ifdef _WIN32
+		static DWORD WINAPI thread_func(LPVOID param)
+		{
+			static_cast<impl*>(param)->worker();
+			return 0;
+		}
+#else
+		static void* thread_func(void* param)
+		{
+			static_cast<impl*>(param)->worker();
+			return 0;
+		}
+#endif
+	};
+
+	thread_pool::thread_pool(unsigned num_threads)
+		: m_impl(new impl)
+	{
+		if (0 == num_threads)
+			num_threads = get_num_processors() - 1;
+
+		for (unsigned i = 0; i < num_threads; ++i)
+		{
+#ifdef _WIN32
+			HANDLE thread = CreateThread(0, 0, &impl::thread_func, m_impl, 0, 0);
+			if (0 == thread)
+				break;
+#else
+			pthread_t thread;
+			if (0 != pthread_create(&thread, 0, &impl::thread_func, m_impl))
+				break;
+#endif
+			m_impl->threads.push_back(thread);
+		}
+	}
+
+	thread_pool::~thread_pool()
+	{
+		m_impl->quit = true;
+		m_impl->work.post((unsigned)m_impl->threads.size());
+
+		for (size_t i = 0; i < m_impl->threads.size(); ++i)
+		{
+#ifdef _WIN32
+			WaitForSingleObject(m_impl->threads[i], INFINITE);
+			CloseHandle(m_impl->threads[i]);
+#else
+			pthread_join(m_impl->threads[i], 0);
+#endif
+		}
+
+		delete m_impl;
+	}
+
+	unsigned thread_pool::size() const
+	{
+		return (unsigned)m_impl->threads.size();
+	}
+
+	void thread_pool::parallel_for(size_t count, const job& f)
+	{
+		if (0 == count)
+			return;
+
+		if (m_impl->threads.empty() || 1 == count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				f(i);
+			return;
+		}
+
+		{
+			scoped_lock l(m_impl->lock);
+			m_impl->current = &f;
+			m_impl->count = count;
+			m_impl->next = 0;
+		}
+
+		const unsigned num_workers = (unsigned)(std::min)(m_impl->threads.size(), count - 1);
+		m_impl->work.post(num_workers);
+		m_impl->run();
+
+		for (unsigned i = 0; i < num_workers; ++i)
+			m_impl->done.wait();
+	}
+}
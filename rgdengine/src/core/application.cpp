@@ -13,6 +13,7 @@
 #include "../base/exception.h"
 
 #include <rgde/render/manager.h>
+#include <rgde/scene/scene.h>
 #include <rgde/io/file_system.h>
 #include <boost/filesystem/operations.hpp>
 
@@ -532,6 +533,11 @@ namespace core
 			}
 			else
 			{
+				m_file_system.update();
+
+				if (scene::TheScene::is_created())
+					scene::TheScene::get().update_index();
+
 				//if (!m_active)
 				//{
 				//	WaitMessage();
@@ -7,6 +7,8 @@
 
 #include <rgde/render/sprites.h>
 
+#include <rgde/base/xml_helpers.h>
+
 namespace game
 {
 	namespace events
@@ -69,52 +71,39 @@ namespace game
         if (strXmlGameConfig == "")
             return;
 
-		std::string fname = "Media/" + strXmlGameConfig;
-		TiXmlDocument doc(fname);
+		base::xml_document doc;
 
-		if (!doc.LoadFile())
+		if (!doc.load(strXmlGameConfig))
 		{
 			//... ,     xml    
 			//printf( "Could not load test file 'demotest.xml'. Error='%s'. Exiting.\n", doc.ErrorDesc() );
 		}
 		else
 		{
-			TiXmlNode *root = doc.FirstChild("game");
-
-			if (!root)
-				return;
-
-			TiXmlElement *game = root->ToElement();
+			pugi::xml_node game = doc.document().child("game");
 
 			if (!game)
 				return;
 
 			//   
-			std::string strCurrentLevel = game->Attribute("startlevel");
+			std::string strCurrentLevel = game.attribute("startlevel").value();
 
 			//  ,    
-			TiXmlElement *level_el = game->FirstChildElement("level");
-
-			while (level_el)
+			for (pugi::xml_node level_el = game.child("level"); level_el; level_el = level_el.next_sibling("level"))
 			{
-				std::string name = level_el->Attribute("name");
-				std::string next_level = level_el->Attribute("next_level");
+				std::string name = level_el.attribute("name").value();
+				std::string next_level = level_el.attribute("next_level").value();
 
 				// 
 				level* pLevel = new level(name,next_level);
 				addLevel(name,next_level);
 
 				//  ,    	
-				TiXmlElement *levelobject = level_el->FirstChildElement("levelobject");
-
-				while (levelobject)
+				for (pugi::xml_node levelobject = level_el.child("levelobject"); levelobject; levelobject = levelobject.next_sibling("levelobject"))
 				{
-					std::string type = levelobject->Attribute("type");
+					std::string type = levelobject.attribute("type").value();
 					pLevel->call("AddTypeToCreate", type);
-					levelobject = levelobject->NextSiblingElement("levelobject");
 				}
-
-				level_el = level_el->NextSiblingElement("level");
 			}
 
 			setCurrentLevel(strCurrentLevel);
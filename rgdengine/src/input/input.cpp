@@ -6,6 +6,8 @@
 
 #include "inputimpl.h"
 
+#include <rgde/base/xml_helpers.h>
+
 namespace input
 {
     Input* Input::ms_instance = 0;
@@ -54,15 +56,10 @@ namespace input
 
     void Input::load (const std::string &filename)
     {
-        std::vector<char> data;
-
-        io::file_system &fs    = io::file_system::get();
-        io::readstream_ptr stream = fs.find(filename);
-        io::stream_to_vector<char>(data, stream);
-
-		std::string str( data.begin(), data.end());
+        base::xml_document doc;
 
-        get().m_impl->load(str);
+        if (doc.load(filename))
+            get().m_impl->load(doc.document());
     }
 
     void Input::update ()
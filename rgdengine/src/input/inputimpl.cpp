@@ -3,6 +3,8 @@
 #include <rgde/input/input.h>
 #include "inputimpl.h"
 
+#include <rgde/base/xml_helpers.h>
+
 #define KEYBOARD_BUFFER_SIZE 1024
 #define    MOUSE_BUFFER_SIZE 1024
 
@@ -223,43 +225,33 @@ namespace input
         if (!m_inited)
             return;
 
-		TiXmlDocument doc;
-		doc.Parse(xml.c_str());
-		
-		TiXmlNode *root = doc.FirstChild("input");
-		if (root)
+		base::xml_document doc;
+		if (doc.parse(xml))
+			load(doc.document());
+    }
+
+    void input_impl::load (pugi::xml_node document)
+    {
+        if (!m_inited)
+            return;
+
+		pugi::xml_node root = document.child("input");
+		for (pugi::xml_node cmd = root.child("command"); cmd; cmd = cmd.next_sibling("command"))
 		{
-			TiXmlNode *command = root->FirstChild("command");
-			while (command)
+			std::string command_name(cmd.attribute("name").value());
+			add_command(command_name);
+
+			for (pugi::xml_node ctrl = cmd.child("control"); ctrl; ctrl = ctrl.next_sibling("control"))
 			{
-				TiXmlElement *cmd = command->ToElement();
-				if (cmd)
+				std::string sDevice(ctrl.attribute("device").value());
+				std::string sControl(ctrl.attribute("name").value());
+				device *d = get_device(String2Device(std::wstring(sDevice.begin(), sDevice.end())));
+				if (d)
 				{
-					std::string command_name(cmd->Attribute("name"));
-					add_command(command_name);
-
-					TiXmlNode *control = command->FirstChild("control");
-					while (control)
-					{
-						TiXmlElement *ctrl = control->ToElement();
-						if (ctrl)
-						{
-							std::string sDevice(ctrl->Attribute("device"));
-							std::string sControl(ctrl->Attribute("name"));
-							device *d = get_device(String2Device(std::wstring(sDevice.begin(), sDevice.end())));
-							if (d)
-							{
-								Control *c = d->get_control(String2Control(std::wstring(sControl.begin(), sControl.end())));
-								if (c)
-									c->bind(get_command(command_name));
-							}
-						}
-
-						control = control->NextSibling("control");
-					}
+					Control *c = d->get_control(String2Control(std::wstring(sControl.begin(), sControl.end())));
+					if (c)
+						c->bind(get_command(command_name));
 				}
-
-				command = command->NextSibling("command");
 			}
 		}
     }
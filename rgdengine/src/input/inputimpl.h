@@ -21,6 +21,7 @@ namespace input
 
 		/// 
         void load(const std::string &xml);                               
+        void load(pugi::xml_node document);
 		void save(std::string &xml);
 
 		//       
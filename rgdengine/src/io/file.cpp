@@ -3,6 +3,60 @@
 #include <rgde/io/file.h>
 #include <rgde/io/serialized_object.h>
 
+namespace
+{
+	/// string length is stored with terminating zero, so string data is read 
+	/// straight into destination buffer and trimmed afterwards.
+	/// string longer than max_size is skipped, so stream stays at the next record
+	template <typename Char>
+	bool read_string_impl(io::read_stream& rf, std::basic_string<Char>& str, unsigned max_size)
+	{
+		typedef std::basic_string<Char> string_type;
+
+		str.clear();
+
+		// length itself is cut off
+		const unsigned long stream_size = rf.size();
+		if (rf.position() + sizeof(unsigned) > stream_size)
+		{
+			rf.position(stream_size);
+			return false;
+		}
+
+		unsigned size	= 0;
+		rf.read((byte *)&size, sizeof(unsigned));
+
+		if (size > max_size)
+		{
+			const unsigned long pos = rf.position();
+			const unsigned long rest = (stream_size - pos) / sizeof(Char);
+			rf.position(size < rest ? pos + size * sizeof(Char) : stream_size);
+			return false;
+		}
+
+		if (0 == size)
+			return true;
+
+		str.resize(size);
+		rf.read((byte *)&str[0], size * sizeof(Char));
+
+		typename string_type::size_type len = str.find(Char(0));
+		if (len != string_type::npos)
+			str.resize(len);
+
+		return true;
+	}
+
+	/// max number of chars which could be stored in the rest of stream
+	unsigned get_max_string_size(io::read_stream& rf, unsigned char_size)
+	{
+		unsigned long size	= rf.size();
+		unsigned long pos	= rf.position() + sizeof(unsigned);
+
+		return pos < size ? (unsigned)((size - pos) / char_size) : 0;
+	}
+}
+
 namespace io
 {
 	namespace helpers
@@ -56,11 +110,8 @@ namespace io
 	//////////////////////////////////////////////////////////////////////////
 	read_stream & operator >>(read_stream &rf, std::string &str)
 	{
-		unsigned size	= 0;
-		rf.read((byte *)&size, sizeof(unsigned));
-		char *c_str	= new char[size];
-		rf.read((byte *)c_str, size * sizeof(char));
-		str = std::string(c_str);
+		bool result = read_string(rf, str, get_max_string_size(rf, sizeof(char)));
+		assert(result && "io::operator >>(std::string&): string length exceeds stream size!");
 		return rf;
 	}
 	//-----------------------------------------------------------------------------------
@@ -96,13 +147,20 @@ namespace io
 	//-----------------------------------------------------------------------------------
 	read_stream & operator >>(read_stream &rf, std::wstring &str)
 	{
-		unsigned size	= 0;
-		rf.read((byte *)&size, sizeof(unsigned));
-		wchar_t *c_str	= new wchar_t[size];
-		rf.read((byte *)c_str, size * sizeof(wchar_t));
-		str = std::wstring(c_str);
+		bool result = read_string(rf, str, get_max_string_size(rf, sizeof(wchar_t)));
+		assert(result && "io::operator >>(std::wstring&): string length exceeds stream size!");
 		return rf;
 	}
+	//-----------------------------------------------------------------------------------
+	bool read_string(read_stream& rf, std::string& str, unsigned max_size)
+	{
+		return read_string_impl(rf, str, max_size);
+	}
+	//-----------------------------------------------------------------------------------
+	bool read_string(read_stream& rf, std::wstring& str, unsigned max_size)
+	{
+		return read_string_impl(rf, str, max_size);
+	}
 	//////////////////////////////////////////////////////////////////////////
 	write_stream & operator <<(write_stream &wf, const std::string &str)
 	{
@@ -2,6 +2,11 @@
 
 #include <rgde/io/file_system.h>
 #include <rgde/io/file.h>
+#include <rgde/io/file_watcher.h>
+#include <rgde/base/log.h>
+#include <rgde/base/lock.h>
+
+#include <boost/scoped_ptr.hpp>
 
 namespace
 {
@@ -9,6 +14,14 @@ namespace
 	{
 		return s1->priority() < s2->priority();
 	}
+
+	typedef std::vector<io::file_change_listener*> listeners_vector;
+
+	listeners_vector& get_listeners()
+	{
+		static listeners_vector listeners;
+		return listeners;
+	}
 }
 
 namespace io
@@ -29,22 +42,94 @@ namespace io
 			return 100;
 		}
 
-		readstream_ptr find(const std::string& file_path) const
+		readstream_ptr find(const interned_path& file_path) const
 		{
-			readstream_ptr	s(new read_file(file_path));
+			bool exists = true;
+			if (get_cached(file_path, exists) && !exists)
+				return readstream_ptr();
 
-			if (s->is_valid()) return s;
+			readstream_ptr	s(new read_file(file_path.str()));
+			exists = s->is_valid();
+			set_cached(file_path, exists);
+
+			if (exists) return s;
 
 			return readstream_ptr();
 		}
 
-		bool is_exist(const std::string& file_path) const
+		bool is_exist(const interned_path& file_path) const
+		{
+			bool exists = false;
+			if (get_cached(file_path, exists))
+				return exists;
+
+			exists = read_file(file_path.str()).is_open();
+			set_cached(file_path, exists);
+			return exists;
+		}
+
+		void invalidate(const interned_path& file_path)
 		{
-			return read_file(file_path).is_open();
+			base::scoped_lock lock(m_cache_mutex);
+			m_exist_cache.erase(file_path);
+		}
+
+		bool enable_watching(const Path& root, bool enable)
+		{
+			m_watcher.reset();
+
+			if (enable)
+			{
+				m_watcher.reset(new file_watcher((m_path / root).string()));
+				if (!m_watcher->is_valid())
+					m_watcher.reset();
+			}
+
+			return 0 != m_watcher.get();
+		}
+
+		void poll_changes(std::vector<std::string>& changed)
+		{
+			if (!m_watcher)
+				return;
+
+			size_t num_changed = changed.size();
+			m_watcher->poll(changed);
+
+			// created files must not stay cached as missing
+			if (changed.size() != num_changed)
+			{
+				base::scoped_lock lock(m_cache_mutex);
+				m_exist_cache.clear();
+			}
 		}
 
 	private:
+		bool get_cached(const interned_path& file_path, bool& exists) const
+		{
+			base::scoped_lock lock(m_cache_mutex);
+			exist_cache::const_iterator it = m_exist_cache.find(file_path);
+			if (it == m_exist_cache.end())
+				return false;
+
+			exists = it->second;
+			return true;
+		}
+
+		void set_cached(const interned_path& file_path, bool exists) const
+		{
+			base::scoped_lock lock(m_cache_mutex);
+			m_exist_cache[file_path] = exists;
+		}
+
+	private:
+		typedef std::map<interned_path, bool> exist_cache;
+
 		Path	m_path;
+		boost::scoped_ptr<file_watcher> m_watcher;
+
+		mutable base::mutex m_cache_mutex;
+		mutable exist_cache m_exist_cache;
 	};
 
 	//////////////////////////////////////////////////////////////////////////
@@ -56,6 +141,31 @@ namespace io
 
 	//////////////////////////////////////////////////////////////////////////
 
+	file_change_listener::file_change_listener()
+	{
+		get_listeners().push_back(this);
+	}
+
+	file_change_listener::~file_change_listener()
+	{
+		listeners_vector& listeners = get_listeners();
+		listeners.erase(std::remove(listeners.begin(), listeners.end(), this), listeners.end());
+	}
+
+	bool file_change_listener::is_same_file(const std::string& changed_path, std::string name)
+	{
+		std::replace(name.begin(), name.end(), '\\', '/');
+
+		if (name.size() > changed_path.size())
+			return false;
+
+		size_t pos = changed_path.size() - name.size();
+		return 0 == changed_path.compare(pos, name.size(), name) &&
+			(0 == pos || '/' == changed_path[pos - 1]);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+
 	file_system* file_system::ms_instance = 0;
 
 	file_system& file_system::get()
@@ -65,7 +175,9 @@ namespace io
 	}
 
 	file_system::file_system()
-		: m_root_path("./Media/")
+		: m_root_path("./Media/"),
+		  m_root(m_root_path.string()),
+		  m_is_watching(false)
 	{
 		assert(ms_instance == 0 && "Only one instance of file_system is allowed!");
 		ms_instance = this;
@@ -86,6 +198,46 @@ namespace io
 	void file_system::set_root_dir(const Path &path)
 	{
 		m_root_path = path;
+		m_root = interned_path(path.string());
+	}
+
+	void file_system::enable_watching(bool enable)
+	{
+		m_is_watching = false;
+
+		for (sources_vector::iterator it = m_sources.begin(); it != m_sources.end(); ++it)
+		{
+			if ((*it)->enable_watching(m_root_path, enable))
+				m_is_watching = true;
+		}
+
+		if (enable && !m_is_watching)
+			base::lwrn << "file_system: file changes tracking is not supported";
+	}
+
+	void file_system::update()
+	{
+		if (!m_is_watching)
+			return;
+
+		std::vector<std::string> changed;
+		for (sources_vector::iterator it = m_sources.begin(); it != m_sources.end(); ++it)
+			(*it)->poll_changes(changed);
+
+		if (changed.empty())
+			return;
+
+		std::sort(changed.begin(), changed.end());
+		changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+		// copy: listener may unregister itself while handling notification
+		listeners_vector listeners = get_listeners();
+		for (std::vector<std::string>::iterator file = changed.begin(); file != changed.end(); ++file)
+		{
+			base::lmsg << "file changed: \"" << *file << "\"";
+			for (listeners_vector::iterator it = listeners.begin(); it != listeners.end(); ++it)
+				(*it)->on_file_changed(*file);
+		}
 	}
 
 	void file_system::add_file_source(const file_source_ptr& spFileSource)
@@ -94,18 +246,25 @@ namespace io
 		std::sort(m_sources.begin(), m_sources.end());
 	}
 
+	std::string file_system::get_full_path(const std::string& file_path) const
+	{
+		return helpers::join_path(m_root.str(), file_path);
+	}
+
 	readstream_ptr file_system::find(const std::string& file_path) const
+	{
+		return find(m_root, file_path);
+	}
+
+	bool file_system::is_exist(const std::string& file_path) const
+	{
+		return is_exist(m_root, file_path);
+	}
+
+	readstream_ptr file_system::find(const interned_path& base, const std::string& file_path) const
 	{
 		readstream_ptr s;
-		std::string total_path	= m_root_path.string();
-		if(total_path != "")
-		{
-			char last = total_path[total_path.size() - 1];
-			if((last != '/') &&
-			   (last != '\\'))
-			total_path += "/";
-		}
-		total_path += file_path;
+		interned_path total_path = base.join(file_path);
 
 		for (sources_vector::const_iterator it = m_sources.begin(); it != m_sources.end(); ++it)
 		{
@@ -117,10 +276,10 @@ namespace io
 		return s;
 	}
 
-	bool file_system::is_exist(const std::string& file_path) const
+	bool file_system::is_exist(const interned_path& base, const std::string& file_path) const
 	{
 		bool result	= false;
-		std::string total_path	= m_root_path.string() + "/" + file_path;
+		interned_path total_path = base.join(file_path);
 
 		for (sources_vector::const_iterator it = m_sources.begin(); it != m_sources.end(); ++it)
 		{
@@ -132,6 +291,14 @@ namespace io
 		return result;
 	}
 
+	void file_system::invalidate_cache(const std::string& full_path)
+	{
+		interned_path path(full_path);
+
+		for (sources_vector::const_iterator it = m_sources.begin(); it != m_sources.end(); ++it)
+			(*it)->invalidate(path);
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 
 	scope_path::scope_path(const std::string& new_path)
@@ -150,7 +317,7 @@ namespace io
 	path_add_scoped::path_add_scoped(const std::string& new_path)
 		: m_old_path(file_system::get().get_root_dir())
 	{
-		std::string total_path	= m_old_path.string() + "/" + new_path;
+		std::string total_path	= helpers::join_path(m_old_path.string(), new_path);
 		file_system::get().set_root_dir(Path(total_path));
 	}
 
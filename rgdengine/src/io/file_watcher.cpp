@@ -0,0 +1,170 @@
+#include "precompiled.h"
+
+#include <rgde/io/file_watcher.h>
+#include <rgde/base/log.h>
+
+#ifdef __linux__
+#	include <sys/inotify.h>
+#	include <dirent.h>
+#	include <unistd.h>
+#	include <fcntl.h>
+#	include <errno.h>
+#	include <time.h>
+#endif
+
+namespace io
+{
+	namespace
+	{
+		double get_time()
+		{
+#ifdef __linux__
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+			return 0;
+#endif
+		}
+
+		std::string join_path(const std::string& dir, const std::string& name)
+		{
+			return dir.empty() ? name : dir + "/" + name;
+		}
+	}
+
+	file_watcher::file_watcher(const std::string& root_dir, float debounce_time)
+		: m_root_dir(root_dir),
+		  m_debounce_time(debounce_time),
+		  m_handle(-1)
+	{
+		while (!m_root_dir.empty() &&
+			(m_root_dir[m_root_dir.size() - 1] == '/' || m_root_dir[m_root_dir.size() - 1] == '\\'))
+		{
+			m_root_dir.erase(m_root_dir.size() - 1);
+		}
+
+#ifdef __linux__
+		m_handle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_handle < 0)
+		{
+			base::lwrn << "file_watcher: inotify_init failed, hot-reload disabled";
+			return;
+		}
+
+		add_watch("", 0);
+#endif
+	}
+
+	file_watcher::~file_watcher()
+	{
+#ifdef __linux__
+		if (m_handle >= 0)
+			close(m_handle);
+#endif
+	}
+
+	bool file_watcher::is_valid() const
+	{
+		return m_handle >= 0 && !m_watches.empty();
+	}
+
+	void file_watcher::add_watch(const std::string& rel_dir, double created_time)
+	{
+#ifdef __linux__
+		std::string full_dir = join_path(m_root_dir.empty() ? "." : m_root_dir, rel_dir);
+
+		const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF;
+		int wd = inotify_add_watch(m_handle, full_dir.c_str(), mask);
+		if (wd < 0)
+		{
+			base::lwrn << "file_watcher: can't watch \"" << full_dir << "\"";
+			return;
+		}
+		m_watches[wd] = rel_dir;
+
+		// inotify is not recursive - every sub directory needs its own watch.
+		// files in just created directory could be written before watch was added
+		if (DIR* dir = opendir(full_dir.c_str()))
+		{
+			while (dirent* entry = readdir(dir))
+			{
+				if (entry->d_name[0] == '.')
+					continue;
+
+				if (entry->d_type == DT_DIR)
+					add_watch(join_path(rel_dir, entry->d_name), created_time);
+				else if (created_time > 0)
+					m_pending[join_path(rel_dir, entry->d_name)] = created_time;
+			}
+			closedir(dir);
+		}
+#endif
+	}
+
+	void file_watcher::read_events(double now)
+	{
+#ifdef __linux__
+		char buffer[4096];
+
+		for (;;)
+		{
+			ssize_t len = read(m_handle, buffer, sizeof(buffer));
+			if (len <= 0)
+				break;
+
+			for (char* ptr = buffer; ptr < buffer + len; )
+			{
+				const inotify_event* ev = (const inotify_event*)ptr;
+				ptr += sizeof(inotify_event) + ev->len;
+
+				watch_map::iterator it = m_watches.find(ev->wd);
+				if (it == m_watches.end())
+					continue;
+
+				if (ev->mask & (IN_DELETE_SELF | IN_IGNORED))
+				{
+					m_watches.erase(it);
+					continue;
+				}
+
+				if (0 == ev->len)
+					continue;
+
+				std::string path = join_path(it->second, ev->name);
+
+				if (ev->mask & IN_ISDIR)
+				{
+					if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+						add_watch(path, now);
+					continue;
+				}
+
+				// plain IN_CREATE is followed by IN_CLOSE_WRITE once data is written
+				if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+					m_pending[path] = now;
+			}
+		}
+#endif
+	}
+
+	void file_watcher::poll(changes_list& changed)
+	{
+		if (m_handle < 0)
+			return;
+
+		double now = get_time();
+		read_events(now);
+
+		for (pending_map::iterator it = m_pending.begin(); it != m_pending.end(); )
+		{
+			if (now - it->second >= m_debounce_time)
+			{
+				changed.push_back(it->first);
+				m_pending.erase(it++);
+			}
+			else
+				++it;
+		}
+	}
+}
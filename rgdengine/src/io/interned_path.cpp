@@ -0,0 +1,100 @@
+#include "precompiled.h"
+
+#include <rgde/io/interned_path.h>
+#include <rgde/base/lock.h>
+
+#include <set>
+
+// pool is constructed before static objects of other translation units,
+// so they may hold interned paths too
+#pragma init_seg(lib)
+
+namespace io
+{
+	namespace
+	{
+		typedef std::set<std::string> path_pool;
+
+		// namespace scope, so first interning threads don't race constructing them
+		base::mutex pool_mutex;
+		path_pool pool;
+
+		/// set nodes never move, so pointers to pooled strings stay valid
+		const std::string* intern(const std::string& normalized_path)
+		{
+			base::scoped_lock lock(pool_mutex);
+			return &*pool.insert(normalized_path).first;
+		}
+	}
+
+	namespace helpers
+	{
+		std::string normalize_path(const std::string& path)
+		{
+			std::vector<std::string> segments;
+			// number of leading ".." which can't be collapsed
+			size_t num_up = 0;
+			bool is_absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+
+			size_t begin = 0;
+			while (begin <= path.size())
+			{
+				size_t end = path.find_first_of("/\\", begin);
+				if (end == std::string::npos)
+					end = path.size();
+
+				std::string segment = path.substr(begin, end - begin);
+				begin = end + 1;
+
+				if (segment.empty() || segment == ".")
+					continue;
+
+				if (segment == "..")
+				{
+					if (segments.size() > num_up)
+					{
+						segments.pop_back();
+						continue;
+					}
+					++num_up;
+				}
+
+				segments.push_back(segment);
+			}
+
+			std::string result = is_absolute ? "/" : "";
+			for (size_t i = 0; i < segments.size(); ++i)
+			{
+				if (i != 0) 
+					result += '/';
+				result += segments[i];
+			}
+			return result;
+		}
+
+		std::string join_path(const std::string& base, const std::string& path)
+		{
+			if (base.empty())
+				return normalize_path(path);
+
+			return normalize_path(base + "/" + path);
+		}
+	}
+
+	interned_path::interned_path()
+		: m_path(intern(std::string()))
+	{
+	}
+
+	interned_path::interned_path(const std::string& path)
+		: m_path(intern(helpers::normalize_path(path)))
+	{
+	}
+
+	interned_path interned_path::join(const std::string& path) const
+	{
+		interned_path result;
+		result.m_path = intern(helpers::join_path(*m_path, path));
+		return result;
+	}
+}
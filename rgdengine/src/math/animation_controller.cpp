@@ -2,18 +2,20 @@
 
 #include <rgde/math/animation_controller.h>
 
+#include <rgde/base/xml_helpers.h>
+
 
 namespace math
 {
-	frame_animation::frame_animation( TiXmlNode* pXmlNode, frame_ptr frame)
+	frame_animation::frame_animation( pugi::xml_node xml_node, frame_ptr frame)
 	{
 		m_paused = false;
 		m_playing = false;
 		m_looped = false;
 
-		if ( pXmlNode != 0 )
+		if ( xml_node )
 		{
-			load( pXmlNode );
+			load( xml_node );
 		}
 
 		m_frame = frame;
@@ -23,53 +25,44 @@ namespace math
 		weight(1.0f);
 	}
 
-	bool frame_animation::load( TiXmlNode* pXmlNode )
+	bool frame_animation::load( pugi::xml_node xml_node )
 	{
-		TiXmlElement *elem = pXmlNode->FirstChildElement("animation");
+		pugi::xml_node elem = xml_node.child("animation");
 
-		if ( elem == 0)
+		if ( elem.empty() )
 			return false;
 
-		double time;
-		elem->Attribute("time", &time );
-		m_anim_time = (float)time;
+		m_anim_time = elem.attribute("time").as_float();
 
-		for (TiXmlElement* ev = elem->FirstChildElement("key"); 0 != ev; ev = ev->NextSiblingElement("key"))
+		for (pugi::xml_node ev = elem.child("key"); ev; ev = ev.next_sibling("key"))
 		{
-			ev->Attribute( "time", &time );
-			TiXmlElement* child = 0;
+			float time = ev.attribute("time").as_float();
+			pugi::xml_node child;
 
-			if ( child = ev->FirstChildElement("translation" ) )
+			if ( child = ev.child("translation") )
 			{
-				double x,y,z;
-				child->Attribute("x", &x);
-				child->Attribute("y", &y);
-				child->Attribute("z", &z);
+				math::vec3f v;
+				base::read(v, child);
 
-				m_PosInterpolyator.add_key( (float)time, math::vec3f((float)x,(float)y,(float)z) );
+				m_PosInterpolyator.add_key( time, v );
 			}
 
-			if ( child = ev->FirstChildElement("rotation" ) )
+			if ( child = ev.child("rotation") )
 			{
-				double x,y,z;
-				child->Attribute("x", &x);
-				child->Attribute("y", &y);
-				child->Attribute("z", &z);
+				math::vec3f v;
+				base::read(v, child);
 
 				using math::Math::deg2Rad;
 
-				math::vec3f v((float)deg2Rad(x), (float)deg2Rad(y), (float)deg2Rad(z));
-				m_RotationInterpolyator.add_key( (float)time, v );
+				m_RotationInterpolyator.add_key( time, math::vec3f(deg2Rad(v[0]), deg2Rad(v[1]), deg2Rad(v[2])) );
 			}
 
-			if ( child = ev->FirstChildElement("scale" ) )
+			if ( child = ev.child("scale") )
 			{
-				double x,y,z;
-				child->Attribute("x", &x);
-				child->Attribute("y", &y);
-				child->Attribute("z", &z);
+				math::vec3f v;
+				base::read(v, child);
 
-				m_ScaleInterpolyator.add_key( (float)time, math::vec3f((float)x,(float)y,(float)z) );
+				m_ScaleInterpolyator.add_key( time, v );
 			}
 
 		}
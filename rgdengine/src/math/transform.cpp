@@ -127,9 +127,9 @@ namespace math
 		math::point3f Z = p + l * world_at();
 
 		render::lines3d& line_manager = render::render_device::get().get_lines3d();
-		line_manager.add_line( p, X, math::Red );
-		line_manager.add_line( p, Y, math::Green );
-		line_manager.add_line( p, Z, math::Blue );
+		line_manager.add_line( p, X, math::Red, render::lines3d::transforms );
+		line_manager.add_line( p, Y, math::Green, render::lines3d::transforms );
+		line_manager.add_line( p, Z, math::Blue, render::lines3d::transforms );
 	}
 
 	void frame::update_transform() const
@@ -37,6 +37,8 @@ namespace math
 #define TIXML_USE_STL
 #include "Tinyxml\\tinyxml.h"
 
+#include "pugixml-0.2\\src\\pugixml.hpp"
+
 //Boost
 //#include <boost\\timer.hpp>
 #include <boost/bind.hpp>
@@ -13,6 +13,7 @@
 #include <rgde/render/render_device.h>
 #include <rgde/render/manager.h>
 #include <rgde/render/light_manager.h>
+#include <rgde/render/transform_cache.h>
 
 #include <rgde/base/lexical_cast.h>
 
@@ -26,27 +27,57 @@ namespace render
 		return render_device::get().camera();
 	}
 
+	namespace
+	{
+		/// matrices of object which is bound now (see setObjectTransforms)
+		const math::frame*		 g_frame = 0;
+		const object_transforms* g_transforms = 0;
+
+		/// precomputed matrices if they are given for this frame,
+		/// otherwise they are computed here. returned by value, so calls
+		/// without precomputed matrices don't share any buffer
+		object_transforms getTransforms(const math::frame_ptr& frame)
+		{
+			if (g_transforms && frame.get() == g_frame)
+				return *g_transforms;
+
+			const math::camera_ptr& cam = camera();
+			assert(cam && "ERROR: render::getTransforms camera is NULL !");
+
+			object_transforms transforms;
+			const math::matrix44f view = cam->view_matrix();
+			transform_cache::compute(view.getData(), cam->proj_matrix().getData(),
+									 frame->world_trasform().getData(), transforms);
+			return transforms;
+		}
+
+		math::matrix44f toMatrix(const float* data)
+		{
+			math::matrix44f result;
+			result.set(data);
+			return result;
+		}
+	}
+
+	void setObjectTransforms(const math::frame* frame, const object_transforms* transforms)
+	{
+		g_frame = frame;
+		g_transforms = transforms;
+	}
+
 	math::matrix44f makeWorldViewProjMatrix(const math::frame_ptr& frame)
 	{
-		const math::camera_ptr& cam = camera();
-		assert(cam && "ERROR: render::makeWorldViewProjMatrix camera is NULL !");
-		const math::matrix44f& view = cam->view_matrix();
-		const math::matrix44f& proj = cam->proj_matrix();
-		return proj*(view*frame->world_trasform());
+		return toMatrix(getTransforms(frame).world_view_proj);
 	}
 
 	math::matrix44f makeWorldViewMatrix(const math::frame_ptr& frame)
 	{
-		return frame->world_trasform()*camera()->view_matrix();
+		return toMatrix(getTransforms(frame).world_view);
 	}
 
 	math::matrix44f makeWorldViewInvTranspMatrix(const math::frame_ptr& frame)
 	{
-		math::matrix44f result = frame->world_trasform();
-		result *= camera()->view_matrix();
-		math::invert(result);
-		math::transpose(result);
-		return result;
+		return toMatrix(getTransforms(frame).world_view_it);
 	}
 
 	void addMatrixParameters(const dynamic_binder_ptr& binder)
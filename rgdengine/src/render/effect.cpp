@@ -5,6 +5,8 @@
 
 #include <rgde/core/application.h>
 
+#include <rgde/base/lock.h>
+
 #include <d3dx9.h>
 #include "texture_impl.h"
 
@@ -100,13 +102,167 @@ namespace render
 		};
 	}
 
+	namespace
+	{
+		typedef std::map<std::string, effect::param_id> ids_map;
+
+		// namespace scope, VC8 doesn't construct function statics thread safely
+		base::mutex ids_mutex;
+		ids_map ids;
+	}
+
+	effect::param_id effect::get_param_id(const std::string& semantic)
+	{
+		base::scoped_lock lock(ids_mutex);
+		return ids.insert(ids_map::value_type(semantic, (param_id)ids.size())).first->second;
+	}
+
+	//------------------------------------------------------------------------------
+	// Staging storage of parameter values of one effect. Values of small not
+	// shared parameters are written here and uploaded all at once on commit_changes
+	// or pass begin. Write of value equal to staged one is dropped, so unchanged
+	// values are not uploaded again.
+	//------------------------------------------------------------------------------
+	class parameter_block
+	{
+	public:
+		enum kind_t
+		{
+			none,
+			int_value,
+			bool_value,
+			float_value,
+			vector_value,
+			matrix_value,
+			raw_value
+		};
+
+		enum {slot_size = 64};
+		static const unsigned no_slot = 0xFFFFFFFF;
+
+		parameter_block() : m_effect(0) {}
+
+		void init(ID3DXEffect* effect)
+		{
+			m_effect = effect;
+		}
+
+		/// effect was recompiled (slot handles are set by parameters),
+		/// staged values are uploaded to new effect on next flush
+		void rebind(ID3DXEffect* effect)
+		{
+			m_effect = effect;
+			for (unsigned i = 0; i < m_slots.size(); ++i)
+			{
+				slot& s = m_slots[i];
+				if (none != s.kind && !s.dirty)
+				{
+					s.dirty = true;
+					m_dirty.push_back(i);
+				}
+			}
+		}
+
+		void set_handle(unsigned index, D3DXHANDLE handle)
+		{
+			m_slots[index].handle = handle;
+		}
+
+		unsigned add_slot(D3DXHANDLE handle)
+		{
+			slot s = {handle, none, 0, false};
+			m_slots.push_back(s);
+			m_data.resize(m_slots.size() * slot_size);
+			return (unsigned)m_slots.size() - 1;
+		}
+
+		void write(unsigned index, kind_t kind, const void* data, unsigned bytes)
+		{
+			slot& s = m_slots[index];
+			byte* staged = &m_data[index * slot_size];
+
+			if (s.kind == kind && s.bytes == bytes && 0 == memcmp(staged, data, bytes))
+				return;
+
+			memcpy(staged, data, bytes);
+			s.kind = kind;
+			s.bytes = bytes;
+
+			if (!s.dirty)
+			{
+				s.dirty = true;
+				m_dirty.push_back(index);
+			}
+		}
+
+		/// value was set past staging, next write must be uploaded
+		void invalidate(unsigned index)
+		{
+			m_slots[index].kind = none;
+		}
+
+		void flush()
+		{
+			for (size_t i = 0; i < m_dirty.size(); ++i)
+			{
+				slot& s = m_slots[m_dirty[i]];
+				s.dirty = false;
+				upload(s, &m_data[m_dirty[i] * slot_size]);
+			}
+			m_dirty.resize(0);
+		}
+
+	private:
+		struct slot
+		{
+			D3DXHANDLE	handle;
+			kind_t		kind;
+			unsigned	bytes;
+			bool		dirty;
+		};
+
+		void upload(const slot& s, const byte* data)
+		{
+			// parameter was removed from recompiled effect
+			if (NULL == s.handle)
+				return;
+
+			HRESULT hr = S_OK;
+
+			switch (s.kind)
+			{
+			case int_value:		hr = m_effect->SetInt(s.handle, *(const int*)data); break;
+			case bool_value:	hr = m_effect->SetBool(s.handle, *(const BOOL*)data); break;
+			case float_value:	hr = m_effect->SetFloat(s.handle, *(const float*)data); break;
+			case vector_value:	hr = m_effect->SetVector(s.handle, (const D3DXVECTOR4*)data); break;
+			case matrix_value:	hr = m_effect->SetMatrix(s.handle, (const D3DXMATRIX*)data); break;
+			case raw_value:		hr = m_effect->SetValue(s.handle, data, s.bytes); break;
+			default:			break;
+			}
+
+			if (FAILED(hr))
+				base::lwrn << "parameter_block: staged parameter upload failed.";
+		}
+
+	private:
+		ID3DXEffect*		  m_effect;
+		std::vector<slot>	  m_slots;
+		std::vector<byte>	  m_data;
+		std::vector<unsigned> m_dirty;
+	};
+
 	//------------------------------------------------------------------------------
 	// effect parameter implementation.
 	//------------------------------------------------------------------------------
 	class effect_param_impl: public effect::parameter
 	{
 	public:
-		effect_param_impl(ID3DXEffect* effect, unsigned int index)
+		effect_param_impl(ID3DXEffect* effect, unsigned int index, parameter_block& block)
+			: m_block(block)
+			, m_slot(parameter_block::no_slot)
+			, m_texture(0)
+			, m_texture_set(false)
+			, m_shared(false)
 		{
 			//guard(render::effect::effect_param_impl())
 			m_effect = effect;
@@ -130,6 +286,11 @@ namespace render
 
 			m_Handle = m_effect->GetParameterByName(NULL, m_name.c_str());
 
+			// shared parameters live in effect pool, other effects change them too
+			m_shared = 0 != (paramDesc.Flags & D3DX_PARAMETER_SHARED);
+			if (D3DXPC_OBJECT != paramDesc.Class && !m_shared)
+				m_slot = m_block.add_slot(m_Handle);
+
 			//base::lmsg << "Annotations: " << paramDesc.Annotations;
 
 			for(unsigned int i = 0; i < paramDesc.Annotations; i++)
@@ -168,6 +329,10 @@ namespace render
 
 		bool set(const void* data, unsigned int size)
 		{
+			if (size <= parameter_block::slot_size && stage(parameter_block::raw_value, data, size))
+				return true;
+			unstage();
+
 			if (FAILED(m_effect->SetValue(m_Handle, data, size)))
 			{
 				base::lwrn << "const void* data, unsigned int size.";
@@ -179,6 +344,9 @@ namespace render
 
 		bool set(int value)
 		{
+			if (stage(parameter_block::int_value, &value, sizeof(value)))
+				return true;
+
 			if (FAILED(m_effect->SetInt(m_Handle, value)))
 			{
 				base::lwrn << "EffectParam::set(int value) failed.";
@@ -190,6 +358,10 @@ namespace render
 
 		bool set(bool value)
 		{
+			BOOL staged = value ? TRUE : FALSE;
+			if (stage(parameter_block::bool_value, &staged, sizeof(staged)))
+				return true;
+
 			if (FAILED(m_effect->SetBool(m_Handle, value)))
 			{
 				base::lwrn << "EffectParam::set(bool value) failed.";
@@ -201,6 +373,9 @@ namespace render
 
 		bool set(float value)
 		{
+			if (stage(parameter_block::float_value, &value, sizeof(value)))
+				return true;
+
 			if (FAILED(m_effect->SetFloat(m_Handle, value)))
 			{
 				base::lwrn << "EffectParam::set(float value) failed.";
@@ -223,6 +398,8 @@ namespace render
 
 		bool set(const math::Matrix33f& value)
 		{
+			unstage();
+
 			if (FAILED(m_effect->SetMatrix(m_Handle, (const D3DXMATRIX*)&value)))
 			{
 				base::lwrn << "EffectParam::set(math::Matrix33f& value) failed.";
@@ -234,6 +411,9 @@ namespace render
 
 		bool set(const math::matrix44f& value)
 		{
+			if (stage(parameter_block::matrix_value, value.getData(), 16 * sizeof(float)))
+				return true;
+
 			if (FAILED(m_effect->SetMatrix(m_Handle, (const D3DXMATRIX*)&value)))
 			{
 				base::lwrn << "EffectParam::set(math::matrix44f& value) failed.";
@@ -245,6 +425,10 @@ namespace render
 
 		bool set(const math::Color& value)
 		{
+			const math::vec4f color(value);
+			if (stage(parameter_block::vector_value, &color, sizeof(color)))
+				return true;
+
 			if (FAILED(m_effect->SetVector(m_Handle, (const D3DXVECTOR4*)&math::vec4f(value))))
 			{
 				base::lwrn << "EffectParam::set(math::Color& value) failed.";
@@ -256,6 +440,9 @@ namespace render
 
 		bool set(const math::vec4f& value)
 		{
+			if (stage(parameter_block::vector_value, &value, sizeof(value)))
+				return true;
+
 			if (FAILED(m_effect->SetVector(m_Handle, (const D3DXVECTOR4*)&value)))
 			{
 				base::lwrn << "EffectParam::set(math::vec4f& value) failed.";
@@ -267,6 +454,10 @@ namespace render
 
 		bool set(const math::vec3f& value)
 		{
+			const float vector[4] = {value[0], value[1], value[2], 0};
+			if (stage(parameter_block::vector_value, vector, sizeof(vector)))
+				return true;
+
 			if (FAILED(m_effect->SetVector(m_Handle, (const D3DXVECTOR4*)&value)))
 			{
 				base::lwrn << "EffectParam::set(math::vec3f& value) failed.";
@@ -278,6 +469,10 @@ namespace render
 
 		bool set(const math::vec2f& value)
 		{
+			const float vector[4] = {value[0], value[1], 0, 0};
+			if (stage(parameter_block::vector_value, vector, sizeof(vector)))
+				return true;
+
 			if (FAILED(m_effect->SetVector(m_Handle, (const D3DXVECTOR4*)&value)))
 			{
 				base::lwrn << "EffectParam::set(math::vec2f& value) failed.";
@@ -289,11 +484,17 @@ namespace render
 
 		bool set(const texture_ptr& texture)
 		{
+			// textures are set at once, but same texture is not set again,
+			// unless slot is shared and other effects may have changed it
+			IDirect3DTexture9* pDxTex = texture ? static_cast<texture_d3d9*>(texture.get())->get_dx_texture() : NULL;
+			if (m_texture_set && pDxTex == m_texture && !m_shared)
+				return true;
+			m_texture = pDxTex;
+			m_texture_set = true;
+
 			if (texture)
 			{
-				texture_d3d9 *pTexImpl = static_cast<texture_d3d9*>(texture.get());
 				//base::lmsg << "bind texture: " << pTexImpl->get_filename();
-				IDirect3DTexture9* pDxTex = pTexImpl->get_dx_texture();
 				if (FAILED(m_effect->SetTexture(m_Handle, pDxTex)))
 				{
 					base::lwrn << "EffectParam::set(texture_ptr texture) failed.";
@@ -314,6 +515,8 @@ namespace render
 
 		bool set(const int* value, int num)
 		{
+			unstage();
+
 			if (FAILED(m_effect->SetIntArray(m_Handle, value, num)))
 			{
 				base::lwrn << "EffectParam::set(int* value, int num) failed.";
@@ -325,6 +528,8 @@ namespace render
 
 		bool set(const float* value, int num)
 		{
+			unstage();
+
 			if (FAILED(m_effect->SetFloatArray(m_Handle, value, num)))
 			{
 				base::lwrn << "EffectParam::set(float* value, int num) failed.";
@@ -336,6 +541,8 @@ namespace render
 
 		bool set(const math::Matrix33f* value, int num)
 		{
+			unstage();
+
 			if (FAILED(m_effect->SetMatrixArray(m_Handle, (const D3DXMATRIX*)value, num)))
 			{
 				base::lwrn << "EffectParam::set(math::Matrix33f* value, int num) failed.";
@@ -347,6 +554,8 @@ namespace render
 
 		bool set(const math::matrix44f* value, int num)
 		{
+			unstage();
+
 			if (FAILED(m_effect->SetMatrixArray(m_Handle, (const D3DXMATRIX*)value, num)))
 			{
 				base::lwrn << "EffectParam::set(math::matrix44f* value, int num) failed.";
@@ -358,6 +567,8 @@ namespace render
 
 		bool set(const math::vec4f* value, int num)
 		{
+			unstage();
+
 			if (FAILED(m_effect->SetVectorArray(m_Handle, (const D3DXVECTOR4*)value, num)))
 			{
 				base::lwrn << "EffectParam::set(math::vec4f* value, int num) failed.";
@@ -369,6 +580,8 @@ namespace render
 
 		bool set(const math::vec3f* value, int num)
 		{
+			unstage();
+
 			if (FAILED(m_effect->SetVectorArray(m_Handle, (const D3DXVECTOR4*)value, num)))
 			{
 				base::lwrn << "EffectParam::set(math::vec3f* value, int num) failed.";
@@ -380,6 +593,8 @@ namespace render
 
 		bool set(const math::vec2f* value, int num)
 		{
+			unstage();
+
 			if (FAILED(m_effect->SetVectorArray(m_Handle, (const D3DXVECTOR4*)value, num)))
 			{
 				base::lwrn << "EffectParam::set(math::vec2f* value, int num) failed.";
@@ -389,6 +604,36 @@ namespace render
 			return true;
 		}
 
+		/// effect was recompiled, handle is looked up by name again (NULL if parameter
+		/// was removed). staged value is kept, texture and values set past staging
+		/// are set to new effect by next set
+		void rebind(ID3DXEffect* effect)
+		{
+			m_effect = effect;
+			m_Handle = m_effect->GetParameterByName(NULL, m_name.c_str());
+			m_texture_set = false;
+
+			if (parameter_block::no_slot != m_slot)
+				m_block.set_handle(m_slot, m_Handle);
+		}
+
+	private:
+		/// true if value is staged in parameter block, otherwise it must be set now
+		bool stage(parameter_block::kind_t kind, const void* data, unsigned bytes)
+		{
+			if (parameter_block::no_slot == m_slot)
+				return false;
+
+			m_block.write(m_slot, kind, data, bytes);
+			return true;
+		}
+
+		void unstage()
+		{
+			if (parameter_block::no_slot != m_slot)
+				m_block.invalidate(m_slot);
+		}
+
 	private:
 		ID3DXEffect* m_effect;
 		std::string m_name;
@@ -397,6 +642,12 @@ namespace render
 		type_t m_type;
 		D3DXHANDLE m_Handle;
 		effect::annotations_vector m_vecAnnotations;
+
+		parameter_block&	m_block;
+		unsigned			m_slot;
+		IDirect3DTexture9*	m_texture;
+		bool				m_texture_set;
+		bool				m_shared;
 	};
 
 	//------------------------------------------------------------------------------
@@ -408,7 +659,8 @@ namespace render
 		class pass_impl: public pass
 		{
 		public:
-			pass_impl(ID3DXEffect* effect, const D3DXHANDLE& technique, unsigned int index)
+			pass_impl(ID3DXEffect* effect, const D3DXHANDLE& technique, unsigned int index, parameter_block& block)
+				: m_block(block)
 			{
 				//guard(effect_technique_impl::pass_impl())
 
@@ -444,10 +696,17 @@ namespace render
 			{
 			}
 
+			void rebind(ID3DXEffect* effect)
+			{
+				m_effect = effect;
+			}
+
 			void begin()
 			{
 				//guard(effect_technique_impl::pass_impl::begin())
+					m_block.flush();
 					m_effect->BeginPass(m_nCurrentPass);
+					render_device::get().add_state_change();
 				//unguard
 			}
 
@@ -472,9 +731,10 @@ namespace render
 			std::string m_name;
 			ID3DXEffect* m_effect;
 			effect::annotations_vector m_vecAnnotations;
+			parameter_block& m_block;
 		};
 
-		effect_technique_impl(ID3DXEffect* effect, unsigned int index)
+		effect_technique_impl(ID3DXEffect* effect, unsigned int index, parameter_block& block)
 		{
 			//guard(effect_technique_impl())
 
@@ -488,7 +748,7 @@ namespace render
 			//base::lmsg << "Num passes in technique '" << Desc.Name << "': " << Desc.Passes;
 			for (unsigned int i = 0; i < Desc.Passes; i ++)
 			{
-				pass* pass = new pass_impl(m_effect, techniqueHandle, i);
+				pass* pass = new pass_impl(m_effect, techniqueHandle, i, block);
 				m_arPasses.push_back(pass);
 			}
 
@@ -513,6 +773,34 @@ namespace render
 			m_effect = NULL;
 		}
 
+		/// effect was recompiled, technique is looked up by name again. passes are
+		/// kept, so pointers to them stay valid, added ones are appended and removed
+		/// ones deleted. false if technique was removed, it draws nothing then
+		bool rebind(ID3DXEffect* effect, parameter_block& block)
+		{
+			D3DXHANDLE handle = effect->GetTechniqueByName(m_name.c_str());
+			unsigned int num_passes = 0;
+			if (NULL != handle && SUCCEEDED(effect->GetTechniqueDesc(handle, &Desc)))
+				num_passes = Desc.Passes;
+
+			while (m_arPasses.size() > num_passes)
+			{
+				delete m_arPasses.back();
+				m_arPasses.pop_back();
+			}
+
+			for (size_t i = 0; i < m_arPasses.size(); ++i)
+				static_cast<pass_impl*>(m_arPasses[i])->rebind(effect);
+
+			for (unsigned int i = (unsigned int)m_arPasses.size(); i < num_passes; ++i)
+				m_arPasses.push_back(new pass_impl(effect, handle, i, block));
+
+			m_nPasses = num_passes;
+			techniqueHandle = handle;
+			m_effect = NULL != handle ? effect : NULL;
+			return NULL != handle;
+		}
+
 		std::vector <pass*>& get_passes()
 		{
 			return m_arPasses;
@@ -536,6 +824,7 @@ namespace render
 				m_effect->SetTechnique(m_name.c_str());
 				unsigned int numPasses = 0;
 				m_effect->Begin(&numPasses, 0);
+				render_device::get().add_technique_begin();
 			}
 			//unguard
 		}
@@ -594,60 +883,46 @@ namespace render
 			}
 
 			m_name = effect_name;
+			m_effect = compile();
+			if (NULL == m_effect)
+				return false;
 
-			ID3DXBuffer* pErrors;
+			m_block.init(m_effect);
+			add_parameters();
+			add_techniques();
 
-			try{
-				io::file_system& fs = io::file_system::get();
-				io::path_add_scoped p("Common/shaders/");
-				io::readstream_ptr in = fs.find(m_name);
+			m_sNumEffects++;
 
-				if (!in)
-				{
-					base::lerr << "fx file not found: " << effect_name;
-					return false;
-				}
-				
-				std::vector<byte> data;
-				io::stream_to_vector(data, in);
+			return true;
+			//unguard
+		}
 
-				V(D3DXCreateEffect(g_d3d, (void*)&(data[0]), (uint)data.size() , NULL, &__include_impl, render_device::get().get_shader_flags(), 
-					m_spPool, &m_effect, &pErrors));
-				//V(D3DXCreateEffectFromFile( g_d3d, m_name.c_str() , NULL, NULL, device_dx9::get().get_shader_flags(), 
-				//	m_spPool, &m_effect, &pErrors));
-			}
-			catch(...)
-			{
-				std::string strError = std::string((char*)pErrors->GetBufferPointer());
-				base::lerr << std::string((char*)pErrors->GetBufferPointer());
+		/// recompiles changed file into this object, so effect_ptr and parameters and
+		/// techniques taken from it stay valid. on error old effect is kept
+		bool reload()
+		{
+			ID3DXEffect* effect = compile();
+			if (NULL == effect)
 				return false;
-			}
 
-			D3DXEFFECT_DESC desc;
-			V(m_effect->GetDesc(&desc));
+			ID3DXEffect* old = m_effect;
+			m_effect = effect;
 
-			// Retrieve parameters.
-			for(unsigned int i = 0; i < desc.Parameters; i ++)
-			{
-				parameter* effectParam = new effect_param_impl(m_effect, i);
-				m_mapParameters[effectParam->semantic()] = effectParam;
-			}
+			for (params_map::iterator it = m_mapParameters.begin(); it != m_mapParameters.end(); ++it)
+				static_cast<effect_param_impl*>(it->second)->rebind(m_effect);
+			m_block.rebind(m_effect);
 
-			// Retrieve techniques.
-			for(unsigned int i = 0; i < desc.Techniques; i ++)
+			for (techniques_list::iterator it = m_listTechniques.begin(); it != m_listTechniques.end(); ++it)
 			{
-				effect_technique_impl* technique = new effect_technique_impl(m_effect, i);
-
-				if(FAILED(m_effect->ValidateTechnique(technique->getHandle())))
-					base::lerr << "ValidateTechnique fault. effect file: " << effect_name << " tech: " << technique->name();
-				else
-					m_listTechniques.push_back(technique);
+				if (!static_cast<effect_technique_impl*>(*it)->rebind(m_effect, m_block))
+					base::lwrn << "technique removed from effect file: " << m_name << " tech: " << (*it)->name();
 			}
 
-			m_sNumEffects++;
+			add_parameters();
+			add_techniques();
 
+			SAFE_RELEASE(old);
 			return true;
-			//unguard
 		}
 
 		ID3DXEffect* m_effect;
@@ -666,7 +941,10 @@ namespace render
 		{
 			//guard(CEffect::commit_changes())
 			if(NULL != m_effect)
+			{
+				m_block.flush();
 				m_effect->CommitChanges();
+			}
 			//unguard
 		}
 
@@ -696,6 +974,11 @@ namespace render
 			return m_mapParameters;
 		}
 
+		parameter* get_param(param_id id)
+		{
+			return id < m_params_by_id.size() ? m_params_by_id[id] : NULL;
+		}
+
 		techniques_list& get_technics()
 		{
 			return m_listTechniques;
@@ -717,17 +1000,146 @@ namespace render
 
 			//unguard
 		}
+	private:
+		/// compiles effect file, NULL on error
+		ID3DXEffect* compile() const
+		{
+			ID3DXEffect* effect = NULL;
+			ID3DXBuffer* pErrors = NULL;
+
+			try{
+				io::file_system& fs = io::file_system::get();
+				io::path_add_scoped p("Common/shaders/");
+				io::readstream_ptr in = fs.find(m_name);
+
+				if (!in)
+				{
+					base::lerr << "fx file not found: " << m_name;
+					return NULL;
+				}
+				
+				std::vector<byte> data;
+				io::stream_to_vector(data, in);
+
+				V(D3DXCreateEffect(g_d3d, (void*)&(data[0]), (uint)data.size() , NULL, &__include_impl, render_device::get().get_shader_flags(), 
+					m_spPool, &effect, &pErrors));
+				//V(D3DXCreateEffectFromFile( g_d3d, m_name.c_str() , NULL, NULL, device_dx9::get().get_shader_flags(), 
+				//	m_spPool, &m_effect, &pErrors));
+			}
+			catch(...)
+			{
+				if (NULL != pErrors)
+				{
+					const char* errors = (const char*)pErrors->GetBufferPointer();
+					base::lerr << errors;
+				}
+				SAFE_RELEASE(pErrors);
+				return NULL;
+			}
+
+			SAFE_RELEASE(pErrors);
+			return effect;
+		}
+
+		/// parameters of m_effect not known yet
+		void add_parameters()
+		{
+			D3DXEFFECT_DESC desc;
+			V(m_effect->GetDesc(&desc));
+
+			for(unsigned int i = 0; i < desc.Parameters; i ++)
+			{
+				D3DXPARAMETER_DESC paramDesc;
+				m_effect->GetParameterDesc(m_effect->GetParameter(NULL, i), &paramDesc);
+				const std::string semantic = NULL != paramDesc.Semantic ? paramDesc.Semantic : paramDesc.Name;
+				if (m_mapParameters.find(semantic) != m_mapParameters.end())
+					continue;
+
+				parameter* effectParam = new effect_param_impl(m_effect, i, m_block);
+				m_mapParameters[effectParam->semantic()] = effectParam;
+
+				param_id id = get_param_id(effectParam->semantic());
+				if (id >= m_params_by_id.size())
+					m_params_by_id.resize(id + 1, 0);
+				m_params_by_id[id] = effectParam;
+			}
+		}
+
+		/// techniques of m_effect not known yet, invalid ones are skipped
+		void add_techniques()
+		{
+			D3DXEFFECT_DESC desc;
+			V(m_effect->GetDesc(&desc));
+
+			for(unsigned int i = 0; i < desc.Techniques; i ++)
+			{
+				D3DXTECHNIQUE_DESC techniqueDesc;
+				if (FAILED(m_effect->GetTechniqueDesc(m_effect->GetTechnique(i), &techniqueDesc)) || find_technique(techniqueDesc.Name))
+					continue;
+
+				effect_technique_impl* technique = new effect_technique_impl(m_effect, i, m_block);
+
+				if(FAILED(m_effect->ValidateTechnique(technique->getHandle())))
+					base::lerr << "ValidateTechnique fault. effect file: " << m_name << " tech: " << technique->name();
+				else
+					m_listTechniques.push_back(technique);
+			}
+		}
+
 	protected:
 		static LPD3DXEFFECTPOOL m_spPool;
 		static int m_sNumEffects;
 		std::string				m_name;
 		params_map m_mapParameters;
+		std::vector<parameter*> m_params_by_id;
+		parameter_block m_block;
 		techniques_list m_listTechniques;
 	};
 
 	LPD3DXEFFECTPOOL CEffect::m_spPool = NULL;
 	int CEffect::m_sNumEffects = 0;
 
+	namespace
+	{
+		/// recompiles effects whose file has changed. changed .fx file which is not
+		/// one of effects may be included by them, so then all effects are recompiled
+		class effect_reloader : public io::file_change_listener
+		{
+		public:
+			void on_file_changed(const std::string& file_path)
+			{
+				if (io::helpers::get_file_ext(file_path) != "fx")
+					return;
+
+				bool found = false;
+				for (EffectsList::iterator it = effects.begin(); it != effects.end(); ++it)
+				{
+					if (is_same_file(file_path, "Common/shaders/" + it->name))
+					{
+						reload(*it);
+						found = true;
+					}
+				}
+
+				if (!found)
+					std::for_each(effects.begin(), effects.end(), &effect_reloader::reload);
+			}
+
+		private:
+			static void reload(const EffectEntry& entry)
+			{
+				if (!entry.effect)
+					return;
+
+				base::lmsg << "reloading effect: " << entry.name;
+				if (!static_cast<CEffect*>(entry.effect.get())->reload())
+					base::lerr << "effect reload failed, previous one is kept: " << entry.name;
+			}
+		};
+
+		effect_reloader reloader;
+	}
+
 	//------------------------------------------------------------------------------
 	// Static methods.
 	//------------------------------------------------------------------------------
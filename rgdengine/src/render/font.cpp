@@ -3,49 +3,44 @@
 #include <rgde/render/font.h>
 #include <rgde/render/manager.h>
 #include <rgde/render/render_device.h>
+#include <rgde/render/sprites.h>
+#include <rgde/render/text_layout.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include "texture_impl.h"
+#include "../base/exception.h"
 
-#include <d3dx9.h>
 extern LPDIRECT3DDEVICE9 g_d3d;
 
 namespace render
 {
-	class font_manager : public rendererable
+	/// Glyph sprites of all text of frame. Shadows have lower priority than text,
+	/// so text of one font is drawn by one or two calls per glyph page
+	class font_manager : public sprite_manager
 	{
 	protected:
-		font_manager() : rendererable(10002)
+		font_manager() : sprite_manager(10002), m_frame(0)
 		{
-			m_render_info.render_func = boost::bind(&font_manager::renderAll, this);
+			m_render_info.render_func = boost::bind(&font_manager::render_text, this);
 		}
 
 	public:
-		typedef boost::function<void(void)>	FontRenderCallback;
-		typedef std::list<FontRenderCallback>	CBList;
-
-		CBList texts;		
-
-		void addText(FontRenderCallback cb)
-		{
-			//      ,      .
-			//   .
-			texts.push_back(cb);
-		}		
-
-		void renderAll()
-		{
-			for (CBList::iterator it = texts.begin(); it != texts.end(); ++it)
-				(*it)();
-			texts.clear();
-		}		
+		/// number of rendered frames, layouts of fonts age by it
+		unsigned get_frame() const { return m_frame; }
 
-		renderable_info & get_renderable_info()
+	private:
+		void render_text()
 		{
-			return m_render_info;
+			render();
+			++m_frame;
 		}
-	};	
 
-	typedef base::singelton<font_manager> TheFontRenderManager;
+	private:
+		unsigned m_frame;
+	};
 
-	static int fontsCreated	= 0;
+	typedef base::singelton<font_manager> TheFontRenderManager;
 
 	void font::render(const std::wstring &text, const math::Rect &rect, unsigned int color)
 	{
@@ -57,8 +52,25 @@ namespace render
 		render(text, rect, color, isDrawShadow, Top | Left | WordBreak);
 	}	
 
-	class font_impl : public font, public device_object
+	/// Glyphs are rasterized by GDI once, at first use, into managed glyph pages.
+	/// Layouts of strings are cached while they are drawn, text becomes sprites
+	/// of font_manager, so it doesn't depend on device reset.
+	class font_impl : public font
 	{
+		enum
+		{
+			page_size = 256,
+			/// frames unused layout is kept
+			layout_max_age = 120
+		};
+
+		/// glyph lookup for layout_text
+		struct glyph_source
+		{
+			font_impl* owner;
+			const glyph* operator()(wchar_t c) const { return owner->get_glyph(c); }
+		};
+
 		int				m_height;
 		std::wstring	m_name;
 		FontWeight		m_eFontWeght;
@@ -71,56 +83,164 @@ namespace render
 
 		void destroy()
 		{
+			if (m_dc != NULL)
+			{
+				SelectObject(m_dc, m_old_font);
+				DeleteDC(m_dc);
+				m_dc = 0;
+			}
+
 			if (m_font != NULL)
 			{
-				m_font->Release();
+				DeleteObject(m_font);
 				m_font = 0;
-				fontsCreated--;
 			}
 		}
 
 		void create()
 		{
-			if (g_d3d == NULL || m_font != NULL)
-				return;
+			m_dc = CreateCompatibleDC(NULL);
+			m_font = CreateFontW(-m_height, 0, 0, 0, m_eFontWeght, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
+								 CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, m_name.c_str());
 
-			if (FAILED(D3DXCreateFont(g_d3d, -m_height, 0, m_eFontWeght, 1, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, 5, DEFAULT_PITCH | FF_DONTCARE, m_name.c_str(), &m_font)))
+			if (m_dc == NULL || m_font == NULL)
 			{
-				throw std::bad_exception("font_impl():Can't create device font object!");
-			}			fontsCreated++;
+				destroy();
+				throw std::bad_exception("font_impl():Can't create GDI font object!");
+			}
+
+			m_old_font = (HFONT)SelectObject(m_dc, m_font);
+
+			TEXTMETRICW metrics;
+			GetTextMetricsW(m_dc, &metrics);
+			m_line_height = (float)metrics.tmHeight;
+			m_ascent = (float)metrics.tmAscent;
 		}
 
 	public:
 		font_impl(int height, const std::wstring &name, FontWeight font_weigh)
-			: m_font(0),
-			  m_height(height),
+			: m_height(height),
 			  m_name(name),
 			  m_eFontWeght(font_weigh),
-			  m_useDelayedRender(true)
+			  m_useDelayedRender(true),
+			  m_dc(0),
+			  m_font(0),
+			  m_old_font(0),
+			  m_glyphs(page_size),
+			  m_last_frame(~0u)
 		{
 			base::lmsg << "Creating Font:  \"" << std::string(name.begin(), name.end()) << "\"," << m_height;
 			create();
 		}		
 
-		void doRender(const std::wstring text, RECT textLocation, unsigned int color, int flags)
+		/// glyph of character, rasterized at first use. 0 if font has no such glyph
+		/// or there is no device for glyph pages yet
+		const glyph* get_glyph(wchar_t c)
 		{
-			if (m_font != NULL)
-				m_font->DrawText(NULL, text.c_str(), -1, &textLocation, flags, color);
-		}		
+			if (const glyph* g = m_glyphs.find(c))
+				return g;
 
-		math::Rect get_rect(const std::wstring &text, int flags)
+			if (g_d3d == NULL)
+				return 0;
+
+			static const MAT2 identity = {{0, 1}, {0, 0}, {0, 0}, {0, 1}};
+			GLYPHMETRICS gm;
+			const DWORD size = GetGlyphOutlineW(m_dc, c, GGO_GRAY8_BITMAP, &gm, 0, 0, &identity);
+			if (GDI_ERROR == size)
+				return 0;
+
+			std::vector<BYTE> bitmap(size);
+			if (size > 0 && GDI_ERROR == GetGlyphOutlineW(m_dc, c, GGO_GRAY8_BITMAP, &gm, size, &bitmap[0], &identity))
+				return 0;
+
+			// empty glyphs (space) have black box 1x1 and no bitmap
+			const unsigned width = size > 0 ? gm.gmBlackBoxX : 0;
+			const unsigned height = size > 0 ? gm.gmBlackBoxY : 0;
+
+			unsigned x, y;
+			const glyph* g = m_glyphs.add(c, (float)gm.gmCellIncX, gm.gmptGlyphOrigin.x, gm.gmptGlyphOrigin.y, width, height, x, y);
+			if (!g || 0 == width)
+				return g;
+
+			while (m_pages.size() < m_glyphs.get_num_pages())
+			{
+				const std::string name = "glyph page " + boost::lexical_cast<std::string>(m_pages.size());
+				m_pages.push_back(texture_ptr(new managed_texture_d3d9(page_size, 1, name)));
+			}
+
+			// white texels, coverage in alpha. gray levels are 0..64, rows are DWORD aligned
+			IDirect3DTexture9* page = static_cast<texture_d3d9*>(m_pages[g->page].get())->get_dx_texture();
+			RECT rect = {(LONG)x, (LONG)y, (LONG)(x + width), (LONG)(y + height)};
+			D3DLOCKED_RECT locked;
+			V(page->LockRect(0, &locked, &rect, 0));
+
+			const unsigned pitch = (width + 3) & ~3u;
+			for (unsigned row = 0; row < height; ++row)
+			{
+				DWORD* dst = (DWORD*)((BYTE*)locked.pBits + row * locked.Pitch);
+				const BYTE* src = &bitmap[row * pitch];
+				for (unsigned col = 0; col < width; ++col)
+					dst[col] = ((DWORD)(src[col] * 255 / 64) << 24) | 0x00FFFFFF;
+			}
+
+			page->UnlockRect(0);
+			return g;
+		}
+
+		/// cached layout of text, it is laid out again only if it wasn't drawn recently
+		const text_layout& get_layout(const std::wstring& text, float width, float height, int flags)
 		{
-			RECT rc	= {0, 0, 0, 200};
+			if (const text_layout* cached = m_layouts.find(text, width, height, flags))
+				return *cached;
 
-			if (m_font != NULL)
-				m_font->DrawText(NULL, text.c_str(), -1, &rc, DT_CALCRECT | flags, 0);
+			glyph_source glyphs = {this};
+			layout_text(text.c_str(), text.size(), width, height, flags, m_line_height, m_ascent, glyphs, m_layout);
+			if (!m_layout.complete)
+				return m_layout;
+
+			text_layout& cached = m_layouts.add(text, width, height, flags);
+			cached = m_layout;
+			return cached;
+		}
 
-			math::Rect	ret((float)rc.left, (float)rc.top, (float)rc.right - rc.left, (float)rc.bottom - rc.top);
-			return ret;
+		math::Rect get_rect(const std::wstring &text, int flags)
+		{
+			const text_layout& layout = get_layout(text, 0, 0, flags | NoClip);
+			return math::Rect(0, 0, layout.width, layout.height);
 		}		
 
+		/// glyph quads as sprites, x and y are in virtual screen coords
+		void add_sprites(const text_layout& layout, float x, float y, const math::vec2f& ratio, unsigned color, unsigned long priority)
+		{
+			// whole pixels shifted by half pixel, so texels of glyphs map to pixels exactly
+			const float left = std::floor(x * ratio[0] + 0.5f) - 0.5f;
+			const float top = std::floor(y * ratio[1] + 0.5f) - 0.5f;
+
+			font_manager& fm = TheFontRenderManager::get();
+
+			sprite s;
+			s.color = color;
+			s.priority = priority;
+
+			for (size_t i = 0; i < layout.quads.size(); ++i)
+			{
+				const glyph_quad& q = layout.quads[i];
+				if (q.page >= m_pages.size())
+					continue;
+
+				s.pos = math::vec2f((left + q.x + q.w * 0.5f) / ratio[0], (top + q.y + q.h * 0.5f) / ratio[1]);
+				s.size = math::vec2f(q.w / ratio[0], q.h / ratio[1]);
+				s.rect = math::Rect(q.uv[0], q.uv[1], q.uv[2] - q.uv[0], q.uv[3] - q.uv[1]);
+				s.texture = m_pages[q.page];
+				fm.add(s);
+			}
+		}
+
 		virtual void render(const std::wstring &text, const math::Rect &rect, unsigned int color, bool isDrawShadow, int flags)
 		{
+			if (text.empty() || g_d3d == NULL)
+				return;
+
 			const math::vec2f virtSize(800, 600);
 
 			unsigned	nShadowDistance	= 2;
@@ -128,59 +248,39 @@ namespace render
 			math::vec2f	screen_size		= render::render_device::get().getBackBufferSize();
 			math::vec2f	ratio = screen_size / virtSize;
 
-			font_manager& rm = TheFontRenderManager::get();
-
-			if (isDrawShadow)
+			font_manager& fm = TheFontRenderManager::get();
+			if (fm.get_frame() != m_last_frame)
 			{
-				RECT	textShadowLocation;
-				textShadowLocation.left = (LONG)((rect.position[0] + nShadowDistance) * ratio[0]);
-				textShadowLocation.top = (LONG)((rect.position[1] + nShadowDistance) * ratio[1]);
-				textShadowLocation.right = textShadowLocation.left + (LONG)(rect.size[0] * ratio[0]);
-				textShadowLocation.bottom = textShadowLocation.top + (LONG)(rect.size[1] * ratio[1]);
-
-				//doRender(text, textShadowLocation, nShadowColor, flags);
-				rm.addText(boost::bind(&font_impl::doRender, this, text, textShadowLocation, nShadowColor, flags));
+				m_layouts.next_frame(layout_max_age);
+				m_last_frame = fm.get_frame();
 			}
 
-			RECT	textLocation;
-			textLocation.left = (LONG)(rect.position[0] * ratio[0]);
-			textLocation.top = (LONG)(rect.position[1] * ratio[1]);
-			textLocation.right = textLocation.left + (LONG)(rect.size[0] * ratio[0]);
-			textLocation.bottom = textLocation.top + (LONG)(rect.size[1] * ratio[1]);
+			const text_layout& layout = get_layout(text, rect.size[0] * ratio[0], rect.size[1] * ratio[1], flags);
 
-			
-			//doRender(text, textLocation, color, flags);
-			rm.addText(boost::bind(&font_impl::doRender, this, text, textLocation, color, flags));
-		}		
+			if (isDrawShadow)
+				add_sprites(layout, rect.position[0] + nShadowDistance, rect.position[1] + nShadowDistance, ratio, nShadowColor, 0);
 
-		virtual void onLostDevice()
-		{
-			if (m_font != NULL)
-			{
-				m_font->OnLostDevice();
-				destroy();
-			}
+			add_sprites(layout, rect.position[0], rect.position[1], ratio, color, 1);
 		}		
 
-		virtual void onResetDevice()
-		{
-			create();
-			if (m_font != NULL) 
-				m_font->OnResetDevice();
-		}
-
 		virtual ~font_impl()
 		{
 			destroy();
-
-			if (0 == fontsCreated)
-			{
-				//TheFontRenderManager::destroy();
-			}
 		}	
 
 	private:		
-		ID3DXFont	*m_font;
+		HDC			m_dc;
+		HFONT		m_font;
+		HFONT		m_old_font;
+		float		m_line_height;
+		float		m_ascent;
+
+		glyph_cache	 m_glyphs;
+		std::vector<texture_ptr> m_pages;
+		layout_cache m_layouts;
+		/// layout of text which is not cached (some glyphs are missing)
+		text_layout	 m_layout;
+		unsigned	 m_last_frame;
 	};
 
 	font_ptr font::create(int height, const std::wstring &name, FontWeight font_weigh)
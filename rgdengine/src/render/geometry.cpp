@@ -7,9 +7,10 @@
 
 #include <rgde/core/coreComPtr.h>
 
-#include <rgde/base/xml_helpers.h>
 #include <rgde/base/lexical_cast.h>
 
+#include <boost/weak_ptr.hpp>
+
 #include <d3dx9.h>
 
 extern LPDIRECT3DDEVICE9       g_d3d;
@@ -17,6 +18,242 @@ extern LPDIRECT3DDEVICE9       g_d3d;
 
 namespace render
 {
+	/// Vertex and index buffers shared by all dynamic geometries. Data is written
+	/// one after another with D3DLOCK_NOOVERWRITE, so uploads don't wait for draws
+	/// of earlier data; when buffer is full it is discarded and filled from start.
+	/// Discard drops everything written before, so each write gets generation of
+	/// its buffer and owner writes data again if generation has changed.
+	class dynamic_buffers : public device_object
+	{
+	public:
+		enum buffer_kind {vertices, indices16, indices32, num_kinds};
+
+		/// place of data written to shared buffer
+		struct allocation
+		{
+			/// first vertex or index
+			unsigned first;
+			/// 0 - not written
+			unsigned generation;
+
+			allocation() : first(0), generation(0) {}
+		};
+
+		dynamic_buffers() : m_vb(0)
+		{
+			m_ib[0] = m_ib[1] = 0;
+			for (int kind = 0; kind < num_kinds; ++kind)
+			{
+				m_size[kind] = 0;
+				m_offset[kind] = 0;
+				m_generation[kind] = 1;
+			}
+		}
+
+		~dynamic_buffers()
+		{
+			for (int kind = 0; kind < num_kinds; ++kind)
+				release((buffer_kind)kind);
+		}
+
+		virtual void onLostDevice()
+		{
+			for (int kind = 0; kind < num_kinds; ++kind)
+				release((buffer_kind)kind);
+		}
+
+		virtual void onResetDevice()
+		{
+		}
+
+		bool is_valid(buffer_kind kind, const allocation& a) const
+		{
+			return 0 != a.generation && a.generation == m_generation[kind];
+		}
+
+		/// copies count elements of stride bytes to buffer
+		bool write(buffer_kind kind, const void* data, unsigned stride, unsigned count, allocation& a)
+		{
+			const unsigned bytes = stride * count;
+			if (0 == bytes || !reserve(kind, bytes))
+				return false;
+
+			// start of element must be multiple of stride
+			unsigned start = (m_offset[kind] + stride - 1) / stride * stride;
+			DWORD flags = D3DLOCK_NOOVERWRITE;
+			if (start + bytes > m_size[kind])
+			{
+				start = 0;
+				flags = D3DLOCK_DISCARD;
+				++m_generation[kind];
+				render_device::get().add_dynamic_discard();
+			}
+
+			void* dst = 0;
+			HRESULT hr = vertices == kind
+				? m_vb->Lock(start, bytes, &dst, flags)
+				: m_ib[indices32 == kind]->Lock(start, bytes, &dst, flags);
+			if (FAILED(hr))
+				return false;
+
+			memcpy(dst, data, bytes);
+			if (vertices == kind)
+				m_vb->Unlock();
+			else
+				m_ib[indices32 == kind]->Unlock();
+			render_device::get().add_dynamic_upload(bytes);
+
+			m_offset[kind] = start + bytes;
+			a.first = start / stride;
+			a.generation = m_generation[kind];
+			return true;
+		}
+
+		IDirect3DVertexBuffer9* vertex_buffer() const {return m_vb;}
+		IDirect3DIndexBuffer9* index_buffer(bool use32) const {return m_ib[use32];}
+
+		static boost::shared_ptr<dynamic_buffers> get()
+		{
+			static boost::weak_ptr<dynamic_buffers> instance;
+			boost::shared_ptr<dynamic_buffers> buffers = instance.lock();
+			if (!buffers)
+			{
+				buffers.reset(new dynamic_buffers());
+				instance = buffers;
+			}
+			return buffers;
+		}
+
+	private:
+		enum {vertex_buffer_size = 2 * 1024 * 1024, index_buffer_size = 512 * 1024};
+
+		/// creates buffer, larger one if data doesn't fit into it
+		bool reserve(buffer_kind kind, unsigned bytes)
+		{
+			if (bytes <= m_size[kind])
+				return true;
+
+			release(kind);
+
+			const unsigned size = (std::max)(bytes, vertices == kind ? (unsigned)vertex_buffer_size : (unsigned)index_buffer_size);
+			HRESULT hr;
+			if (vertices == kind)
+			{
+				hr = g_d3d->CreateVertexBuffer(size, D3DUSAGE_DYNAMIC|D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &m_vb, NULL);
+				if (FAILED(hr))
+					m_vb = 0;
+			}
+			else
+			{
+				const bool use32 = indices32 == kind;
+				hr = g_d3d->CreateIndexBuffer(size, D3DUSAGE_DYNAMIC|D3DUSAGE_WRITEONLY, use32 ? D3DFMT_INDEX32 : D3DFMT_INDEX16, D3DPOOL_DEFAULT, &m_ib[use32], NULL);
+				if (FAILED(hr))
+					m_ib[use32] = 0;
+			}
+
+			if (FAILED(hr))
+				return false;
+
+			m_size[kind] = size;
+			m_offset[kind] = 0;
+			return true;
+		}
+
+		void release(buffer_kind kind)
+		{
+			if (vertices == kind)
+			{
+				if (0 != m_vb)
+					m_vb->Release();
+				m_vb = 0;
+			}
+			else
+			{
+				IDirect3DIndexBuffer9*& ib = m_ib[indices32 == kind];
+				if (0 != ib)
+					ib->Release();
+				ib = 0;
+			}
+
+			// data written into released buffer is gone
+			m_size[kind] = 0;
+			m_offset[kind] = 0;
+			++m_generation[kind];
+		}
+
+	private:
+		IDirect3DVertexBuffer9* m_vb;
+		/// 16 and 32 bit indices
+		IDirect3DIndexBuffer9*	m_ib[2];
+		unsigned				m_size[num_kinds];
+		unsigned				m_offset[num_kinds];
+		unsigned				m_generation[num_kinds];
+	};
+
+	/// static index buffer of quads (0 1 2, 0 2 3 of every 4 vertices), shared by
+	/// all geometries drawn as quads (see IIndexedGeometry::use_quad_indices)
+	class quad_indices
+	{
+	public:
+		enum {max_quads = 0x10000 / 4};
+
+		quad_indices() : m_ib(0)
+		{
+			const UINT bytes = max_quads * 6 * sizeof(unsigned short);
+			if (FAILED(g_d3d->CreateIndexBuffer(bytes, D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, D3DPOOL_MANAGED, &m_ib, NULL)))
+			{
+				m_ib = 0;
+				return;
+			}
+
+			unsigned short* indices = 0;
+			if (FAILED(m_ib->Lock(0, bytes, (void**)&indices, 0)))
+			{
+				m_ib->Release();
+				m_ib = 0;
+				return;
+			}
+
+			for (unsigned quad = 0; quad < max_quads; ++quad)
+			{
+				const unsigned short first = (unsigned short)(quad * 4);
+				indices[0] = first;
+				indices[1] = first + 1;
+				indices[2] = first + 2;
+				indices[3] = first;
+				indices[4] = first + 2;
+				indices[5] = first + 3;
+				indices += 6;
+			}
+
+			m_ib->Unlock();
+			render_device::get().add_upload(bytes);
+		}
+
+		~quad_indices()
+		{
+			if (0 != m_ib)
+				m_ib->Release();
+		}
+
+		IDirect3DIndexBuffer9* buffer() const {return m_ib;}
+
+		static boost::shared_ptr<quad_indices> get()
+		{
+			static boost::weak_ptr<quad_indices> instance;
+			boost::shared_ptr<quad_indices> quads = instance.lock();
+			if (!quads)
+			{
+				quads.reset(new quad_indices());
+				instance = quads;
+			}
+			return quads;
+		}
+
+	private:
+		IDirect3DIndexBuffer9* m_ib;
+	};
+
     class geometry_impl : public base_geometry, public device_object
 	{
 		typedef core::com_ptr<IDirect3DVertexDeclaration9>	SPDirect3DVertexDeclaration9;
@@ -24,9 +261,11 @@ namespace render
 
 	public:
 		geometry_impl(const vertex::vertex_decl decl, bool is_dynamic)
-			:m_vb(0), m_vertex_decl(0), m_dynamic(is_dynamic), m_size(0)
+			:m_vb(0), m_vertex_decl(0), m_dynamic(is_dynamic), m_size(0), m_nSizeOfVertex(0)
 		{
 			g_d3d->CreateVertexDeclaration((const D3DVERTEXELEMENT9*)decl, &m_vertex_decl);
+			if (m_dynamic)
+				m_buffers = dynamic_buffers::get();
 		}
 
 		virtual ~geometry_impl()
@@ -68,6 +307,15 @@ namespace render
 		{
 			m_nSizeOfVertex = size_of_vertex;
 
+			if (m_dynamic)
+			{
+				// written into shared buffer when drawn
+				const char* data = static_cast<const char*>(pdata);
+				m_data.assign(data, data + bytes);
+				m_allocation = dynamic_buffers::allocation();
+				return;
+			}
+
 			recreateVB(bytes);
 
 			if (!m_vb) return;
@@ -79,16 +327,35 @@ namespace render
 
 				memcpy( pVertices, pdata, bytes);
 			m_vb->Unlock();
+			render_device::get().add_upload((unsigned)bytes);
 		}
 
 		virtual void render(primitive_type ePrimType, unsigned nPrimNum)
 		{
 			if (0 == nPrimNum) return;
 
-			g_d3d->SetStreamSource( 0, m_vb.get(), 0, (UINT)m_nSizeOfVertex );
+			unsigned first_vertex = 0;
+			if (m_dynamic)
+			{
+				if (m_data.empty())
+					return;
+
+				if (!m_buffers->is_valid(dynamic_buffers::vertices, m_allocation)
+					&& !m_buffers->write(dynamic_buffers::vertices, &m_data[0], (unsigned)m_nSizeOfVertex,
+										 (unsigned)(m_data.size() / m_nSizeOfVertex), m_allocation))
+					return;
+
+				first_vertex = m_allocation.first;
+				g_d3d->SetStreamSource( 0, m_buffers->vertex_buffer(), 0, (UINT)m_nSizeOfVertex );
+			}
+			else
+			{
+				g_d3d->SetStreamSource( 0, m_vb.get(), 0, (UINT)m_nSizeOfVertex );
+			}
+
 			g_d3d->SetVertexDeclaration(m_vertex_decl.get());
 			D3DPRIMITIVETYPE dxPrimTypeEnum = (D3DPRIMITIVETYPE)ePrimType;
-			g_d3d->DrawPrimitive(dxPrimTypeEnum, 0, nPrimNum);
+			g_d3d->DrawPrimitive(dxPrimTypeEnum, first_vertex, nPrimNum);
 
 			render_device::get().add_statistics(nPrimNum * 3, nPrimNum);
 		}
@@ -99,6 +366,11 @@ namespace render
 		size_t							m_nSizeOfVertex;
 		SPDirect3DVertexDeclaration9	m_vertex_decl;
 		SPDirect3DVertexBuffer9			m_vb;// Buffer to hold vertices
+
+		/// dynamic geometry keeps its vertices and draws them from shared buffer
+		std::vector<char>				m_data;
+		dynamic_buffers::allocation		m_allocation;
+		boost::shared_ptr<dynamic_buffers> m_buffers;
 	};
 
 	base_geometry* base_geometry::create(const vertex::vertex_decl decl, bool is_dynamic)
@@ -107,6 +379,251 @@ namespace render
 	}
 
 
+	/// dynamic vertex buffer with per instance data shared by all indexed geometries.
+	/// filled as ring buffer, so instanced draws of one frame don't wait for each other
+	class instance_stream : public device_object
+	{
+	public:
+		enum {buffer_size = 256 * 1024};
+
+		instance_stream() : m_vb(0), m_offset(0)
+		{
+		}
+
+		~instance_stream()
+		{
+			release();
+		}
+
+		virtual void onLostDevice()
+		{
+			release();
+		}
+
+		virtual void onResetDevice()
+		{
+		}
+
+		static unsigned capacity(unsigned stride) {return buffer_size / stride;}
+
+		/// copies count elements to buffer, returns their byte offset in it
+		bool write(const void* data, unsigned stride, unsigned count, unsigned& offset)
+		{
+			if (!m_vb)
+			{
+				if (FAILED(g_d3d->CreateVertexBuffer(buffer_size, D3DUSAGE_DYNAMIC|D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &m_vb, NULL)))
+				{
+					m_vb = 0;
+					return false;
+				}
+				m_offset = 0;
+			}
+
+			const unsigned bytes = stride * count;
+			// start of element must be multiple of stride
+			unsigned start = (m_offset + stride - 1) / stride * stride;
+			DWORD flags = D3DLOCK_NOOVERWRITE;
+			if (start + bytes > buffer_size)
+			{
+				start = 0;
+				flags = D3DLOCK_DISCARD;
+			}
+
+			void* dst = 0;
+			if (FAILED(m_vb->Lock(start, bytes, &dst, flags)))
+				return false;
+			memcpy(dst, data, bytes);
+			m_vb->Unlock();
+			render_device::get().add_upload(bytes);
+
+			offset = start;
+			m_offset = start + bytes;
+			return true;
+		}
+
+		IDirect3DVertexBuffer9* buffer() const {return m_vb;}
+
+		static boost::shared_ptr<instance_stream> get()
+		{
+			static boost::weak_ptr<instance_stream> instance;
+			boost::shared_ptr<instance_stream> stream = instance.lock();
+			if (!stream)
+			{
+				stream.reset(new instance_stream());
+				instance = stream;
+			}
+			return stream;
+		}
+
+	private:
+		void release()
+		{
+			if (0 != m_vb)
+				m_vb->Release();
+			m_vb = 0;
+		}
+
+	private:
+		IDirect3DVertexBuffer9* m_vb;
+		unsigned				m_offset;
+	};
+
+	/// vertex shaders decoding vertex::PackedMeshVertex, shared by all packed geometries.
+	/// Declaration types give normalized position, shader scales it into mesh box
+	/// (c4 - scale, c5 - bias) and transforms with fixed function matrices (c0..c3).
+	/// Like fixed function techniques of meshes it doesn't light and normal and tangent
+	/// are not decoded. Single decoder is used only by passes without vertex shader
+	/// (geometry is unpacked otherwise), instanced one replaces shader of instanced technique
+	class packed_decoder
+	{
+	public:
+		packed_decoder() : m_single(0), m_instanced(0), m_previous(0)
+		{
+			m_single = compile(single_source(), "vs_2_0");
+			if (render_device::get().supports_instancing())
+				m_instanced = compile(instanced_source(), "vs_3_0");
+		}
+
+		~packed_decoder()
+		{
+			if (0 != m_single)
+				m_single->Release();
+			if (0 != m_instanced)
+				m_instanced->Release();
+		}
+
+		bool is_valid() const {return 0 != m_single;}
+
+		/// sets decoder over vertex shader of current pass, instanced decoder takes
+		/// world transform from instance rows TEXCOORD4..6. single decoder fails
+		/// if pass has vertex shader, it isn't replaced
+		bool begin(const float* decode, bool instanced)
+		{
+			IDirect3DVertexShader9* shader = instanced ? m_instanced : m_single;
+			if (0 == shader)
+				return false;
+
+			g_d3d->GetVertexShader(&m_previous);
+			if (!instanced && 0 != m_previous)
+			{
+				m_previous->Release();
+				m_previous = 0;
+				return false;
+			}
+
+			D3DXMATRIX world, view, proj;
+			g_d3d->GetTransform(D3DTS_WORLD, &world);
+			g_d3d->GetTransform(D3DTS_VIEW, &view);
+			g_d3d->GetTransform(D3DTS_PROJECTION, &proj);
+
+			D3DXMATRIX m = instanced ? view * proj : world * view * proj;
+			D3DXMatrixTranspose(&m, &m);
+
+			// registers may hold constants of effect, they are restored in end()
+			g_d3d->GetVertexShaderConstantF(0, m_saved, num_registers);
+
+			g_d3d->SetVertexShaderConstantF(0, (const float*)&m, 4);
+			g_d3d->SetVertexShaderConstantF(4, decode, 2);
+			g_d3d->SetVertexShader(shader);
+			return true;
+		}
+
+		void end()
+		{
+			g_d3d->SetVertexShader(m_previous);
+			g_d3d->SetVertexShaderConstantF(0, m_saved, num_registers);
+			if (0 != m_previous)
+				m_previous->Release();
+			m_previous = 0;
+		}
+
+		static boost::shared_ptr<packed_decoder> get()
+		{
+			static boost::weak_ptr<packed_decoder> instance;
+			boost::shared_ptr<packed_decoder> decoder = instance.lock();
+			if (!decoder)
+			{
+				decoder.reset(new packed_decoder());
+				instance = decoder;
+			}
+			return decoder;
+		}
+
+	private:
+		enum {num_registers = 6};
+
+		static IDirect3DVertexShader9* compile(const char* source, const char* profile)
+		{
+			LPD3DXBUFFER code = 0;
+			LPD3DXBUFFER errors = 0;
+			IDirect3DVertexShader9* shader = 0;
+
+			if (SUCCEEDED(D3DXCompileShader(source, (UINT)strlen(source), 0, 0, "main", profile, 0, &code, &errors, 0)))
+			{
+				if (FAILED(g_d3d->CreateVertexShader((const DWORD*)code->GetBufferPointer(), &shader)))
+					shader = 0;
+			}
+			else if (0 != errors)
+			{
+				base::lerr << "packed_decoder: " << (const char*)errors->GetBufferPointer();
+			}
+
+			if (0 != code)
+				code->Release();
+			if (0 != errors)
+				errors->Release();
+			return shader;
+		}
+
+		static const char* single_source()
+		{
+			return
+				"float4x4 world_view_proj : register(c0);\n"
+				"float4 decode_scale : register(c4);\n"
+				"float4 decode_bias : register(c5);\n"
+				"struct input {float4 position : POSITION; float2 tex0 : TEXCOORD0; float2 tex1 : TEXCOORD1;};\n"
+				"struct output {float4 position : POSITION; float4 diffuse : COLOR0; float2 tex0 : TEXCOORD0; float2 tex1 : TEXCOORD1;};\n"
+				"output main(input i)\n"
+				"{\n"
+				"	output o;\n"
+				"	float4 position = float4(decode_bias.xyz + i.position.xyz * decode_scale.xyz, 1);\n"
+				"	o.position = mul(position, world_view_proj);\n"
+				"	o.diffuse = 1;\n"
+				"	o.tex0 = i.tex0;\n"
+				"	o.tex1 = i.tex1;\n"
+				"	return o;\n"
+				"}\n";
+		}
+
+		static const char* instanced_source()
+		{
+			return
+				"float4x4 view_proj : register(c0);\n"
+				"float4 decode_scale : register(c4);\n"
+				"float4 decode_bias : register(c5);\n"
+				"struct input {float4 position : POSITION; float2 tex0 : TEXCOORD0; float2 tex1 : TEXCOORD1;\n"
+				"	float4 row0 : TEXCOORD4; float4 row1 : TEXCOORD5; float4 row2 : TEXCOORD6;};\n"
+				"struct output {float4 position : POSITION; float4 diffuse : COLOR0; float2 tex0 : TEXCOORD0; float2 tex1 : TEXCOORD1;};\n"
+				"output main(input i)\n"
+				"{\n"
+				"	output o;\n"
+				"	float4 position = float4(decode_bias.xyz + i.position.xyz * decode_scale.xyz, 1);\n"
+				"	float4 world = float4(dot(position, i.row0), dot(position, i.row1), dot(position, i.row2), 1);\n"
+				"	o.position = mul(world, view_proj);\n"
+				"	o.diffuse = 1;\n"
+				"	o.tex0 = i.tex0;\n"
+				"	o.tex1 = i.tex1;\n"
+				"	return o;\n"
+				"}\n";
+		}
+
+	private:
+		IDirect3DVertexShader9* m_single;
+		IDirect3DVertexShader9* m_instanced;
+		IDirect3DVertexShader9* m_previous;
+		float					m_saved[num_registers * 4];
+	};
+
 	class IndexedGeometryImpl : public IIndexedGeometry, public device_object
 	{
 	public:
@@ -120,13 +637,24 @@ namespace render
 			m_bUse32bitIndixes = bUse32bitIndixes;
 			m_pVB	= 0;
 			m_pIB	= 0;
+			m_pInstancedDeclaration = 0;
+			m_pPackedDeclaration = 0;
+			m_nSizeOfVertex = 0;
 			g_d3d->CreateVertexDeclaration((const D3DVERTEXELEMENT9*)decl, &m_pVertexDeclaration);
+			if (m_is_dynamic)
+				m_buffers = dynamic_buffers::get();
 		}
 		virtual ~IndexedGeometryImpl()
 		{
 			if (0 != m_pVertexDeclaration)
 				m_pVertexDeclaration->Release();
 
+			if (0 != m_pInstancedDeclaration)
+				m_pInstancedDeclaration->Release();
+
+			if (0 != m_pPackedDeclaration)
+				m_pPackedDeclaration->Release();
+
 			if (0 != m_pVB)
 				m_pVB->Release();
 
@@ -169,6 +697,15 @@ namespace render
 		{
 			m_nSizeOfVertex = size_of_vertex;
 
+			if (m_is_dynamic)
+			{
+				// written into shared buffer when drawn
+				const char* vertices = static_cast<const char*>(data);
+				m_vb_data.assign(vertices, vertices + nBytes);
+				m_vb_allocation = dynamic_buffers::allocation();
+				return;
+			}
+
 			if (0 == nBytes) return;
 
 			//g_d3d->CreateVertexBuffer( (UINT)bytes, D3DUSAGE_WRITEONLY, 0,
@@ -183,6 +720,7 @@ namespace render
 			m_pVB->Lock( 0, (UINT)nBytes, (void**)&pVertices, m_is_dynamic ? D3DLOCK_DISCARD : 0 );
 				memcpy( pVertices, data, nBytes);
 			m_pVB->Unlock();
+			render_device::get().add_upload((unsigned)nBytes);
 		}
 
 		void recreateIB(size_t bytes)
@@ -218,6 +756,17 @@ namespace render
 
 		virtual void updateIB(const void *data, size_t nBytes)
 		{
+			if (m_quads)
+				return;
+
+			if (m_is_dynamic)
+			{
+				const char* indices = static_cast<const char*>(data);
+				m_ib_data.assign(indices, indices + nBytes);
+				m_ib_allocation = dynamic_buffers::allocation();
+				return;
+			}
+
 			if (0 == nBytes)
 				return;
 
@@ -229,6 +778,7 @@ namespace render
 			m_pIB->Lock(0, (UINT)nBytes, &pIndexes, m_is_dynamic ? D3DLOCK_DISCARD : 0);
 				memcpy( pIndexes, data, nBytes);
 			m_pIB->Unlock();
+			render_device::get().add_upload((unsigned)nBytes);
 		}
 
 		virtual void render(primitive_type ePrimType, unsigned nBaseVertexIndex, unsigned min_index, unsigned nNumVertices, unsigned nStartIndex, unsigned nPrimitiveCount)
@@ -236,16 +786,219 @@ namespace render
 			if (0 == nPrimitiveCount)
 				return;
 
-			g_d3d->SetStreamSource( 0, m_pVB, 0, (UINT)m_nSizeOfVertex );
-			g_d3d->SetIndices(m_pIB);
+			unsigned first_vertex = 0, first_index = 0;
+			if (!bindBuffers(first_vertex, first_index))
+				return;
+			nBaseVertexIndex += first_vertex;
+			nStartIndex += first_index;
 
-			g_d3d->SetVertexDeclaration(m_pVertexDeclaration);
 			D3DPRIMITIVETYPE dxPrimTypeEnum = (D3DPRIMITIVETYPE)ePrimType;
-			g_d3d->DrawIndexedPrimitive(dxPrimTypeEnum, nBaseVertexIndex, min_index, nNumVertices, nStartIndex, nPrimitiveCount);
+			if (0 != m_pPackedDeclaration)
+			{
+				if (!m_decoder->begin(m_decode, false))
+					return;
+
+				g_d3d->SetVertexDeclaration(m_pPackedDeclaration);
+				g_d3d->DrawIndexedPrimitive(dxPrimTypeEnum, nBaseVertexIndex, min_index, nNumVertices, nStartIndex, nPrimitiveCount);
+				m_decoder->end();
+			}
+			else
+			{
+				g_d3d->SetVertexDeclaration(m_pVertexDeclaration);
+				g_d3d->DrawIndexedPrimitive(dxPrimTypeEnum, nBaseVertexIndex, min_index, nNumVertices, nStartIndex, nPrimitiveCount);
+			}
 
 			render_device::get().add_statistics(nNumVertices, nPrimitiveCount);
 		}
 
+		virtual bool set_packing(const vertex::vertex_decl decl, const float scale[3], const float bias[3])
+		{
+			if (0 != m_pPackedDeclaration)
+				m_pPackedDeclaration->Release();
+			m_pPackedDeclaration = 0;
+
+			// instance elements are appended to other declaration now
+			if (0 != m_pInstancedDeclaration)
+				m_pInstancedDeclaration->Release();
+			m_pInstancedDeclaration = 0;
+
+			if (0 == decl)
+				return true;
+
+			if (!render_device::get().supports_packed_vertices())
+				return false;
+
+			if (!m_decoder)
+				m_decoder = packed_decoder::get();
+			if (!m_decoder->is_valid())
+				return false;
+
+			if (FAILED(g_d3d->CreateVertexDeclaration((const D3DVERTEXELEMENT9*)decl, &m_pPackedDeclaration)))
+			{
+				m_pPackedDeclaration = 0;
+				return false;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				m_decode[k] = scale[k];
+				m_decode[4 + k] = bias[k];
+			}
+			m_decode[3] = 1;
+			m_decode[7] = 0;
+			return true;
+		}
+
+		virtual bool has_vertex_shader() const
+		{
+			IDirect3DVertexShader9* shader = 0;
+			g_d3d->GetVertexShader(&shader);
+			if (0 == shader)
+				return false;
+
+			shader->Release();
+			return true;
+		}
+
+		virtual void render_instanced(primitive_type ePrimType, unsigned nNumVertices, unsigned nPrimitiveCount,
+									  const void* instances, unsigned stride, unsigned count)
+		{
+			if (0 == nPrimitiveCount || 0 == count)
+				return;
+
+			if (0 == m_pInstancedDeclaration && !createInstancedDeclaration(stride))
+				return;
+
+			if (!m_instances)
+				m_instances = instance_stream::get();
+
+			unsigned first_vertex = 0, first_index = 0;
+			if (!bindBuffers(first_vertex, first_index))
+				return;
+			g_d3d->SetVertexDeclaration(m_pInstancedDeclaration);
+
+			const bool packed = 0 != m_pPackedDeclaration;
+			if (packed && !m_decoder->begin(m_decode, true))
+				return;
+
+			const unsigned max_count = instance_stream::capacity(stride);
+			const char* data = static_cast<const char*>(instances);
+			D3DPRIMITIVETYPE dxPrimTypeEnum = (D3DPRIMITIVETYPE)ePrimType;
+
+			for (unsigned first = 0; first < count; first += max_count)
+			{
+				const unsigned num = (std::min)(count - first, max_count);
+				unsigned offset = 0;
+				if (!m_instances->write(data + first * stride, stride, num, offset))
+					break;
+
+				g_d3d->SetStreamSourceFreq(0, D3DSTREAMSOURCE_INDEXEDDATA | num);
+				g_d3d->SetStreamSource(1, m_instances->buffer(), offset, stride);
+				g_d3d->SetStreamSourceFreq(1, D3DSTREAMSOURCE_INSTANCEDATA | 1u);
+
+				g_d3d->DrawIndexedPrimitive(dxPrimTypeEnum, first_vertex, 0, nNumVertices, first_index, nPrimitiveCount);
+
+				render_device::get().add_statistics(nNumVertices * num, nPrimitiveCount * num);
+			}
+
+			g_d3d->SetStreamSourceFreq(0, 1);
+			g_d3d->SetStreamSourceFreq(1, 1);
+			g_d3d->SetStreamSource(1, 0, 0, 0);
+
+			if (packed)
+				m_decoder->end();
+		}
+
+		virtual void use_quad_indices()
+		{
+			if (!m_quads)
+				m_quads = quad_indices::get();
+
+			if (0 != m_pIB)
+				m_pIB->Release();
+			m_pIB = 0;
+			m_ib_size = m_ib_used_size = 0;
+			std::vector<char>().swap(m_ib_data);
+		}
+
+	private:
+		/// sets vertex and index buffers of stream 0, dynamic data is written into
+		/// shared buffers if it isn't there since last update or discard of them.
+		/// first_vertex and first_index - where data of geometry starts
+		bool bindBuffers(unsigned& first_vertex, unsigned& first_index)
+		{
+			IDirect3DVertexBuffer9* vb = m_pVB;
+			IDirect3DIndexBuffer9* ib = m_quads ? m_quads->buffer() : m_pIB;
+
+			if (m_is_dynamic)
+			{
+				if (m_vb_data.empty() || (!m_quads && m_ib_data.empty()))
+					return false;
+
+				if (!m_buffers->is_valid(dynamic_buffers::vertices, m_vb_allocation)
+					&& !m_buffers->write(dynamic_buffers::vertices, &m_vb_data[0], (unsigned)m_nSizeOfVertex,
+										 (unsigned)(m_vb_data.size() / m_nSizeOfVertex), m_vb_allocation))
+					return false;
+
+				vb = m_buffers->vertex_buffer();
+				first_vertex = m_vb_allocation.first;
+
+				if (!m_quads)
+				{
+					const dynamic_buffers::buffer_kind kind = m_bUse32bitIndixes ? dynamic_buffers::indices32 : dynamic_buffers::indices16;
+					const unsigned index_size = m_bUse32bitIndixes ? 4 : 2;
+					if (!m_buffers->is_valid(kind, m_ib_allocation)
+						&& !m_buffers->write(kind, &m_ib_data[0], index_size, (unsigned)(m_ib_data.size() / index_size), m_ib_allocation))
+						return false;
+
+					ib = m_buffers->index_buffer(m_bUse32bitIndixes);
+					first_index = m_ib_allocation.first;
+				}
+			}
+
+			if (0 == vb || 0 == ib)
+				return false;
+
+			g_d3d->SetStreamSource(0, vb, 0, (UINT)m_nSizeOfVertex);
+			g_d3d->SetIndices(ib);
+			return true;
+		}
+
+		/// vertex declaration of geometry (packed one if it is set) with instance
+		/// stream appended: stride / 16 float4 elements TEXCOORD4, TEXCOORD5...
+		bool createInstancedDeclaration(unsigned stride)
+		{
+			LPDIRECT3DVERTEXDECLARATION9 source = m_pPackedDeclaration ? m_pPackedDeclaration : m_pVertexDeclaration;
+			if (0 == source)
+				return false;
+
+			D3DVERTEXELEMENT9 elements[MAXD3DDECLLENGTH + 1];
+			UINT num = 0;
+			if (FAILED(source->GetDeclaration(elements, &num)) || 0 == num)
+				return false;
+
+			// last element is D3DDECL_END
+			UINT last = num - 1;
+			const UINT num_rows = stride / 16;
+			if (last + num_rows + 1 > MAXD3DDECLLENGTH + 1)
+				return false;
+
+			for (UINT i = 0; i < num_rows; ++i, ++last)
+			{
+				D3DVERTEXELEMENT9 row = {1, (WORD)(16 * i), D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, (BYTE)(4 + i)};
+				elements[last] = row;
+			}
+			D3DVERTEXELEMENT9 end = D3DDECL_END();
+			elements[last] = end;
+
+			if (FAILED(g_d3d->CreateVertexDeclaration(elements, &m_pInstancedDeclaration)))
+			{
+				m_pInstancedDeclaration = 0;
+				return false;
+			}
+			return true;
+		}
+
 	private:
 		size_t							m_vb_used_size;
 		size_t							m_vb_size;
@@ -260,73 +1013,28 @@ namespace render
 		LPDIRECT3DVERTEXDECLARATION9	m_pVertexDeclaration;
 		LPDIRECT3DVERTEXBUFFER9			m_pVB;// Buffer to hold vertices
 		IDirect3DIndexBuffer9*			m_pIB;
-	};
-
-	IIndexedGeometry* IIndexedGeometry::create(const vertex::vertex_decl decl, bool bUse32bitIndixes, bool is_dynamic)
-	{
-		return new IndexedGeometryImpl(decl, bUse32bitIndixes, is_dynamic);
-	}
-
-	void readColor( TiXmlElement* node, math::Color& color)
-	{		
-		double r,g,b,a; 
-		r = g = b = a = 1; 		
-		TiXmlElement *pElement = node->FirstChildElement("color");
-		if ( 0  != pElement )
-		{
-			pElement->Attribute("r", &r);
-			pElement->Attribute("g", &g);
-			pElement->Attribute("b", &b);
-			pElement->Attribute("a", &a);
-		}
-		color = math::Color( (unsigned char)(r*255),(unsigned char)(g*255), (unsigned char)(b*255), (unsigned char)(a*255) );
-	}
 
-	void readPosition( TiXmlElement* node, math::vec3f& position)
-	{
-		if ( TiXmlElement *elem = node->FirstChildElement("position") )
-			base::read(position, elem);
-	}
-
-	void readTangent( TiXmlElement* node, math::vec3f& tangent)
-	{
-		if (TiXmlElement *elem = node->FirstChildElement("tangent") )
-			base::read(tangent, elem);
-	}
+		LPDIRECT3DVERTEXDECLARATION9	m_pInstancedDeclaration;
+		boost::shared_ptr<instance_stream> m_instances;
 
-	void readBinormal( TiXmlElement* node, math::vec3f& binormal)
-	{
-		if (TiXmlElement *elem = node->FirstChildElement("binormal") )
-			base::read(binormal, elem);
-	}
+		/// set by set_packing, decode - scale (c4) and bias (c5) of positions
+		LPDIRECT3DVERTEXDECLARATION9	m_pPackedDeclaration;
+		float							m_decode[8];
+		boost::shared_ptr<packed_decoder> m_decoder;
 
-	void readNormal( TiXmlElement* node, math::vec3f& normal)
-	{		
-		if (TiXmlElement *elem = node->FirstChildElement("normal") )
-			base::read(normal, elem);
-	}
+		/// dynamic geometry keeps its data and draws it from shared buffers
+		std::vector<char>				m_vb_data;
+		std::vector<char>				m_ib_data;
+		dynamic_buffers::allocation		m_vb_allocation;
+		dynamic_buffers::allocation		m_ib_allocation;
+		boost::shared_ptr<dynamic_buffers> m_buffers;
 
-	void readTexCoords( TiXmlElement* node, math::vec2f& tex)
-	{
-		if (TiXmlElement *elem = node->FirstChildElement("uvset") )
-			base::read(tex, elem);
-	}
+		/// set by use_quad_indices
+		boost::shared_ptr<quad_indices> m_quads;
+	};
 
-	void readTexCoords2( TiXmlElement* node, math::vec2f& tex0, math::vec2f& tex1)
+	IIndexedGeometry* IIndexedGeometry::create(const vertex::vertex_decl decl, bool bUse32bitIndixes, bool is_dynamic)
 	{
-		if (TiXmlElement *elem = node->FirstChildElement("uvset") )
-		{
-			base::read(tex0, elem);
-
-			if (elem = elem->NextSiblingElement("uvset"))
-				base::read(tex1, elem);
-		}
-	}
-
-	void readWeights( TiXmlElement* node, math::vec4f& weights)
-	{		
-		if (TiXmlElement *elem = node->FirstChildElement("weights") )
-			base::read(weights, elem);
+		return new IndexedGeometryImpl(decl, bUse32bitIndixes, is_dynamic);
 	}
-
 }
\ No newline at end of file
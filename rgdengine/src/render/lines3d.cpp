@@ -9,254 +9,415 @@
 
 namespace render
 {
+	namespace
+	{
+		const unsigned sphere_segments = 24;
+
+		/// corners of box with half size 1
+		const float box_points[8][3] = {
+			{-1, 1, -1}, {-1, 1, 1}, {1, 1, 1}, {1, 1, -1},
+			{-1, -1, -1}, {-1, -1, 1}, {1, -1, 1}, {1, -1, -1}};
+
+		/// top and bottom rectangles and edges between them
+		const unsigned short box_lines[24] = {
+			0, 1, 1, 2, 2, 3, 3, 0,
+			4, 5, 5, 6, 6, 7, 7, 4,
+			0, 4, 1, 5, 2, 6, 3, 7};
+
+		/// line from origin to (0, 0, 1) and head
+		const float arrow_points[6][3] = {
+			{0, 0, 0}, {0, 0, 1}, {0.08f, 0, 0.85f}, {-0.08f, 0, 0.85f}, {0, 0.08f, 0.85f}, {0, -0.08f, 0.85f}};
+
+		const unsigned short arrow_lines[10] = {0, 1, 1, 2, 1, 3, 1, 4, 1, 5};
+
+		/// square from (-1, -1) to (1, 1) in xy plane
+		const float quad_points[4][3] = {{1, -1, 0}, {1, 1, 0}, {-1, 1, 0}, {-1, -1, 0}};
+
+		const unsigned short quad_lines[8] = {0, 1, 1, 2, 2, 3, 3, 0};
+	}
+
 	//-----------------------------------------------------------------------------------
 	lines3d::lines3d(unsigned long priority)
 		: render::rendererable(1000),
 		  m_effect(effect::create("Line3dManager.fx")),
+		  m_technique(0),
+		  m_instanced(0),
+		  m_lvp(0),
 		  m_priority(priority),
-		  m_geometry(true)
+		  m_geometry(true),
+		  m_open(0),
+		  m_last_group(0),
+		  m_enabled(~0u)
 	{
 		//base::lmsg << "lines3d::lines3d()";
-		m_vertices = &(m_geometry.lock());
+		if (m_effect)
+		{
+			m_technique = m_effect->find_technique("Lines3d");
+			m_instanced = m_effect->find_technique("Lines3dInstanced");
+			m_lvp = m_effect->get_param(effect::get_param_id("g_mLVP"));
+		}
+
+		create_shapes();
 		m_render_info.render_func = boost::bind(&lines3d::render, this);
 	}
 
 	//-----------------------------------------------------------------------------------
-	void lines3d::render()
+	void lines3d::create_shapes()
 	{
-		if (m_vertices->size() == 0)
-			return;
-
-		math::camera_ptr camera	= render::render_device::get().camera();
+		const math::Color white = 0xffffffff;
 
-		if (!camera)
-			return;
-
-		const math::matrix44f &mView = camera->view_matrix();
-		const math::matrix44f &mProj = camera->proj_matrix();
-		math::matrix44f mLVP		 = mProj *mView;
+		struct source
+		{
+			const float* points;
+			size_t num_points;
+			const unsigned short* lines;
+			size_t num_indices;
+		};
+
+		const source sources[] = {
+			{&box_points[0][0], 8, box_lines, 24},
+			{0, 0, 0, 0},
+			{&arrow_points[0][0], 6, arrow_lines, 10},
+			{&quad_points[0][0], 4, quad_lines, 8}};
+
+		for (int s = 0; s < num_shapes; ++s)
+		{
+			shape_geometry::vertexies& vertices = m_shapes[s].lock_vb();
+			shape_geometry::indexies& indices = m_shapes[s].lock_ib();
 
-		m_effect->get_params()["g_mLVP"]->set(mLVP);
+			if (sphere_shape == s)
+			{
+				// circles in xy, yz and zx planes
+				for (unsigned c = 0; c < 3; ++c)
+				{
+					const unsigned short first = (unsigned short)vertices.size();
+					for (unsigned i = 0; i < sphere_segments; ++i)
+					{
+						const float a = i * 2 * 3.1415926f / sphere_segments;
+						float p[3] = {0, 0, 0};
+						p[c] = cosf(a);
+						p[(c + 1) % 3] = sinf(a);
+						vertices.push_back(Point(math::vec3f(p[0], p[1], p[2]), white));
+
+						indices.push_back((unsigned short)(first + i));
+						indices.push_back((unsigned short)(first + (i + 1) % sphere_segments));
+					}
+				}
+			}
+			else
+			{
+				const source& src = sources[s];
+				for (size_t i = 0; i < src.num_points; ++i)
+				{
+					const float* p = src.points + i * 3;
+					vertices.push_back(Point(math::vec3f(p[0], p[1], p[2]), white));
+				}
+				indices.assign(src.lines, src.lines + src.num_indices);
+			}
 
-		render::effect::technique *pTechnique	= m_effect->find_technique("Lines3d");
-		if (0 == pTechnique)
-			return;
+			m_shapes[s].unlock_vb();
+			m_shapes[s].unlock_ib();
+		}
+	}
 
-		pTechnique->begin();
-		m_effect->commit_changes();
+	//-----------------------------------------------------------------------------------
+	void lines3d::enable(unsigned category, bool flag)
+	{
+		if (flag)
+			m_enabled |= 1u << category;
+		else
+			m_enabled &= ~(1u << category);
+	}
 
-		m_geometry.unlock();
+	//-----------------------------------------------------------------------------------
+	lines3d::group_id lines3d::begin_group(unsigned frames)
+	{
+		group g;
+		g.id = ++m_last_group;
+		g.frames = frames;
+		m_groups.push_back(g);
+		m_open = &m_groups.back();
+		return g.id;
+	}
 
-		size_t cPasses	= pTechnique->get_passes().size();
+	//-----------------------------------------------------------------------------------
+	void lines3d::end_group()
+	{
+		m_open = 0;
+	}
 
-		for (unsigned iPass = 0; iPass < cPasses; ++iPass)
+	//-----------------------------------------------------------------------------------
+	void lines3d::remove_group(group_id id)
+	{
+		for (std::list<group>::iterator it = m_groups.begin(); it != m_groups.end(); ++it)
 		{
-			pTechnique->get_passes()[iPass]->begin();
-			m_geometry.render(LineList);
-			pTechnique->get_passes()[iPass]->end();
+			if (it->id == id)
+			{
+				if (&*it == m_open)
+					m_open = 0;
+				m_groups.erase(it);
+				return;
+			}
 		}
-
-		pTechnique->end();
-
-		//       
-		m_vertices = &(m_geometry.lock());
-		m_vertices->resize(0);
 	}
 
 	//-----------------------------------------------------------------------------------
-	void lines3d::add_line(const math::vec3f &point1, const math::vec3f &point2, const math::Color &color)
+	void lines3d::clear_groups()
 	{
-		m_vertices->push_back(Point(point1, color));
-		m_vertices->push_back(Point(point2, color));
+		m_groups.clear();
+		m_open = 0;
 	}
+
 	//-----------------------------------------------------------------------------------
-	void lines3d::add_box(const math::vec3f& size, const math::Color& color)
+	void lines3d::gather_groups()
 	{
-		static const size_t nVerts = 8;
-		static math::vec3f box[nVerts];
-		static bool isVertexesCreated	= false;
-
-		if (!isVertexesCreated)
+		for (std::list<group>::iterator it = m_groups.begin(); it != m_groups.end();)
 		{
-			isVertexesCreated = true;
+			const batch& b = it->shapes;
+			for (size_t i = 0; i < b.line_categories.size(); ++i)
+			{
+				if (is_enabled(b.line_categories[i]))
+				{
+					m_frame.lines.push_back(b.lines[i * 2]);
+					m_frame.lines.push_back(b.lines[i * 2 + 1]);
+				}
+			}
 
-			box[0] = math::vec3f(-1, 1, -1);
-			box[1] = math::vec3f(-1, 1, 1);
-			box[2] = math::vec3f(1, 1, 1);
-			box[3] = math::vec3f(1, 1, -1);
+			for (int s = 0; s < num_shapes; ++s)
+			{
+				for (size_t i = 0; i < b.shape_categories[s].size(); ++i)
+				{
+					if (is_enabled(b.shape_categories[s][i]))
+						m_frame.shapes[s].push_back(b.shapes[s][i]);
+				}
+			}
 
-			box[4] = math::vec3f(-1, -1, -1);
-			box[5] = math::vec3f(-1, -1, 1);
-			box[6] = math::vec3f(1, -1, 1);
-			box[7] = math::vec3f(1, -1, -1);
+			if (it->frames > 0 && 0 == --it->frames && &*it != m_open)
+				it = m_groups.erase(it);
+			else
+				++it;
 		}
+	}
 
-		static math::point3f size_box[nVerts];
-		for (unsigned i = 0; i < nVerts; ++i)
+	//-----------------------------------------------------------------------------------
+	void lines3d::expand(shape s, const std::vector<shape_instance>& instances, std::vector<Point>& lines) const
+	{
+		const shape_geometry::vertexies& points = m_shapes[s].getVB();
+		const shape_geometry::indexies& indices = m_shapes[s].getIB();
+
+		std::vector<math::vec3f> transformed(points.size());
+		for (size_t i = 0; i < instances.size(); ++i)
 		{
-			const math::vec3f &v= box[i];			
-			size_box[i] = math::point3f(v[0] * size[0], v[1] * size[1], v[2] * size[2]);
-		}
+			const shape_instance& inst = instances[i];
+			const math::Color color((uchar)(inst.color[0] * 255 + 0.5f), (uchar)(inst.color[1] * 255 + 0.5f),
+									(uchar)(inst.color[2] * 255 + 0.5f), (uchar)(inst.color[3] * 255 + 0.5f));
 
+			for (size_t p = 0; p < points.size(); ++p)
+			{
+				const math::vec3f& v = points[p].position;
+				for (int r = 0; r < 3; ++r)
+					transformed[p][r] = inst.rows[r][0] * v[0] + inst.rows[r][1] * v[1] + inst.rows[r][2] * v[2] + inst.rows[r][3];
+			}
 
-		//  
-		// up size
-		add_line(size_box[0], size_box[1], color);
-		add_line(size_box[1], size_box[2], color);
-		add_line(size_box[2], size_box[3], color);
-		add_line(size_box[3], size_box[0], color);
-
-		//bottom size
-		add_line(size_box[0 + 4], size_box[1 + 4], color);
-		add_line(size_box[1 + 4], size_box[2 + 4], color);
-		add_line(size_box[2 + 4], size_box[3 + 4], color);
-		add_line(size_box[3 + 4], size_box[0 + 4], color);
-
-		// connections between up and bottom
-		add_line(size_box[0], size_box[0 + 4], color);
-		add_line(size_box[1], size_box[1 + 4], color);
-		add_line(size_box[2], size_box[2 + 4], color);
-		add_line(size_box[3], size_box[3 + 4], color);
+			for (size_t j = 0; j < indices.size(); ++j)
+				lines.push_back(Point(transformed[indices[j]], color));
+		}
 	}
+
 	//-----------------------------------------------------------------------------------
-	void lines3d::add_box(const math::aaboxf& box, const math::Color& color)
+	void lines3d::render()
 	{
-		math::point3f max = box.getMax();
-		math::point3f min = box.getMin();
+		gather_groups();
 
-		math::point3f center = min + (max - min) / 2.0f;
-		math::point3f r		 = max - center;
-
-		math::point3f x(r[0], 0.0f, 0.0f);
-		math::point3f y(0.0f, r[1], 0.0f);
-		math::point3f z(0.0f, 0.0f, r[2]);
+		math::camera_ptr camera	= render::render_device::get().camera();
 
-		math::point3f& xm		= x;
-		math::point3f& ym		= y;
-		math::point3f& zm		= z;
-		math::point3f& centerm	= center;
+		const bool instancing = m_instanced && render::render_device::get().supports_instancing();
+		if (!instancing)
+		{
+			for (int s = 0; s < num_shapes; ++s)
+			{
+				expand((shape)s, m_frame.shapes[s], m_frame.lines);
+				m_frame.shapes[s].resize(0);
+			}
+		}
 
-		add_line(centerm + xm + ym + zm, centerm - xm + ym + zm, color);
-		add_line(centerm + xm + ym - zm, centerm - xm + ym - zm, color);
+		if (camera && m_technique)
+		{
+			const math::matrix44f &mView = camera->view_matrix();
+			const math::matrix44f &mProj = camera->proj_matrix();
+			math::matrix44f mLVP		 = mProj *mView;
 
-		add_line(centerm + xm - ym + zm, centerm - xm - ym + zm, color);
-		add_line(centerm + xm - ym - zm, centerm - xm - ym - zm, color);
+			if (m_lvp)
+				m_lvp->set(mLVP);
 
-		add_line(centerm + xm + ym + zm, centerm + xm - ym + zm, color);
-		add_line(centerm + xm + ym - zm, centerm + xm - ym - zm, color);
+			if (!m_frame.lines.empty())
+			{
+				// frame lines are swapped into geometry and back, both keep their capacity
+				geometry::vertexies& vertices = m_geometry.lock();
+				vertices.swap(m_frame.lines);
+				m_geometry.unlock();
+
+				m_technique->begin();
+				m_effect->commit_changes();
+
+				const size_t cPasses = m_technique->get_passes().size();
+				for (unsigned iPass = 0; iPass < cPasses; ++iPass)
+				{
+					m_technique->get_passes()[iPass]->begin();
+					m_geometry.render(LineList);
+					m_technique->get_passes()[iPass]->end();
+				}
+
+				m_technique->end();
+				vertices.swap(m_frame.lines);
+			}
 
-		add_line(centerm - xm + ym + zm, centerm - xm - ym + zm, color);
-		add_line(centerm - xm + ym - zm, centerm - xm - ym - zm, color);
+			bool has_instances = false;
+			for (int s = 0; s < num_shapes; ++s)
+				has_instances = has_instances || !m_frame.shapes[s].empty();
 
-		add_line(centerm + xm + ym + zm, centerm + xm + ym - zm, color);
-		add_line(centerm + xm - ym + zm, centerm + xm - ym - zm, color);
+			if (instancing && has_instances)
+			{
+				m_instanced->begin();
+				m_effect->commit_changes();
+
+				const size_t cPasses = m_instanced->get_passes().size();
+				for (unsigned iPass = 0; iPass < cPasses; ++iPass)
+				{
+					m_instanced->get_passes()[iPass]->begin();
+					for (int s = 0; s < num_shapes; ++s)
+					{
+						const std::vector<shape_instance>& instances = m_frame.shapes[s];
+						if (!instances.empty())
+							m_shapes[s].render_instanced(LineList, (unsigned)m_shapes[s].getIB().size() / 2,
+								&instances[0], sizeof(shape_instance), (unsigned)instances.size());
+					}
+					m_instanced->get_passes()[iPass]->end();
+				}
+
+				m_instanced->end();
+			}
+		}
 
-		add_line(centerm - xm + ym + zm, centerm - xm + ym - zm, color);
-		add_line(centerm - xm - ym + zm, centerm - xm - ym - zm, color);
+		// shapes are drawn once, groups keep their own
+		m_frame.lines.resize(0);
+		for (int s = 0; s < num_shapes; ++s)
+			m_frame.shapes[s].resize(0);
 	}
+
 	//-----------------------------------------------------------------------------------
-	void lines3d::add_box(const math::matrix44f &m, const math::aaboxf &box, const math::Color &color)
+	void lines3d::add_shape(shape s, const math::matrix44f& m, const math::vec3f axes[3], const math::vec3f& origin,
+							const math::Color& color, unsigned category)
 	{
-		math::point3f max = box.getMax();
-		math::point3f min = box.getMin();
-
-		math::point3f center = min + (max - min) / 2.0f;
-		math::point3f r		 = max - center;
+		batch& b = target();
+		b.shapes[s].resize(b.shapes[s].size() + 1);
+		shape_instance& inst = b.shapes[s].back();
 
-		math::point3f x(r[0], 0.0f, 0.0f);
-		math::point3f y(0.0f, r[1], 0.0f);
-		math::point3f z(0.0f, 0.0f, r[2]);
-
-		math::matrix44f noTransTM	= m;
-		noTransTM[0][3] = 0.0f;
-		noTransTM[1][3] = 0.0f;
-		noTransTM[2][3] = 0.0f;
+		// m is column major: element of row r and column c is mData[c * 4 + r]
+		const float* a = m.mData;
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int j = 0; j < 3; ++j)
+				inst.rows[r][j] = a[r] * axes[j][0] + a[4 + r] * axes[j][1] + a[8 + r] * axes[j][2];
+			inst.rows[r][3] = a[12 + r] + a[r] * origin[0] + a[4 + r] * origin[1] + a[8 + r] * origin[2];
+		}
 
-		math::point3f xm		= noTransTM *x;
-		math::point3f ym		= noTransTM *y;
-		math::point3f zm		= noTransTM *z;
-		math::point3f centerm	= m *center;
+		inst.color[0] = color.r / 255.0f;
+		inst.color[1] = color.g / 255.0f;
+		inst.color[2] = color.b / 255.0f;
+		inst.color[3] = color.a / 255.0f;
 
-		add_line(centerm + xm + ym + zm, centerm - xm + ym + zm, color);
-		add_line(centerm + xm + ym - zm, centerm - xm + ym - zm, color);
+		if (m_open)
+			b.shape_categories[s].push_back((unsigned char)category);
+	}
 
-		add_line(centerm + xm - ym + zm, centerm - xm - ym + zm, color);
-		add_line(centerm + xm - ym - zm, centerm - xm - ym - zm, color);
+	//-----------------------------------------------------------------------------------
+	void lines3d::add_line(const math::vec3f &point1, const math::vec3f &point2, const math::Color &color, unsigned category)
+	{
+		if (!is_enabled(category))
+			return;
 
-		add_line(centerm + xm + ym + zm, centerm + xm - ym + zm, color);
-		add_line(centerm + xm + ym - zm, centerm + xm - ym - zm, color);
+		batch& b = target();
+		b.lines.push_back(Point(point1, color));
+		b.lines.push_back(Point(point2, color));
+		if (m_open)
+			b.line_categories.push_back((unsigned char)category);
+	}
+	//-----------------------------------------------------------------------------------
+	void lines3d::add_box(const math::vec3f& size, const math::Color& color, unsigned category)
+	{
+		add_box(math::matrix44f(), size, color, category);
+	}
+	//-----------------------------------------------------------------------------------
+	void lines3d::add_box(const math::aaboxf& box, const math::Color& color, unsigned category)
+	{
+		add_box(math::matrix44f(), box, color, category);
+	}
+	//-----------------------------------------------------------------------------------
+	void lines3d::add_box(const math::matrix44f &m, const math::aaboxf &box, const math::Color &color, unsigned category)
+	{
+		if (!is_enabled(category))
+			return;
 
-		add_line(centerm - xm + ym + zm, centerm - xm - ym + zm, color);
-		add_line(centerm - xm + ym - zm, centerm - xm - ym - zm, color);
+		math::point3f max = box.getMax();
+		math::point3f min = box.getMin();
 
-		add_line(centerm + xm + ym + zm, centerm + xm + ym - zm, color);
-		add_line(centerm + xm - ym + zm, centerm + xm - ym - zm, color);
+		math::point3f center = min + (max - min) / 2.0f;
+		math::point3f r		 = max - center;
 
-		add_line(centerm - xm + ym + zm, centerm - xm + ym - zm, color);
-		add_line(centerm - xm - ym + zm, centerm - xm - ym - zm, color);
+		const math::vec3f axes[3] = {math::vec3f(r[0], 0, 0), math::vec3f(0, r[1], 0), math::vec3f(0, 0, r[2])};
+		add_shape(box_shape, m, axes, center, color, category);
 	}
 	//-----------------------------------------------------------------------------------
-	void lines3d::add_box(const math::matrix44f &m, const math::vec3f &size, const math::Color &color)
+	void lines3d::add_box(const math::matrix44f &m, const math::vec3f &size, const math::Color &color, unsigned category)
 	{
-		static const int nVerts = 8;
-		static math::vec3f box[nVerts];				// for size(x,y,z) = 1
-		static bool isVertexesCreated	= false;
-
-		if (!isVertexesCreated)
-		{
-			isVertexesCreated = true;
-
-			box[0] = math::vec3f(-1, 1, -1);
-			box[1] = math::vec3f(-1, 1, 1);
-			box[2] = math::vec3f(1, 1, 1);
-			box[3] = math::vec3f(1, 1, -1);
+		if (!is_enabled(category))
+			return;
 
-			box[4] = math::vec3f(-1, -1, -1);
-			box[5] = math::vec3f(-1, -1, 1);
-			box[6] = math::vec3f(1, -1, 1);
-			box[7] = math::vec3f(1, -1, -1);
-		}
+		const math::vec3f axes[3] = {math::vec3f(size[0], 0, 0), math::vec3f(0, size[1], 0), math::vec3f(0, 0, size[2])};
+		add_shape(box_shape, m, axes, math::vec3f(0, 0, 0), color, category);
+	}
 
-		math::point3f SizeBox[nVerts];
-		for (unsigned i = 0; i < nVerts; ++i)
-		{
-			// by Korak
-			const math::vec3f &v= box[i];			
-			SizeBox[i] = m * math::point3f(v[0] * size[0], v[1] * size[1], v[2] * size[2]);
-		}
+	//-----------------------------------------------------------------------------------
+	void lines3d::add_arrow(const math::matrix44f &m, const math::point3f &dir, const math::Color &color, unsigned category)
+	{
+		if (!is_enabled(category))
+			return;
 
+		const float length = math::length(math::vec3f(dir));
+		if (length <= 0)
+			return;
 
-		//  
-		// up size
-		add_line(SizeBox[0], SizeBox[1], color);
-		add_line(SizeBox[1], SizeBox[2], color);
-		add_line(SizeBox[2], SizeBox[3], color);
-		add_line(SizeBox[3], SizeBox[0], color);
-
-		//bottom size
-		add_line(SizeBox[0 + 4], SizeBox[1 + 4], color);
-		add_line(SizeBox[1 + 4], SizeBox[2 + 4], color);
-		add_line(SizeBox[2 + 4], SizeBox[3 + 4], color);
-		add_line(SizeBox[3 + 4], SizeBox[0 + 4], color);
-
-		// connections between up and bottom
-		add_line(SizeBox[0], SizeBox[0 + 4], color);
-		add_line(SizeBox[1], SizeBox[1 + 4], color);
-		add_line(SizeBox[2], SizeBox[2 + 4], color);
-		add_line(SizeBox[3], SizeBox[3 + 4], color);
+		// head lies in plane of two axes perpendicular to direction, scaled by its length
+		const math::vec3f z(dir[0], dir[1], dir[2]);
+		const math::vec3f up = fabsf(dir[0]) < 0.9f * length ? math::vec3f(1, 0, 0) : math::vec3f(0, 1, 0);
+		math::vec3f x, y;
+		math::cross(x, z, up);
+		math::normalize(x);
+		x *= length;
+		math::cross(y, z, x);
+		y /= length;
+
+		const math::vec3f axes[3] = {x, y, z};
+		add_shape(arrow_shape, m, axes, math::vec3f(0, 0, 0), color, category);
 	}
 
 	//-----------------------------------------------------------------------------------
-	void lines3d::add_arrow(const math::matrix44f &m, const math::point3f &dir, const math::Color &color)
+	void lines3d::add_sphere(const math::matrix44f &m, float rad, const math::Color &color, unsigned category)
 	{
-		math::vec3f trans;
-		math::setTrans(trans, m);
-		add_line(trans, m * dir, color);
+		if (!is_enabled(category))
+			return;
+
+		const math::vec3f axes[3] = {math::vec3f(rad, 0, 0), math::vec3f(0, rad, 0), math::vec3f(0, 0, rad)};
+		add_shape(sphere_shape, m, axes, math::vec3f(0, 0, 0), color, category);
 	}
 
 	//-----------------------------------------------------------------------------------
-	void lines3d::add_sphere(const math::matrix44f &m, float rad, int angle)
+	void lines3d::add_sphere(const math::matrix44f &m, float rad, int angle, unsigned category)
 	{
+		if (!is_enabled(category))
+			return;
+
 		static math::point3f circle[361];				// for radius = 1
 		static math::point3f circle2[2][361];
 		static bool isVertexesCreated	= false;
@@ -292,23 +453,26 @@ namespace render
 			if (i > angle && i < 359 - angle)
 				continue;
 
-			add_line(circle2[0][i], circle2[0][i + 1], math::Green);
-			add_line(circle2[1][i], circle2[1][i + 1], math::Green);
+			add_line(circle2[0][i], circle2[0][i + 1], math::Green, category);
+			add_line(circle2[1][i], circle2[1][i + 1], math::Green, category);
 		}
 
 		math::vec3f zTrans;
 		math::setTrans(zTrans, m90z);
-		add_line(circle2[1][angle], zTrans, math::Green);
-		add_line(zTrans, circle2[1][359 - angle], math::Green);
+		add_line(circle2[1][angle], zTrans, math::Green, category);
+		add_line(zTrans, circle2[1][359 - angle], math::Green, category);
 
 		math::vec3f yTrans;
 		math::setTrans(yTrans, m90y);
-		add_line(circle2[0][angle], yTrans, math::Green);
-		add_line(yTrans, circle2[0][359 - angle], math::Green);
+		add_line(circle2[0][angle], yTrans, math::Green, category);
+		add_line(yTrans, circle2[0][359 - angle], math::Green, category);
 	}
 	//-----------------------------------------------------------------------------------
-	void lines3d::add_quad(const math::vec3f &center, const math::vec2f &size, float spin)
+	void lines3d::add_quad(const math::vec3f &center, const math::vec2f &size, float spin, unsigned category)
 	{
+		if (!is_enabled(category))
+			return;
+
 		const math::matrix44f & mView = render_device::get().camera()->view_matrix();
 
 		math::vec3f up	(mView.mData[0], mView.mData[4], mView.mData[8]);
@@ -321,14 +485,8 @@ namespace render
 		float cosa		= cos(spin);
 		float sina		= sin(spin);
 
-		math::vec3f p1	= center + (cosa - sina) * right + (-sina - cosa) * up;
-		math::vec3f p2	= center + (cosa + sina) * right + (-sina + cosa) * up;
-		math::vec3f p3	= center + (-cosa + sina) * right + (sina + cosa) * up;
-		math::vec3f p4	= center + (-cosa - sina) * right + (sina - cosa) * up;
-
-		add_line(p1, p2, math::Blue);
-		add_line(p2, p3, math::Blue);
-		add_line(p3, p4, math::Blue);
-		add_line(p4, p1, math::Blue);
+		// corner (x, y) of unit quad is center + (x cosa + y sina) right + (y cosa - x sina) up
+		const math::vec3f axes[3] = {cosa * right - sina * up, sina * right + cosa * up, math::vec3f(0, 0, 0)};
+		add_shape(quad_shape, math::matrix44f(), axes, center, math::Blue, category);
 	}
 } //~ namespace utility
\ No newline at end of file
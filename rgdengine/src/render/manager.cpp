@@ -5,6 +5,7 @@
 #include <rgde/render/light_manager.h>
 #include <rgde/render/render_device.h>
 #include <rgde/render/camera_manager.h>
+#include <rgde/render/render_queue.h>
 
 #include <rgde/base/lexical_cast.h>
 
@@ -37,11 +38,18 @@ namespace render
 
 	render_manager::render_manager()
 		: m_volumes(true)
+		, m_instancing(true)
+		, m_statistics(false)
+		, m_occlusion(true)
+		, m_max_occluders(16)
+		, m_stream_textures(false)
 		, m_white_texture(load_default_texture("White.jpg"))
 		, m_flat_normal_texture(load_default_texture("DefaultNormalMap.jpg"))
 		, m_black_texture(load_default_texture("Black.jpg"))
 		, m_default_sffect(effect::create("Default.fx"))
 		, m_default_font(font::create(11,  L"Arial", render::font::Heavy))
+		, m_view_technique(0)
+		, m_view_material(0)
 	{
 
 		if (!m_default_sffect)
@@ -96,11 +104,26 @@ namespace render
 		//m_lRenderables.remove(r);
 		Renderables::iterator it = std::find(m_lRenderables.begin(), m_lRenderables.end(), r);
 		m_lRenderables.erase(it);
+
+		if (r->m_tree_proxy != scene::live_tree::null_proxy)
+			m_tree.destroy(r->m_tree_proxy);
+		r->m_tree_proxy = scene::live_tree::null_proxy;
+
+		// object could be removed in the middle of frame
+		std::replace(m_objects.begin(), m_objects.end(), r, (rendererable*)0);
 	}
 
 	void render_manager::clear()
 	{
+		for (Renderables::iterator it = m_lRenderables.begin(); it != m_lRenderables.end(); ++it)
+			(*it)->m_tree_proxy = scene::live_tree::null_proxy;
+
 		m_lRenderables.resize(0);
+		m_tree.clear();
+		m_objects.resize(0);
+		m_spheres.clear();
+		m_unbounded.resize(0);
+		m_infos.resize(0);
 	}
 
 	namespace functors
@@ -184,6 +207,124 @@ namespace render
 			}
 		};
 
+		/// draws sorted render queue: objects sharing material are rendered
+		/// inside single technique begin/end and pass begin/end pair.
+		/// with instanced technique given, runs of same geometry inside batch
+		/// are drawn by one instanced call each. camera dependent matrices
+		/// are taken from transform cache of view by item index
+		struct SQueueRender : public render_queue::backend, public instance_batcher::backend
+		{
+			SDefaultRender m_render;
+			const render_queue& m_queue;
+			const transform_cache& m_transforms;
+			instance_batcher* m_batcher;
+			effect::technique* m_instanced;
+			std::vector<const render_queue::item*> m_items;
+
+			SQueueRender(render_manager* manager, const render_queue& queue, const transform_cache& transforms,
+						 instance_batcher* batcher = 0, effect::technique* instanced = 0)
+				: m_render(manager)
+				, m_queue(queue)
+				, m_transforms(transforms)
+				, m_batcher(batcher)
+				, m_instanced(instanced)
+			{
+			}
+
+			~SQueueRender()
+			{
+				setObjectTransforms(0, 0);
+			}
+
+			void draw_batch(const render_queue::item* items, size_t count)
+			{
+				m_items.resize(0);
+
+				if (1 == count || NULL == m_batcher || NULL == m_instanced)
+				{
+					for (size_t i = 0; i < count; ++i)
+						m_items.push_back(&items[i]);
+				}
+				else
+					m_batcher->submit(items, count, *this);
+
+				if (!m_items.empty())
+					drawItems(&m_items[0], m_items.size());
+			}
+
+			void draw_instanced(const instance_batcher::group& g, const render_queue::item* items, const instance_data* instances)
+			{
+				// items of group share geometry, so they share detail level
+				const renderable_info &info = *static_cast<renderable_info const *>(items[0].data);
+				info.lod = items[0].lod;
+
+				m_instanced->begin();
+
+				std::vector<effect::technique::pass*> &vecPasses = m_instanced->get_passes();
+				for (size_t p = 0; p < vecPasses.size(); ++p)
+				{
+					effect::technique::pass	*pass = vecPasses[p];
+					pass->begin();
+					info.instanced_render_func(instances, (unsigned)g.count);
+					pass->end();
+				}
+
+				m_instanced->end();
+			}
+
+			void draw_single(const render_queue::item& item)
+			{
+				m_items.push_back(&item);
+			}
+
+			/// makes precomputed matrices of item visible to dynamic binders
+			const renderable_info& bind(const render_queue::item* item) const
+			{
+				const renderable_info &info = *static_cast<renderable_info const *>(item->data);
+				info.lod = item->lod;
+				const size_t index = item - &m_queue[0];
+				setObjectTransforms(info.frame, index < m_transforms.size() ? &m_transforms[index] : 0);
+				return info;
+			}
+
+			void drawItems(const render_queue::item* const* items, size_t count)
+			{
+				const material_ptr mat = m_render.m_manager.get_default_material();
+				effect::technique *pTechnique = mat->getTechnique();
+
+				if (1 == count || NULL == pTechnique)
+				{
+					for (size_t i = 0; i < count; ++i)
+						m_render(&bind(items[i]));
+					return;
+				}
+
+				const dynamic_binder_ptr& binder = mat->getDynamicBinder();
+				const effect_ptr& effect = binder->getEffect();
+
+				pTechnique->begin();
+
+				std::vector<effect::technique::pass*> &vecPasses = pTechnique->get_passes();
+				for (size_t p = 0; p < vecPasses.size(); ++p)
+				{
+					effect::technique::pass	*pass = vecPasses[p];
+					pass->begin();
+
+					for (size_t i = 0; i < count; ++i)
+					{
+						const renderable_info &info = bind(items[i]);
+						binder->setupParameters(info.frame);
+						effect->commit_changes();
+						info.render_func();
+					}
+
+					pass->end();
+				}
+
+				pTechnique->end();
+			}
+		};
+
 		struct priority_sorter_less
 		{
 			bool operator()(rendererable *r1, rendererable *r2)
@@ -191,101 +332,397 @@ namespace render
 				return r1->priority() < r2->priority() ? true : false;
 			}
 		};
+	}
 
-		struct SDistanceSorter_Less
+	namespace
+	{
+		/// upper bound of frame scale, works for both scale*rotation orders
+		float getMaxScale(const math::matrix44f& m)
+		{
+			float max_scale = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				float row = m[i][0]*m[i][0] + m[i][1]*m[i][1] + m[i][2]*m[i][2];
+				float col = m[0][i]*m[0][i] + m[1][i]*m[1][i] + m[2][i]*m[2][i];
+				if (row > max_scale) max_scale = row;
+				if (col > max_scale) max_scale = col;
+			}
+			return sqrt(max_scale);
+		}
+
+		/// collects leaves passed spatial index query
+		struct SCandidateCollector
 		{
-			math::vec3f	vCamPos;
-			SDistanceSorter_Less(const math::vec3f &camPos)
-				: vCamPos(camPos)
+			const scene::live_tree		&tree;
+			std::vector<rendererable*>	&result;
+
+			SCandidateCollector(const scene::live_tree &t, std::vector<rendererable*> &r)
+				: tree(t),
+				  result(r)
 			{
 			}
 
-			bool operator()(renderable_info const * r1, renderable_info const * r2)
+			void operator()(scene::live_tree::proxy_id id)
 			{
-				const math::frame_ptr& pFrame1 = r1->frame;
-				const math::frame_ptr& pFrame2 = r2->frame;
-
-				math::vec3f		pos1, pos2;
-				if (pFrame1)
-					pos1 = pFrame1->world_position();
-				if (pFrame2)
-					pos2 = pFrame2->world_position();
-				float	fLengthSqr1			= math::lengthSquared<float, 3>(vCamPos - pos1),
-						fLengthSqr2			= math::lengthSquared<float, 3>(vCamPos - pos2);
-
-				return fLengthSqr1 > fLengthSqr2;
+				result.push_back(static_cast<rendererable*>(tree.get_data(id)));
 			}
 		};
+
+		const unsigned not_visible = (unsigned)-1;
 	}
 
-	struct SRenderblesSorter
+	/// gathers world space bounding spheres of visible renderables (once per frame)
+	/// and moves bounded ones in spatial index, so every camera queries index
+	/// instead of testing all objects
+	void render_manager::updateBounds()
 	{
-		std::vector<renderable_info const *>   &vsolids;
-		std::vector<renderable_info const *>   &vtrans;
-		std::vector<renderable_info const *>   &vposttrans;
-		const math::frustum				   &m_frustum;
-
-		SRenderblesSorter(std::vector<renderable_info const *> &solids, std::vector<renderable_info const *> &trans, std::vector<renderable_info const *> &posttrans, const math::frustum &frustum)
-			: vsolids(solids),
-			  vtrans(trans),
-			  vposttrans(posttrans),
-			  m_frustum(frustum)
+		m_objects.resize(0);
+		m_spheres.clear();
+		m_unbounded.resize(0);
+		m_infos.resize(0);
+
+		for (Renderables::iterator it = m_lRenderables.begin(); it != m_lRenderables.end(); ++it)
 		{
+			rendererable *r = *it;
+			if (NULL == r)
+				continue;
+
+			r->m_bounds_index = not_visible;
+			if (!r->visible())
+				continue;
+
+			const renderable_info  &ri = r->get_renderable_info();
+			r->m_bounds_index = (unsigned)m_objects.size();
+			m_objects.push_back(r);
+
+			object_info info;
+			info.info = &ri;
+			info.priority = r->priority();
+			info.layer = render_queue::solid;
+			if (r->priority() >= 1000)
+				info.layer = render_queue::post_transparent;
+			else if (ri.material && ri.material->isTransparent())
+				info.layer = render_queue::transparent;
+			info.geometry = ri.frame && ri.instanced_render_func ? ri.geometry : 0;
+			info.world = ri.frame ? ri.frame->world_trasform().getData() : 0;
+			info.bbox = ri.frame && !ri.bbox.isEmpty() ? &ri.bbox : 0;
+			info.occluder = info.bbox ? ri.occluder : 0;
+			info.lods = ri.lods && ri.lods->get_num_levels() > 1 ? ri.lods : 0;
+			info.lod_geometries = info.lods ? ri.lod_geometries : 0;
+			info.streamed = !ri.detail_func.empty();
+			m_infos.push_back(info);
+
+			// objects without frame or bounds are never culled
+			if (!ri.frame || ri.bbox.isEmpty())
+			{
+				if (r->m_tree_proxy != scene::live_tree::null_proxy)
+				{
+					m_tree.destroy(r->m_tree_proxy);
+					r->m_tree_proxy = scene::live_tree::null_proxy;
+				}
+
+				m_unbounded.push_back(r->m_bounds_index);
+
+				if (!ri.frame)
+					m_spheres.add_infinite();
+				else
+				{
+					math::vec3f pos = ri.frame->world_position();
+					m_spheres.add(pos[0], pos[1], pos[2], (std::numeric_limits<float>::max)());
+				}
+				continue;
+			}
+
+			const math::point3f& max	= ri.bbox.getMax();
+			const math::point3f& min	= ri.bbox.getMin();
+			math::point3f center		= min + (max - min) / 2.0f;
+
+			const math::matrix44f& world = ri.frame->world_trasform();
+			float fRadius = math::length<float, 3>(max - min) / 2.0f * getMaxScale(world);
+
+			math::point3f centerGlobal = world * center;
+			m_spheres.add(centerGlobal[0], centerGlobal[1], centerGlobal[2], fRadius);
+
+			scene::aabb box = scene::aabb::from_sphere(centerGlobal[0], centerGlobal[1], centerGlobal[2], fRadius);
+			if (r->m_tree_proxy == scene::live_tree::null_proxy)
+				r->m_tree_proxy = m_tree.create(box, r);
+			else
+				m_tree.move(r->m_tree_proxy, box);
 		}
+	}
 
-		void operator()(rendererable const * r)
+	void render_manager::query_sphere(const math::point3f& center, float radius, std::vector<rendererable*>& result) const
+	{
+		Renderables candidates;
+		SCandidateCollector collector(m_tree, candidates);
+		m_tree.query_sphere(center[0], center[1], center[2], radius, collector);
+
+		for (size_t i = 0; i < candidates.size(); ++i)
 		{
-			if ((NULL == r) || (r->visible() == false))
-				return;
+			unsigned index = candidates[i]->m_bounds_index;
+			if (index == not_visible)
+				continue;
+
+			float dx = m_spheres.x[index] - center[0];
+			float dy = m_spheres.y[index] - center[1];
+			float dz = m_spheres.z[index] - center[2];
+			float r = m_spheres.r[index] + radius;
+			if (dx*dx + dy*dy + dz*dz <= r*r)
+				result.push_back(candidates[i]);
+		}
+	}
 
-			const renderable_info  &ri = r->get_renderable_info();
+	void render_manager::query_aabb(const math::aaboxf& box, std::vector<rendererable*>& result) const
+	{
+		const math::point3f& min = box.getMin();
+		const math::point3f& max = box.getMax();
+		scene::aabb query = {{min[0], min[1], min[2]}, {max[0], max[1], max[2]}};
 
-			if (ri.frame)
+		Renderables candidates;
+		SCandidateCollector collector(m_tree, candidates);
+		m_tree.query_aabb(query, collector);
+
+		for (size_t i = 0; i < candidates.size(); ++i)
+		{
+			unsigned index = candidates[i]->m_bounds_index;
+			if (index == not_visible)
+				continue;
+
+			if (scene::sphere_overlaps(query, m_spheres.x[index], m_spheres.y[index], m_spheres.z[index], m_spheres.r[index]))
+				result.push_back(candidates[i]);
+		}
+	}
+
+	void render_manager::query_ray(const math::point3f& origin, const math::vec3f& dir, float max_dist, std::vector<rendererable*>& result) const
+	{
+		const float o[3] = {origin[0], origin[1], origin[2]};
+		const float d[3] = {dir[0], dir[1], dir[2]};
+
+		Renderables candidates;
+		SCandidateCollector collector(m_tree, candidates);
+		m_tree.query_ray(o, d, max_dist, collector);
+
+		for (size_t i = 0; i < candidates.size(); ++i)
+		{
+			unsigned index = candidates[i]->m_bounds_index;
+			if (index == not_visible)
+				continue;
+
+			if (scene::ray_hits_sphere(o, d, max_dist, m_spheres.x[index], m_spheres.y[index], m_spheres.z[index], m_spheres.r[index]))
+				result.push_back(candidates[i]);
+		}
+	}
+
+	/// culls objects for one camera and fills its render queue. works only with
+	/// data gathered by updateBounds, so several cameras are prepared at once.
+	/// distance to camera is computed once per object from bounding sphere center,
+	/// detail level is chosen by projected size of bounding sphere in this camera
+	void render_manager::prepareView(size_t index)
+	{
+		camera_view &view = m_views[index];
+		view.queue.clear();
+		view.num_visible = 0;
+		view.num_occluded = 0;
+		view.visible.resize(0);
+		view.distances.resize(0);
+		view.occluders.resize(0);
+		if (m_stream_textures)
+			view.sizes.assign(m_objects.size(), 0.0f);
+
+		// spatial index gives objects which fat boxes intersect frustum,
+		// exact test is made with bounding spheres of all candidates at once
+		view.candidates.resize(0);
+		SCandidateCollector collector(m_tree, view.candidates);
+		m_tree.query_frustum(view.frustum.planes(), collector);
+
+		view.candidate_objects.resize(0);
+		view.candidate_spheres.clear();
+		for (size_t i = 0; i < view.candidates.size(); ++i)
+		{
+			const unsigned object = view.candidates[i]->m_bounds_index;
+			if (object == not_visible)
+				continue;
+
+			view.candidate_objects.push_back(object);
+			view.candidate_spheres.add(m_spheres.x[object], m_spheres.y[object], m_spheres.z[object], m_spheres.r[object]);
+		}
+		math::cull_spheres(view.frustum.planes(), view.candidate_spheres, view.candidate_visible);
+
+		const size_t num_candidates = view.candidate_objects.size();
+		for (size_t i = 0, num = num_candidates + m_unbounded.size(); i < num; ++i)
+		{
+			unsigned object;
+			if (i < num_candidates)
 			{
-				const math::point3f& max	= ri.bbox.getMax();
-				const math::point3f& min	= ri.bbox.getMin();
-				math::point3f center		= min + (max - min) / 2.0f;
+				if (!view.candidate_visible[i])
+					continue;
+				object = view.candidate_objects[i];
+			}
+			else
+				object = m_unbounded[i - num_candidates];
+
+			float dx = m_spheres.x[object] - view.position[0];
+			float dy = m_spheres.y[object] - view.position[1];
+			float dz = m_spheres.z[object] - view.position[2];
+			const float distance = dx*dx + dy*dy + dz*dz;
+
+			view.visible.push_back(object);
+			view.distances.push_back(distance);
+
+			if (m_occlusion && m_infos[object].occluder)
+				view.occluders.push_back(std::make_pair(distance, object));
+		}
 
-				float fHalfLenght = math::length<float, 3>(max - min) / 2.0f;
+		// nearest occluders are drawn into depth buffer, objects behind them are skipped
+		const bool occlusion = !view.occluders.empty();
+		if (occlusion)
+		{
+			if (view.occluders.size() > m_max_occluders)
+			{
+				std::nth_element(view.occluders.begin(), view.occluders.begin() + m_max_occluders, view.occluders.end());
+				view.occluders.resize(m_max_occluders);
+			}
 
-				math::point3f centerGlobal = ri.frame->world_trasform() * center;
+			float view_proj[16];
+			transform_cache::multiply(view.proj.getData(), view.view.getData(), view_proj);
+			view.occlusion.clear(view_proj);
 
-				// skip test on that low level.
-				//if (!m_frustum.test_sphere(centerGlobal[0], centerGlobal[1], centerGlobal[2], fHalfLenght))
-				//	return;
+			for (size_t i = 0; i < view.occluders.size(); ++i)
+			{
+				const object_info &info = m_infos[view.occluders[i].second];
+				view.occlusion.add_occluder(*info.occluder, info.world);
 			}
+		}
 
-			if (r->priority() >= 1000)
-				vposttrans.push_back(&ri);
-			else if (ri.material && ri.material->isTransparent())
-				vtrans.push_back(&ri);
+		for (size_t i = 0; i < view.visible.size(); ++i)
+		{
+			const unsigned object = view.visible[i];
+			const object_info &info = m_infos[object];
+
+			if (occlusion && info.bbox && !info.occluder &&
+				!view.occlusion.test_box(info.bbox->getMin().getData(), info.bbox->getMax().getData(), info.world))
+			{
+				++view.num_occluded;
+				continue;
+			}
+
+			const bool streamed = m_stream_textures && info.streamed;
+			const float size = info.lods || streamed ?
+				lod::projected_size(m_spheres.r[object], sqrt(view.distances[i]), view.proj[1][1]) : 0.0f;
+			if (streamed)
+				view.sizes[object] = size;
+
+			unsigned level = 0;
+			const void* geometry = info.geometry;
+			if (info.lods)
+			{
+				rendererable* r = m_objects[object];
+				if (r && index < rendererable::max_lod_views)
+				{
+					level = info.lods->select(size, r->m_lod_levels[index]);
+					r->m_lod_levels[index] = (unsigned char)level;
+				}
+				else
+					level = info.lods->select(size, 0);
+
+				if (geometry)
+					geometry = info.lod_geometries[level];
+			}
+
+			// objects without frame are drawn without material (see SDefaultRender)
+			if (info.info->frame)
+				view.queue.add(info.layer, info.priority, m_view_technique, m_view_material, view.distances[i], info.info,
+							   geometry, info.world, level);
 			else
-				vsolids.push_back(&ri);
+				view.queue.add(info.layer, info.priority, 0, 0, view.distances[i], info.info);
+
+			++view.num_visible;
+		}
+
+		view.queue.sort();
+
+		// matrices of all objects of camera in one pass, in draw order
+		view.transforms.clear();
+		for (size_t i = 0; i < view.queue.size(); ++i)
+			view.transforms.add(view.queue[i].world);
+		view.transforms.compute(view.view.getData(), view.proj.getData());
+	}
+
+	/// texture detail follows nearest camera, so requests are made once per frame
+	/// after all views are prepared
+	void render_manager::requestTextureDetail(size_t num_views)
+	{
+		for (size_t object = 0; object < m_objects.size(); ++object)
+		{
+			const object_info &info = m_infos[object];
+			if (!info.streamed || !m_objects[object])
+				continue;
+
+			float size = 0;
+			for (size_t i = 0; i < num_views; ++i)
+				size = (std::max)(size, m_views[i].sizes[object]);
+
+			if (size > 0)
+				info.info->detail_func(size);
 		}
-	};	
+	}
 
 	void render_manager::renderScene()
 	{
-		render::render_device::get().reset_statistics();
+		render_device &device = render_device::get();
+		device.begin_frame();
 
 		//m_lRenderables.sort(functors::priority_sorter_less());
 		std::sort(m_lRenderables.begin(), m_lRenderables.end(), functors::priority_sorter_less());
 
 		TheCameraManager::get().sort();
 
-		static std::vector<renderable_info const *> vPostTransparet(1000);
-		static std::vector<renderable_info const *> vTransparet(1000);
-		static std::vector<renderable_info const *> vSolid(1000);
-
 		// draw scene through every active camera
 		camera_manager &cm	= TheCameraManager::get();
 		if (cm.begin() != cm.end())
 		{
-			for (camera_manager::camera_it camera = cm.begin(); camera != cm.end(); ++camera)
+			m_stage_timer.start();
+			updateBounds();
+			device.add_stage_time(stage_bounds, m_stage_timer.elapsed() * 1000.0f);
+
+			// camera matrices are cached lazily, so frustums are computed here
+			size_t num_views = 0;
+			for (camera_manager::camera_it camera = cm.begin(); camera != cm.end(); ++camera, ++num_views)
+			{
+				if (m_views.size() <= num_views)
+					m_views.resize(num_views + 1);
+
+				m_views[num_views].frustum.calculate(**camera);
+				m_views[num_views].position = (*camera)->position();
+				m_views[num_views].view = (*camera)->view_matrix();
+				m_views[num_views].proj = (*camera)->proj_matrix();
+			}
+
+			const material_ptr mat = get_default_material();
+			m_view_technique = mat->getTechnique();
+			m_view_material = mat.get();
+			m_stream_textures = texture_streaming::is_active();
+
+			// visibility and sorting of all cameras in parallel,
+			// only submission is left for render thread
+			m_pool.parallel_for(num_views, boost::bind(&render_manager::prepareView, this, _1));
+
+			if (m_stream_textures)
 			{
-				vSolid.resize(0);
-				vTransparet.resize(0);
-				vPostTransparet.resize(0);
+				requestTextureDetail(num_views);
+				texture_streaming::update();
+			}
+			device.add_stage_time(stage_views, m_stage_timer.elapsed() * 1000.0f);
+
+			effect::technique *instanced = NULL;
+			if (m_instancing && device.supports_instancing())
+				instanced = getDefaultEffect()->find_technique("Instanced");
+			m_batcher.reset_statistics();
+
+			size_t view_index = 0;
+			for (camera_manager::camera_it camera = cm.begin(); camera != cm.end(); ++camera, ++view_index)
+			{
+				const camera_view &view = m_views[view_index];
 
 				TheCameraManager::get().activate(camera);
 
@@ -293,15 +730,8 @@ namespace render
 					createBinder();
 				m_static_binder->setupParameters(0);
 
-				const math::frustum& frustum = render_device::get().camera()->frustum();
-				std::for_each(m_lRenderables.begin(), m_lRenderables.end(), SRenderblesSorter(vSolid, vTransparet, vPostTransparet, frustum));
-
-				int nVisibleObjects = static_cast<int>(vTransparet.size() + vSolid.size());
-				//std::string str = base::Lexical_cast<std::string, int>(nVisibleObjects);
-				//std::wstring wstr(str.begin(), str.end());
-				//getDefaultFont()->renderText(wstr, math::Rect(1, 29, 400, 400), 0xFFFFFFFF, true);
-
-				std::sort(vTransparet.begin(), vTransparet.end(), functors::SDistanceSorter_Less(render_device::get().camera()->position()));
+				device.add_culling_statistics(view.num_visible, (unsigned)(m_objects.size() - view.num_visible - view.num_occluded));
+				device.add_occlusion_statistics(view.num_occluded, view.occluders.empty() ? 0 : view.occlusion.get_num_triangles());
 
 				{
 					{
@@ -314,12 +744,12 @@ namespace render
 					}
 
 
-					functors::SDefaultRender r(this);
-					std::for_each(vSolid.begin(),			vSolid.end(),			r);
-					std::for_each(vTransparet.begin(),		vTransparet.end(),		r);
-					std::for_each(vPostTransparet.begin(),	vPostTransparet.end(),	r);
+					functors::SQueueRender r(this, view.queue, view.transforms, &m_batcher, instanced);
+					view.queue.execute(r);
 				}
 			}
+
+			device.add_stage_time(stage_submit, m_stage_timer.elapsed() * 1000.0f);
 		}
 		else // if we have no any cameras
 		{
@@ -335,13 +765,21 @@ namespace render
 				it != temp_copy.end(); ++it)
 			{
 				if ((*it)->visible())
-					r(&(*it)->get_renderable_info());
+				{
+					// without camera objects are drawn in full detail
+					const renderable_info &info = (*it)->get_renderable_info();
+					info.lod = 0;
+					r(&info);
+				}
 			}
 		}
 
 		// draw debug information
 		//scene::TheScene::get().debug_draw();
-		//render::render_device::get().showStatistics(getDefaultFont());
+		if (m_statistics)
+			device.showStatistics(getDefaultFont());
+
+		device.end_frame();
 	}
 
 	void render_manager::createBinder()
@@ -359,8 +797,11 @@ namespace render
 
 	rendererable::rendererable(unsigned priority)
 		: m_render_priority(priority),
-		  m_visible(true)
+		  m_visible(true),
+		  m_tree_proxy(scene::live_tree::null_proxy),
+		  m_bounds_index(not_visible)
 	{
+		std::fill(m_lod_levels, m_lod_levels + max_lod_views, 0);
 		TheRenderManager::get().add(this);
 	}
 
@@ -373,8 +814,13 @@ namespace render
 
 	renderable_info::renderable_info()
 		: frame(0),
+		  geometry(0),
 		  has_volumes(false),
-		  material()
+		  material(),
+		  occluder(0),
+		  lods(0),
+		  lod_geometries(0),
+		  lod(0)
 	{
 	}
 }
\ No newline at end of file
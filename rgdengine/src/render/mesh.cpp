@@ -1,19 +1,45 @@
 #include "precompiled.h"
 
 #include <rgde/render/mesh.h>
+#include <rgde/render/render_device.h>
 
 #include <rgde/scene/scene.h>
 
 #include "../base/exception.h"
 
+#include <boost/weak_ptr.hpp>
+
 
 namespace render
 {
+	namespace
+	{
+		/// meshes loaded from same file share geometry, so they can be instanced
+		typedef std::map<std::string, boost::weak_ptr<mesh::geometry> > geometry_cache;
+		geometry_cache g_geometries;
+
+		/// shared geometry of xml mesh, loaded (with cache) on first request
+		mesh::geometry_ptr getSharedGeometry(const std::string& filename, const std::string& full_path)
+		{
+			mesh::geometry_ptr g = g_geometries[full_path].lock();
+			if (!g)
+			{
+				g = mesh::geometry_ptr(new mesh::geometry());
+				g_geometries[full_path] = g;
+				g->load(filename);
+			}
+			return g;
+		}
+	}
+
 	mesh::mesh()
 	: rendererable(10)
+	, m_is_occluder(false)
 	{
 		m_render_info.frame = this;//m_frame;
 		m_render_info.render_func = boost::bind(&mesh::render, this);
+		m_render_info.instanced_render_func = boost::bind(&mesh::render_instanced, this, _1, _2);
+		m_render_info.detail_func = boost::bind(&mesh::request_texture_detail, this, _1);
 		m_render_info.has_volumes = true;
 	}
 
@@ -30,13 +56,11 @@ namespace render
 		size_t materials_num = m_materials.size();
 		materials_list &mats = m_materials;
 
-		if (0 == materials_num)
-		{
-			m_geometry->render(m_prim_type, m_prim_num);
-		}
-		else if (1 == materials_num)
+		if (materials_num <= 1)
 		{
-			m_geometry->render(m_prim_type, m_prim_num);
+			const lod_level& level = current_lod();
+			level.geometry->render(m_prim_type, level.prim_num);
+			render_device::get().add_lod_statistics(m_prim_num, level.prim_num);
 		}
 		else
 		{
@@ -50,6 +74,13 @@ namespace render
 		}
 	}
 
+	void mesh::render_instanced(const instance_data* instances, unsigned count)
+	{
+		const lod_level& level = current_lod();
+		level.geometry->render_instanced(m_prim_type, level.prim_num, instances, sizeof(instance_data), count);
+		render_device::get().add_lod_statistics(m_prim_num * count, level.prim_num * count);
+	}
+
 	unsigned int mesh::get_num_verts()const
 	{
 		unsigned int ret= 0;
@@ -65,26 +96,45 @@ namespace render
 	void mesh::load(const std::string& filename)
 	{
 		m_file_name = filename;
-		m_geometry = geometry_ptr(new geometry());
 
 		io::file_system &fs	= io::file_system::get();
 		io::path_add_scoped p	("meshes/");
 
-		m_geometry->load(filename);
-
-		m_geometry->lock_ib();
-		m_geometry->unlock_ib();
+		const std::string full_path = fs.get_full_path(filename);
+		m_geometry = getSharedGeometry(filename, full_path);
 
 		m_vertex_num = m_geometry->get_num_verts();
-		m_geometry->lock_vb();
-		m_geometry->unlock_vb();
-
 		m_prim_type = TriangleList;
 		m_prim_num = m_geometry->getIndexNum() / 3;
 
 		m_render_info.bbox = m_geometry->getBBox();
 		m_render_info.bsphere = m_geometry->getBSphere();
 
+		clear_lods();
+
+		// levels generated by MeshConverter, shared between meshes like main geometry
+		for (unsigned level = 1; ; ++level)
+		{
+			const std::string lod_path = mesh_cache::get_lod_cache_filename(full_path, level);
+			geometry_ptr g = g_geometries[lod_path].lock();
+			if (!g)
+			{
+				g = geometry_ptr(new geometry());
+				if (!g->load_lod(filename, level, m_geometry->get_source_hash()))
+				{
+					g_geometries.erase(lod_path);
+					break;
+				}
+				g_geometries[lod_path] = g;
+			}
+
+			lod_level l = {g, g->getIndexNum() / 3};
+			m_lods.push_back(l);
+			m_lod_selector.add_level(lod::default_threshold(level));
+		}
+
+		update_occluder();
+
 		//Neonic: octree.     
 		//createLocal( this, (m_render_info.bbox.getMax()-m_render_info.bbox.getMin()) * 0.5f);
 	}
@@ -145,8 +195,107 @@ namespace render
 		}
 	}
 
+	void mesh::add_lod(const std::string& filename, float max_size)
+	{
+		io::file_system &fs	= io::file_system::get();
+		io::path_add_scoped p	("meshes/");
+
+		geometry_ptr g = getSharedGeometry(filename, fs.get_full_path(filename));
+		if (0 == g->getIndexNum())
+			return;
+
+		if (!m_lod_selector.add_level(max_size))
+		{
+			base::lwrn << "mesh::add_lod: level \"" << filename << "\" size " << max_size
+					   << " must be below size of previous level, level is skipped";
+			return;
+		}
+
+		lod_level l = {g, g->getIndexNum() / 3};
+		m_lods.push_back(l);
+		update_occluder();
+	}
+
+	void mesh::clear_lods()
+	{
+		m_lods.clear();
+		m_lod_selector.clear();
+
+		lod_level l = {m_geometry, m_prim_num};
+		m_lods.push_back(l);
+		update_occluder();
+	}
+
+	void mesh::set_occluder(bool flag)
+	{
+		m_is_occluder = flag;
+		update_occluder();
+	}
+
+	void mesh::update_occluder()
+	{
+		m_render_info.occluder = 0;
+		if (!m_is_occluder || m_lods.empty() || !m_lods.back().geometry)
+			return;
+
+		const geometry& g = *m_lods.back().geometry;
+		if (g.getVB().empty() || g.getIB().size() < 3)
+			return;
+
+		m_occluder.positions = g.getVB()[0].position.getData();
+		m_occluder.stride = sizeof(geometry::vertex_type);
+		m_occluder.num_verts = (unsigned)g.getVB().size();
+		m_occluder.indices = &g.getIB()[0];
+		m_occluder.num_indices = (unsigned)g.getIB().size();
+		m_render_info.occluder = &m_occluder;
+	}
+
+	unsigned int mesh::current_lod_index() const
+	{
+		const unsigned num = (unsigned)m_lods.size();
+		return m_render_info.lod < num ? m_render_info.lod : (num > 0 ? num - 1 : 0);
+	}
+
+	void mesh::request_texture_detail(float size) const
+	{
+		const float pixels = size * render_device::get().getBackBufferSize()[1];
+		for (materials_list::const_iterator it = m_materials.begin(); it != m_materials.end(); ++it)
+		{
+			if (!*it)
+				continue;
+
+			const material::MaterialMaps& maps = (*it)->getMaterialMaps();
+			for (material::MaterialMaps::const_iterator map = maps.begin(); map != maps.end(); ++map)
+				if (const texture_ptr& t = map->second.get_texture())
+					t->request_detail(pixels);
+		}
+	}
+
 	const renderable_info & mesh::get_renderable_info() const
 	{
+		m_render_info.lods = 0;
+		m_render_info.lod_geometries = 0;
+
+		// meshes with several materials are drawn by submeshes, 
+		// they have no detail levels and are not instanced
+		if (m_materials.size() > 1 || m_lods.empty())
+			m_render_info.geometry = 0;
+		else
+		{
+			m_render_info.geometry = m_lods[0].geometry.get();
+
+			// level of every camera is chosen by render_manager
+			if (m_lods.size() > 1)
+			{
+				m_lod_geometries.resize(m_lods.size());
+				for (size_t i = 0; i < m_lods.size(); ++i)
+					m_lod_geometries[i] = m_lods[i].geometry.get();
+
+				m_render_info.lods = &m_lod_selector;
+				m_render_info.lod_geometries = &m_lod_geometries[0];
+			}
+		}
+
 		if (m_materials.size() > 0)
 			m_render_info.material = *m_materials.begin();
 		else
@@ -0,0 +1,79 @@
+#include "precompiled.h"
+
+#include <rgde/render/mesh_cache.h>
+#include <rgde/base/lexical_cast.h>
+
+namespace render
+{
+	namespace mesh_cache
+	{
+		//-----------------------------------------------------------------------------------
+		header::header()
+			: magic(file_magic)
+			, version(file_version)
+			, vertex_size(0)
+			, vertex_count(0)
+			, index_size(0)
+			, index_count(0)
+		{
+			memset(source_hash.raw_uchar, 0, sizeof(source_hash.raw_uchar));
+		}
+		//-----------------------------------------------------------------------------------
+		std::string get_cache_filename(const std::string& xml_filename)
+		{
+			return xml_filename + ".mesh";
+		}
+		//-----------------------------------------------------------------------------------
+		std::string get_lod_cache_filename(const std::string& xml_filename, unsigned level)
+		{
+			return xml_filename + ".lod" + base::lexical_cast<std::string>(level) + ".mesh";
+		}
+		//-----------------------------------------------------------------------------------
+		hash_id calc_source_hash(const std::vector<byte>& xml_data)
+		{
+			if (xml_data.empty())
+				return base::hash_string::calc_hash(0, 0);
+
+			return base::hash_string::calc_hash(&xml_data[0], xml_data.size());
+		}
+		//-----------------------------------------------------------------------------------
+		bool read_header(io::read_stream& in, header& h)
+		{
+			if (in.size() < sizeof(unsigned) * 2)
+				return false;
+
+			in >> h.magic >> h.version;
+			if ((h.magic != file_magic && h.magic != packed_magic) || h.version != file_version)
+				return false;
+
+			in.read(h.source_hash.raw_uchar, sizeof(h.source_hash.raw_uchar));
+
+			in	>> h.vertex_size >> h.vertex_count
+				>> h.index_size >> h.index_count;
+
+			math::point3f min, max, center;
+			float radius = 0;
+			in >> min >> max >> center >> radius;
+
+			h.bbox.setMin(min);
+			h.bbox.setMax(max);
+			h.bbox.setEmpty(false);
+			h.bsphere.setCenter(center);
+			h.bsphere.setRadius(radius);
+
+			return true;
+		}
+		//-----------------------------------------------------------------------------------
+		void write_header(io::write_stream& out, const header& h)
+		{
+			out << h.magic << h.version;
+			out.write(h.source_hash.raw_uchar, sizeof(h.source_hash.raw_uchar));
+
+			out	<< h.vertex_size << h.vertex_count
+				<< h.index_size << h.index_count;
+
+			out << h.bbox.getMin() << h.bbox.getMax()
+				<< h.bsphere.getCenter() << h.bsphere.getRadius();
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#include "precompiled.h"
+
+#include <rgde/render/mesh_xml.h>
+
+#include <rgde/base/xml_helpers.h>
+
+namespace render
+{
+	void readColor( TiXmlElement* node, math::Color& color)
+	{		
+		double r,g,b,a; 
+		r = g = b = a = 1; 		
+		TiXmlElement *pElement = node->FirstChildElement("color");
+		if ( 0  != pElement )
+		{
+			pElement->Attribute("r", &r);
+			pElement->Attribute("g", &g);
+			pElement->Attribute("b", &b);
+			pElement->Attribute("a", &a);
+		}
+		color = math::Color( (unsigned char)(r*255),(unsigned char)(g*255), (unsigned char)(b*255), (unsigned char)(a*255) );
+	}
+
+	void readPosition( TiXmlElement* node, math::vec3f& position)
+	{
+		if ( TiXmlElement *elem = node->FirstChildElement("position") )
+			base::read(position, elem);
+	}
+
+	void readTangent( TiXmlElement* node, math::vec3f& tangent)
+	{
+		if (TiXmlElement *elem = node->FirstChildElement("tangent") )
+			base::read(tangent, elem);
+	}
+
+	void readBinormal( TiXmlElement* node, math::vec3f& binormal)
+	{
+		if (TiXmlElement *elem = node->FirstChildElement("binormal") )
+			base::read(binormal, elem);
+	}
+
+	void readNormal( TiXmlElement* node, math::vec3f& normal)
+	{		
+		if (TiXmlElement *elem = node->FirstChildElement("normal") )
+			base::read(normal, elem);
+	}
+
+	void readTexCoords( TiXmlElement* node, math::vec2f& tex)
+	{
+		if (TiXmlElement *elem = node->FirstChildElement("uvset") )
+			base::read(tex, elem);
+	}
+
+	void readTexCoords2( TiXmlElement* node, math::vec2f& tex0, math::vec2f& tex1)
+	{
+		if (TiXmlElement *elem = node->FirstChildElement("uvset") )
+		{
+			base::read(tex0, elem);
+
+			if (elem = elem->NextSiblingElement("uvset"))
+				base::read(tex1, elem);
+		}
+	}
+
+	void readWeights( TiXmlElement* node, math::vec4f& weights)
+	{		
+		if (TiXmlElement *elem = node->FirstChildElement("weights") )
+			base::read(weights, elem);
+	}
+}
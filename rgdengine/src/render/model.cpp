@@ -5,6 +5,8 @@
 
 #include <rgde/base/xml_helpers.h>
 
+#include <functional>
+
 using namespace std;
 using math::Color;
 
@@ -20,7 +22,7 @@ namespace render
 		clear();
 	}
 
-	void read_node(TiXmlElement *elem, math::frame &root_frame, model &model);
+	void read_node(pugi::xml_node elem, math::frame &root_frame, model &model);
 	mesh::geometry_ptr read_geometry(const std::string& fNm);
 
 	model_ptr model::create(const std::string& filename)
@@ -40,62 +42,56 @@ namespace render
 		io::file_system &fs	= io::file_system::get();
 
 		io::path_add_scoped p	("Models/" + model_name + "/");
-		io::readstream_ptr in	= fs.find(model_name + ".xml");
+		base::xml_document xml;
 
-		if (!in)
+		if (!xml.load(model_name + ".xml"))
 		{
 			std::string error	= "model::load: can't load file ";// + filename;
 			base::lerr << "model::load: can't load file: " << model_name << ".xml";
 			throw exception(error.c_str());
 		}
 
-		std::vector<byte> data;
-		io::stream_to_vector(data, in);
-
-		TiXmlDocument xml;//(std::string(model_name.begin(), model_name.end()));
-		xml.Parse((const char*)&(data[0]));
-
 		clear();
 
-		TiXmlElement *mod_elem	= xml.RootElement();
-		TiXmlElement *elem		= mod_elem->FirstChild("material_list")->ToElement();
+		pugi::xml_node mod_elem	= xml.root();
+		pugi::xml_node elem		= mod_elem.child("material_list");
 
 		if (elem)
 		{
-			for (TiXmlNode* node = elem->IterateChildren(NULL);
-					node != 0; node = elem->IterateChildren(node))
+			for (pugi::xml_node tx = elem.first_child(); tx; tx = tx.next_sibling())
 			{
-				TiXmlElement *tx= node->ToElement();
-				int m_id= 0; 
-				tx->Attribute("id", &m_id);
+				if (tx.type() != pugi::node_element)
+					continue;
 
-				std::string str	= tx->Attribute("file");
+				int m_id = tx.attribute("id").as_int();
+
+				std::string str	= tx.attribute("file").value();
 				m_materials[m_id] = material::create(str);
 			}
 		}
 		{
-			TiXmlNode *elem = mod_elem->FirstChild("node");
+			pugi::xml_node elem = mod_elem.child("node");
 
 			if (elem)
-				read_node(elem->ToElement(), *this, *this);
+				read_node(elem, *this, *this);
 		}
 
 		//Neonic: octree.      .
 		update();
 	}
 
-	void read_node(TiXmlElement *elem, math::frame &root_frame, model &model)
+	void read_node(pugi::xml_node elem, math::frame &root_frame, model &model)
 	{
-		if (elem->Attribute("name"))
+		if (pugi::xml_attribute name = elem.attribute("name"))
 		{
-			root_frame.name(elem->Attribute("name"));
+			root_frame.name(name.value());
 		}
 
 		//////////////////////////////////////////////////////////////////////////
 		// load transformation data if exist
 		{
 			// translation
-			if (TiXmlElement * node = elem->FirstChildElement("translation"))
+			if (pugi::xml_node node = elem.child("translation"))
 			{
 				math::vec3f v;
 				base::read(v, node);
@@ -103,7 +99,7 @@ namespace render
 			}
 
 			//rotation
-			if (TiXmlElement * node = elem->FirstChildElement("rotation"))
+			if (pugi::xml_node node = elem.child("rotation"))
 			{
 				math::vec3f v;
 				base::read(v, node);
@@ -118,7 +114,7 @@ namespace render
 			}
 
 			//scale
-			if (TiXmlElement * node = elem->FirstChildElement("scale"))
+			if (pugi::xml_node node = elem.child("scale"))
 			{
 				math::vec3f v;
 				base::read(v, node);
@@ -127,7 +123,7 @@ namespace render
 		}
 		//////////////////////////////////////////////////////////////////////////
 
-		TiXmlElement *gm	= elem->FirstChildElement("animation");
+		pugi::xml_node gm	= elem.child("animation");
 
 		//Neonic: octree
 		bool dynamic = 0;
@@ -144,22 +140,41 @@ namespace render
 			dynamic=1;
 		}
 
-		TiXmlElement *mt= elem->FirstChildElement("material");
+		pugi::xml_node mt= elem.child("material");
 
 		int m_id		= -1;
 
 		if (mt)
-			mt->Attribute("id", &m_id); 		   
+			m_id = mt.attribute("id").as_int();
 
-		gm = elem->FirstChildElement("geometry");
+		gm = elem.child("geometry");
 
 		if (gm)
 		{
 			mesh_ptr m(new mesh);
-			std::string mesh_file = std::string(gm->Attribute("name")) + ".xml";
+			std::string mesh_file = std::string(gm.attribute("name").value()) + ".xml";
 
 			m->load(mesh_file);
 
+			// explicit detail levels replace generated ones:
+			// <lod name="mesh_low" size="0.1"/>, size is max projected size of level.
+			// levels may be listed in any order, they are added from finer to coarser
+			if (pugi::xml_node lod = gm.child("lod"))
+			{
+				std::vector<std::pair<float, std::string> > levels;
+				for (; lod; lod = lod.next_sibling("lod"))
+					levels.push_back(std::make_pair(lod.attribute("size").as_float(), std::string(lod.attribute("name").value())));
+				std::sort(levels.begin(), levels.end(), std::greater<std::pair<float, std::string> >());
+
+				m->clear_lods();
+				for (size_t i = 0; i < levels.size(); ++i)
+					m->add_lod(levels[i].second + ".xml", levels[i].first);
+			}
+
+			// <geometry name="wall" occluder="1"> - large mesh hiding objects behind it
+			if (gm.attribute("occluder").as_bool())
+				m->set_occluder(true);
+
 			if (m_id >= 0)
 				m->get_materials().push_back(model.get_materials()[m_id]);
 
@@ -169,16 +184,14 @@ namespace render
 		}
 
 		//By PC
-		TiXmlElement *lt= elem->FirstChildElement("light");
+		pugi::xml_node lt= elem.child("light");
 
 		if (lt)
 		{
 			std::string strType = "point";
 
-			TiXmlElement *type = lt->FirstChildElement("type");
-			if(type)
-				if(type->Attribute("value"))
-					strType = type->Attribute("value");
+			if (pugi::xml_attribute type = lt.child("type").attribute("value"))
+				strType = type.value();
 
 			if(strType == "point")
 			{
@@ -198,35 +211,26 @@ namespace render
 
 				float range = 1.0f;
 
-				TiXmlElement *att = lt->FirstChildElement("far_att");
-				if(att)
-					if(att->Attribute("end"))
-						range = base::lexical_cast<float, std::string>(att->Attribute("end"));
+				range = base::safe_read_attr<float>(lt.child("far_att"), "end", range);
 
 				pPointLight->range(range);
 				pPointLight->constant_attenuation(0.0f);
 				pPointLight->linear_attenuation(1.0f);
 				pPointLight->quadratic_attenuation(0.0f);
 
-				std::string strEnabled = "1";
-
-				TiXmlElement *enabled = lt->FirstChildElement("enabled");
-				if(enabled)
-					if(enabled->Attribute("value"))
-						strEnabled = enabled->Attribute("value");
+				int enabled = base::safe_read_attr<int>(lt.child("enabled"), "value", 1);
 
-				pPointLight->setEnabled(base::lexical_cast<int, std::string>(strEnabled)>0);
+				pPointLight->setEnabled(enabled > 0);
 			}
 			else
 				base::lwrn<<"\""<<strType<<"\" light type temporally unsupported.";
 		}
 
 
-		TiXmlNode *cd	= 0;
-		while (cd = elem->IterateChildren("node", cd))
+		for (pugi::xml_node cd = elem.child("node"); cd; cd = cd.next_sibling("node"))
 		{
 			math::frame_ptr child = math::frame::create();
-			read_node(cd->ToElement(), *(child.get()), model);
+			read_node(cd, *(child.get()), model);
 			root_frame.add(child);
 			model.getFrames().push_back(child); //   ??
 		};
@@ -26,6 +26,10 @@ namespace particles
 	{
 		base_emitter::debug_draw();
 
+		render::lines3d& line_manager = render::render_device::get().get_lines3d();
+		if (!line_manager.is_enabled(render::lines3d::emitters))
+			return;
+
 		math::vec3f size = m_box_size(m_normalized_time);
 		math::vec3f size_rand = m_box_size_spread(m_normalized_time);
 
@@ -33,13 +37,12 @@ namespace particles
 		math::vec3f direction_rand = m_direction_spread(m_normalized_time);
 
 		math::matrix44f m = world_trasform();
-		render::lines3d& line_manager = render::render_device::get().get_lines3d();
-		line_manager.add_box( m, (math::vec3f)(size + size_rand), math::Color(0, 255, 0, 255) );
-		line_manager.add_box( m, (math::vec3f)(size - size_rand), math::Color(0, 255, 0, 255) );
+		line_manager.add_box( m, (math::vec3f)(size + size_rand), math::Color(0, 255, 0, 255), render::lines3d::emitters );
+		line_manager.add_box( m, (math::vec3f)(size - size_rand), math::Color(0, 255, 0, 255), render::lines3d::emitters );
 
-		line_manager.add_box( m, size, math::Color(0, 255, 0, 255) );
+		line_manager.add_box( m, size, math::Color(0, 255, 0, 255), render::lines3d::emitters );
 
-		line_manager.add_arrow( m, direction, math::Color(0, 255, 0, 255) );
+		line_manager.add_arrow( m, direction, math::Color(0, 255, 0, 255), render::lines3d::emitters );
 	}
 
 	//-----------------------------------------------------------------------------------
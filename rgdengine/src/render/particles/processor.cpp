@@ -248,13 +248,16 @@ namespace particles{
 		if( !m_visible )
 			return;
 
+		render::lines3d& line_manager = render::render_device::get().get_lines3d();
+		if (!line_manager.is_enabled(render::lines3d::particles))
+			return;
+
 		math::matrix44f m = local_trasform();
 
 		//if (m_is_global)
 		//	m = math::setTrans( m, math::vec3f(0,0,0) );
 
 		math::vec3f center, vel;
-		render::lines3d& line_manager = render::render_device::get().get_lines3d(); 
 		for (particles_iter it = m_particles.begin(); it != m_particles.end(); ++it)
 		{
 			if ((*it).dead)
@@ -271,8 +274,8 @@ namespace particles{
 			//	vel = it->pos + (*it).sum_vel*5.0f;
 			//}
 
-			line_manager.add_quad( center, math::vec2f (it->size, it->size), 0 );	
-			line_manager.add_line( center, vel, math::Green );
+			line_manager.add_quad( center, math::vec2f (it->size, it->size), 0, render::lines3d::particles );	
+			line_manager.add_line( center, vel, math::Green, render::lines3d::particles );
 		}
 	}
 	//-----------------------------------------------------------------------------------
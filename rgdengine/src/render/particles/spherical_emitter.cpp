@@ -59,6 +59,8 @@ namespace particles
 		base_emitter::debug_draw();
 
 		render::lines3d& line_manager = render::render_device::get().get_lines3d();
+		if (!line_manager.is_enabled(render::lines3d::emitters))
+			return;
 
 		float rad = m_Radius.get_value(m_normalized_time);// + 
 		float r_rand = m_RadiusSpread.get_value(m_normalized_time);
@@ -66,11 +68,11 @@ namespace particles
 
 		const math::matrix44f& m = world_trasform();
 
-		line_manager.add_sphere( m , rad, angle );
+		line_manager.add_sphere( m , rad, angle, render::lines3d::emitters );
 		if( r_rand != 0 )
 		{
-			line_manager.add_sphere( m , rad-r_rand, angle );
-			line_manager.add_sphere( m , rad+r_rand, angle );
+			line_manager.add_sphere( m , rad-r_rand, angle, render::lines3d::emitters );
+			line_manager.add_sphere( m , rad+r_rand, angle, render::lines3d::emitters );
 		}
 	}
 
@@ -7,16 +7,18 @@
 namespace particles
 {
 	//-----------------------------------------------------------------------------------
-	renderer::renderer() : m_reserved_size(0)
+	renderer::renderer() : m_geometry(true)
 	{
-		m_effect = render::effect::create( "particles.fx" );
+		// vertices of particle go around quad: top left, top right, bottom right, bottom left
+		m_geometry.use_quad_indices();
 
-		render::effect::params_map& params = m_effect->get_params();
+		m_effect = render::effect::create( "particles.fx" );
 
-		m_paramUpVec			= params["m_vUp"];
-		m_paramRightVec			= params["m_vRight"];
-		m_paramParticleTexture	= params["ParticlesTexture"];
-		m_paramTransformMatrix	= params["m_mLVP"];
+		typedef render::effect effect;
+		m_paramUpVec			= m_effect->get_param(effect::get_param_id("m_vUp"));
+		m_paramRightVec			= m_effect->get_param(effect::get_param_id("m_vRight"));
+		m_paramParticleTexture	= m_effect->get_param(effect::get_param_id("ParticlesTexture"));
+		m_paramTransformMatrix	= m_effect->get_param(effect::get_param_id("m_mLVP"));
 
 		m_pRenderTechnique = m_effect->find_technique("PartilesRenderModulate");
 
@@ -30,7 +32,9 @@ namespace particles
 	//-----------------------------------------------------------------------------------
 	void renderer::render(render::texture_ptr texture, math::frame_ptr frame)
 	{
-		if( (m_reserved_size == 0) )
+		// particles uploaded by last update
+		const unsigned num_particles = (std::min)((unsigned)m_particles.size(), (unsigned)m_geometry.get_num_verts() / 4);
+		if (0 == num_particles)
 			return;
 
 		const math::matrix44f& mLocal	= frame->world_trasform();
@@ -76,7 +80,11 @@ namespace particles
 		for(size_t pass = 0; pass < passes.size(); ++pass)
 		{
 			passes[pass]->begin();
-			m_geometry.render( render::TriangleList, 2*(unsigned)m_particles.size() );
+			for (unsigned start = 0; start < num_particles; start += max_batch_particles)
+			{
+				const unsigned num = (std::min)(num_particles - start, (unsigned)max_batch_particles);
+				m_geometry.render(render::TriangleList, 4 * start, 0, num * 4, 0, num * 2);
+			}
 			passes[pass]->end();
 		}
 
@@ -89,28 +97,9 @@ namespace particles
 
 		if( nParticles == 0 ) return;
 
-		if( (nParticles > m_reserved_size) )
-		{
-			m_reserved_size = nParticles;
-
-			geometry::indexies& indexies = m_geometry.lock_ib();
-			if( indexies.size() < nParticles*6 )
-				indexies.resize(nParticles*6);
-			for(unsigned i = 0; i < nParticles; ++i)
-			{
-				indexies[i * 6 + 0] = i * 4 + 0;
-				indexies[i * 6 + 1] = i * 4 + 1;
-				indexies[i * 6 + 2] = i * 4 + 2;
-				indexies[i * 6 + 3] = i * 4 + 3;
-				indexies[i * 6 + 4] = i * 4 + 2;
-				indexies[i * 6 + 5] = i * 4 + 1;
-			}
-			m_geometry.unlock_ib();
-		}
-
+		// only vertices of alive particles are uploaded
 		geometry::vertexies& vertexies = m_geometry.lock_vb();
-		if( vertexies.size() < nParticles*4 )
-			vertexies.resize(nParticles*4);
+		vertexies.resize(nParticles*4);
 
 		unsigned int j = 0;
 		for( unsigned int i = 0; i < nParticles; ++i )
@@ -142,14 +131,14 @@ namespace particles
 			++j;
 
 			vertexies[j].position = p.pos;
-			vertexies[j].tex1 = math::vec2f( -xcos + ysin, -xsin - ycos );
-			vertexies[j].tex0 = math::vec2f(fTileX*m_fInvTotalColumns, (fTileY + 1.0f)*m_fInvTotalRows);
+			vertexies[j].tex1 = math::vec2f( xcos + ysin, xsin - ycos );
+			vertexies[j].tex0 = math::vec2f((fTileX + 1.0f)*m_fInvTotalColumns, (fTileY + 1.0f)*m_fInvTotalRows);
 			vertexies[j].color = p.color;
 			++j;
 
 			vertexies[j].position = p.pos;
-			vertexies[j].tex1 = math::vec2f( xcos + ysin, xsin - ycos );
-			vertexies[j].tex0 = math::vec2f((fTileX + 1.0f)*m_fInvTotalColumns, (fTileY + 1.0f)*m_fInvTotalRows);
+			vertexies[j].tex1 = math::vec2f( -xcos + ysin, -xsin - ycos );
+			vertexies[j].tex0 = math::vec2f(fTileX*m_fInvTotalColumns, (fTileY + 1.0f)*m_fInvTotalRows);
 			vertexies[j].color = p.color;
 			++j;
 		}
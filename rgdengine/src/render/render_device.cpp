@@ -7,6 +7,7 @@
 #include <rgde/render/lines2d.h>
 
 #include <rgde/core/timer.h>
+#include <rgde/io/file.h>
 
 #include <d3dx9.h>
 extern LPDIRECT3DDEVICE9 g_d3d;
@@ -27,9 +28,141 @@ namespace render
 		return ms_is_created;
 	}
 
+	/// GPU time of frames by timestamp queries. Results are read without
+	/// waiting, so they arrive few frames later and are written into history.
+	/// Frames are not measured while all query sets are in flight.
+	class gpu_timer : public device_object
+	{
+	public:
+		gpu_timer() : m_current(0), m_active(false)
+		{
+			memset(m_sets, 0, sizeof(m_sets));
+			create();
+		}
+
+		~gpu_timer()
+		{
+			release();
+		}
+
+		void onLostDevice()		{release();}
+		void onResetDevice()	{create();}
+
+		void begin(unsigned frame)
+		{
+			query_set& q = m_sets[m_current];
+			m_active = NULL != q.disjoint && !q.pending;
+			if (!m_active)
+				return;
+
+			q.frame = frame;
+			q.disjoint->Issue(D3DISSUE_BEGIN);
+			q.begin->Issue(D3DISSUE_END);
+		}
+
+		void end()
+		{
+			if (!m_active)
+				return;
+
+			query_set& q = m_sets[m_current];
+			q.end->Issue(D3DISSUE_END);
+			q.frequency->Issue(D3DISSUE_END);
+			q.disjoint->Issue(D3DISSUE_END);
+			q.pending = true;
+
+			m_current = (m_current + 1) % num_sets;
+			m_active = false;
+		}
+
+		/// writes ready results into history
+		void collect(statistics_history& history)
+		{
+			for (int i = 0; i < num_sets; ++i)
+			{
+				query_set& q = m_sets[i];
+				if (!q.pending)
+					continue;
+
+				BOOL disjoint = FALSE;
+				UINT64 frequency = 0, begin_ticks = 0, end_ticks = 0;
+
+				HRESULT hr = q.disjoint->GetData(&disjoint, sizeof(disjoint), 0);
+				if (S_OK == hr) hr = q.frequency->GetData(&frequency, sizeof(frequency), 0);
+				if (S_OK == hr) hr = q.begin->GetData(&begin_ticks, sizeof(begin_ticks), 0);
+				if (S_OK == hr) hr = q.end->GetData(&end_ticks, sizeof(end_ticks), 0);
+
+				if (S_FALSE == hr)
+					continue;
+
+				// device lost or counter changed frequency - frame is skipped
+				q.pending = false;
+				if (FAILED(hr) || disjoint || 0 == frequency)
+					continue;
+
+				if (frame_statistics* f = history.find(q.frame))
+					f->gpu_ms = (float)((end_ticks - begin_ticks) * 1000.0 / frequency);
+			}
+		}
+
+	private:
+		void create()
+		{
+			release();
+			if (NULL == g_d3d)
+				return;
+
+			for (int i = 0; i < num_sets; ++i)
+			{
+				query_set& q = m_sets[i];
+				if (FAILED(g_d3d->CreateQuery(D3DQUERYTYPE_TIMESTAMPDISJOINT, &q.disjoint)) ||
+					FAILED(g_d3d->CreateQuery(D3DQUERYTYPE_TIMESTAMPFREQ, &q.frequency)) ||
+					FAILED(g_d3d->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &q.begin)) ||
+					FAILED(g_d3d->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &q.end)))
+				{
+					// timestamps are not supported, frames are not measured
+					release();
+					return;
+				}
+			}
+		}
+
+		void release()
+		{
+			for (int i = 0; i < num_sets; ++i)
+			{
+				query_set& q = m_sets[i];
+				SAFE_RELEASE(q.disjoint);
+				SAFE_RELEASE(q.frequency);
+				SAFE_RELEASE(q.begin);
+				SAFE_RELEASE(q.end);
+				q.pending = false;
+			}
+			m_active = false;
+		}
+
+	private:
+		enum { num_sets = 4 };
+
+		struct query_set
+		{
+			IDirect3DQuery9* disjoint;
+			IDirect3DQuery9* frequency;
+			IDirect3DQuery9* begin;
+			IDirect3DQuery9* end;
+			unsigned		 frame;
+			bool			 pending;
+		};
+
+		query_set	m_sets[num_sets];
+		int			m_current;
+		bool		m_active;
+	};
+
 	render_device::render_device() : m_shaderFlags(0)
 	{
         m_clear_color = math::Color(0,0,0,255);
+		m_frame_timer.start();
 		ms_instance = this;
 		ms_is_created = true;
 	}
@@ -54,6 +187,7 @@ namespace render
 	{
 		m_lines2d.reset(new lines2d());
 		m_lines3d.reset(new lines3d());
+		m_gpu_timer.reset(new gpu_timer());
 	}
 
 	struct  _reseter
@@ -94,14 +228,108 @@ namespace render
 
 	void render_device::add_statistics(unsigned verts, unsigned tris)
 	{
-		m_verts += verts;
-		m_triangles += tris;
+		frame_statistics& f = m_statistics.current();
+		++f.draw_calls;
+		f.verts += verts;
+		f.tris += tris;
+	}
+
+	void render_device::add_culling_statistics(unsigned visible, unsigned culled)
+	{
+		frame_statistics& f = m_statistics.current();
+		f.visible_objects += visible;
+		f.culled_objects += culled;
+
+		if (f.num_cameras < frame_statistics::max_cameras)
+		{
+			f.camera_visible[f.num_cameras] = visible;
+			f.camera_culled[f.num_cameras] = culled;
+		}
+		++f.num_cameras;
+	}
+
+	void render_device::add_occlusion_statistics(unsigned occluded, unsigned occluder_tris)
+	{
+		frame_statistics& f = m_statistics.current();
+		f.occluded_objects += occluded;
+		f.occluder_tris += occluder_tris;
+	}
+
+	void render_device::add_lod_statistics(unsigned full_tris, unsigned drawn_tris)
+	{
+		frame_statistics& f = m_statistics.current();
+		f.lod_full_tris += full_tris;
+		f.lod_tris += drawn_tris;
 	}
 
 	void render_device::reset_statistics()
 	{
-		m_verts = 0;
-		m_triangles = 0;
+		frame_statistics& f = m_statistics.current();
+		f.reset(f.frame);
+	}
+
+	void render_device::begin_frame()
+	{
+		reset_statistics();
+
+		if (m_gpu_timer)
+			m_gpu_timer->begin(m_statistics.current().frame);
+	}
+
+	void render_device::end_frame()
+	{
+		if (m_gpu_timer)
+			m_gpu_timer->end();
+
+		m_statistics.current().frame_ms = m_frame_timer.elapsed() * 1000.0f;
+		m_statistics.end_frame();
+
+		if (m_gpu_timer)
+			m_gpu_timer->collect(m_statistics);
+	}
+
+	const frame_statistics& render_device::last_frame() const
+	{
+		return m_statistics.size() > 0 ? m_statistics.get(0) : m_statistics.current();
+	}
+
+	bool render_device::save_statistics(const std::string& filename) const
+	{
+		std::ofstream out(filename.c_str());
+		if (!out)
+			return false;
+
+		if (io::helpers::get_file_ext(filename) == "json")
+			m_statistics.write_json(out);
+		else
+			m_statistics.write_csv(out);
+
+		return out.good();
+	}
+
+	bool render_device::supports_instancing() const
+	{
+		if (NULL == g_d3d)
+			return false;
+
+		D3DCAPS9 caps;
+		if (FAILED(g_d3d->GetDeviceCaps(&caps)))
+			return false;
+
+		return caps.VertexShaderVersion >= D3DVS_VERSION(3, 0);
+	}
+
+	bool render_device::supports_packed_vertices() const
+	{
+		if (NULL == g_d3d)
+			return false;
+
+		D3DCAPS9 caps;
+		if (FAILED(g_d3d->GetDeviceCaps(&caps)))
+			return false;
+
+		const DWORD types = D3DDTCAPS_USHORT4N | D3DDTCAPS_SHORT4N | D3DDTCAPS_FLOAT16_2;
+		return caps.VertexShaderVersion >= D3DVS_VERSION(2, 0) && types == (caps.DeclTypes & types);
 	}
 
 	//--------------------------------------------------------------------------------------
@@ -184,9 +412,32 @@ namespace render
 
 	void render_device::showStatistics(const font_ptr& font)
 	{
-		WCHAR szStatisticsString[512];
-		wsprintf(szStatisticsString, L"Tris: %d, Vertices: %d", m_triangles, m_verts);
-		font->render(szStatisticsString, math::Rect(1, 19, 400, 400), 0xFFFFFFFF, true);
+		// averages over history are stable enough to read
+		const frame_statistics f = m_statistics.average();
+
+		std::wostringstream text;
+		text << std::fixed << std::setprecision(2);
+		text << L"Frame: " << f.frame_ms << L" ms, GPU: ";
+		if (f.gpu_ms >= 0)
+			text << f.gpu_ms << L" ms";
+		else
+			text << L"n/a";
+
+		text << L"\nCPU:";
+		for (int s = 0; s < num_render_stages; ++s)
+			text << L" " << statistics_history::stage_name(s) << L" " << f.stage_ms[s] << L" ms";
+
+		text << L"\nDraw calls: " << f.draw_calls << L", state changes: " << f.state_changes
+			 << L", techniques: " << f.technique_begins << L", uploaded: " << f.upload_bytes / 1024 << L" KB";
+		text << L"\nDynamic: " << f.dynamic_upload_bytes / 1024 << L" KB, discards: " << f.dynamic_discards;
+		text << L"\nTris: " << f.tris << L", Vertices: " << f.verts << L", LOD saved tris: " << f.lod_full_tris - f.lod_tris;
+		text << L"\nObjects: " << f.visible_objects << L" visible / " << f.culled_objects << L" culled / "
+			 << f.occluded_objects << L" occluded (" << f.occluder_tris << L" occluder tris)";
+
+		for (unsigned c = 0; c < f.num_cameras && c < frame_statistics::max_cameras; ++c)
+			text << L"\n  camera " << c << L": " << f.camera_visible[c] << L" / " << f.camera_culled[c];
+
+		font->render(text.str(), math::Rect(1, 19, 600, 400), 0xFFFFFFFF, true);
 	}
 
 //////////////////////////////////////////////////////////////////////////
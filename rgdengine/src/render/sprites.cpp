@@ -25,19 +25,56 @@ namespace render
 	{
 	}
 
+	sprite_layer::sprite_layer(bool is_static, int order)
+		: m_geometry(!is_static)
+		, m_rebuild(true)
+		, m_static(is_static)
+		, m_visible(true)
+		, m_order(order)
+	{
+		// quads of one draw call share indices, calls differ by base vertex
+		m_geometry.use_quad_indices();
+	}
+
+	size_t sprite_layer::add(const sprite& s)
+	{
+		m_rebuild = true;
+		m_sprites.push_back(s);
+		return m_sprites.size() - 1;
+	}
+
+	sprite& sprite_layer::modify(size_t index)
+	{
+		if (!m_rebuild)
+			m_modified.push_back((unsigned)index);
+		return m_sprites[index];
+	}
+
+	void sprite_layer::clear()
+	{
+		m_rebuild = true;
+		m_sprites.resize(0);
+		m_modified.resize(0);
+	}
+
+	namespace
+	{
+		bool order_less(const sprite_layer_ptr& a, const sprite_layer_ptr& b)
+		{
+			return a->get_order() < b->get_order();
+		}
+	}
+
 	sprite_manager::sprite_manager(int priority)
 		: m_screen_size(800, 600)
-		, m_reserved_size(0)
 		, m_sprites_rendered(0)
-		, m_sorted(false)
-		, m_updated(true)
 		, rendererable(priority)
 		, m_origin(0, 0)
-		, m_geometry(true) // true - for dynamic
 		, m_aditive(false)
 		, m_additive_tech(0)
 		, m_modulate_tech(0)
 		, m_texture_param(0)
+		, m_atlas_version(0)
 	{
 		//base::lmsg << "sprite_manager::sprite_manager()";
 		math::vec2f vFrontBufferSize= render::render_device::get().getBackBufferSize();
@@ -48,8 +85,10 @@ namespace render
 		m_additive_tech = m_effect->find_technique("aditive");
 		m_modulate_tech = m_effect->find_technique("alpha");
 
-		m_texture_param = m_effect->get_params()["spriteTexture"];
-		assert(0 != m_texture_param && "m_effect->get_params()[\"spriteTexture\"] == NULL !");
+		m_texture_param = m_effect->get_param(effect::get_param_id("spriteTexture"));
+		assert(0 != m_texture_param && "spriteTexture effect parameter is NULL !");
+
+		m_immediate = create_layer(false, 0);
 
 		m_render_info.render_func = boost::bind(&sprite_manager::render, this);
 	}
@@ -60,183 +99,163 @@ namespace render
 
 	void sprite_manager::add(const sprite &s)
 	{
-		m_updated = false;
-		m_sprites.push_back(s);
+		m_immediate->add(s);
 	}
 
-	inline bool sorting_pred(const sprite& s1, sprite& s2)
+	sprite_layer_ptr sprite_manager::create_layer(bool is_static, int order)
 	{
-		return s1.priority == s2.priority ?
-			s1.texture < s2.texture
-			:
-			s1.priority < s2.priority;
+		sprite_layer_ptr layer(new sprite_layer(is_static, order));
+
+		// after layers of same order, but immediate sprites stay over them
+		std::vector<sprite_layer_ptr>::iterator it = std::upper_bound(m_layers.begin(), m_layers.end(), layer, order_less);
+		if (it != m_layers.begin() && *(it - 1) == m_immediate)
+			--it;
+		m_layers.insert(it, layer);
+		return layer;
 	}
 
-	inline math::vec2f rotatePos(float x, float y, float sina, float cosa)
+	void sprite_manager::remove_layer(const sprite_layer_ptr& layer)
 	{
-		return math::vec2f(x * cosa - y * sina, x * sina + y * cosa);
+		if (layer != m_immediate)
+			m_layers.erase(std::remove(m_layers.begin(), m_layers.end(), layer), m_layers.end());
 	}
 
-	inline void rotatePos(math::vec2f& pos, float sina, float cosa)
+	void sprite_manager::set_atlas(const texture_atlas_ptr& atlas)
 	{
-		float x = pos[0];
-		float y = pos[1];
-		pos[0] = x * cosa - y * sina;
-		pos[1] = x * sina + y * cosa;
+		m_atlas = atlas;
+		m_atlas_version = atlas ? atlas->get_version() : 0;
+
+		for (size_t i = 0; i < m_layers.size(); ++i)
+			m_layers[i]->m_rebuild = true;
 	}
 
 	void sprite_manager::update()
 	{
-		if (m_sprites.empty())
-			m_updated = true;
-
-		if (m_updated)
-			return;
-
-		using namespace math;
+		if (m_atlas && m_atlas->get_version() != m_atlas_version)
+		{
+			m_atlas_version = m_atlas->get_version();
+			for (size_t i = 0; i < m_layers.size(); ++i)
+				m_layers[i]->m_rebuild = true;
+		}
 
-		std::sort( m_sprites.begin(), m_sprites.end(), sorting_pred );
+		for (size_t i = 0; i < m_layers.size(); ++i)
+			update_layer(*m_layers[i]);
+	}
 
-		unsigned num_sprites	= (unsigned)m_sprites.size();
-		//  ,      ,    
-		if ((num_sprites > m_reserved_size))
+	void sprite_manager::update_layer(sprite_layer& layer)
+	{
+		const size_t num_sprites = layer.m_sprites.size();
+		if (0 == num_sprites)
 		{
-			m_reserved_size = num_sprites;
+			layer.m_rebuild = false;
+			layer.m_modified.resize(0);
+			return;
+		}
 
-			geometry::indexies &indexies = m_geometry.lock_ib();
-			
-			if (indexies.size() < num_sprites * 6)
-				indexies.resize(num_sprites * 6);
+		// modified sprites which moved in draw order need full rebuild
+		if (!layer.m_rebuild)
+		{
+			if (layer.m_modified.empty())
+				return;
 
-			for (unsigned i = 0; i < num_sprites; ++i)
+			for (size_t i = 0; i < layer.m_modified.size() && !layer.m_rebuild; ++i)
 			{
-				indexies[i * 6 + 0] = i * 4 + 0;
-				indexies[i * 6 + 1] = i * 4 + 1;
-				indexies[i * 6 + 2] = i * 4 + 2;
-				indexies[i * 6 + 3] = i * 4 + 0;
-				indexies[i * 6 + 4] = i * 4 + 2;
-				indexies[i * 6 + 5] = i * 4 + 3;
+				const unsigned index = layer.m_modified[i];
+				layer.m_rebuild = !layer.m_batch.same_order(layer.m_sprites[index], index);
 			}
-			m_geometry.unlock_ib();
 		}
 
-		geometry::vertexies &vertexies	= m_geometry.lock_vb();
-		
-		if (vertexies.size() < num_sprites * 4)
-			vertexies.resize(num_sprites * 4);
-
-		geometry::vertex_type* v = &(*vertexies.begin());
+		sprite_layer::geometry::vertexies &vertexies = layer.m_geometry.lock_vb();
 
-		for (sprites_iter it = m_sprites.begin(); it != m_sprites.end(); ++it)
+		if (!layer.m_rebuild)
 		{
 			//       
-			const sprite &sprite	= *it;
-			const math::Color &color= sprite.color;
-			const math::Rect &rect	= sprite.rect;
-
-			//      
-			math::vec2f hsize(sprite.size[0] * m_scale[0]*0.5f, sprite.size[1] * m_scale[1]*0.5f);
-			math::vec2f pos(sprite.pos[0] * m_scale[0], sprite.pos[1] * m_scale[1]);
-
-			float cosa = ::cos(sprite.spin);
-			float sina = ::sin(sprite.spin);
-
-			// Top left
-			math::vec2f rotPos = rotatePos(-hsize[0], -hsize[1], sina, cosa) + pos;
-			v->position.set(rotPos[0], rotPos[1], 0, 0);
-			v->tex = rect.get_top_left();
-			v->color = color;
-			v++;
-
-			// Top right
-			rotPos = rotatePos(hsize[0], -hsize[1], sina, cosa) + pos;
-			v->position.set(rotPos[0], rotPos[1], 0, 0);
-			v->tex = rect.get_top_right();
-			v->color = color;
-			v++;
-
-			// Bottom right
-			rotPos = rotatePos(hsize[0], hsize[1], sina, cosa) + pos;
-			v->position.set(rotPos[0], rotPos[1], 0, 0);
-			v->tex = rect.get_bottom_right();
-			v->color = color;
-			v++;
-
-			// Bottom left
-			rotPos = rotatePos(-hsize[0], hsize[1], sina, cosa) + pos;
-			v->position.set(rotPos[0], rotPos[1], 0, 0);
-			v->tex = rect.get_bottom_left();
-			v->color = color;
-			v++;
+			for (size_t i = 0; i < layer.m_modified.size(); ++i)
+			{
+				const unsigned index = layer.m_modified[i];
+				sprite_batch::build_quad(layer.m_sprites[index], m_scale[0], m_scale[1],
+										 &vertexies[layer.m_batch.get_slot(index) * 4], layer.m_batch.get_region(index));
+			}
 		}
-		m_geometry.unlock_vb();
+		else
+		{
+			layer.m_batch.sort(&layer.m_sprites[0], num_sprites, m_atlas.get());
+			vertexies.resize(num_sprites * 4);
 
-		m_updated = true;
+			if (num_sprites < parallel_sprites)
+				layer.m_batch.build(&layer.m_sprites[0], 0, num_sprites, m_scale[0], m_scale[1], &vertexies[0]);
+			else
+			{
+				const size_t num_chunks = (num_sprites + chunk_sprites - 1) / chunk_sprites;
+				TheRenderManager::get().getThreadPool().parallel_for(num_chunks,
+					boost::bind(&sprite_manager::build_chunk, this, boost::cref(layer), &vertexies[0], _1));
+			}
+		}
+
+		layer.m_geometry.unlock_vb();
+		layer.m_rebuild = false;
+		layer.m_modified.resize(0);
 	}
 
-	void sprite_manager::render()
+	void sprite_manager::build_chunk(const sprite_layer& layer, vertex::PositionTransformedColoredTextured* vertices, size_t chunk)
 	{
-		if (m_sprites.empty()) 
-			return;
+		const size_t begin = chunk * chunk_sprites;
+		const size_t end = (std::min)(begin + chunk_sprites, layer.m_sprites.size());
+		layer.m_batch.build(&layer.m_sprites[0], begin, end, m_scale[0], m_scale[1], vertices);
+	}
 
+	void sprite_manager::render()
+	{
 		update();
 
 		effect::technique *tech = m_aditive ? m_additive_tech : m_modulate_tech;
 
 		const effect::technique::passes& passes = tech->get_passes();
 
+		m_sprites_rendered = 0;
 		tech->begin();
 
 		for (unsigned iPass = 0; iPass < passes.size(); iPass++)
 		{
-			effect::technique::pass& pass = *passes.front();
+			effect::technique::pass& pass = *passes[iPass];
 			pass.begin();
 
-			unsigned nSpritesRendered = 0;			
-
-			uint start_sprite = 0;
-			sprite* sp = &m_sprites.front();
-			texture_ptr cur_tex = sp->texture;
-			for (uint i = 0, size = (uint)m_sprites.size(); i < size; ++i)
+			for (size_t i = 0; i < m_layers.size(); ++i)
 			{
-				sprite &sprite = sp[i];
-
-				if (cur_tex != sprite.texture)
-				{
-					int cur_sprite = i - 1;
-					int num_sprites = cur_sprite - start_sprite + 1;
-
-					if (num_sprites > 0)
-					{
-						m_texture_param->set(cur_tex);
-						m_effect->commit_changes();
-						m_geometry.render(TriangleList, 0, 4 * start_sprite, num_sprites * 4, 6 * start_sprite, num_sprites * 2);
-						nSpritesRendered += num_sprites;
-					}
-					cur_tex = sprite.texture;
-					start_sprite = i;
-				}
-
-				if (i == size - 1)
-				{
-					int cur_sprite = i;
-					int num_sprites = i - start_sprite + 1;
-					if (num_sprites > 0)
-					{
-						m_texture_param->set(cur_tex);
-						m_effect->commit_changes();
-						m_geometry.render(TriangleList, 0, 4 * start_sprite, num_sprites * 4, 6 * start_sprite, num_sprites * 2);
-						nSpritesRendered += num_sprites;
-					}
-				}
+				if (m_layers[i]->visible())
+					render_layer(*m_layers[i]);
 			}
-			m_sprites_rendered = nSpritesRendered;
 
 			pass.end();
 		}
 		tech->end();
 
-		m_sprites.resize(0);
+		m_immediate->clear();
+	}
+
+	/// one call per run of sprites with same texture, long runs are split
+	/// by max_batch_sprites to fit 16 bit indices
+	void sprite_manager::render_layer(sprite_layer& layer)
+	{
+		if (layer.m_sprites.empty())
+			return;
+
+		const sprite_batch::runs& runs = layer.m_batch.get_runs();
+		for (sprite_batch::runs::const_iterator it = runs.begin(); it != runs.end(); ++it)
+		{
+			// texture of run is taken from its first sprite, or atlas page it is on
+			const unsigned first = layer.m_batch.get_sprite(it->start);
+			const atlas_region* region = layer.m_batch.get_region(first);
+			m_texture_param->set(region ? m_atlas->get_page(region->page) : layer.m_sprites[first].texture);
+			m_effect->commit_changes();
+
+			for (unsigned start = it->start, end = it->start + it->count; start < end; start += max_batch_sprites)
+			{
+				const unsigned num_sprites = (std::min)(end - start, (unsigned)max_batch_sprites);
+				layer.m_geometry.render(TriangleList, 4 * start, 0, num_sprites * 4, 0, num_sprites * 2);
+			}
+			m_sprites_rendered += it->count;
+		}
 	}
 
 	void sprite_manager::onLostDevice()
@@ -248,6 +267,9 @@ namespace render
 		// calc scale coefs
 		math::vec2f front_buffer_size = render::render_device::get().getBackBufferSize();
 		m_scale = front_buffer_size / m_screen_size;
+
+		for (size_t i = 0; i < m_layers.size(); ++i)
+			m_layers[i]->m_rebuild = true;
 		update();
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -17,6 +17,152 @@ namespace render
 	typedef ::base::resource_manager<std::string, texture> texture_manager;
 	texture_manager manager(boost::bind(&texture_d3d9::create_from_file, _1), true, "default.jpg");
 
+	namespace
+	{
+		/// changed source is newer than its cooked file, so it is loaded directly
+		void reload_texture(texture& t, const std::string& filename)
+		{
+			base::lmsg << "reloading texture:  " << filename.c_str();
+			static_cast<texture_d3d9&>(t).createTextureFromFile(filename, false);
+		}
+
+		class texture_reloader : public io::file_change_listener
+		{
+		public:
+			texture_reloader()
+			{
+				manager.set_reload_func(&reload_texture);
+			}
+
+			void on_file_changed(const std::string& file_path)
+			{
+				// texture names are relative to one of search dirs (see open_texture_file)
+				manager.reload_if(boost::bind(&io::file_change_listener::is_same_file, boost::cref(file_path), _1));
+			}
+		};
+
+		texture_reloader reloader;
+
+		/// fallback search dir of open_texture_file. namespace scope, so loading
+		/// threads don't race constructing it (interned path pool is ready before it)
+		const io::interned_path common_textures("Media/Common/Textures");
+
+		/// streamed textures keep levels down to this size always loaded,
+		/// so DXT top level is never smaller than block
+		const unsigned base_level_size = 64;
+
+		struct texture_streamer
+		{
+			texture_streamer()
+				: budget(128 * 1024 * 1024)
+				, upload_limit(4 * 1024 * 1024)
+			{
+			}
+
+			void add(texture_d3d9* t)
+			{
+				if (std::find(textures.begin(), textures.end(), t) == textures.end())
+					textures.push_back(t);
+			}
+
+			void remove(texture_d3d9* t)
+			{
+				textures.erase(std::remove(textures.begin(), textures.end(), t), textures.end());
+			}
+
+			std::vector<texture_d3d9*>	textures;
+			size_t						budget;
+			size_t						upload_limit;
+		};
+
+		texture_streamer& get_streamer()
+		{
+			static texture_streamer streamer;
+			return streamer;
+		}
+
+		/// the most magnified resident levels are loaded first
+		bool is_more_magnified(texture_d3d9* a, texture_d3d9* b)
+		{
+			const streaming::texture_state& sa = a->get_stream_state();
+			const streaming::texture_state& sb = b->get_stream_state();
+			return sa.oversampling(sa.resident) < sb.oversampling(sb.resident);
+		}
+
+		D3DFORMAT get_cooked_format(unsigned format)
+		{
+			switch (format)
+			{
+			case cooker::format_dxt1:	return D3DFMT_DXT1;
+			case cooker::format_dxt5:	return D3DFMT_DXT5;
+			default:					return D3DFMT_A8R8G8B8;
+			}
+		}
+	}
+
+	namespace texture_streaming
+	{
+		void set_budget(size_t bytes)		{get_streamer().budget = bytes;}
+		size_t get_budget()					{return get_streamer().budget;}
+		void set_upload_limit(size_t bytes)	{get_streamer().upload_limit = bytes;}
+		size_t get_upload_limit()			{return get_streamer().upload_limit;}
+		bool is_active()					{return !get_streamer().textures.empty();}
+
+		size_t get_resident_bytes()
+		{
+			const texture_streamer& s = get_streamer();
+			size_t bytes = 0;
+			for (size_t i = 0; i < s.textures.size(); ++i)
+			{
+				const streaming::texture_state& state = s.textures[i]->get_stream_state();
+				bytes += state.bytes(state.resident);
+			}
+			return bytes;
+		}
+
+		void update()
+		{
+			texture_streamer& s = get_streamer();
+			if (s.textures.empty())
+				return;
+
+			std::vector<streaming::texture_state*> states(s.textures.size());
+			for (size_t i = 0; i < s.textures.size(); ++i)
+				states[i] = &s.textures[i]->get_stream_state();
+
+			streaming::plan(states, s.budget);
+
+			// drops first, they free memory for loads
+			std::vector<texture_d3d9*> loads;
+			for (size_t i = 0; i < s.textures.size(); ++i)
+			{
+				const streaming::texture_state& state = *states[i];
+				if (state.target > state.resident)
+					s.textures[i]->load_levels(state.target);
+				else if (state.target < state.resident)
+					loads.push_back(s.textures[i]);
+			}
+
+			std::sort(loads.begin(), loads.end(), &is_more_magnified);
+
+			size_t uploaded = 0;
+			for (size_t i = 0; i < loads.size(); ++i)
+			{
+				const streaming::texture_state& state = loads[i]->get_stream_state();
+				const size_t bytes = state.bytes(state.target) - state.bytes(state.resident);
+				if (uploaded > 0 && uploaded + bytes > s.upload_limit)
+					break;
+
+				if (loads[i]->load_levels(state.target))
+					uploaded += bytes;
+			}
+
+			// requests of next frame
+			for (size_t i = 0; i < states.size(); ++i)
+				states[i]->screen_pixels = 0;
+		}
+	}
+
 
 	texture_ptr texture::create(const std::string& filename)
 	{
@@ -64,17 +210,12 @@ namespace render
 				return in;
 		}
 
-		{
-			io::path_add_scoped p	("Textures/");
-			if (io::readstream_ptr in	= fs.find(filename))
-				return in;
-		}
+		// explicit bases instead of scoped root dir change - keeps lookup thread safe
+		if (io::readstream_ptr in	= fs.find(fs.get_root().join("Textures"), filename))
+			return in;
 
-		{
-			io::scope_path p	("Media/Common/Textures/");
-			if (io::readstream_ptr in = fs.find(filename))
-				return in;
-		}
+		if (io::readstream_ptr in = fs.find(common_textures, filename))
+			return in;
 
 		return io::readstream_ptr();
 	}
@@ -84,10 +225,16 @@ namespace render
 		return texture_ptr(new texture_d3d9(filename));
 	}
 
-	void texture_d3d9::createTextureFromFile(const std::string& filename)
+	void texture_d3d9::createTextureFromFile(const std::string& filename, bool allow_cooked)
 	{	
 		if (NULL == g_d3d) return;
 
+		if (allow_cooked && create_cooked(filename))
+			return;
+
+		get_streamer().remove(this);
+		m_cooked.reset();
+
 		std::vector<byte> data;
 		io::readstream_ptr in = open_texture_file(filename);
 
@@ -130,6 +277,128 @@ namespace render
 			base::lwrn << "Warning: texture \"" << filename << "\" has unknown type";
 	}
 
+	bool texture_d3d9::create_cooked(const std::string& filename)
+	{
+		io::readstream_ptr in = open_texture_file(filename + ".tex");
+		if (!in || in->size() < cooker::fixed_header_size)
+			return false;
+
+		std::vector<byte> head(cooker::fixed_header_size);
+		in->read(&head[0], cooker::fixed_header_size);
+
+		const unsigned levels = cooker::read_num_levels(&head[0], head.size());
+		if (0 == levels || in->size() < cooker::header_size(levels))
+			return false;
+
+		head.resize(cooker::header_size(levels));
+		in->read(&head[cooker::fixed_header_size], (unsigned)head.size() - cooker::fixed_header_size);
+
+		cooker::header h;
+		if (!cooker::read_header(&head[0], head.size(), in->size(), h))
+		{
+			base::lwrn << "Broken cooked texture \"" << filename << ".tex\"";
+			return false;
+		}
+
+		streaming::texture_state state;
+		state.width = h.width;
+		state.height = h.height;
+		for (unsigned level = 0; level < levels; ++level)
+		{
+			state.level_bytes.push_back(h.levels[level].size);
+			const cooker::level_info& l = h.levels[level];
+			if (state.base_level == 0 && level > 0 && (std::max)(l.width, l.height) <= base_level_size)
+				state.base_level = level;
+		}
+		if ((std::max)(h.width, h.height) <= base_level_size)
+			state.base_level = 0;
+
+		// nothing is resident yet
+		state.resident = levels;
+
+		SAFE_RELEASE(m_texture);
+		m_cooked = in;
+		m_cooked_header = h;
+		m_stream = state;
+
+		if (!load_levels(state.base_level))
+		{
+			m_cooked.reset();
+			return false;
+		}
+
+		m_usage = DefaultUsage;
+		m_width = h.width;
+		m_height = h.height;
+		m_format = (texture_format)get_cooked_format(h.format);
+		m_type = Texture;
+
+		get_streamer().add(this);
+		return true;
+	}
+
+	bool texture_d3d9::load_levels(unsigned first)
+	{
+		const cooker::header& h = m_cooked_header;
+		const unsigned levels = (unsigned)h.levels.size();
+		if (!m_cooked || first >= levels)
+			return false;
+		if (first == m_stream.resident && m_texture)
+			return true;
+
+		const cooker::format format = (cooker::format)h.format;
+		IDirect3DTexture9* texture = 0;
+		if (FAILED(g_d3d->CreateTexture(h.levels[first].width, h.levels[first].height, levels - first, 0,
+										get_cooked_format(h.format), D3DPOOL_MANAGED, &texture, 0)))
+			return false;
+
+		std::vector<byte> data;
+		for (unsigned level = first; level < levels; ++level)
+		{
+			const cooker::level_info& l = h.levels[level];
+			const unsigned pitch = cooker::row_pitch(format, l.width);
+			const unsigned rows = cooker::num_rows(format, l.height);
+
+			D3DLOCKED_RECT dst;
+			if (FAILED(texture->LockRect(level - first, &dst, 0, 0)))
+			{
+				texture->Release();
+				return false;
+			}
+
+			D3DLOCKED_RECT src;
+			if (m_texture && level >= m_stream.resident &&
+				SUCCEEDED(m_texture->LockRect(level - m_stream.resident, &src, 0, D3DLOCK_READONLY)))
+			{
+				for (unsigned row = 0; row < rows; ++row)
+					memcpy((char*)dst.pBits + row * dst.Pitch, (const char*)src.pBits + row * src.Pitch, pitch);
+				m_texture->UnlockRect(level - m_stream.resident);
+			}
+			else
+			{
+				data.resize(l.size);
+				m_cooked->position(l.offset);
+				m_cooked->read(&data[0], l.size);
+				for (unsigned row = 0; row < rows; ++row)
+					memcpy((char*)dst.pBits + row * dst.Pitch, &data[row * pitch], pitch);
+			}
+
+			texture->UnlockRect(level - first);
+		}
+
+		SAFE_RELEASE(m_texture);
+		m_texture = texture;
+		V(m_texture->GetLevelDesc(0, &m_desc));
+		m_stream.resident = first;
+		return true;
+	}
+
+	void texture_d3d9::request_detail(float screen_pixels)
+	{
+		if (m_cooked && screen_pixels > m_stream.screen_pixels)
+			m_stream.screen_pixels = screen_pixels;
+	}
+
 	texture_d3d9::texture_d3d9(const std::string& filename)
 		: m_texture(0),
 		m_filename(filename)
@@ -138,6 +407,32 @@ namespace render
 		createTextureFromFile(m_filename);
 	}
 
+	managed_texture_d3d9::managed_texture_d3d9(unsigned size, unsigned levels, const std::string& name)
+	{
+		m_texture = 0;
+		m_filename = name;
+		m_usage = DefaultUsage;
+		m_format = A8R8G8B8;
+		m_type = Texture;
+		m_width = size;
+		m_height = size;
+
+		V(g_d3d->CreateTexture(size, size, levels, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &m_texture, 0));
+		V(m_texture->GetLevelDesc(0, &m_desc));
+
+		// free space stays transparent
+		for (DWORD level = 0; level < m_texture->GetLevelCount(); ++level)
+		{
+			D3DSURFACE_DESC desc;
+			D3DLOCKED_RECT locked;
+			V(m_texture->GetLevelDesc(level, &desc));
+			V(m_texture->LockRect(level, &locked, 0, 0));
+			for (UINT y = 0; y < desc.Height; ++y)
+				memset((char*)locked.pBits + y * locked.Pitch, 0, desc.Width * 4);
+			m_texture->UnlockRect(level);
+		}
+	}
+
 	IDirect3DTexture9 * texture_d3d9::get_dx_texture()
 	{
 		return m_texture;
@@ -147,6 +442,8 @@ namespace render
 	{
 		//std::string base_name = std::string("Media\\")+m_texName;
 		//base::lmsg << "deleting texture.";
+		if (m_cooked)
+			get_streamer().remove(this);
 		SAFE_RELEASE(m_texture);
 	}
 
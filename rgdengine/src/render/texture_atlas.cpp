@@ -0,0 +1,171 @@
+#include "precompiled.h"
+
+#include <rgde/render/texture_atlas.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include "texture_impl.h"
+#include "../base/exception.h"
+
+namespace render
+{
+	namespace
+	{
+		RECT make_rect(unsigned x, unsigned y, unsigned w, unsigned h)
+		{
+			RECT r = {(LONG)x, (LONG)y, (LONG)(x + w), (LONG)(y + h)};
+			return r;
+		}
+
+		/// part of source surface stretched into part of page surface
+		bool copy(IDirect3DSurface9* dst, const RECT& dst_rect, IDirect3DSurface9* src, const RECT& src_rect)
+		{
+			return SUCCEEDED(D3DXLoadSurfaceFromSurface(dst, 0, &dst_rect, src, 0, &src_rect, D3DX_FILTER_POINT, 0));
+		}
+
+		/// mip levels whose texels don't reach neighbour images through padding
+		unsigned page_levels(unsigned padding)
+		{
+			unsigned levels = 1;
+			for (unsigned p = padding; p > 1; p >>= 1)
+				++levels;
+			return levels;
+		}
+	}
+
+	texture_atlas::texture_atlas(unsigned page_size, unsigned padding)
+		: m_page_size(page_size)
+		, m_padding(padding)
+		, m_version(0)
+	{
+	}
+
+	bool texture_atlas::add(const texture_ptr& source)
+	{
+		const bool added = insert(source);
+		update_pages();
+		return added;
+	}
+
+	unsigned texture_atlas::add(const std::vector<texture_ptr>& sources)
+	{
+		std::vector<std::pair<unsigned, unsigned> > sizes(sources.size());
+		std::vector<unsigned> order(sources.size());
+		for (size_t i = 0; i < sources.size(); ++i)
+		{
+			sizes[i] = sources[i] ? std::make_pair((unsigned)sources[i]->width(), (unsigned)sources[i]->get_height())
+								  : std::make_pair(0u, 0u);
+			order[i] = (unsigned)i;
+		}
+
+		atlas_detail::size_less less = {&sizes};
+		std::sort(order.begin(), order.end(), less);
+
+		unsigned added = 0;
+		for (size_t i = 0; i < order.size(); ++i)
+			added += insert(sources[order[i]]) ? 1 : 0;
+
+		update_pages();
+		return added;
+	}
+
+	const atlas_region* texture_atlas::find(const texture* source) const
+	{
+		regions::const_iterator it = m_regions.find(source);
+		return it == m_regions.end() ? 0 : &it->second;
+	}
+
+	bool texture_atlas::insert(const texture_ptr& source)
+	{
+		if (!source || source->type() != Texture || find(source.get()))
+			return false;
+
+		const unsigned w = source->width(), h = source->get_height();
+		const unsigned pw = w + m_padding * 2, ph = h + m_padding * 2;
+		if (0 == w || 0 == h || pw > m_page_size / 2 || ph > m_page_size / 2)
+			return false;
+
+		IDirect3DTexture9* src_texture = static_cast<texture_d3d9*>(source.get())->get_dx_texture();
+		if (!src_texture)
+			return false;
+
+		// first page with free space, new one if there is none
+		unsigned x = 0, y = 0;
+		size_t index = 0;
+		while (index < m_pages.size() && !m_pages[index].packer.insert(pw, ph, x, y))
+			++index;
+
+		if (index == m_pages.size())
+		{
+			page p;
+			p.packer.reset(m_page_size, m_page_size);
+			p.texture = texture_ptr(new managed_texture_d3d9(m_page_size, page_levels(m_padding),
+				"atlas page " + boost::lexical_cast<std::string>(index)));
+			p.dirty = false;
+			m_pages.push_back(p);
+
+			m_pages.back().packer.insert(pw, ph, x, y);
+		}
+
+		page& p = m_pages[index];
+		x += m_padding;
+		y += m_padding;
+
+		IDirect3DSurface9* src = 0;
+		IDirect3DSurface9* dst = 0;
+		V(src_texture->GetSurfaceLevel(0, &src));
+		V(static_cast<texture_d3d9*>(p.texture.get())->get_dx_texture()->GetSurfaceLevel(0, &dst));
+
+		// image, then its edges and corners stretched over padding
+		const unsigned pad = m_padding;
+		bool copied = copy(dst, make_rect(x, y, w, h), src, make_rect(0, 0, w, h));
+		if (copied && pad > 0)
+		{
+			copy(dst, make_rect(x - pad, y, pad, h), src, make_rect(0, 0, 1, h));
+			copy(dst, make_rect(x + w, y, pad, h), src, make_rect(w - 1, 0, 1, h));
+			copy(dst, make_rect(x, y - pad, w, pad), src, make_rect(0, 0, w, 1));
+			copy(dst, make_rect(x, y + h, w, pad), src, make_rect(0, h - 1, w, 1));
+
+			copy(dst, make_rect(x - pad, y - pad, pad, pad), src, make_rect(0, 0, 1, 1));
+			copy(dst, make_rect(x + w, y - pad, pad, pad), src, make_rect(w - 1, 0, 1, 1));
+			copy(dst, make_rect(x - pad, y + h, pad, pad), src, make_rect(0, h - 1, 1, 1));
+			copy(dst, make_rect(x + w, y + h, pad, pad), src, make_rect(w - 1, h - 1, 1, 1));
+		}
+
+		SAFE_RELEASE(src);
+		SAFE_RELEASE(dst);
+
+		if (!copied)
+		{
+			base::lerr << "texture_atlas: can't copy texture \"" << source->get_filename() << "\"";
+			return false;
+		}
+
+		atlas_region& region = m_regions[source.get()];
+		region.page = (unsigned)index;
+		region.page_texture = p.texture.get();
+		region.offset[0] = (float)x / m_page_size;
+		region.offset[1] = (float)y / m_page_size;
+		region.scale[0] = (float)w / m_page_size;
+		region.scale[1] = (float)h / m_page_size;
+
+		m_sources.push_back(source);
+		p.dirty = true;
+		++m_version;
+		return true;
+	}
+
+	void texture_atlas::update_pages()
+	{
+		for (size_t i = 0; i < m_pages.size(); ++i)
+		{
+			if (!m_pages[i].dirty)
+				continue;
+
+			IDirect3DTexture9* page_texture = static_cast<texture_d3d9*>(m_pages[i].texture.get())->get_dx_texture();
+			if (page_texture->GetLevelCount() > 1)
+				V(D3DXFilterTexture(page_texture, 0, 0, D3DX_FILTER_BOX));
+			m_pages[i].dirty = false;
+		}
+	}
+}
@@ -2,6 +2,9 @@
 
 #include <d3dx9.h>
 #include <rgde/render/texture.h>
+#include <rgde/render/texture_cooker.h>
+#include <rgde/render/texture_streaming.h>
+#include <rgde/io/file.h>
 
 namespace render
 {
@@ -13,9 +16,21 @@ namespace render
 
 		static texture_ptr		create_from_file(const std::string& filename);
 
-		void				createTextureFromFile(const std::string& filename);
+		/// loads cooked texture "<filename>.tex" if there is one and allow_cooked is set,
+		/// otherwise source file is decoded by D3DX
+		void				createTextureFromFile(const std::string& filename, bool allow_cooked = true);
 		void				create_render_texture(const math::Vec2i &size, texture_format format);
 
+		/// cooked texture with base levels loaded, false if there is none or it is broken
+		bool				create_cooked(const std::string& filename);
+		/// recreates texture with levels from first to the coarsest, levels already
+		/// resident are copied, others are read from cooked file
+		bool				load_levels(unsigned first);
+		bool				is_streamed() const {return 0 != m_cooked.get();}
+		streaming::texture_state& get_stream_state() {return m_stream;}
+
+		void				request_detail(float screen_pixels);
+
 		IDirect3DTexture9*	get_dx_texture();
 
 		texture_format		get_format()	const { return m_format; }
@@ -28,7 +43,7 @@ namespace render
 
 		bool				has_alpha()		const
 		{
-			return m_format == A32B32G32R32F || m_format == A16B16G16R16F || m_format == ARGB8 || m_format == A16B16G16R16 || m_format == A8B8G8R8 || m_format == A8R8G8B8 || m_format == DXT3;
+			return m_format == A32B32G32R32F || m_format == A16B16G16R16F || m_format == ARGB8 || m_format == A16B16G16R16 || m_format == A8B8G8R8 || m_format == A8R8G8B8 || m_format == DXT3 || m_format == DXT5;
 		}
 
 	protected:
@@ -45,5 +60,18 @@ namespace render
 		unsigned			m_width;
 		texture_format		m_format;
 		texture_type		m_type;
+
+		/// cooked file is kept open while texture is streamed
+		io::readstream_ptr	m_cooked;
+		cooker::header		m_cooked_header;
+		streaming::texture_state m_stream;
+	};
+
+	/// managed A8R8G8B8 texture cleared to transparent black, its content is
+	/// written by owner (atlas pages, glyph pages)
+	class managed_texture_d3d9 : public texture_d3d9
+	{
+	public:
+		managed_texture_d3d9(unsigned size, unsigned levels, const std::string& name);
 	};
 }
\ No newline at end of file
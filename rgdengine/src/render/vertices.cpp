@@ -235,6 +235,20 @@ namespace vertex
 		return aDecl;
 	}
 
+	const vertex_decl PackedMeshVertex::get_decl()
+	{
+		static VertexElement aDecl[]=
+		{
+			{0,  0, TypeUshort4n,	MethodDefault, UsagePosition,	0}, 
+			{0,  8, TypeShort4n,	MethodDefault, UsageNormal,		0}, 
+			{0, 16, TypeFloat16_2,	MethodDefault, UsageTexCoord,	0}, 
+			{0, 20, TypeFloat16_2,	MethodDefault, UsageTexCoord,	1}, 
+			{255,0,	TypeUnused, (DeclMethod)0, (DeclUsage)0,	0}
+		};
+
+		return aDecl;
+	}
+
 	const vertex::vertex_decl PositionSkinnedNormalColoredTextured2TangentBinorm::get_decl()
 	{
 		static vertex::VertexElement aDecl[] = {
@@ -3,9 +3,24 @@
 #include <rgde/scene/scene.h>
 
 #include <rgde/math/transform.h>
+#include <rgde/math/frustum.h>
 
 namespace scene
 {
+	/// gathers frames which fat boxes pass index query
+	struct Scene::collector
+	{
+		const live_tree					 &index;
+		std::vector<const indexed_frame*> candidates;
+
+		explicit collector(const live_tree &i) : index(i) {}
+
+		void operator()(live_tree::proxy_id id)
+		{
+			candidates.push_back(static_cast<const indexed_frame*>(index.get_data(id)));
+		}
+	};
+
 	Scene::Scene(): m_root( math::frame::create() )
 	{
 	}
@@ -41,6 +56,110 @@ namespace scene
 		//}
 	}
 
+	void Scene::inject(const math::frame_ptr& frame, float radius)
+	{
+		for (indexed_frames::iterator it = m_indexed.begin(); it != m_indexed.end(); ++it)
+		{
+			if (it->frame == frame)
+			{
+				it->radius = radius;
+				return;
+			}
+		}
+
+		indexed_frame entry;
+		entry.frame = frame;
+		entry.radius = radius;
+		entry.center = frame->world_position();
+		m_indexed.push_back(entry);
+
+		indexed_frame &f = m_indexed.back();
+		f.proxy = m_index.create(aabb::from_sphere(f.center[0], f.center[1], f.center[2], radius), &f);
+	}
+
+	void Scene::eject(const math::frame_ptr& frame)
+	{
+		for (indexed_frames::iterator it = m_indexed.begin(); it != m_indexed.end(); ++it)
+		{
+			if (it->frame == frame)
+			{
+				m_index.destroy(it->proxy);
+				m_indexed.erase(it);
+				return;
+			}
+		}
+	}
+
+	void Scene::update_index()
+	{
+		for (indexed_frames::iterator it = m_indexed.begin(); it != m_indexed.end(); ++it)
+		{
+			it->center = it->frame->world_position();
+			m_index.move(it->proxy, aabb::from_sphere(it->center[0], it->center[1], it->center[2], it->radius));
+		}
+	}
+
+	void Scene::query_sphere(const math::point3f& center, float radius, frames_list& result) const
+	{
+		collector c(m_index);
+		m_index.query_sphere(center[0], center[1], center[2], radius, c);
+
+		for (size_t i = 0; i < c.candidates.size(); ++i)
+		{
+			const indexed_frame &f = *c.candidates[i];
+			math::vec3f d = f.center - center;
+			float r = f.radius + radius;
+			if (d[0]*d[0] + d[1]*d[1] + d[2]*d[2] <= r*r)
+				result.push_back(f.frame.get());
+		}
+	}
+
+	void Scene::query_aabb(const math::aaboxf& box, frames_list& result) const
+	{
+		const math::point3f& min = box.getMin();
+		const math::point3f& max = box.getMax();
+		aabb query = {{min[0], min[1], min[2]}, {max[0], max[1], max[2]}};
+
+		collector c(m_index);
+		m_index.query_aabb(query, c);
+
+		for (size_t i = 0; i < c.candidates.size(); ++i)
+		{
+			const indexed_frame &f = *c.candidates[i];
+			if (sphere_overlaps(query, f.center[0], f.center[1], f.center[2], f.radius))
+				result.push_back(f.frame.get());
+		}
+	}
+
+	void Scene::query_ray(const math::point3f& origin, const math::vec3f& dir, float max_dist, frames_list& result) const
+	{
+		const float o[3] = {origin[0], origin[1], origin[2]};
+		const float d[3] = {dir[0], dir[1], dir[2]};
+
+		collector c(m_index);
+		m_index.query_ray(o, d, max_dist, c);
+
+		for (size_t i = 0; i < c.candidates.size(); ++i)
+		{
+			const indexed_frame &f = *c.candidates[i];
+			if (ray_hits_sphere(o, d, max_dist, f.center[0], f.center[1], f.center[2], f.radius))
+				result.push_back(f.frame.get());
+		}
+	}
+
+	void Scene::query_frustum(const math::frustum& frustum, frames_list& result) const
+	{
+		collector c(m_index);
+		m_index.query_frustum(frustum.planes(), c);
+
+		for (size_t i = 0; i < c.candidates.size(); ++i)
+		{
+			const indexed_frame &f = *c.candidates[i];
+			if (frustum.test_sphere(f.center[0], f.center[1], f.center[2], f.radius))
+				result.push_back(f.frame.get());
+		}
+	}
+
 	void Scene::to_stream(io::write_stream& wf) const
 	{
 		wf << *m_root;
@@ -0,0 +1,275 @@
+// Checks and measures texture atlas packing without device.
+// Random image sizes are packed by render::pack_atlas (all at once, sorted) and by
+// render::skyline_packer in arrival order, as runtime atlas does for single textures.
+// Every packed image must lie inside its page with padding and overlap no other.
+// Then sprites of many textures are sorted by render::sprite_batch with atlas:
+// runs must be merged by page and uv remapped into page, tiled sprites keep their texture.
+// usage: AtlasBench [images] [page size] [padding]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <map>
+#include <iostream>
+
+#include "rgde/render/sprite_batch.h"
+
+namespace
+{
+	typedef std::vector<std::pair<unsigned, unsigned> > sizes_vector;
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+
+	/// padded rectangles of images inside pages and not overlapped
+	bool checkPlaces(const sizes_vector& sizes, const std::vector<render::atlas_place>& places,
+					 unsigned num_pages, unsigned page_size, unsigned padding)
+	{
+		std::vector<std::vector<bool> > used(num_pages, std::vector<bool>(page_size * page_size));
+		for (size_t i = 0; i < sizes.size(); ++i)
+		{
+			const render::atlas_place& p = places[i];
+			if (p.page >= num_pages || p.x < padding || p.y < padding ||
+				p.x + sizes[i].first + padding > page_size || p.y + sizes[i].second + padding > page_size)
+				return false;
+
+			for (unsigned y = p.y - padding; y < p.y + sizes[i].second + padding; ++y)
+			{
+				for (unsigned x = p.x - padding; x < p.x + sizes[i].first + padding; ++x)
+				{
+					if (used[p.page][y * page_size + x])
+						return false;
+					used[p.page][y * page_size + x] = true;
+				}
+			}
+		}
+		return true;
+	}
+
+	/// images added one by one, first page with space takes image
+	unsigned packIncremental(const sizes_vector& sizes, unsigned page_size, unsigned padding,
+							 std::vector<render::atlas_place>& places)
+	{
+		std::vector<render::skyline_packer> pages;
+		places.resize(sizes.size());
+		for (size_t i = 0; i < sizes.size(); ++i)
+		{
+			const unsigned w = sizes[i].first + padding * 2, h = sizes[i].second + padding * 2;
+			render::atlas_place& p = places[i];
+			p.page = 0;
+			while (p.page < pages.size() && !pages[p.page].insert(w, h, p.x, p.y))
+				++p.page;
+
+			if (p.page == pages.size())
+			{
+				pages.push_back(render::skyline_packer(page_size, page_size));
+				pages.back().insert(w, h, p.x, p.y);
+			}
+			p.x += padding;
+			p.y += padding;
+		}
+		return (unsigned)pages.size();
+	}
+
+	double area(const sizes_vector& sizes)
+	{
+		double a = 0;
+		for (size_t i = 0; i < sizes.size(); ++i)
+			a += (double)sizes[i].first * sizes[i].second;
+		return a;
+	}
+
+	struct vec2
+	{
+		float v[2];
+		float operator[](int i) const {return v[i];}
+		float& operator[](int i) {return v[i];}
+	};
+
+	vec2 make_vec2(float x, float y)
+	{
+		vec2 r = {{x, y}};
+		return r;
+	}
+
+	struct sprite_rect
+	{
+		float x, y, w, h;
+		vec2 get_top_left() const {return make_vec2(x, y);}
+		vec2 get_top_right() const {return make_vec2(x + w, y);}
+		vec2 get_bottom_right() const {return make_vec2(x + w, y + h);}
+		vec2 get_bottom_left() const {return make_vec2(x, y + h);}
+	};
+
+	struct texture_ref
+	{
+		const void* p;
+		const void* get() const {return p;}
+	};
+
+	/// same members as render::sprite
+	struct sprite
+	{
+		sprite_rect rect;
+		vec2 pos;
+		vec2 size;
+		float spin;
+		unsigned long priority;
+		texture_ref texture;
+		unsigned color;
+	};
+
+	struct vertex
+	{
+		struct vec4
+		{
+			float v[4];
+			void set(float x, float y, float z, float w) {v[0] = x; v[1] = y; v[2] = z; v[3] = w;}
+		} position;
+		unsigned color;
+		vec2 tex;
+	};
+
+	/// regions of packed images, as render::texture_atlas::find
+	struct atlas
+	{
+		std::map<const void*, render::atlas_region> regions;
+
+		const render::atlas_region* find(const void* texture) const
+		{
+			std::map<const void*, render::atlas_region>::const_iterator it = regions.find(texture);
+			return it == regions.end() ? 0 : &it->second;
+		}
+	};
+
+	/// sprites of all textures of one page and priority share run, uv are in page
+	bool checkBatch(const sizes_vector& sizes, const std::vector<render::atlas_place>& places,
+					unsigned num_pages, unsigned page_size)
+	{
+		std::vector<char> textures(sizes.size());
+		std::vector<char> pages(num_pages);
+
+		atlas a;
+		for (size_t i = 0; i < sizes.size(); ++i)
+		{
+			render::atlas_region r = {places[i].page, &pages[places[i].page],
+				{(float)places[i].x / page_size, (float)places[i].y / page_size},
+				{(float)sizes[i].first / page_size, (float)sizes[i].second / page_size}};
+			a.regions[&textures[i]] = r;
+		}
+
+		const unsigned num_priorities = 4;
+		std::vector<sprite> sprites(sizes.size() * 4);
+		for (size_t i = 0; i < sprites.size(); ++i)
+		{
+			sprite& s = sprites[i];
+			sprite_rect quarter = {0.5f * (std::rand() % 2), 0.5f * (std::rand() % 2), 0.5f, 0.5f};
+			sprite_rect tiled = {0, 0, 4, 4};
+			s.rect = i % 100 == 0 ? tiled : quarter;
+			s.pos = make_vec2(100, 100);
+			s.size = make_vec2(10, 10);
+			s.spin = 0;
+			s.priority = std::rand() % num_priorities;
+			texture_ref t = {&textures[std::rand() % textures.size()]};
+			s.texture = t;
+			s.color = 0xFFFFFFFF;
+		}
+
+		render::sprite_batch plain, batch;
+		plain.sort(&sprites[0], sprites.size());
+		batch.sort(&sprites[0], sprites.size(), &a);
+
+		std::vector<vertex> vertices(sprites.size() * 4);
+		batch.build(&sprites[0], 0, sprites.size(), 1, 1, &vertices[0]);
+
+		size_t tiled_runs = 0;
+		for (size_t r = 0; r < batch.get_runs().size(); ++r)
+		{
+			const render::sprite_batch::run& run = batch.get_runs()[r];
+			const bool on_page = run.texture >= &pages[0] && run.texture < &pages[0] + num_pages;
+			tiled_runs += on_page ? 0 : 1;
+
+			for (unsigned slot = run.start; slot < run.start + run.count; ++slot)
+			{
+				const unsigned index = batch.get_sprite(slot);
+				const sprite& s = sprites[index];
+				const render::atlas_region* region = batch.get_region(index);
+
+				// tiled sprites are drawn from their own texture with own uv
+				if (s.rect.w > 1)
+				{
+					if (region || run.texture != s.texture.p || vertices[slot * 4 + 2].tex[0] != 4)
+						return false;
+					continue;
+				}
+
+				if (!region || region->page_texture != run.texture || region != a.find(s.texture.p))
+					return false;
+
+				const float u = region->offset[0] + (s.rect.x + s.rect.w) * region->scale[0];
+				const float v = region->offset[1] + (s.rect.y + s.rect.h) * region->scale[1];
+				if (std::fabs(vertices[slot * 4 + 2].tex[0] - u) > 1e-6f || std::fabs(vertices[slot * 4 + 2].tex[1] - v) > 1e-6f)
+					return false;
+			}
+		}
+
+		std::cout << "sprite runs:      " << plain.get_runs().size() << " without atlas, " << batch.get_runs().size()
+				  << " with atlas (" << tiled_runs << " of tiled sprites)" << std::endl;
+		return batch.get_runs().size() - tiled_runs <= num_pages * num_priorities;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int num_images = argc > 1 ? std::atoi(argv[1]) : 2000;
+	const int page_size = argc > 2 ? std::atoi(argv[2]) : 1024;
+	const int padding = argc > 3 ? std::atoi(argv[3]) : 2;
+
+	if (num_images <= 0 || page_size < 64 || padding < 0 || padding > 16)
+	{
+		std::cout << "usage: AtlasBench [images] [page size] [padding]" << std::endl;
+		return 1;
+	}
+
+	std::srand(12345);
+	sizes_vector sizes(num_images);
+	for (int i = 0; i < num_images; ++i)
+	{
+		// mostly small sprites, few large ones
+		const unsigned max_size = std::rand() % 10 == 0 ? page_size / 4 : page_size / 16;
+		sizes[i].first = 4 + std::rand() % max_size;
+		sizes[i].second = 4 + std::rand() % max_size;
+	}
+
+	const double page_area = (double)page_size * page_size;
+	const int iterations = 10;
+
+	std::vector<render::atlas_place> places;
+	unsigned num_pages = 0;
+	std::clock_t start = std::clock();
+	for (int i = 0; i < iterations; ++i)
+		num_pages = render::pack_atlas(sizes, page_size, page_size, padding, places);
+	const double pack_ms = toMs(std::clock() - start, iterations);
+	bool valid = checkPlaces(sizes, places, num_pages, page_size, padding);
+
+	std::vector<render::atlas_place> incremental;
+	unsigned incremental_pages = 0;
+	start = std::clock();
+	for (int i = 0; i < iterations; ++i)
+		incremental_pages = packIncremental(sizes, page_size, padding, incremental);
+	const double incremental_ms = toMs(std::clock() - start, iterations);
+	valid = checkPlaces(sizes, incremental, incremental_pages, page_size, padding) && valid;
+
+	std::cout << num_images << " images, " << page_size << "x" << page_size << " pages, padding " << padding << std::endl;
+	std::cout << "sorted packing:   " << num_pages << " pages, " << 100 * area(sizes) / (num_pages * page_area)
+			  << "% used, " << pack_ms << " ms" << std::endl;
+	std::cout << "one by one:       " << incremental_pages << " pages, " << 100 * area(sizes) / (incremental_pages * page_area)
+			  << "% used, " << incremental_ms << " ms" << std::endl;
+
+	valid = checkBatch(sizes, places, num_pages, page_size) && valid;
+	std::cout << "placement valid:  " << (valid ? "yes" : "no") << std::endl;
+
+	return valid ? 0 : 2;
+}
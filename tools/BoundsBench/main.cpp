@@ -0,0 +1,126 @@
+// Checks and measures bounds of vertex positions (rgde/math/bounds.h) without
+// device. Random vertices of mesh vertex size are bounded by reduction and by
+// plain loop, results must be equal, appended vertices must extend old bounds
+// the same way as bounding all of them.
+// usage: BoundsBench [vertices]
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <iostream>
+
+#include "rgde/math/bounds.h"
+
+namespace
+{
+	/// layout of vertex::MeshVertex: position, normal, tangent, binormal, tex0, tex1
+	struct vertex
+	{
+		float position[3];
+		float rest[13];
+	};
+
+	double toMs(std::clock_t ticks)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC;
+	}
+
+	int failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	void plainBounds(const std::vector<vertex>& vb, float min[3], float max[3])
+	{
+		for (int k = 0; k < 3; ++k)
+			min[k] = max[k] = vb[0].position[k];
+
+		for (size_t i = 1; i < vb.size(); ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				if (vb[i].position[k] < min[k]) min[k] = vb[i].position[k];
+				if (vb[i].position[k] > max[k]) max[k] = vb[i].position[k];
+			}
+		}
+	}
+
+	bool same(const float a[3], const float b[3])
+	{
+		return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+	}
+
+	float random(float range)
+	{
+		return (std::rand() / (float)RAND_MAX - 0.5f) * range;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int num = argc > 1 ? std::atoi(argv[1]) : 100000;
+	if (num < 2)
+	{
+		std::cout << "usage: BoundsBench [vertices]" << std::endl;
+		return 1;
+	}
+
+	std::srand(1);
+	std::vector<vertex> vb(num);
+	for (int i = 0; i < num; ++i)
+	{
+		vb[i].position[0] = random(100);
+		vb[i].position[1] = random(10) + 50;
+		vb[i].position[2] = random(1000);
+		for (int k = 0; k < 13; ++k)
+			vb[i].rest[k] = random(1e6f);	// garbage next to position must not get into bounds
+	}
+
+	float min[3], max[3], plain_min[3], plain_max[3];
+
+	// every count up to 9 covers odd and even tails of both paths
+	for (size_t count = 1; count <= 9; ++count)
+	{
+		std::vector<vertex> small(vb.begin(), vb.begin() + count);
+		math::compute_bounds(&small[0].position[0], small.size(), sizeof(vertex), min, max);
+		plainBounds(small, plain_min, plain_max);
+		check(same(min, plain_min) && same(max, plain_max), "bounds of few vertices");
+	}
+	check(!math::compute_bounds(&vb[0].position[0], 0, sizeof(vertex), min, max), "no vertices, no bounds");
+
+	// appended vertices extend bounds of old ones
+	const size_t old_count = vb.size() / 3;
+	math::compute_bounds(&vb[0].position[0], old_count, sizeof(vertex), min, max);
+	math::extend_bounds(&vb[old_count].position[0], vb.size() - old_count, sizeof(vertex), min, max);
+	plainBounds(vb, plain_min, plain_max);
+	check(same(min, plain_min) && same(max, plain_max), "appended vertices");
+
+	// tightly packed positions, stride of 3 floats
+	std::vector<float> positions;
+	for (int i = 0; i < num; ++i)
+		positions.insert(positions.end(), vb[i].position, vb[i].position + 3);
+	math::compute_bounds(&positions[0], num, 3 * sizeof(float), min, max);
+	check(same(min, plain_min) && same(max, plain_max), "packed positions");
+
+	const int runs = 100;
+	std::clock_t start = std::clock();
+	for (int r = 0; r < runs; ++r)
+		math::compute_bounds(&vb[0].position[0], vb.size(), sizeof(vertex), min, max);
+	const double reduction_ms = toMs(std::clock() - start) / runs;
+
+	start = std::clock();
+	for (int r = 0; r < runs; ++r)
+		plainBounds(vb, plain_min, plain_max);
+	const double plain_ms = toMs(std::clock() - start) / runs;
+
+	check(same(min, plain_min) && same(max, plain_max), "bounds of all vertices");
+
+	std::cout << num << " vertices: reduction " << reduction_ms << " ms, plain loop " << plain_ms << " ms" << std::endl;
+	std::cout << "checks: " << (failures ? "failed" : "passed") << std::endl;
+	return failures ? 2 : 0;
+}
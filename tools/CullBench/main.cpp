@@ -0,0 +1,137 @@
+// Measures frustum culling stage of render_manager::renderScene without device:
+// per object test (as math::frustum::test_sphere) against batched SoA kernels
+// from rgde/math/culling.h. Engine independent, runs anywhere.
+// usage: CullBench [objects] [iterations]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <iostream>
+
+#include "rgde/math/culling.h"
+
+namespace
+{
+	struct sphere
+	{
+		float x, y, z, r;
+	};
+
+	/// camera in origin looking along +z, planes pointing inside (as math::frustum)
+	void makePlanes(math::frustum_planes& planes, float fovy, float aspect, float zn, float zf)
+	{
+		const float ty = std::tan(fovy / 2);
+		const float tx = ty * aspect;
+
+		const float src[6][4] = {
+			{-1,  0, tx, 0},	// right
+			{ 1,  0, tx, 0},	// left
+			{ 0,  1, ty, 0},	// bottom
+			{ 0, -1, ty, 0},	// top
+			{ 0,  0, -1, zf},	// far
+			{ 0,  0,  1, -zn}	// near
+		};
+
+		for (int p = 0; p < 6; ++p)
+		{
+			float len = std::sqrt(src[p][0]*src[p][0] + src[p][1]*src[p][1] + src[p][2]*src[p][2]);
+			for (int c = 0; c < 4; ++c)
+				planes[p][c] = src[p][c] / len;
+		}
+	}
+
+	bool testSphere(const math::frustum_planes& planes, const sphere& s)
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			if (planes[i][0] * s.x + planes[i][1] * s.y + planes[i][2] * s.z + planes[i][3] <= -s.r)
+				return false;
+		}
+		return true;
+	}
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * std::rand() / RAND_MAX;
+	}
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int num_objects = argc > 1 ? std::atoi(argv[1]) : 100000;
+	const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+
+	if (num_objects <= 0 || iterations <= 0)
+	{
+		std::cout << "usage: CullBench [objects] [iterations]" << std::endl;
+		return 1;
+	}
+
+	math::frustum_planes planes;
+	makePlanes(planes, 1.0f, 4.0f / 3.0f, 1.0f, 500.0f);
+
+	// scene around camera, roughly 1/6 of objects is visible
+	std::srand(12345);
+	std::vector<sphere> objects(num_objects);
+	math::sphere_soa spheres;
+	math::box_soa boxes;
+	spheres.reserve(num_objects);
+	boxes.reserve(num_objects);
+	for (int i = 0; i < num_objects; ++i)
+	{
+		sphere& s = objects[i];
+		s.x = random(-500, 500);
+		s.y = random(-50, 50);
+		s.z = random(-500, 500);
+		s.r = random(0.5f, 5.0f);
+		spheres.add(s.x, s.y, s.z, s.r);
+		boxes.add(s.x, s.y, s.z, s.r, s.r, s.r);
+	}
+
+	std::vector<unsigned char> visible(num_objects);
+
+	unsigned scalar_visible = 0;
+	std::clock_t start = std::clock();
+	for (int it = 0; it < iterations; ++it)
+	{
+		scalar_visible = 0;
+		for (int i = 0; i < num_objects; ++i)
+		{
+			visible[i] = testSphere(planes, objects[i]) ? 1 : 0;
+			scalar_visible += visible[i];
+		}
+	}
+	const double scalar_ms = toMs(std::clock() - start, iterations);
+
+	unsigned soa_visible = 0;
+	start = std::clock();
+	for (int it = 0; it < iterations; ++it)
+		soa_visible = math::cull_spheres(planes, spheres, visible);
+	const double soa_ms = toMs(std::clock() - start, iterations);
+
+	unsigned box_visible = 0;
+	start = std::clock();
+	for (int it = 0; it < iterations; ++it)
+		box_visible = math::cull_boxes(planes, boxes, visible);
+	const double box_ms = toMs(std::clock() - start, iterations);
+
+#ifdef RGDE_CULLING_SSE
+	const char* kernel = "sse, 4 objects per iteration";
+#else
+	const char* kernel = "scalar fallback";
+#endif
+
+	std::cout << num_objects << " objects, " << iterations << " iterations, kernel: " << kernel << std::endl;
+	std::cout << "per object spheres: " << scalar_ms << " ms, " << scalar_visible << " visible" << std::endl;
+	std::cout << "batched spheres:    " << soa_ms << " ms, " << soa_visible << " visible" << std::endl;
+	std::cout << "batched boxes:      " << box_ms << " ms, " << box_visible << " visible" << std::endl;
+	if (soa_ms > 0)
+		std::cout << "speedup: " << scalar_ms / soa_ms << "x" << std::endl;
+
+	return scalar_visible == soa_visible ? 0 : 2;
+}
@@ -0,0 +1,167 @@
+// Checks and measures render::instance_batcher without device: sorted render
+// queue batches are split into instanced groups by null backend, which counts
+// draw calls and verifies per instance stream against object transforms.
+// usage: InstanceBench [objects] [geometries] [materials] [iterations]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <iostream>
+
+#include "rgde/render/instancing.h"
+
+namespace
+{
+	struct object
+	{
+		float world[16];
+		const void* geometry;
+		const void* material;
+	};
+
+	class null_backend : public render::render_queue::backend, public render::instance_batcher::backend
+	{
+	public:
+		null_backend(render::instance_batcher& batcher)
+			: batcher(batcher), num_draws(0), num_instances(0), valid(true)
+		{
+		}
+
+		void draw_batch(const render::render_queue::item* items, size_t count)
+		{
+			batcher.submit(items, count, *this);
+		}
+
+		void draw_instanced(const render::instance_batcher::group& g, const render::render_queue::item* items,
+							const render::instance_data* instances)
+		{
+			++num_draws;
+			num_instances += g.count;
+
+			for (size_t i = 0; i < g.count; ++i)
+			{
+				const object& o = *static_cast<const object*>(items[i].data);
+				valid = valid && o.geometry == g.geometry && o.material == g.state;
+
+				// world position of some local point must be the same as with full matrix
+				const float p[3] = {1.5f, -2.0f, 0.5f};
+				for (int j = 0; j < 3; ++j)
+				{
+					const float* row = instances[i].rows[j];
+					float by_stream = p[0] * row[0] + p[1] * row[1] + p[2] * row[2] + row[3];
+					float by_matrix = p[0] * o.world[j] + p[1] * o.world[4 + j] + p[2] * o.world[8 + j] + o.world[12 + j];
+					valid = valid && std::fabs(by_stream - by_matrix) < 1e-4f;
+				}
+			}
+		}
+
+		void draw_single(const render::render_queue::item&)
+		{
+			++num_draws;
+		}
+
+		render::instance_batcher& batcher;
+		size_t num_draws;
+		size_t num_instances;
+		bool valid;
+	};
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * std::rand() / RAND_MAX;
+	}
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+
+	/// rotation around y, uniform scale and translation in render device layout
+	void makeWorld(float* m)
+	{
+		const float a = random(0, 6.28f), s = random(0.5f, 2.0f);
+		const float c = std::cos(a) * s, si = std::sin(a) * s;
+		const float src[16] = {
+			 c, 0, -si, 0,
+			 0, s,   0, 0,
+			si, 0,   c, 0,
+			random(-500, 500), random(-50, 50), random(-500, 500), 1
+		};
+		for (int i = 0; i < 16; ++i)
+			m[i] = src[i];
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int num_objects = argc > 1 ? std::atoi(argv[1]) : 10000;
+	const int num_geometries = argc > 2 ? std::atoi(argv[2]) : 20;
+	const int num_materials = argc > 3 ? std::atoi(argv[3]) : 4;
+	const int iterations = argc > 4 ? std::atoi(argv[4]) : 100;
+
+	if (num_objects <= 0 || num_geometries <= 0 || num_materials <= 0 || iterations <= 0)
+	{
+		std::cout << "usage: InstanceBench [objects] [geometries] [materials] [iterations]" << std::endl;
+		return 1;
+	}
+
+	std::srand(12345);
+	std::vector<char> geometries(num_geometries);
+	std::vector<char> materials(num_materials);
+	std::vector<object> objects(num_objects);
+	for (int i = 0; i < num_objects; ++i)
+	{
+		object& o = objects[i];
+		makeWorld(o.world);
+		// every 10th object is unique (not instanceable)
+		o.geometry = std::rand() % 10 == 0 ? 0 : &geometries[std::rand() % num_geometries];
+		o.material = &materials[std::rand() % num_materials];
+	}
+
+	const float cx = 0, cy = 10, cz = -100;
+
+	render::render_queue queue;
+	queue.reserve(num_objects);
+	render::instance_batcher batcher;
+
+	size_t num_draws = 0, num_instances = 0;
+	bool valid = true;
+	double build_ms = 0, submit_ms = 0;
+	for (int it = 0; it < iterations; ++it)
+	{
+		std::clock_t start = std::clock();
+		queue.clear();
+		for (int i = 0; i < num_objects; ++i)
+		{
+			const object& o = objects[i];
+			float dx = o.world[12] - cx, dy = o.world[13] - cy, dz = o.world[14] - cz;
+			queue.add(render::render_queue::solid, 10, &materials[0], o.material, dx*dx + dy*dy + dz*dz, &o,
+					  o.geometry, o.world);
+		}
+		queue.sort();
+		std::clock_t built = std::clock();
+
+		batcher.reset_statistics();
+		null_backend backend(batcher);
+		queue.execute(backend);
+
+		build_ms += toMs(built - start, iterations);
+		submit_ms += toMs(std::clock() - built, iterations);
+
+		num_draws = backend.num_draws;
+		num_instances = backend.num_instances;
+		valid = valid && backend.valid;
+	}
+
+	const size_t drawn = batcher.get_num_instances() + batcher.get_num_single_draws();
+
+	std::cout << num_objects << " objects, " << num_geometries << " geometries, " << num_materials
+			  << " materials, " << iterations << " iterations" << std::endl;
+	std::cout << "queue build:   " << build_ms << " ms" << std::endl;
+	std::cout << "batch submit:  " << submit_ms << " ms" << std::endl;
+	std::cout << "draw calls:    " << num_draws << " (" << batcher.get_num_instanced_draws() << " instanced with "
+			  << num_instances << " instances, " << batcher.get_num_single_draws() << " single)" << std::endl;
+	std::cout << "streams valid: " << (valid ? "yes" : "no") << std::endl;
+
+	return valid && drawn == (size_t)num_objects ? 0 : 2;
+}
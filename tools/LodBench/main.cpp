@@ -0,0 +1,248 @@
+// Checks and measures offline simplifier and detail level selection without device.
+// Sphere with texture seam and noisy open grid are simplified to several levels,
+// result is checked for valid indices, degenerate triangles and distance to surface.
+// Selection is run for objects moving with jitter near level thresholds,
+// number of level switches with and without hysteresis is compared.
+// usage: LodBench [sphere segments] [objects] [frames]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <iostream>
+
+#include "rgde/render/lod.h"
+#include "rgde/render/mesh_simplifier.h"
+
+namespace
+{
+	struct vertex
+	{
+		float position[3];
+		float tex[2];
+	};
+
+	typedef unsigned short index;
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * std::rand() / RAND_MAX;
+	}
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+
+	/// uv sphere of unit radius, first and last column share positions (texture seam)
+	void makeSphere(int segments, std::vector<vertex>& vb, std::vector<index>& ib)
+	{
+		const int rings = segments / 2;
+		for (int r = 0; r <= rings; ++r)
+		{
+			const float theta = 3.14159265f * r / rings;
+			for (int s = 0; s <= segments; ++s)
+			{
+				const float phi = 2 * 3.14159265f * (s % segments) / segments;
+				vertex v = {{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)},
+							{(float)s / segments, (float)r / rings}};
+				vb.push_back(v);
+			}
+		}
+
+		for (int r = 0; r < rings; ++r)
+		{
+			for (int s = 0; s < segments; ++s)
+			{
+				const index a = (index)(r * (segments + 1) + s), b = (index)(a + segments + 1);
+				if (r > 0)
+				{
+					ib.push_back(a); ib.push_back((index)(a + 1)); ib.push_back(b);
+				}
+				if (r < rings - 1)
+				{
+					ib.push_back((index)(a + 1)); ib.push_back((index)(b + 1)); ib.push_back(b);
+				}
+			}
+		}
+	}
+
+	/// open height field with small noise, bounding radius is about 0.71 * size
+	void makeGrid(int size, std::vector<vertex>& vb, std::vector<index>& ib)
+	{
+		for (int y = 0; y <= size; ++y)
+		{
+			for (int x = 0; x <= size; ++x)
+			{
+				vertex v = {{(float)x, random(0, 0.05f), (float)y}, {(float)x / size, (float)y / size}};
+				vb.push_back(v);
+			}
+		}
+
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				const index a = (index)(y * (size + 1) + x), b = (index)(a + size + 1);
+				ib.push_back(a); ib.push_back(b); ib.push_back((index)(a + 1));
+				ib.push_back((index)(a + 1)); ib.push_back(b); ib.push_back((index)(b + 1));
+			}
+		}
+	}
+
+	bool validTriangles(const std::vector<vertex>& vb, const std::vector<index>& ib)
+	{
+		for (size_t t = 0; t < ib.size(); t += 3)
+		{
+			if (ib[t] >= vb.size() || ib[t + 1] >= vb.size() || ib[t + 2] >= vb.size())
+				return false;
+
+			const float* p0 = vb[ib[t]].position;
+			const float* p1 = vb[ib[t + 1]].position;
+			const float* p2 = vb[ib[t + 2]].position;
+			const double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			const double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+			const double n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+			if (n[0]*n[0] + n[1]*n[1] + n[2]*n[2] <= 0)
+				return false;
+		}
+		return true;
+	}
+
+	/// max distance of triangle centers from unit sphere
+	double sphereError(const std::vector<vertex>& vb, const std::vector<index>& ib)
+	{
+		double max_error = 0;
+		for (size_t t = 0; t < ib.size(); t += 3)
+		{
+			double c[3] = {0, 0, 0};
+			for (int k = 0; k < 3; ++k)
+				for (int i = 0; i < 3; ++i)
+					c[i] += vb[ib[t + k]].position[i] / 3;
+
+			const double e = 1 - std::sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
+			if (e > max_error)
+				max_error = e;
+		}
+		return max_error;
+	}
+
+	bool checkLevels(const char* name, const std::vector<vertex>& vb, const std::vector<index>& ib, float radius, bool sphere)
+	{
+		bool valid = true;
+		std::cout << name << ": " << ib.size() / 3 << " triangles" << std::endl;
+
+		for (unsigned level = 1; level <= 4; ++level)
+		{
+			std::vector<index> lod_ib;
+			std::clock_t start = std::clock();
+			const double max_distance = render::lod::default_max_distance(radius, level);
+			render::simplifier::simplify(vb, ib, (ib.size() / 3) >> level, lod_ib, max_distance * max_distance);
+			const double ms = toMs(std::clock() - start, 1);
+
+			std::vector<vertex> lod_vb(vb);
+			render::simplifier::compact(lod_vb, lod_ib);
+
+			const bool level_valid = validTriangles(lod_vb, lod_ib) && lod_ib.size() < ib.size();
+			valid = valid && level_valid;
+
+			std::cout << "  level " << level << ": " << lod_ib.size() / 3 << " triangles, " << lod_vb.size()
+					  << " vertices, " << ms << " ms";
+			if (sphere)
+				std::cout << ", max error " << sphereError(lod_vb, lod_ib);
+			std::cout << (level_valid ? "" : " INVALID") << std::endl;
+		}
+		return valid;
+	}
+
+	struct object
+	{
+		float distance;
+		float speed;
+		unsigned level;
+		unsigned switches;
+	};
+
+	/// moves objects back and forth around level thresholds, returns level switches
+	unsigned long countSwitches(const render::lod::selector& selector, std::vector<object>& objects, int frames,
+								unsigned long& full_tris, unsigned long& drawn_tris, unsigned tris)
+	{
+		unsigned long switches = 0;
+		const float proj_scale = 1 / std::tan(0.5f);
+
+		std::srand(54321);
+		for (size_t i = 0; i < objects.size(); ++i)
+		{
+			objects[i].distance = random(2, 200);
+			objects[i].speed = random(-0.2f, 0.2f);
+			objects[i].level = 0;
+		}
+
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (size_t i = 0; i < objects.size(); ++i)
+			{
+				object& o = objects[i];
+				// slow motion with small camera shake
+				o.distance = (o.distance + o.speed) * random(0.98f, 1.02f);
+				if (o.distance < 2 || o.distance > 200)
+					o.speed = -o.speed;
+
+				const unsigned level = selector.select(render::lod::projected_size(1.0f, o.distance, proj_scale), o.level);
+				switches += level != o.level ? 1 : 0;
+				o.level = level;
+
+				full_tris += tris;
+				drawn_tris += tris >> level;
+			}
+		}
+		return switches;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int segments = argc > 1 ? std::atoi(argv[1]) : 64;
+	const int num_objects = argc > 2 ? std::atoi(argv[2]) : 1000;
+	const int frames = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+	if (segments < 4 || segments > 180 || num_objects <= 0 || frames <= 0)
+	{
+		std::cout << "usage: LodBench [sphere segments (4..180)] [objects] [frames]" << std::endl;
+		return 1;
+	}
+
+	std::srand(12345);
+	std::vector<vertex> vb;
+	std::vector<index> ib;
+	makeSphere(segments, vb, ib);
+	bool valid = checkLevels("sphere", vb, ib, 1.0f, true);
+
+	vb.clear();
+	ib.clear();
+	makeGrid(segments, vb, ib);
+	valid = checkLevels("grid", vb, ib, segments * 0.71f, false) && valid;
+
+	render::lod::selector smooth(0.1f), sharp(0.0f);
+	for (unsigned level = 1; level <= 4; ++level)
+	{
+		smooth.add_level(render::lod::default_threshold(level));
+		sharp.add_level(render::lod::default_threshold(level));
+	}
+
+	std::vector<object> objects(num_objects);
+	unsigned long full_tris = 0, drawn_tris = 0, unused_full = 0, unused_drawn = 0;
+	const unsigned tris = (unsigned)segments * segments;
+
+	std::clock_t start = std::clock();
+	const unsigned long smooth_switches = countSwitches(smooth, objects, frames, full_tris, drawn_tris, tris);
+	const double select_ms = toMs(std::clock() - start, frames);
+	const unsigned long sharp_switches = countSwitches(sharp, objects, frames, unused_full, unused_drawn, tris);
+
+	std::cout << num_objects << " objects, " << frames << " frames" << std::endl;
+	std::cout << "selection:        " << select_ms << " ms per frame" << std::endl;
+	std::cout << "level switches:   " << smooth_switches << " with hysteresis, " << sharp_switches << " without" << std::endl;
+	std::cout << "triangles saved:  " << 100.0 * (full_tris - drawn_tris) / full_tris << "%" << std::endl;
+	std::cout << "levels valid:     " << (valid ? "yes" : "no") << std::endl;
+
+	return valid && smooth_switches < sharp_switches ? 0 : 2;
+}
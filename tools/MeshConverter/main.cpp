@@ -1,71 +1,112 @@
-#include <rgde/engine.h>
-#include <io.h>
+// Converts xml meshes into binary mesh caches offline (see rgde/render/mesh_converter.h),
+// only device independent part of engine is compiled in.
+#include "precompiled.h"
 
-void searchFiles(std::vector<std::string>& vFileNames, const std::string mask = "*.xml", const std::string& path = "")
+#include <rgde/render/mesh_converter.h>
+
+#include <boost/filesystem/operations.hpp>
+
+typedef vertex::MeshVertex Vertex;
+typedef unsigned short ushort;
+
+namespace
 {
-	_finddata_t c_file;
-	intptr_t hFile;
+	/// packs vertices in bbox and prints decoding errors.
+	/// returns false if they are above limits
+	bool checkPacking(const std::vector<Vertex>& vb, const math::aaboxf& bbox)
+	{
+		const render::packing::error e = render::mesh_converter::measure_packing(vb, bbox);
+
+		std::cout << "packed: " << vb.size() * sizeof(Vertex) << " -> " << vb.size() * sizeof(vertex::PackedMeshVertex)
+				  << " bytes, max error: position " << e.position << ", normal " << e.normal
+				  << " deg, tangent " << e.tangent << " deg, binormal " << e.binormal << " deg, uv " << e.tex << std::endl;
+
+		return render::mesh_converter::is_packing_acceptable(e, bbox);
+	}
 
-	// Find first .xml file in current directory 
-	if( (hFile = _findfirst( (path + mask).c_str(), &c_file )) == -1L )
+	void searchFiles(std::vector<std::string>& vFileNames, const std::string& ext = "xml", const std::string& path = ".")
 	{
-		//printf( "No *.bmp files in current directory!\n" );
+		namespace fs = boost::filesystem;
+
+		fs::directory_iterator end;
+		for (fs::directory_iterator it(path); it != end; ++it)
+		{
+			if (fs::is_directory(it->status()))
+				continue;
+
+			std::string file_name = it->path().leaf();
+			if (io::helpers::get_file_ext(file_name) == ext)
+				vFileNames.push_back(file_name);
+		}
 	}
-	else{
-		std::string file_name(c_file.name);
-		vFileNames.push_back(file_name);
 
-		while( _findnext( hFile, &c_file ) == 0 ){
-			std::string file_name(c_file.name);
-			vFileNames.push_back(file_name);
+	/// writes binary mesh cache in the same format render::indexed_geometry::load expects,
+	/// mesh is optimized the same way as on load. pack - vertices are packed 
+	/// if decoding errors of mesh are within limits
+	bool convertMesh(const std::string& strXmlFile, unsigned num_lods, bool pack)
+	{
+		io::read_file in(strXmlFile);
+		if (!in.is_valid() || 0 == in.size())
+			return false;
+
+		std::vector<byte> xml_data(in.size());
+		in.read(&xml_data[0], (unsigned)xml_data.size());
+
+		const render::mesh_cache::hash_id source_hash = render::mesh_cache::calc_source_hash(xml_data);
+
+		std::vector<Vertex> vb;
+		std::vector<ushort> ib;
+		math::aaboxf bbox;
+		math::spheref bsphere;
+		const render::optimizer::report r = render::mesh_converter::parse(xml_data, vb, ib, bbox, bsphere);
+
+		if (vb.empty())
+			return false;
+
+		std::cout << "triangles: " << r.triangles << ", vertices: " << r.vertices_before << " -> " << r.vertices_after
+				  << ", ACMR: " << r.acmr_before << " -> " << r.acmr_after << std::endl;
+
+		if (pack && !checkPacking(vb, bbox))
+		{
+			std::cout << "error is above limits, mesh is not packed" << std::endl;
+			pack = false;
 		}
 
-		size_t size = vFileNames.size();
+		const std::string cache_filename = render::mesh_cache::get_cache_filename(strXmlFile);
+		if (!(pack ? render::mesh_converter::save_packed(cache_filename, source_hash, vb, ib, bbox, bsphere)
+				   : render::mesh_converter::save(cache_filename, source_hash, vb, ib, bbox, bsphere)))
+			return false;
 
-		_findclose( hFile );
+		if (num_lods > 0)
+			std::cout << "levels: " << render::mesh_converter::generate_lods(strXmlFile, source_hash, vb, ib, bbox, bsphere, num_lods, pack) << std::endl;
+
+		return true;
 	}
 }
 
-template<typename IndexType, typename VertexType>
-void saveGeomData(std::string strFileName, std::vector<VertexType>& vb, std::vector<IndexType>& ib)
+// usage: MeshConverter [dir] [lods] [pack] - converts all xml meshes in dir (current by default)
+// and generates up to lods simplified detail levels for each (none by default).
+// pack = 1 stores vertices of meshes in compressed layout (vertex::PackedMeshVertex)
+// when decoding error is within limits. Packed meshes are drawn by decoding vertex
+// shader without lighting, so only meshes of fixed function techniques should be packed
+int main(int argc, char* argv[])
 {
-	std::ofstream out(strFileName.c_str(), std::ios::binary);
-	uint vsize = sizeof(VertexType);
-	uint vbsize = (uint)(vb.size() * vsize);
-	out.write((char*)&vsize, sizeof(uint));		//Vertex size
-	out.write((char*)&vbsize, sizeof(uint));	//Vertex Data Size
-	out.write((char*)&(vb[0]), vbsize);				//Vertex Data
-
-	uint isize = sizeof(IndexType);
-	uint ibsize = (uint)(ib.size()*isize);
-
-	out.write((char*)&isize, sizeof(unsigned int));	//Index size
-	out.write((char*)&ibsize, sizeof(unsigned int));	//Index data size
-	out.write((char*)&(ib[0]), ibsize);				//Index sata
-}
-
-typedef vertex::MeshVertex Vertex;
-typedef unsigned short ushort;
-
+	std::string path = argc > 1 ? argv[1] : ".";
+	const unsigned num_lods = argc > 2 ? (unsigned)atoi(argv[2]) : 0;
+	const bool pack = argc > 3 && 0 != atoi(argv[3]);
 
-// The application's entry point
-int __stdcall WinMain( HINSTANCE hInst, HINSTANCE, LPSTR, int )
-{
 	std::vector<std::string> vMeshNames;
-
-	searchFiles(vMeshNames);
-	io::ScopePathChange path(".\\");
+	searchFiles(vMeshNames, "xml", path);
 
 	for(unsigned int i = 0; i < vMeshNames.size(); ++i)
 	{
-		std::string strXmlFile = vMeshNames[i];
+		std::string strXmlFile = path + "/" + vMeshNames[i];
 
-		std::vector<Vertex> vb;
-		std::vector<ushort> ib;
-
-		render::loadGeomDataFromXmlFile(strXmlFile, vb, ib);
-		saveGeomData(strXmlFile + ".mesh", vb, ib);
+		if (convertMesh(strXmlFile, num_lods, pack))
+			std::cout << "converted: " << strXmlFile << std::endl;
+		else
+			std::cout << "skipped: " << strXmlFile << std::endl;
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,212 @@
+// Checks and measures mesh optimizer without device. Generated grid, sphere with
+// duplicated vertices and sphere with shuffled triangles are optimized, result is
+// checked to have the same triangles with the same winding, and ACMR before and
+// after every stage is printed.
+// usage: MeshOptBench [grid size] [sphere segments]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "rgde/render/mesh_optimizer.h"
+
+namespace
+{
+	struct vertex
+	{
+		float position[3];
+		float tex[2];
+	};
+
+	typedef unsigned short index_type;
+
+	double toMs(std::clock_t ticks)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC;
+	}
+
+	int failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	/// grid of size x size quads, rows of triangles as geom_generator emits them
+	void makeGrid(int size, std::vector<vertex>& vb, std::vector<index_type>& ib)
+	{
+		for (int x = 0; x <= size; ++x)
+		{
+			for (int z = 0; z <= size; ++z)
+			{
+				vertex v = {{(float)x, 0, (float)z}, {(float)x / size, (float)z / size}};
+				vb.push_back(v);
+
+				if (x < size && z < size)
+				{
+					const index_type i = (index_type)(x * (size + 1) + z);
+					const index_type quad[6] = {i, (index_type)(i + 1), (index_type)(i + 2 + size), (index_type)(i + 2 + size), (index_type)(i + 1 + size), i};
+					ib.insert(ib.end(), quad, quad + 6);
+				}
+			}
+		}
+	}
+
+	/// uv sphere, every triangle has its own copy of vertices
+	void makeSphere(int segments, std::vector<vertex>& vb, std::vector<index_type>& ib)
+	{
+		const int rings = segments / 2;
+		std::vector<vertex> grid;
+		for (int r = 0; r <= rings; ++r)
+		{
+			const float theta = 3.1415926f * r / rings;
+			for (int s = 0; s <= segments; ++s)
+			{
+				const float phi = 2 * 3.1415926f * s / segments;
+				vertex v = {{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)},
+							{(float)s / segments, (float)r / rings}};
+				grid.push_back(v);
+			}
+		}
+
+		for (int r = 0; r < rings; ++r)
+		{
+			for (int s = 0; s < segments; ++s)
+			{
+				const int i = r * (segments + 1) + s;
+				const int quad[6] = {i, i + 1, i + segments + 2, i + segments + 2, i + segments + 1, i};
+				for (int k = 0; k < 6; ++k)
+				{
+					ib.push_back((index_type)vb.size());
+					vb.push_back(grid[quad[k]]);
+				}
+			}
+		}
+	}
+
+	struct triangle
+	{
+		float p[9];
+
+		bool operator<(const triangle& t) const {return std::lexicographical_compare(p, p + 9, t.p, t.p + 9);}
+		bool operator==(const triangle& t) const {return std::equal(p, p + 9, t.p);}
+	};
+
+	/// triangles by positions, rotated to start from least vertex so winding is kept
+	/// and degenerate ones are skipped
+	std::vector<triangle> triangles(const std::vector<vertex>& vb, const std::vector<index_type>& ib)
+	{
+		std::vector<triangle> result;
+		for (size_t t = 0; t + 2 < ib.size(); t += 3)
+		{
+			const float* p[3] = {vb[ib[t]].position, vb[ib[t + 1]].position, vb[ib[t + 2]].position};
+			if (std::equal(p[0], p[0] + 3, p[1]) || std::equal(p[1], p[1] + 3, p[2]) || std::equal(p[2], p[2] + 3, p[0]))
+				continue;
+
+			int first = 0;
+			for (int k = 1; k < 3; ++k)
+				if (std::lexicographical_compare(p[k], p[k] + 3, p[first], p[first] + 3))
+					first = k;
+
+			triangle tri;
+			for (int k = 0; k < 3; ++k)
+				std::copy(p[(first + k) % 3], p[(first + k) % 3] + 3, tri.p + k * 3);
+			result.push_back(tri);
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	bool validIndices(const std::vector<vertex>& vb, const std::vector<index_type>& ib)
+	{
+		for (size_t i = 0; i < ib.size(); ++i)
+			if (ib[i] >= vb.size())
+				return false;
+		return true;
+	}
+
+	void run(const char* name, std::vector<vertex> vb, std::vector<index_type> ib)
+	{
+		const std::vector<triangle> source = triangles(vb, ib);
+		const size_t source_vertices = vb.size();
+		const float source_acmr = render::optimizer::acmr(ib, vb.size());
+
+		std::clock_t start = std::clock();
+		render::optimizer::weld_vertices(vb, ib);
+		const double weld_ms = toMs(std::clock() - start);
+
+		start = std::clock();
+		render::optimizer::optimize_vertex_cache(ib, vb.size());
+		const double cache_ms = toMs(std::clock() - start);
+		const float cache_acmr = render::optimizer::acmr(ib, vb.size());
+
+		start = std::clock();
+		render::optimizer::optimize_overdraw(ib, vb);
+		const double overdraw_ms = toMs(std::clock() - start);
+		const float overdraw_acmr = render::optimizer::acmr(ib, vb.size());
+
+		render::optimizer::optimize_vertex_fetch(vb, ib);
+
+		check(validIndices(vb, ib), "valid indices");
+		check(triangles(vb, ib) == source, "same triangles");
+		check(cache_acmr <= source_acmr, "cache order is not worse");
+		check(overdraw_acmr <= cache_acmr * render::optimizer::default_overdraw_threshold * 1.1f, "overdraw order keeps ACMR");
+
+		// first use order: every new vertex is the next one
+		bool ordered = true;
+		size_t next = 0;
+		for (size_t i = 0; i < ib.size() && ordered; ++i)
+		{
+			ordered = ib[i] <= next;
+			if (ib[i] == next)
+				++next;
+		}
+		check(ordered && next == vb.size(), "vertex fetch order");
+
+		std::cout << name << ": " << ib.size() / 3 << " triangles, vertices " << source_vertices << " -> " << vb.size() << std::endl;
+		std::cout << "  ACMR source " << source_acmr << ", cache " << cache_acmr << ", overdraw " << overdraw_acmr << std::endl;
+		std::cout << "  weld " << weld_ms << " ms, cache " << cache_ms << " ms, overdraw " << overdraw_ms << " ms" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int grid_size = argc > 1 ? std::atoi(argv[1]) : 100;
+	const int segments = argc > 2 ? std::atoi(argv[2]) : 64;
+
+	if (grid_size < 2 || segments < 4 || (grid_size + 1) * (grid_size + 1) > 65535 || segments * segments * 3 > 65535)
+	{
+		std::cout << "usage: MeshOptBench [grid size] [sphere segments]" << std::endl;
+		return 1;
+	}
+
+	std::vector<vertex> vb;
+	std::vector<index_type> ib;
+	makeGrid(grid_size, vb, ib);
+	run("grid", vb, ib);
+
+	vb.clear();
+	ib.clear();
+	makeSphere(segments, vb, ib);
+	run("sphere with copied vertices", vb, ib);
+
+	// welded sphere with triangles in random order
+	render::optimizer::weld_vertices(vb, ib);
+	render::optimizer::optimize_vertex_fetch(vb, ib);
+	std::srand(1);
+	for (size_t t = ib.size() / 3; t > 1; --t)
+	{
+		const size_t o = std::rand() % t;
+		std::swap_ranges(ib.begin() + (t - 1) * 3, ib.begin() + t * 3, ib.begin() + o * 3);
+	}
+	run("shuffled sphere", vb, ib);
+
+	std::cout << "checks: " << (failures ? "failed" : "passed") << std::endl;
+	return failures ? 2 : 0;
+}
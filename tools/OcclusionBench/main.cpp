@@ -0,0 +1,290 @@
+// Checks and measures software occlusion buffer without device.
+// Synthetic scene of several walls (occluders) and many small boxes behind and
+// in front of them. Boxes reported as hidden are checked by rays from camera to
+// points on their faces: every ray must hit a wall, otherwise box was culled wrongly.
+// usage: OcclusionBench [objects] [walls] [frames]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <iostream>
+
+#include "rgde/render/occlusion.h"
+
+namespace
+{
+	const float z_near = 1.0f;
+	const float z_far = 500.0f;
+	const float eye[3] = {0, 2, 0};
+
+	struct box
+	{
+		float center[3];
+		float half[3];
+	};
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * std::rand() / RAND_MAX;
+	}
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+
+	/// left handed perspective projection (D3DXMatrixPerspectiveFovLH), column major
+	void perspective(float fovy, float aspect, float* m)
+	{
+		const float ys = 1 / std::tan(fovy / 2);
+		const float q = z_far / (z_far - z_near);
+		for (int i = 0; i < 16; ++i)
+			m[i] = 0;
+		m[0] = ys / aspect;
+		m[5] = ys;
+		m[10] = q;
+		m[11] = 1;
+		m[14] = -q * z_near;
+	}
+
+	/// translation by center and scale by half sizes, unit box becomes b
+	void boxWorld(const box& b, float* m)
+	{
+		for (int i = 0; i < 16; ++i)
+			m[i] = 0;
+		m[0] = b.half[0];
+		m[5] = b.half[1];
+		m[10] = b.half[2];
+		m[12] = b.center[0];
+		m[13] = b.center[1];
+		m[14] = b.center[2];
+		m[15] = 1;
+	}
+
+	/// unit cube as occluder
+	struct cube
+	{
+		float positions[8][3];
+		unsigned short indices[36];
+
+		cube()
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				positions[i][0] = i & 1 ? 1.0f : -1.0f;
+				positions[i][1] = i & 2 ? 1.0f : -1.0f;
+				positions[i][2] = i & 4 ? 1.0f : -1.0f;
+			}
+
+			static const unsigned short faces[6][4] = {
+				{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+			for (int f = 0; f < 6; ++f)
+			{
+				unsigned short* tri = &indices[f * 6];
+				tri[0] = faces[f][0]; tri[1] = faces[f][1]; tri[2] = faces[f][2];
+				tri[3] = faces[f][0]; tri[4] = faces[f][2]; tri[5] = faces[f][3];
+			}
+		}
+
+		render::occluder_mesh mesh() const
+		{
+			render::occluder_mesh m = {&positions[0][0], sizeof(positions[0]), 8, indices, 36};
+			return m;
+		}
+	};
+
+	/// ray from eye to point hits box before reaching point
+	bool rayBlocked(const float* p, const box& b)
+	{
+		float t0 = 0, t1 = 1 - 1e-4f;
+		for (int i = 0; i < 3; ++i)
+		{
+			const float d = p[i] - eye[i];
+			const float lo = b.center[i] - b.half[i], hi = b.center[i] + b.half[i];
+			if (std::fabs(d) < 1e-9f)
+			{
+				if (eye[i] < lo || eye[i] > hi)
+					return false;
+				continue;
+			}
+
+			float ta = (lo - eye[i]) / d, tb = (hi - eye[i]) / d;
+			if (ta > tb) std::swap(ta, tb);
+			if (ta > t0) t0 = ta;
+			if (tb < t1) t1 = tb;
+			if (t0 > t1)
+				return false;
+		}
+		return true;
+	}
+
+	/// all sample points on faces of object are hidden by walls
+	bool reallyHidden(const box& object, const std::vector<box>& walls)
+	{
+		const int n = 6;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			for (int side = -1; side <= 1; side += 2)
+			{
+				for (int u = 0; u <= n; ++u)
+				{
+					for (int v = 0; v <= n; ++v)
+					{
+						float p[3];
+						const int a1 = (axis + 1) % 3, a2 = (axis + 2) % 3;
+						p[axis] = object.center[axis] + side * object.half[axis];
+						p[a1] = object.center[a1] + object.half[a1] * (2.0f * u / n - 1);
+						p[a2] = object.center[a2] + object.half[a2] * (2.0f * v / n - 1);
+
+						bool blocked = false;
+						for (size_t w = 0; w < walls.size() && !blocked; ++w)
+							blocked = rayBlocked(p, walls[w]);
+						if (!blocked)
+							return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	/// all corners of box are inside of view volume
+	bool inFrustum(const box& b, const float* view_proj)
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			const float p[3] = {b.center[0] + (i & 1 ? b.half[0] : -b.half[0]),
+								b.center[1] + (i & 2 ? b.half[1] : -b.half[1]),
+								b.center[2] + (i & 4 ? b.half[2] : -b.half[2])};
+			const float* m = view_proj;
+			const float x = m[0] * p[0] + m[4] * p[1] + m[8]  * p[2] + m[12];
+			const float y = m[1] * p[0] + m[5] * p[1] + m[9]  * p[2] + m[13];
+			const float z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+			const float w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+			if (w <= 0 || std::fabs(x) > w || std::fabs(y) > w || z < 0 || z > w)
+				return false;
+		}
+		return true;
+	}
+
+	/// wall facing camera must give exact depth of its front face
+	bool checkDepth(const float* view_proj, const cube& unit)
+	{
+		render::occlusion_buffer buffer(64, 32);
+		buffer.clear(view_proj);
+
+		const box wall = {{0, eye[1], 31}, {100, 100, 1}};
+		float world[16];
+		boxWorld(wall, world);
+		buffer.add_occluder(unit.mesh(), world);
+
+		const float q = z_far / (z_far - z_near);
+		const float expected = q * (30 - z_near) / 30;
+		float max_error = 0;
+		for (unsigned i = 0; i < buffer.get_width() * buffer.get_height(); ++i)
+			max_error = (std::max)(max_error, std::fabs(buffer.get_depth()[i] - expected));
+
+		std::cout << "depth error:      " << max_error << std::endl;
+		return max_error < 1e-4f;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int num_objects = argc > 1 ? std::atoi(argv[1]) : 10000;
+	const int num_walls = argc > 2 ? std::atoi(argv[2]) : 8;
+	const int frames = argc > 3 ? std::atoi(argv[3]) : 100;
+
+	if (num_objects <= 0 || num_walls <= 0 || frames <= 0)
+	{
+		std::cout << "usage: OcclusionBench [objects] [walls] [frames]" << std::endl;
+		return 1;
+	}
+
+	float proj[16], view[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, -eye[0],-eye[1],-eye[2],1}, view_proj[16];
+	perspective(1.0f, 2.0f, proj);
+	render::transform_cache::multiply(proj, view, view_proj);
+
+	const cube unit;
+	bool valid = checkDepth(view_proj, unit);
+
+	std::srand(12345);
+	std::vector<box> walls(num_walls);
+	std::vector<float> wall_worlds(num_walls * 16);
+	for (int i = 0; i < num_walls; ++i)
+	{
+		box& w = walls[i];
+		w.center[2] = random(15, 40);
+		w.center[0] = random(-0.8f, 0.8f) * w.center[2];
+		w.half[0] = random(2, 8);
+		w.half[1] = random(2, 6);
+		w.half[2] = random(0.2f, 1);
+		w.center[1] = w.half[1];
+		boxWorld(w, &wall_worlds[i * 16]);
+	}
+
+	std::vector<box> objects;
+	std::vector<float> object_worlds;
+	while ((int)objects.size() < num_objects)
+	{
+		box b;
+		b.center[2] = random(5, 200);
+		b.center[0] = random(-1, 1) * b.center[2];
+		b.center[1] = random(0, 4);
+		b.half[0] = random(0.2f, 1);
+		b.half[1] = random(0.2f, 1);
+		b.half[2] = random(0.2f, 1);
+		if (!inFrustum(b, view_proj))
+			continue;
+
+		objects.push_back(b);
+		object_worlds.resize(object_worlds.size() + 16);
+		boxWorld(b, &object_worlds[object_worlds.size() - 16]);
+	}
+
+	const render::occluder_mesh mesh = unit.mesh();
+	const float unit_min[3] = {-1, -1, -1}, unit_max[3] = {1, 1, 1};
+
+	render::occlusion_buffer buffer;
+	std::vector<bool> visible(objects.size());
+	std::clock_t raster_ticks = 0, test_ticks = 0;
+
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		std::clock_t start = std::clock();
+		buffer.clear(view_proj);
+		for (int i = 0; i < num_walls; ++i)
+			buffer.add_occluder(mesh, &wall_worlds[i * 16]);
+		raster_ticks += std::clock() - start;
+
+		start = std::clock();
+		for (size_t i = 0; i < objects.size(); ++i)
+			visible[i] = buffer.test_box(unit_min, unit_max, &object_worlds[i * 16]);
+		test_ticks += std::clock() - start;
+	}
+
+	unsigned occluded = 0, wrong = 0, really_hidden = 0;
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		const bool hidden = reallyHidden(objects[i], walls);
+		really_hidden += hidden ? 1 : 0;
+		if (!visible[i])
+		{
+			++occluded;
+			if (!hidden)
+				++wrong;
+		}
+	}
+
+	std::cout << objects.size() << " objects, " << num_walls << " walls, " << buffer.get_width() << "x"
+			  << buffer.get_height() << " buffer, " << frames << " frames" << std::endl;
+	std::cout << "rasterization:    " << toMs(raster_ticks, frames) << " ms per frame, "
+			  << buffer.get_num_triangles() << " triangles" << std::endl;
+	std::cout << "box tests:        " << toMs(test_ticks, frames) << " ms per frame" << std::endl;
+	std::cout << "occluded:         " << occluded << " (" << 100.0 * occluded / objects.size() << "%), really hidden "
+			  << really_hidden << std::endl;
+	std::cout << "wrongly occluded: " << wrong << std::endl;
+
+	valid = valid && 0 == wrong && occluded > 0 && occluded <= really_hidden;
+	return valid ? 0 : 2;
+}
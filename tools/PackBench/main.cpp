@@ -0,0 +1,223 @@
+// Checks and measures vertex packing without device. Half float conversion is
+// checked on every half value and on known roundings, octahedral encoding on random
+// directions, and generated sphere with tangent frames of both handednesses is packed
+// and decoded with errors printed against limits MeshConverter uses.
+// usage: PackBench [sphere segments] [random directions]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <iostream>
+
+#include "rgde/render/vertex_packing.h"
+
+namespace
+{
+	struct vertex
+	{
+		float position[3];
+		float normal[3];
+		float tex0[2];
+		float tex1[2];
+		float tangent[3];
+		float binormal[3];
+	};
+
+	/// vertex::PackedMeshVertex
+	struct packed_vertex
+	{
+		unsigned short	position[4];
+		short			frame[4];
+		unsigned short	tex0[2];
+		unsigned short	tex1[2];
+	};
+
+	double toMs(std::clock_t ticks)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC;
+	}
+
+	int failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * std::rand() / RAND_MAX;
+	}
+
+	void checkHalf()
+	{
+		using namespace render::packing;
+
+		bool round_trip = true;
+		for (unsigned h = 0; h < 0x10000; ++h)
+		{
+			// nan is not kept bitwise
+			if ((h & 0x7C00) == 0x7C00 && (h & 0x3FF))
+				continue;
+			round_trip = round_trip && float_to_half(half_to_float((unsigned short)h)) == h;
+		}
+		check(round_trip, "every half converts to float and back");
+
+		check(float_to_half(1.0f) == 0x3C00, "half 1");
+		check(float_to_half(-2.0f) == 0xC000, "half -2");
+		check(float_to_half(0.1f) == 0x2E66, "half 0.1 rounded to nearest");
+		check(float_to_half(65504.0f) == 0x7BFF, "max half");
+		check(float_to_half(1e6f) == 0x7BFF, "large value is clamped");
+		check(float_to_half(5.9604645e-8f) == 0x0001, "min subnormal half");
+		check(float_to_half(2.0e-8f) == 0x0000, "tiny value rounds to zero");
+		check(float_to_half(1.0f + 1.0f / 2048) == 0x3C00, "tie rounds to even down");
+		check(float_to_half(1.0f + 3.0f / 2048) == 0x3C02, "tie rounds to even up");
+
+		float max_relative = 0;
+		for (int i = 0; i < 100000; ++i)
+		{
+			const float v = random(-1000, 1000);
+			if (std::fabs(v) < 1e-3f)
+				continue;
+			const float e = std::fabs(half_to_float(float_to_half(v)) - v) / std::fabs(v);
+			max_relative = e > max_relative ? e : max_relative;
+		}
+		check(max_relative <= 1.0f / 2048, "half relative error is within half ulp");
+		std::cout << "half: max relative error " << max_relative << std::endl;
+	}
+
+	void checkOctahedral(int count)
+	{
+		using namespace render::packing;
+
+		float max_angle = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			float v[3] = {random(-1, 1), random(-1, 1), random(-1, 1)};
+			// axes and diagonal folds
+			if (i < 6)
+			{
+				v[0] = v[1] = v[2] = 0;
+				v[i / 2] = i & 1 ? -1.0f : 1.0f;
+			}
+
+			const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+			if (length < 1e-3f)
+				continue;
+
+			short e[2];
+			float d[3];
+			encode_octahedral(v, e);
+			decode_octahedral(e, d);
+
+			const float c[3] = {v[1] * d[2] - v[2] * d[1], v[2] * d[0] - v[0] * d[2], v[0] * d[1] - v[1] * d[0]};
+			const float sine = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+			const float angle = std::atan2(sine, v[0] * d[0] + v[1] * d[1] + v[2] * d[2]) * 57.2957795f;
+			max_angle = angle > max_angle ? angle : max_angle;
+		}
+		check(max_angle < 0.01f, "octahedral error is below 0.01 degree");
+		std::cout << "octahedral: max error " << max_angle << " deg" << std::endl;
+	}
+
+	/// uv sphere with radius 50 around (100, -20, 5), tex1 is tex0 tiled.
+	/// left half has mirrored tangent frames
+	void makeSphere(int segments, float tiling, std::vector<vertex>& vb)
+	{
+		const int rings = segments / 2;
+		for (int r = 0; r <= rings; ++r)
+		{
+			const float theta = 3.1415926f * r / rings;
+			for (int s = 0; s <= segments; ++s)
+			{
+				const float phi = 2 * 3.1415926f * s / segments;
+				const float n[3] = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+				const float t[3] = {-std::sin(phi), 0, std::cos(phi)};
+				const float sign = s * 2 < segments ? 1.0f : -1.0f;
+
+				vertex v;
+				for (int k = 0; k < 3; ++k)
+				{
+					v.normal[k] = n[k];
+					v.tangent[k] = t[k];
+					v.binormal[k] = sign * (n[(k + 1) % 3] * t[(k + 2) % 3] - n[(k + 2) % 3] * t[(k + 1) % 3]);
+				}
+				v.position[0] = 100 + 50 * n[0];
+				v.position[1] = -20 + 50 * n[1];
+				v.position[2] = 5 + 50 * n[2];
+				v.tex0[0] = (float)s / segments;
+				v.tex0[1] = (float)r / rings;
+				v.tex1[0] = tiling * v.tex0[0];
+				v.tex1[1] = tiling * v.tex0[1];
+				vb.push_back(v);
+			}
+		}
+	}
+
+	/// fits - mesh is expected to be within limits of MeshConverter
+	void checkSphere(int segments, float tiling, bool fits)
+	{
+		using namespace render::packing;
+
+		std::vector<vertex> vb;
+		makeSphere(segments, tiling, vb);
+
+		const float min[3] = {50, -70, -45}, max[3] = {150, 30, 55};
+		const position_box box = make_box(min, max);
+
+		std::vector<packed_vertex> packed;
+		std::clock_t start = std::clock();
+		pack(vb, box, packed);
+		const double pack_ms = toMs(std::clock() - start);
+
+		std::vector<vertex> decoded;
+		start = std::clock();
+		unpack(packed, box, decoded);
+		const double unpack_ms = toMs(std::clock() - start);
+
+		const error e = measure(vb, decoded);
+
+		// half step of quantization along each axis
+		check(e.position <= 100.0f / 65535 * 0.5f * 1.7321f, "position error is within quantization step");
+		check(e.normal < 0.01f && e.tangent < 0.01f, "normal and tangent error");
+		check(e.binormal < 0.02f, "binormal handedness is kept");
+		check(e.tex <= tiling / 2048, "uv error is within half ulp");
+
+		// the limits of MeshConverter
+		const float diagonal = 100 * 1.7321f;
+		const bool within = e.tex <= 1.0f / 1024 && e.normal <= 2 && e.binormal <= 2 && e.position <= diagonal / 16384;
+		check(within == fits, fits ? "sphere fits converter limits" : "tiled sphere is above converter limits");
+
+		std::cout << "sphere, uv tiling " << tiling << ": " << vb.size() << " vertices, " << vb.size() * sizeof(vertex) << " -> "
+				  << packed.size() * sizeof(packed_vertex) << " bytes" << std::endl;
+		std::cout << "  max error: position " << e.position << ", normal " << e.normal << " deg, tangent " << e.tangent
+				  << " deg, binormal " << e.binormal << " deg, uv " << e.tex << std::endl;
+		std::cout << "  pack " << pack_ms << " ms, unpack " << unpack_ms << " ms" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int segments = argc > 1 ? std::atoi(argv[1]) : 250;
+	const int directions = argc > 2 ? std::atoi(argv[2]) : 100000;
+
+	if (segments < 4 || directions < 6)
+	{
+		std::cout << "usage: PackBench [sphere segments] [random directions]" << std::endl;
+		return 1;
+	}
+
+	check(sizeof(packed_vertex) == 24, "packed vertex is 24 bytes");
+
+	std::srand(1);
+	checkHalf();
+	checkOctahedral(directions);
+	checkSphere(segments, 1, true);
+	checkSphere(segments, 8, false);
+
+	std::cout << "checks: " << (failures ? "failed" : "passed") << std::endl;
+	return failures ? 2 : 0;
+}
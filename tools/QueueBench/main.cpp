@@ -0,0 +1,163 @@
+// Measures render queue of render_manager::renderScene without device:
+// key building, radix sort and execution through null backend, which only
+// counts batches (technique/material binds) and draws.
+// Old path (comparison sort of transparent objects by distance computed
+// inside comparator, one bind per object) is measured for reference.
+// usage: QueueBench [objects] [materials] [iterations]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "rgde/render/render_queue.h"
+
+namespace
+{
+	struct object
+	{
+		float x, y, z;
+		unsigned priority;
+		bool transparent;
+		const void* material;
+	};
+
+	class null_backend : public render::render_queue::backend
+	{
+	public:
+		null_backend() : num_batches(0), num_draws(0) {}
+
+		void draw_batch(const render::render_queue::item*, size_t count)
+		{
+			++num_batches;
+			num_draws += count;
+		}
+
+		size_t num_batches;
+		size_t num_draws;
+	};
+
+	struct distance_greater
+	{
+		float cx, cy, cz;
+
+		bool operator()(const object* o1, const object* o2) const
+		{
+			float d1 = (o1->x - cx) * (o1->x - cx) + (o1->y - cy) * (o1->y - cy) + (o1->z - cz) * (o1->z - cz);
+			float d2 = (o2->x - cx) * (o2->x - cx) + (o2->y - cy) * (o2->y - cy) + (o2->z - cz) * (o2->z - cz);
+			return d1 > d2;
+		}
+	};
+
+	struct priority_less
+	{
+		bool operator()(const object* o1, const object* o2) const
+		{
+			return o1->priority < o2->priority;
+		}
+	};
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * std::rand() / RAND_MAX;
+	}
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int num_objects = argc > 1 ? std::atoi(argv[1]) : 10000;
+	const int num_materials = argc > 2 ? std::atoi(argv[2]) : 32;
+	const int iterations = argc > 3 ? std::atoi(argv[3]) : 100;
+
+	if (num_objects <= 0 || num_materials <= 0 || iterations <= 0)
+	{
+		std::cout << "usage: QueueBench [objects] [materials] [iterations]" << std::endl;
+		return 1;
+	}
+
+	std::srand(12345);
+	std::vector<char> materials(num_materials);
+	std::vector<object> objects(num_objects);
+	for (int i = 0; i < num_objects; ++i)
+	{
+		object& o = objects[i];
+		o.x = random(-500, 500);
+		o.y = random(-50, 50);
+		o.z = random(-500, 500);
+		o.priority = std::rand() % 8 == 0 ? 9 : 10;
+		o.transparent = std::rand() % 5 == 0;
+		o.material = &materials[std::rand() % num_materials];
+	}
+
+	const float cx = 0, cy = 10, cz = -100;
+
+	// old path: priority sort, split, distance sort of transparent, bind per object
+	std::vector<const object*> all, solids, transparents;
+	size_t old_binds = 0;
+	std::clock_t start = std::clock();
+	for (int it = 0; it < iterations; ++it)
+	{
+		all.resize(0);
+		for (int i = 0; i < num_objects; ++i)
+			all.push_back(&objects[i]);
+		std::sort(all.begin(), all.end(), priority_less());
+
+		solids.resize(0);
+		transparents.resize(0);
+		for (size_t i = 0; i < all.size(); ++i)
+			(all[i]->transparent ? transparents : solids).push_back(all[i]);
+
+		distance_greater by_distance = {cx, cy, cz};
+		std::sort(transparents.begin(), transparents.end(), by_distance);
+		old_binds = solids.size() + transparents.size();
+	}
+	const double old_ms = toMs(std::clock() - start, iterations);
+
+	render::render_queue queue;
+	queue.reserve(num_objects);
+	null_backend backend;
+
+	double build_ms = 0, sort_ms = 0, execute_ms = 0;
+	for (int it = 0; it < iterations; ++it)
+	{
+		start = std::clock();
+		queue.clear();
+		for (int i = 0; i < num_objects; ++i)
+		{
+			const object& o = objects[i];
+			float d = (o.x - cx) * (o.x - cx) + (o.y - cy) * (o.y - cy) + (o.z - cz) * (o.z - cz);
+			render::render_queue::layer l = o.transparent ? render::render_queue::transparent : render::render_queue::solid;
+			queue.add(l, o.priority, &materials[0], o.material, d, &o);
+		}
+		std::clock_t built = std::clock();
+		queue.sort();
+		std::clock_t sorted = std::clock();
+
+		backend = null_backend();
+		queue.execute(backend);
+
+		build_ms += toMs(built - start, iterations);
+		sort_ms += toMs(sorted - built, iterations);
+		execute_ms += toMs(std::clock() - sorted, iterations);
+	}
+
+	// check order: layers/priorities ascending, transparent back to front
+	bool ordered = true;
+	for (size_t i = 1; i < queue.size(); ++i)
+		ordered = ordered && queue[i - 1].key <= queue[i].key;
+
+	std::cout << num_objects << " objects, " << num_materials << " materials, " << iterations << " iterations" << std::endl;
+	std::cout << "old sort:     " << old_ms << " ms, " << old_binds << " binds" << std::endl;
+	std::cout << "queue build:  " << build_ms << " ms" << std::endl;
+	std::cout << "queue sort:   " << sort_ms << " ms" << std::endl;
+	std::cout << "queue submit: " << execute_ms << " ms, " << backend.num_batches << " binds, "
+			  << backend.num_draws << " draws" << std::endl;
+
+	return ordered && backend.num_draws == (size_t)num_objects ? 0 : 2;
+}
@@ -0,0 +1,266 @@
+// Measures sprite_manager update without device: old path (std::sort of whole
+// sprite vector and vertices with cos/sin of every sprite each frame) against
+// render::sprite_batch radix sort, vertex building on thread pool by chunks
+// and retained static layer with few modified sprites per frame.
+// Draw order is checked: priorities ascending, textures grouped, stable.
+// usage: SpriteBench [sprites] [textures] [frames]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "precompiled.h"
+#include "rgde/base/thread_pool.h"
+#include "rgde/render/sprite_batch.h"
+
+namespace
+{
+	struct vec2
+	{
+		float v[2];
+		float operator[](int i) const {return v[i];}
+		float& operator[](int i) {return v[i];}
+	};
+
+	vec2 make_vec2(float x, float y)
+	{
+		vec2 r = {{x, y}};
+		return r;
+	}
+
+	struct sprite_rect
+	{
+		float x, y, w, h;
+		vec2 get_top_left() const {return make_vec2(x, y);}
+		vec2 get_top_right() const {return make_vec2(x + w, y);}
+		vec2 get_bottom_right() const {return make_vec2(x + w, y + h);}
+		vec2 get_bottom_left() const {return make_vec2(x, y + h);}
+	};
+
+	struct texture_ref
+	{
+		const void* p;
+		const void* get() const {return p;}
+		bool operator<(const texture_ref& t) const {return p < t.p;}
+	};
+
+	/// same members as render::sprite
+	struct sprite
+	{
+		sprite_rect rect;
+		vec2 pos;
+		vec2 size;
+		float spin;
+		unsigned long priority;
+		texture_ref texture;
+		unsigned color;
+	};
+
+	/// same members as vertex::PositionTransformedColoredTextured
+	struct vertex
+	{
+		struct vec4
+		{
+			float v[4];
+			void set(float x, float y, float z, float w) {v[0] = x; v[1] = y; v[2] = z; v[3] = w;}
+		} position;
+		unsigned color;
+		vec2 tex;
+	};
+
+	const float scale_x = 1.6f, scale_y = 1.5f;
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * std::rand() / RAND_MAX;
+	}
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+
+	bool sorting_pred(const sprite& s1, const sprite& s2)
+	{
+		return s1.priority == s2.priority ? s1.texture < s2.texture : s1.priority < s2.priority;
+	}
+
+	vec2 rotatePos(float x, float y, float sina, float cosa)
+	{
+		return make_vec2(x * cosa - y * sina, x * sina + y * cosa);
+	}
+
+	/// vertices as old sprite_manager::update
+	void oldQuad(const sprite& s, vertex* v)
+	{
+		const float hx = s.size[0] * scale_x * 0.5f, hy = s.size[1] * scale_y * 0.5f;
+		const float x = s.pos[0] * scale_x, y = s.pos[1] * scale_y;
+		const float cosa = std::cos(s.spin), sina = std::sin(s.spin);
+
+		const float corners[4][2] = {{-hx, -hy}, {hx, -hy}, {hx, hy}, {-hx, hy}};
+		const vec2 tex[4] = {s.rect.get_top_left(), s.rect.get_top_right(), s.rect.get_bottom_right(), s.rect.get_bottom_left()};
+		for (int i = 0; i < 4; ++i)
+		{
+			const vec2 p = rotatePos(corners[i][0], corners[i][1], sina, cosa);
+			v[i].position.set(p[0] + x, p[1] + y, 0, 0);
+			v[i].tex = tex[i];
+			v[i].color = s.color;
+		}
+	}
+
+	sprite randomSprite(const std::vector<char>& textures)
+	{
+		sprite s;
+		sprite_rect r = {0, 0, 1, 1};
+		s.rect = r;
+		s.pos = make_vec2(random(0, 800), random(0, 600));
+		s.size = make_vec2(random(4, 64), random(4, 64));
+		s.spin = std::rand() % 4 == 0 ? random(0, 6.28f) : 0;
+		s.priority = std::rand() % 16;
+		texture_ref t = {&textures[std::rand() % textures.size()]};
+		s.texture = t;
+		s.color = 0xFFFFFFFF;
+		return s;
+	}
+
+	/// draw order and vertices against old quads of the same sprites
+	bool checkBatch(const render::sprite_batch& batch, const std::vector<sprite>& sprites, const std::vector<vertex>& vertices)
+	{
+		for (size_t slot = 0; slot < batch.size(); ++slot)
+		{
+			const unsigned index = batch.get_sprite(slot);
+			if (batch.get_slot(index) != slot)
+				return false;
+
+			if (slot > 0)
+			{
+				const unsigned prev = batch.get_sprite(slot - 1);
+				if (sprites[prev].priority > sprites[index].priority)
+					return false;
+				if (sprites[prev].priority == sprites[index].priority &&
+					sprites[prev].texture.p == sprites[index].texture.p && prev > index)
+					return false;
+			}
+
+			vertex expected[4];
+			oldQuad(sprites[index], expected);
+			for (int i = 0; i < 4; ++i)
+			{
+				for (int c = 0; c < 2; ++c)
+				{
+					if (std::fabs(expected[i].position.v[c] - vertices[slot * 4 + i].position.v[c]) > 1e-3f ||
+						expected[i].tex[c] != vertices[slot * 4 + i].tex[c])
+						return false;
+				}
+			}
+		}
+
+		// every (priority, texture) pair is one run
+		size_t pairs = 0;
+		std::vector<sprite> sorted(sprites);
+		std::sort(sorted.begin(), sorted.end(), sorting_pred);
+		for (size_t i = 0; i < sorted.size(); ++i)
+			pairs += 0 == i || sorting_pred(sorted[i - 1], sorted[i]) ? 1 : 0;
+
+		return pairs == batch.get_runs().size();
+	}
+
+	struct chunk_builder
+	{
+		const render::sprite_batch* batch;
+		const sprite* sprites;
+		vertex* vertices;
+		size_t num;
+
+		void operator()(size_t chunk) const
+		{
+			const size_t begin = chunk * 2048;
+			batch->build(sprites, begin, (std::min)(begin + 2048, num), scale_x, scale_y, vertices);
+		}
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	const int num_sprites = argc > 1 ? std::atoi(argv[1]) : 100000;
+	const int num_textures = argc > 2 ? std::atoi(argv[2]) : 64;
+	const int frames = argc > 3 ? std::atoi(argv[3]) : 50;
+
+	if (num_sprites <= 0 || num_textures <= 0 || frames <= 0)
+	{
+		std::cout << "usage: SpriteBench [sprites] [textures] [frames]" << std::endl;
+		return 1;
+	}
+
+	std::srand(12345);
+	std::vector<char> textures(num_textures);
+	std::vector<sprite> sprites(num_sprites);
+	for (int i = 0; i < num_sprites; ++i)
+		sprites[i] = randomSprite(textures);
+
+	std::vector<vertex> vertices(num_sprites * 4);
+
+	// old path: every frame sprites are copied, sorted and all quads rebuilt
+	std::clock_t start = std::clock();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		std::vector<sprite> frame_sprites(sprites);
+		std::sort(frame_sprites.begin(), frame_sprites.end(), sorting_pred);
+		for (int i = 0; i < num_sprites; ++i)
+			oldQuad(frame_sprites[i], &vertices[i * 4]);
+	}
+	const double old_ms = toMs(std::clock() - start, frames);
+
+	render::sprite_batch batch;
+	start = std::clock();
+	for (int frame = 0; frame < frames; ++frame)
+		batch.sort(&sprites[0], num_sprites);
+	const double sort_ms = toMs(std::clock() - start, frames);
+
+	start = std::clock();
+	for (int frame = 0; frame < frames; ++frame)
+		batch.build(&sprites[0], 0, num_sprites, scale_x, scale_y, &vertices[0]);
+	const double build_ms = toMs(std::clock() - start, frames);
+
+	bool valid = checkBatch(batch, sprites, vertices);
+
+	// dynamic layer: chunks are built by calling thread and pool workers
+	base::thread_pool pool;
+	chunk_builder builder = {&batch, &sprites[0], &vertices[0], (size_t)num_sprites};
+	const size_t num_chunks = (num_sprites + 2047) / 2048;
+	start = std::clock();
+	for (int frame = 0; frame < frames; ++frame)
+		pool.parallel_for(num_chunks, builder);
+	const double parallel_ms = toMs(std::clock() - start, frames);
+	valid = checkBatch(batch, sprites, vertices) && valid;
+
+	// static layer: 1% of sprites move, their quads are rebuilt in place
+	const int num_modified = (std::max)(num_sprites / 100, 1);
+	start = std::clock();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		for (int i = 0; i < num_modified; ++i)
+		{
+			const unsigned index = (unsigned)((frame * 7919 + i * 104729) % num_sprites);
+			sprite& s = sprites[index];
+			s.pos = make_vec2(s.pos[0] + 1, s.pos[1]);
+			if (batch.same_order(s, index))
+				render::sprite_batch::build_quad(s, scale_x, scale_y, &vertices[batch.get_slot(index) * 4]);
+		}
+	}
+	const double static_ms = toMs(std::clock() - start, frames);
+	valid = checkBatch(batch, sprites, vertices) && valid;
+
+	std::cout << num_sprites << " sprites, " << num_textures << " textures, " << frames << " frames, "
+			  << pool.size() + 1 << " threads" << std::endl;
+	std::cout << "old update:       " << old_ms << " ms (std::sort, cos/sin of every sprite)" << std::endl;
+	std::cout << "radix sort:       " << sort_ms << " ms, " << batch.get_runs().size() << " runs" << std::endl;
+	std::cout << "build vertices:   " << build_ms << " ms" << std::endl;
+	std::cout << "build on pool:    " << parallel_ms << " ms (processor time of all threads)" << std::endl;
+	std::cout << "static, 1% moved: " << static_ms << " ms" << std::endl;
+	std::cout << "order valid:      " << (valid ? "yes" : "no") << std::endl;
+
+	return valid ? 0 : 2;
+}
@@ -0,0 +1,9 @@
+// engine sources compiled into bench (thread pool) include only this
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
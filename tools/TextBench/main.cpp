@@ -0,0 +1,234 @@
+// Checks text layout and glyph packing of glyph cache font without device, and
+// measures HUD text drawn each frame: layout of every string against cached layouts.
+// Font is synthetic: glyph size and advance depend on character code.
+// usage: TextBench [strings] [frames]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include "rgde/render/text_layout.h"
+
+namespace
+{
+	const float line_height = 16;
+	const float ascent = 12;
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+
+	/// proportional font: advance 6..9, bitmap (advance - 1) x 9..12, space and tab are empty
+	struct glyphs
+	{
+		render::glyph_cache cache;
+		unsigned rasterized;
+
+		glyphs() : cache(128), rasterized(0) {}
+
+		const render::glyph* operator()(wchar_t c)
+		{
+			if (const render::glyph* g = cache.find(c))
+				return g;
+
+			if (c < 32 && c != L'\t')
+				return 0;
+
+			++rasterized;
+			const unsigned advance = 6 + c % 4;
+			const bool empty = L' ' == c || L'\t' == c;
+			unsigned x, y;
+			return cache.add(c, (float)advance, 0, 9 + c % 4, empty ? 0 : advance - 1, empty ? 0 : 9 + c % 4, x, y);
+		}
+	};
+
+	bool near(float a, float b)
+	{
+		return std::fabs(a - b) < 1e-4f;
+	}
+
+	int failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	float advance(glyphs& font, const std::wstring& text)
+	{
+		float a = 0;
+		for (size_t i = 0; i < text.size(); ++i)
+			a += font(text[i])->advance;
+		return a;
+	}
+
+	void layout(glyphs& font, const std::wstring& text, float width, float height, int flags, render::text_layout& result)
+	{
+		render::layout_text(text.c_str(), text.size(), width, height, flags, line_height, ascent, font, result);
+	}
+
+	void checkLayout(glyphs& font)
+	{
+		render::text_layout l;
+
+		// pen positions and baseline
+		layout(font, L"ab c", 0, 0, 0, l);
+		check(l.complete && l.quads.size() == 3, "glyph count");
+		check(near(l.quads[1].x, font(L'a')->advance) && near(l.quads[0].y, ascent - font(L'a')->top), "pen and baseline");
+		check(near(l.width, advance(font, L"ab c")) && near(l.height, line_height), "extent");
+
+		// line feeds and single line
+		layout(font, L"ab\ncd\n", 0, 0, 0, l);
+		check(near(l.height, 3 * line_height) && near(l.quads[2].x, 0) && near(l.quads[2].y, line_height + ascent - font(L'c')->top), "line feed");
+		layout(font, L"ab\ncd", 0, 0, render::text_single_line, l);
+		check(near(l.height, line_height) && near(l.quads[2].x, advance(font, L"ab")), "single line");
+
+		// word break: "aaa bbb ccc" in width of two words
+		const float two_words = advance(font, L"aaa bbb");
+		layout(font, L"aaa bbb ccc", two_words + 1, 0, render::text_word_break, l);
+		check(near(l.height, 2 * line_height) && near(l.quads[6].x, 0) && near(l.width, two_words), "word break");
+
+		// long word is not broken
+		layout(font, L"aaaaaaaaaaaa", 20, 0, render::text_word_break | render::text_no_clip, l);
+		check(near(l.height, line_height) && l.quads.size() == 12, "long word");
+
+		// alignment ignores trailing spaces
+		const float ab = advance(font, L"ab");
+		layout(font, L"ab  ", 100, 50, render::text_right | render::text_bottom, l);
+		check(near(l.quads[0].x, 100 - ab) && near(l.quads[0].y, 50 - line_height + ascent - font(L'a')->top), "right bottom");
+		layout(font, L"ab", 100, 50, render::text_center | render::text_vcenter, l);
+		check(near(l.quads[0].x, std::floor((100 - ab) * 0.5f + 0.5f)), "center");
+
+		// tabs stop at 8 spaces
+		const float tab = font(L' ')->advance * 8;
+		layout(font, L"a\tb", 0, 0, render::text_expand_tabs, l);
+		check(near(l.quads[1].x, tab), "tab stop");
+
+		// clipping cuts quads and their uv
+		layout(font, L"abcdef", 10, 0, 0, l);
+		check(l.quads.size() == 2 && near(l.quads[1].x + l.quads[1].w, 10), "clip width");
+		const render::glyph* b = font(L'b');
+		const float cut = (b->uv[2] - b->uv[0]) * l.quads[1].w / b->width;
+		check(near(l.quads[1].uv[2] - l.quads[1].uv[0], cut), "clip uv");
+		layout(font, L"abcdef", 10, 0, render::text_no_clip, l);
+		check(l.quads.size() == 6, "no clip");
+
+		// missing glyph makes layout incomplete
+		layout(font, std::wstring(L"a") + wchar_t(1), 0, 0, 0, l);
+		check(!l.complete, "missing glyph");
+	}
+
+	/// glyphs of all pages lie inside page and don't overlap
+	void checkPacking(glyphs& font)
+	{
+		for (wchar_t c = 32; c < 32 + 2000; ++c)
+			font(c);
+
+		const unsigned size = font.cache.get_page_size();
+		std::vector<std::vector<bool> > used(font.cache.get_num_pages(), std::vector<bool>(size * size));
+		bool valid = true;
+		for (wchar_t c = 32; c < 32 + 2000 && valid; ++c)
+		{
+			const render::glyph* g = font.cache.find(c);
+			const unsigned x = (unsigned)(g->uv[0] * size + 0.5f), y = (unsigned)(g->uv[1] * size + 0.5f);
+			valid = g->page < used.size() && x + g->width <= size && y + g->height <= size;
+			for (unsigned j = y; j < y + g->height && valid; ++j)
+			{
+				for (unsigned i = x; i < x + g->width && valid; ++i)
+				{
+					valid = !used[g->page][j * size + i];
+					used[g->page][j * size + i] = true;
+				}
+			}
+		}
+		check(valid, "glyph packing");
+		std::cout << "glyph packing:    " << font.cache.size() << " glyphs in " << font.cache.get_num_pages() << " pages of "
+				  << size << "x" << size << std::endl;
+	}
+
+	std::wstring hudString(int i)
+	{
+		static const wchar_t* labels[] = {L"Score: ", L"Health ", L"Ammo\t", L"FPS ", L"Objects visible: "};
+		std::wstring s = labels[i % 5];
+		for (int n = i * 7919 % 100000; n > 0; n /= 10)
+			s += wchar_t(L'0' + n % 10);
+		return s;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int num_strings = argc > 1 ? std::atoi(argv[1]) : 200;
+	const int frames = argc > 2 ? std::atoi(argv[2]) : 200;
+
+	if (num_strings <= 0 || frames <= 0)
+	{
+		std::cout << "usage: TextBench [strings] [frames]" << std::endl;
+		return 1;
+	}
+
+	glyphs font;
+	checkLayout(font);
+	checkPacking(font);
+
+	std::vector<std::wstring> strings(num_strings);
+	for (int i = 0; i < num_strings; ++i)
+		strings[i] = hudString(i);
+
+	// every frame every string is laid out again
+	render::text_layout l;
+	size_t quads = 0;
+	std::clock_t start = std::clock();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		for (int i = 0; i < num_strings; ++i)
+		{
+			layout(font, strings[i], 300, 20, render::text_word_break | render::text_expand_tabs, l);
+			quads += l.quads.size();
+		}
+	}
+	const double layout_ms = toMs(std::clock() - start, frames);
+
+	// cached layouts, one string in 10 changes each frame
+	render::layout_cache cache;
+	size_t cached_quads = 0, misses = 0;
+	start = std::clock();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		for (int i = 0; i < num_strings / 10; ++i)
+			strings[(frame * 31 + i * 10) % num_strings] = hudString(frame * num_strings + i);
+
+		for (int i = 0; i < num_strings; ++i)
+		{
+			const int flags = render::text_word_break | render::text_expand_tabs;
+			const render::text_layout* cached = cache.find(strings[i], 300, 20, flags);
+			if (!cached)
+			{
+				++misses;
+				render::text_layout& added = cache.add(strings[i], 300, 20, flags);
+				layout(font, strings[i], 300, 20, flags, added);
+				cached = &added;
+			}
+			cached_quads += cached->quads.size();
+		}
+		cache.next_frame(30);
+	}
+	const double cached_ms = toMs(std::clock() - start, frames);
+
+	// changed strings live at most max age and trimming period
+	check(cache.size() <= (size_t)num_strings + (num_strings / 10) * (30 + 64), "cache trimming");
+
+	std::cout << num_strings << " strings, " << frames << " frames, " << quads / frames << " glyph quads per frame" << std::endl;
+	std::cout << "layout each frame: " << layout_ms << " ms" << std::endl;
+	std::cout << "cached layouts:    " << cached_ms << " ms, " << misses << " misses, " << cache.size() << " kept" << std::endl;
+	std::cout << "checks:            " << (failures ? "failed" : "passed") << std::endl;
+
+	return failures ? 2 : 0;
+}
@@ -0,0 +1,327 @@
+// Checks and measures texture cooking and mip streaming plan without device.
+// Generated images are compressed and decompressed, cooked files are written
+// and parsed back (damaged ones must be rejected) and streaming plan is run
+// over set of textures with different on screen sizes and budgets.
+// usage: TextureBench [image size]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <iostream>
+
+#include "rgde/render/texture_cooker.h"
+#include "rgde/render/texture_streaming.h"
+
+namespace
+{
+	using namespace render;
+
+	double toMs(std::clock_t ticks)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC;
+	}
+
+	int failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	/// smooth gradients with alpha ramp
+	cooker::image makeGradient(unsigned size)
+	{
+		cooker::image img(size, size);
+		for (unsigned y = 0; y < size; ++y)
+		{
+			for (unsigned x = 0; x < size; ++x)
+			{
+				unsigned char* p = img.at(x, y);
+				p[0] = (unsigned char)(255 * x / (size - 1));
+				p[1] = (unsigned char)(255 * y / (size - 1));
+				p[2] = (unsigned char)(128 + 127 * std::sin(x * 0.05f + y * 0.03f));
+				p[3] = (unsigned char)(255 * (x + y) / (2 * size - 2));
+			}
+		}
+		return img;
+	}
+
+	/// gradient with noise, worst case for block compression
+	cooker::image makeNoise(unsigned size)
+	{
+		cooker::image img = makeGradient(size);
+		std::srand(1);
+		for (size_t i = 0; i < img.pixels.size(); ++i)
+		{
+			const int v = img.pixels[i] + std::rand() % 33 - 16;
+			img.pixels[i] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+		}
+		return img;
+	}
+
+	cooker::image makeSolid(unsigned size, const unsigned char color[4])
+	{
+		cooker::image img(size, size);
+		for (size_t i = 0; i < img.pixels.size(); ++i)
+			img.pixels[i] = color[i % 4];
+		return img;
+	}
+
+	/// rmse of color channels only, DXT1 keeps no alpha
+	float colorRmse(const cooker::image& a, const cooker::image& b)
+	{
+		double sum = 0;
+		for (size_t i = 0; i < a.pixels.size(); ++i)
+		{
+			if (3 == i % 4)
+				continue;
+			const double d = (double)a.pixels[i] - b.pixels[i];
+			sum += d * d;
+		}
+		return (float)std::sqrt(sum / (a.pixels.size() / 4 * 3));
+	}
+
+	void checkCompression(const char* name, const cooker::image& img, float dxt1_limit, float dxt5_limit)
+	{
+		std::vector<unsigned char> data;
+		cooker::image decoded;
+
+		std::clock_t start = std::clock();
+		cooker::compress(img, cooker::format_dxt1, data);
+		const double dxt1_ms = toMs(std::clock() - start);
+		check(data.size() == img.pixels.size() / 8, "DXT1 size");
+		cooker::decompress(&data[0], cooker::format_dxt1, img.width, img.height, decoded);
+		const float dxt1 = colorRmse(img, decoded);
+		check(dxt1 <= dxt1_limit, "DXT1 error");
+
+		start = std::clock();
+		cooker::compress(img, cooker::format_dxt5, data);
+		const double dxt5_ms = toMs(std::clock() - start);
+		check(data.size() == img.pixels.size() / 4, "DXT5 size");
+		cooker::decompress(&data[0], cooker::format_dxt5, img.width, img.height, decoded);
+		const float dxt5 = cooker::rmse(img, decoded);
+		check(dxt5 <= dxt5_limit, "DXT5 error");
+
+		cooker::compress(img, cooker::format_argb8, data);
+		cooker::decompress(&data[0], cooker::format_argb8, img.width, img.height, decoded);
+		check(decoded.pixels == img.pixels, "A8R8G8B8 is lossless");
+
+		std::cout << name << " " << img.width << "x" << img.height << ": rmse DXT1 " << dxt1 << ", DXT5 " << dxt5
+				  << ", " << dxt1_ms << " / " << dxt5_ms << " ms" << std::endl;
+	}
+
+	void checkSolid()
+	{
+		// solid blocks must decode exactly where color is representable in 565
+		const unsigned char colors[][4] = {{0, 0, 0, 255}, {255, 255, 255, 0}, {0, 255, 0, 128}, {255, 0, 255, 17}};
+		for (size_t i = 0; i < sizeof(colors) / sizeof(colors[0]); ++i)
+		{
+			const cooker::image img = makeSolid(8, colors[i]);
+			std::vector<unsigned char> data;
+			cooker::image decoded;
+
+			cooker::compress(img, cooker::format_dxt5, data);
+			cooker::decompress(&data[0], cooker::format_dxt5, 8, 8, decoded);
+			check(decoded.pixels == img.pixels, "solid DXT5 block is exact");
+
+			cooker::compress(img, cooker::format_dxt1, data);
+			cooker::decompress(&data[0], cooker::format_dxt1, 8, 8, decoded);
+			check(colorRmse(img, decoded) == 0, "solid DXT1 block is exact");
+		}
+	}
+
+	void checkChain(unsigned width, unsigned height)
+	{
+		cooker::image img(width, height);
+		const unsigned char color[4] = {10, 100, 200, 255};
+		for (size_t i = 0; i < img.pixels.size(); ++i)
+			img.pixels[i] = color[i % 4];
+		// checker in red channel, every 2x2 box averages to 100
+		for (unsigned y = 0; y < height; ++y)
+			for (unsigned x = 0; x < width; ++x)
+				img.at(x, y)[2] = (x + y) & 1 ? 0 : 200;
+
+		std::vector<cooker::cooked_level> levels;
+		cooker::cook(img, cooker::format_argb8, levels);
+
+		check(levels.size() == cooker::num_levels(width, height), "number of levels");
+		check(levels.back().width == 1 && levels.back().height == 1, "chain ends with 1x1");
+		for (size_t i = 0; i < levels.size(); ++i)
+		{
+			check(levels[i].width == cooker::level_dim(width, (unsigned)i) &&
+				  levels[i].height == cooker::level_dim(height, (unsigned)i), "level sizes");
+			check(levels[i].data.size() == cooker::level_bytes(cooker::format_argb8, levels[i].width, levels[i].height), "level bytes");
+		}
+		check(levels.size() > 1 && 100 == levels[1].data[2] && 10 == levels[1].data[0], "box filter average");
+	}
+
+	void checkFile(const cooker::image& img)
+	{
+		std::vector<cooker::cooked_level> levels;
+		cooker::cook(img, cooker::format_dxt5, levels);
+
+		std::vector<unsigned char> file;
+		cooker::write_file(cooker::format_dxt5, levels, 0x0123456789ABCDEFull, file);
+
+		cooker::header h;
+		check(cooker::read_header(&file[0], file.size(), file.size(), h), "cooked file is read");
+		check(h.width == img.width && h.height == img.height && h.format == cooker::format_dxt5, "header fields");
+		check(h.source_hash == 0x0123456789ABCDEFull, "source hash");
+		check(h.levels.size() == levels.size(), "level table size");
+
+		bool same = true;
+		unsigned previous_offset = (unsigned)file.size();
+		for (size_t i = 0; i < levels.size() && i < h.levels.size(); ++i)
+		{
+			const cooker::level_info& l = h.levels[i];
+			same = same && std::equal(levels[i].data.begin(), levels[i].data.end(), file.begin() + l.offset);
+			// coarse levels come first, base of streamed texture is read by one seek
+			check(l.offset < previous_offset, "levels stored coarsest first");
+			previous_offset = l.offset;
+		}
+		check(same, "level data");
+		check(cooker::read_num_levels(&file[0], cooker::fixed_header_size) == levels.size(), "levels from fixed header");
+
+		check(!cooker::read_header(&file[0], file.size(), file.size() - 1, h), "truncated file is rejected");
+		check(!cooker::read_header(&file[0], cooker::header_size((unsigned)levels.size()) - 1, file.size(), h), "truncated header is rejected");
+
+		std::vector<unsigned char> damaged = file;
+		damaged[0] ^= 1;
+		check(!cooker::read_header(&damaged[0], damaged.size(), damaged.size(), h), "wrong magic is rejected");
+
+		damaged = file;
+		damaged[4] = 2;
+		check(!cooker::read_header(&damaged[0], damaged.size(), damaged.size(), h), "unknown version is rejected");
+
+		damaged = file;
+		damaged[cooker::fixed_header_size + 8] ^= 1;
+		check(!cooker::read_header(&damaged[0], damaged.size(), damaged.size(), h), "wrong level size is rejected");
+
+		damaged = file;
+		damaged[cooker::fixed_header_size + 3] = 0x7F;
+		check(!cooker::read_header(&damaged[0], damaged.size(), damaged.size(), h), "offset outside of file is rejected");
+	}
+
+	void checkDesiredLevel()
+	{
+		// 1024x512, 11 levels
+		check(0 == streaming::desired_level(1024, 512, 11, 2000), "magnified texture needs top level");
+		check(0 == streaming::desired_level(1024, 512, 11, 1024), "exact size needs top level");
+		check(0 == streaming::desired_level(1024, 512, 11, 600), "level 1 would be magnified");
+		check(1 == streaming::desired_level(1024, 512, 11, 500), "half size needs level 1");
+		check(3 == streaming::desired_level(1024, 512, 11, 128), "1024 / 8 pixels");
+		check(10 == streaming::desired_level(1024, 512, 11, 0.5f), "subpixel needs coarsest");
+		check(10 == streaming::desired_level(1024, 512, 11, 0), "not drawn needs coarsest");
+		check(2 == streaming::desired_level(1024, 512, 3, 1), "clamped to existing levels");
+	}
+
+	streaming::texture_state makeState(unsigned size, unsigned base_level, float pixels)
+	{
+		streaming::texture_state t;
+		t.width = size;
+		t.height = size;
+		const unsigned levels = cooker::num_levels(size, size);
+		for (unsigned level = 0; level < levels; ++level)
+		{
+			const unsigned dim = cooker::level_dim(size, level);
+			t.level_bytes.push_back(cooker::level_bytes(cooker::format_dxt1, dim, dim));
+		}
+		t.base_level = base_level;
+		t.resident = base_level;
+		t.screen_pixels = pixels;
+		return t;
+	}
+
+	void checkPlan()
+	{
+		// 1024 textures with base level 64x64 (level 4)
+		std::vector<streaming::texture_state> states;
+		states.push_back(makeState(1024, 4, 1024));		// full screen
+		states.push_back(makeState(1024, 4, 300));		// needs level 1 (512)
+		states.push_back(makeState(1024, 4, 0));		// not drawn
+		states.push_back(makeState(1024, 4, 40));		// base is enough
+
+		std::vector<streaming::texture_state*> textures;
+		for (size_t i = 0; i < states.size(); ++i)
+			textures.push_back(&states[i]);
+
+		size_t total = streaming::plan(textures, ~(size_t)0);
+		check(0 == states[0].target && 1 == states[1].target && 4 == states[2].target && 4 == states[3].target, "unlimited budget gives desired levels");
+		check(total == states[0].bytes(0) + states[1].bytes(1) + states[2].bytes(4) + states[3].bytes(4), "planned bytes");
+
+		// loaded levels finer than desired are kept while they fit
+		states[0].resident = 0;
+		states[1].resident = 1;
+		states[2].resident = 0;
+		streaming::plan(textures, ~(size_t)0);
+		check(0 == states[2].target, "resident levels are kept within budget");
+
+		// budget without finest level of full screen one: not drawn texture is dropped first
+		const size_t bases = states[0].bytes(4) * 4;
+		const size_t budget = states[0].bytes(0) + states[1].bytes(1) + bases - states[0].bytes(4) * 2;
+		total = streaming::plan(textures, budget);
+		check(total <= budget, "plan fits budget");
+		check(4 == states[2].target, "not drawn texture is dropped first");
+		check(0 == states[0].target && 1 == states[1].target, "drawn textures keep desired levels");
+
+		// tight budget: the most oversampled ones go first, bases stay
+		total = streaming::plan(textures, states[0].bytes(2) + bases);
+		check(total <= states[0].bytes(2) + bases, "tight plan fits budget");
+		check(states[1].target > states[0].target || states[0].target >= 2, "oversampled texture is dropped first");
+
+		total = streaming::plan(textures, 0);
+		check(total == bases, "bases are never dropped");
+		for (size_t i = 0; i < states.size(); ++i)
+			check(states[i].target == states[i].base_level, "zero budget leaves bases");
+
+		// timing of plan over many textures
+		std::vector<streaming::texture_state> many;
+		std::srand(2);
+		for (int i = 0; i < 4096; ++i)
+		{
+			// base level is 64x64 as texture loading makes it
+			const unsigned scale = std::rand() % 4;
+			many.push_back(makeState(256 << scale, 2 + scale, (float)(std::rand() % 2048)));
+		}
+		std::vector<streaming::texture_state*> many_ptr;
+		for (size_t i = 0; i < many.size(); ++i)
+		{
+			many[i].resident = 0;
+			many_ptr.push_back(&many[i]);
+		}
+
+		const std::clock_t start = std::clock();
+		const int runs = 100;
+		for (int r = 0; r < runs; ++r)
+			total = streaming::plan(many_ptr, 64 << 20);
+		std::cout << "plan of " << many.size() << " textures: " << total / 1024 << " KB, "
+				  << toMs(std::clock() - start) / runs << " ms" << std::endl;
+		check(total <= (64 << 20), "large plan fits budget");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned size = argc > 1 ? (unsigned)std::atoi(argv[1]) : 512;
+	if (size < 8 || size % 4 || size > 4096)
+	{
+		std::cout << "usage: TextureBench [image size, multiple of 4]" << std::endl;
+		return 1;
+	}
+
+	checkCompression("gradient", makeGradient(size), 4, 4);
+	checkCompression("noise", makeNoise(size), 16, 16);
+	checkSolid();
+	checkChain(size, size / 2);
+	checkChain(12, 20);
+	checkFile(makeGradient(size));
+	checkDesiredLevel();
+	checkPlan();
+
+	std::cout << "checks: " << (failures ? "failed" : "passed") << std::endl;
+	return failures ? 2 : 0;
+}
@@ -0,0 +1,296 @@
+// Cooks textures for mip streaming: every source image in dir gets "<name>.tex"
+// next to it (see rgde/render/texture_cooker.h) with full mip chain, block
+// compressed. Sources that are unchanged since last cooking are skipped.
+// TGA is read everywhere, on windows D3DX reads other formats too.
+// usage: TextureCooker [dir] [format] [force]
+//   format: auto (default, DXT5 for images with alpha, DXT1 otherwise), dxt1, dxt5, argb8
+//   force = 1 cooks unchanged sources too
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "rgde/render/texture_cooker.h"
+
+#ifdef _WIN32
+#	include <windows.h>
+#	include <d3dx9.h>
+#	pragma comment (lib, "d3d9.lib")
+#	pragma comment (lib, "d3dx9.lib")
+#endif
+
+using render::cooker::image;
+
+namespace
+{
+	bool readFile(const std::string& filename, std::vector<unsigned char>& data)
+	{
+		std::ifstream in(filename.c_str(), std::ios::binary);
+		if (!in)
+			return false;
+
+		in.seekg(0, std::ios::end);
+		data.resize((size_t)in.tellg());
+		in.seekg(0, std::ios::beg);
+		if (!data.empty())
+			in.read((char*)&data[0], (std::streamsize)data.size());
+		return !data.empty() && in.good();
+	}
+
+	std::string lowerExtension(const std::string& filename)
+	{
+		const size_t dot = filename.rfind('.');
+		std::string ext = dot == std::string::npos ? "" : filename.substr(dot + 1);
+		for (size_t i = 0; i < ext.size(); ++i)
+			ext[i] = (char)tolower(ext[i]);
+		return ext;
+	}
+
+	/// uncompressed (2) and RLE (10) true color TGA, 24 or 32 bit
+	bool readTga(const std::vector<unsigned char>& data, image& img)
+	{
+		if (data.size() < 18)
+			return false;
+
+		const unsigned type = data[2];
+		const unsigned width = data[12] | (data[13] << 8);
+		const unsigned height = data[14] | (data[15] << 8);
+		const unsigned bytes = data[16] / 8;
+		const bool top_down = 0 != (data[17] & 0x20);
+
+		if ((type != 2 && type != 10) || (bytes != 3 && bytes != 4) || 0 == width || 0 == height)
+			return false;
+
+		img = image(width, height);
+		size_t pos = 18 + data[0];
+		const size_t count = (size_t)width * height;
+		size_t pixel = 0;
+
+		while (pixel < count)
+		{
+			unsigned run = 1;
+			bool packet = false;
+			if (10 == type)
+			{
+				if (pos >= data.size())
+					return false;
+				packet = 0 != (data[pos] & 0x80);
+				run = (data[pos] & 0x7F) + 1;
+				++pos;
+			}
+
+			for (unsigned i = 0; i < run && pixel < count; ++i, ++pixel)
+			{
+				if (pos + bytes > data.size())
+					return false;
+
+				const unsigned x = (unsigned)(pixel % width);
+				const unsigned y = (unsigned)(pixel / width);
+				unsigned char* dst = img.at(x, top_down ? y : height - 1 - y);
+				// TGA stores BGR(A) like A8R8G8B8 in memory
+				dst[0] = data[pos];
+				dst[1] = data[pos + 1];
+				dst[2] = data[pos + 2];
+				dst[3] = 4 == bytes ? data[pos + 3] : 255;
+
+				if (!packet || i + 1 == run)
+					pos += bytes;
+			}
+		}
+		return true;
+	}
+
+#ifdef _WIN32
+	/// D3DX decoding on reference device without window, nothing is drawn
+	class D3DXReader
+	{
+	public:
+		D3DXReader() : m_d3d(0), m_device(0)
+		{
+			m_d3d = Direct3DCreate9(D3D_SDK_VERSION);
+			if (!m_d3d)
+				return;
+
+			D3DPRESENT_PARAMETERS pp;
+			memset(&pp, 0, sizeof(pp));
+			pp.Windowed = TRUE;
+			pp.SwapEffect = D3DSWAPEFFECT_DISCARD;
+			pp.BackBufferFormat = D3DFMT_UNKNOWN;
+			pp.BackBufferWidth = 1;
+			pp.BackBufferHeight = 1;
+
+			if (FAILED(m_d3d->CreateDevice(D3DADAPTER_DEFAULT, D3DDEVTYPE_NULLREF, GetDesktopWindow(),
+										   D3DCREATE_SOFTWARE_VERTEXPROCESSING, &pp, &m_device)))
+				m_device = 0;
+		}
+
+		~D3DXReader()
+		{
+			if (m_device)
+				m_device->Release();
+			if (m_d3d)
+				m_d3d->Release();
+		}
+
+		bool read(const std::vector<unsigned char>& data, image& img)
+		{
+			if (!m_device)
+				return false;
+
+			IDirect3DTexture9* texture = 0;
+			if (FAILED(D3DXCreateTextureFromFileInMemoryEx(m_device, &data[0], (UINT)data.size(),
+					D3DX_DEFAULT_NONPOW2, D3DX_DEFAULT_NONPOW2, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_SCRATCH,
+					D3DX_FILTER_NONE, D3DX_FILTER_NONE, 0, 0, 0, &texture)))
+				return false;
+
+			D3DSURFACE_DESC desc;
+			D3DLOCKED_RECT locked;
+			bool result = false;
+			if (SUCCEEDED(texture->GetLevelDesc(0, &desc)) && SUCCEEDED(texture->LockRect(0, &locked, 0, D3DLOCK_READONLY)))
+			{
+				img = image(desc.Width, desc.Height);
+				for (UINT y = 0; y < desc.Height; ++y)
+					memcpy(img.at(0, y), (const char*)locked.pBits + y * locked.Pitch, desc.Width * 4);
+				texture->UnlockRect(0);
+				result = true;
+			}
+			texture->Release();
+			return result;
+		}
+
+	private:
+		IDirect3D9*			m_d3d;
+		IDirect3DDevice9*	m_device;
+	};
+#endif
+
+	bool isSource(const std::string& ext)
+	{
+#ifdef _WIN32
+		return ext == "tga" || ext == "jpg" || ext == "png" || ext == "bmp" || ext == "dds";
+#else
+		return ext == "tga";
+#endif
+	}
+
+	bool readImage(const std::string& filename, const std::vector<unsigned char>& data, image& img)
+	{
+		if (lowerExtension(filename) == "tga")
+			return readTga(data, img);
+
+#ifdef _WIN32
+		static D3DXReader reader;
+		return reader.read(data, img);
+#else
+		return false;
+#endif
+	}
+
+	/// cooked file is up to date if it was made from the same source in the same format
+	bool isUpToDate(const std::string& cooked, unsigned long long source_hash, render::cooker::format f)
+	{
+		std::vector<unsigned char> data;
+		if (!readFile(cooked, data))
+			return false;
+
+		render::cooker::header h;
+		return render::cooker::read_header(&data[0], data.size(), data.size(), h)
+			&& h.source_hash == source_hash && h.format == (unsigned)f;
+	}
+
+	enum cook_result {cooked, skipped, failed};
+
+	/// forced - format given by user, auto format otherwise
+	cook_result cookTexture(const std::string& filename, bool auto_format, render::cooker::format f, bool force)
+	{
+		using namespace render::cooker;
+
+		std::vector<unsigned char> source;
+		image img;
+		if (!readFile(filename, source) || !readImage(filename, source, img))
+			return failed;
+
+		if (auto_format)
+			f = has_alpha(img) ? format_dxt5 : format_dxt1;
+
+		if (is_compressed(f) && (img.width % 4 || img.height % 4))
+		{
+			std::cout << filename << ": size is not multiple of 4, stored uncompressed" << std::endl;
+			f = format_argb8;
+		}
+
+		const unsigned long long source_hash = hash(&source[0], source.size());
+		const std::string cooked_filename = filename + ".tex";
+		if (!force && isUpToDate(cooked_filename, source_hash, f))
+			return skipped;
+
+		std::vector<cooked_level> levels;
+		cook(img, f, levels);
+
+		std::vector<unsigned char> file;
+		write_file(f, levels, source_hash, file);
+
+		std::ofstream out(cooked_filename.c_str(), std::ios::binary);
+		if (!out)
+			return failed;
+		out.write((const char*)&file[0], (std::streamsize)file.size());
+
+		image decoded;
+		decompress(&levels[0].data[0], f, img.width, img.height, decoded);
+
+		static const char* names[] = {"A8R8G8B8", "DXT1", "DXT5"};
+		std::cout << filename << ": " << img.width << "x" << img.height << ", " << levels.size() << " levels, "
+				  << names[f] << ", " << img.pixels.size() * 4 / 3 << " -> " << file.size() << " bytes, rmse "
+				  << rmse(img, decoded) << std::endl;
+		return cooked;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	namespace fs = boost::filesystem;
+
+	const std::string path = argc > 1 ? argv[1] : ".";
+	const std::string format_name = argc > 2 ? argv[2] : "auto";
+	const bool force = argc > 3 && 0 != atoi(argv[3]);
+
+	render::cooker::format f = render::cooker::format_dxt1;
+	if (format_name == "dxt5")
+		f = render::cooker::format_dxt5;
+	else if (format_name == "argb8")
+		f = render::cooker::format_argb8;
+	else if (format_name != "dxt1" && format_name != "auto")
+	{
+		std::cout << "usage: TextureCooker [dir] [auto|dxt1|dxt5|argb8] [force]" << std::endl;
+		return 1;
+	}
+
+	unsigned num_cooked = 0, num_skipped = 0, num_failed = 0;
+
+	fs::directory_iterator end;
+	for (fs::directory_iterator it(path); it != end; ++it)
+	{
+		if (fs::is_directory(it->status()))
+			continue;
+
+		const std::string filename = it->path().string();
+		if (!isSource(lowerExtension(filename)))
+			continue;
+
+		switch (cookTexture(filename, format_name == "auto", f, force))
+		{
+		case cooked:	++num_cooked;	break;
+		case skipped:	++num_skipped;	break;
+		default:
+			std::cout << "failed: " << filename << std::endl;
+			++num_failed;
+		}
+	}
+
+	std::cout << "cooked: " << num_cooked << ", up to date: " << num_skipped << ", failed: " << num_failed << std::endl;
+	return num_failed ? 2 : 0;
+}
@@ -0,0 +1,227 @@
+// Measures scene::live_tree (dynamic AABB tree) under churn: every frame
+// part of objects moves, tree is updated incrementally and queried by frustum.
+// Linear batched frustum test over all objects (current renderScene path)
+// is measured for reference. Sphere and ray queries are checked against brute force.
+// usage: TreeBench [objects] [moving percent] [frames]
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <iostream>
+
+#include "rgde/scene/live_tree.h"
+
+namespace
+{
+	struct object
+	{
+		float x, y, z, r;
+		float vx, vy, vz;
+		scene::live_tree::proxy_id proxy;
+	};
+
+	/// camera in origin looking along +z, planes pointing inside (as math::frustum)
+	void makePlanes(math::frustum_planes& planes, float fovy, float aspect, float zn, float zf)
+	{
+		const float ty = std::tan(fovy / 2);
+		const float tx = ty * aspect;
+
+		const float src[6][4] = {
+			{-1,  0, tx, 0},	// right
+			{ 1,  0, tx, 0},	// left
+			{ 0,  1, ty, 0},	// bottom
+			{ 0, -1, ty, 0},	// top
+			{ 0,  0, -1, zf},	// far
+			{ 0,  0,  1, -zn}	// near
+		};
+
+		for (int p = 0; p < 6; ++p)
+		{
+			float len = std::sqrt(src[p][0]*src[p][0] + src[p][1]*src[p][1] + src[p][2]*src[p][2]);
+			for (int c = 0; c < 4; ++c)
+				planes[p][c] = src[p][c] / len;
+		}
+	}
+
+	bool testSphere(const math::frustum_planes& planes, const object& o)
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			if (planes[i][0] * o.x + planes[i][1] * o.y + planes[i][2] * o.z + planes[i][3] <= -o.r)
+				return false;
+		}
+		return true;
+	}
+
+	/// exact sphere test for leaves passed by tree
+	struct frustum_collector
+	{
+		const math::frustum_planes& planes;
+		const scene::live_tree& tree;
+		unsigned num_visible;
+
+		frustum_collector(const math::frustum_planes& p, const scene::live_tree& t)
+			: planes(p), tree(t), num_visible(0)
+		{
+		}
+
+		void operator()(scene::live_tree::proxy_id id)
+		{
+			if (testSphere(planes, *static_cast<const object*>(tree.get_data(id))))
+				++num_visible;
+		}
+	};
+
+	struct counter
+	{
+		unsigned num;
+		counter() : num(0) {}
+		void operator()(scene::live_tree::proxy_id) {++num;}
+	};
+
+	float random(float min, float max)
+	{
+		return min + (max - min) * std::rand() / RAND_MAX;
+	}
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+
+	scene::aabb bounds(const object& o)
+	{
+		return scene::aabb::from_sphere(o.x, o.y, o.z, o.r);
+	}
+
+	bool rayHits(const scene::aabb& box, const float o[3], const float d[3], float max_t)
+	{
+		float t0 = 0, t1 = max_t;
+		for (int i = 0; i < 3; ++i)
+		{
+			float tn = (box.min[i] - o[i]) / d[i];
+			float tf = (box.max[i] - o[i]) / d[i];
+			if (tn > tf) { float t = tn; tn = tf; tf = t; }
+			if (tn > t0) t0 = tn;
+			if (tf < t1) t1 = tf;
+		}
+		return t0 <= t1;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int num_objects = argc > 1 ? std::atoi(argv[1]) : 100000;
+	const int moving_percent = argc > 2 ? std::atoi(argv[2]) : 10;
+	const int frames = argc > 3 ? std::atoi(argv[3]) : 100;
+
+	if (num_objects <= 0 || moving_percent < 0 || moving_percent > 100 || frames <= 0)
+	{
+		std::cout << "usage: TreeBench [objects] [moving percent] [frames]" << std::endl;
+		return 1;
+	}
+
+	math::frustum_planes planes;
+	makePlanes(planes, 1.0f, 4.0f / 3.0f, 1.0f, 500.0f);
+
+	std::srand(12345);
+	std::vector<object> objects(num_objects);
+	const int num_moving = num_objects * moving_percent / 100;
+	for (int i = 0; i < num_objects; ++i)
+	{
+		object& o = objects[i];
+		o.x = random(-2000, 2000);
+		o.y = random(-50, 50);
+		o.z = random(-2000, 2000);
+		o.r = random(0.5f, 5.0f);
+		o.vx = i < num_moving ? random(-1, 1) : 0;
+		o.vy = 0;
+		o.vz = i < num_moving ? random(-1, 1) : 0;
+	}
+
+	scene::live_tree tree;
+	std::clock_t start = std::clock();
+	for (int i = 0; i < num_objects; ++i)
+		objects[i].proxy = tree.create(bounds(objects[i]), &objects[i]);
+	const double build_ms = toMs(std::clock() - start, 1);
+
+	math::sphere_soa spheres;
+	spheres.reserve(num_objects);
+	std::vector<unsigned char> visible;
+
+	double move_ms = 0, tree_ms = 0, linear_ms = 0;
+	size_t reinserts = 0;
+	bool same = true;
+
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		start = std::clock();
+		for (int i = 0; i < num_moving; ++i)
+		{
+			object& o = objects[i];
+			o.x += o.vx;
+			o.z += o.vz;
+			if (tree.move(o.proxy, bounds(o)))
+				++reinserts;
+		}
+		std::clock_t moved = std::clock();
+
+		frustum_collector collector(planes, tree);
+		tree.query_frustum(planes, collector);
+		std::clock_t queried = std::clock();
+
+		// reference: bounds gathered and tested linearly every frame
+		spheres.clear();
+		for (int i = 0; i < num_objects; ++i)
+			spheres.add(objects[i].x, objects[i].y, objects[i].z, objects[i].r);
+		unsigned linear_visible = math::cull_spheres(planes, spheres, visible);
+		std::clock_t culled = std::clock();
+
+		move_ms += toMs(moved - start, frames);
+		tree_ms += toMs(queried - moved, frames);
+		linear_ms += toMs(culled - queried, frames);
+		same = same && collector.num_visible == linear_visible;
+	}
+
+	// sphere and ray queries must return superset of brute force answer
+	bool complete = true;
+	for (int q = 0; q < 100; ++q)
+	{
+		const float cx = random(-2000, 2000), cz = random(-2000, 2000), r = random(10, 100);
+		const scene::aabb box = scene::aabb::from_sphere(cx, 0, cz, r);
+
+		counter by_tree;
+		tree.query_sphere(cx, 0, cz, r, by_tree);
+		counter by_box;
+		tree.query_aabb(box, by_box);
+
+		unsigned brute = 0;
+		for (int i = 0; i < num_objects; ++i)
+		{
+			const object& o = objects[i];
+			float dx = o.x - cx, dy = o.y, dz = o.z - cz;
+			if (dx*dx + dy*dy + dz*dz <= (r + o.r) * (r + o.r))
+				++brute;
+		}
+		complete = complete && by_tree.num >= brute && by_box.num >= by_tree.num;
+
+		const float origin[3] = {cx, 0, cz};
+		const float dir[3] = {random(-1, 1), 0.01f, random(-1, 1)};
+		counter by_ray;
+		tree.query_ray(origin, dir, 1000, by_ray);
+
+		unsigned brute_ray = 0;
+		for (int i = 0; i < num_objects; ++i)
+			brute_ray += rayHits(bounds(objects[i]), origin, dir, 1000) ? 1 : 0;
+		complete = complete && by_ray.num >= brute_ray;
+	}
+
+	std::cout << num_objects << " objects, " << num_moving << " moving, " << frames << " frames" << std::endl;
+	std::cout << "tree build:      " << build_ms << " ms, height " << tree.get_height() << std::endl;
+	std::cout << "tree update:     " << move_ms << " ms, " << reinserts / frames << " reinserts per frame" << std::endl;
+	std::cout << "tree frustum:    " << tree_ms << " ms" << std::endl;
+	std::cout << "linear frustum:  " << linear_ms << " ms" << std::endl;
+	std::cout << "queries complete: " << (complete ? "yes" : "no") << std::endl;
+
+	return same && complete ? 0 : 2;
+}
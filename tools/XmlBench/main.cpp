@@ -0,0 +1,117 @@
+// Compares TinyXML DOM loading (old model/level loaders) with in-situ pugixml 
+// parsing used by base::xml_document. Engine independent, runs anywhere.
+// usage: XmlBench <file.xml> [iterations]
+// note: TinyXML sources and this file must be built with TIXML_USE_STL
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#include "TinyXML/tinyxml.h"
+#include "pugixml-0.2/src/pugixml.hpp"
+
+namespace
+{
+	bool readFile(const std::string& filename, std::vector<char>& data)
+	{
+		std::ifstream in(filename.c_str(), std::ios::binary);
+		if (!in)
+			return false;
+
+		in.seekg(0, std::ios::end);
+		data.resize((size_t)in.tellg());
+		in.seekg(0, std::ios::beg);
+
+		if (!data.empty())
+			in.read(&data[0], (std::streamsize)data.size());
+
+		return true;
+	}
+
+	/// visits every element and attribute, as loaders do
+	size_t walkTiXml(const TiXmlElement* elem)
+	{
+		size_t count = 1;
+		for (const TiXmlAttribute* a = elem->FirstAttribute(); a; a = a->Next())
+			count += a->Value()[0] != 0;
+
+		for (const TiXmlElement* child = elem->FirstChildElement(); child; child = child->NextSiblingElement())
+			count += walkTiXml(child);
+
+		return count;
+	}
+
+	size_t walkPugi(pugi::xml_node elem)
+	{
+		size_t count = 1;
+		for (pugi::xml_attribute a = elem.first_attribute(); a; a = a.next_attribute())
+			count += a.value()[0] != 0;
+
+		for (pugi::xml_node child = elem.first_child(); child; child = child.next_sibling())
+			if (child.type() == pugi::node_element)
+				count += walkPugi(child);
+
+		return count;
+	}
+
+	double toMs(std::clock_t ticks, int iterations)
+	{
+		return 1000.0 * ticks / CLOCKS_PER_SEC / iterations;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: XmlBench <file.xml> [iterations]" << std::endl;
+		return 1;
+	}
+
+	const int iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+
+	std::vector<char> file_data;
+	if (!readFile(argv[1], file_data) || file_data.empty() || iterations <= 0)
+	{
+		std::cout << "can't read: " << argv[1] << std::endl;
+		return 1;
+	}
+	file_data.push_back(0);
+
+	size_t tixml_count = 0;
+	std::clock_t start = std::clock();
+	for (int i = 0; i < iterations; ++i)
+	{
+		// same steps as old loaders: copy of stream data + DOM build
+		std::vector<char> data(file_data);
+		TiXmlDocument xml;
+		xml.Parse(&data[0]);
+		if (xml.RootElement())
+			tixml_count = walkTiXml(xml.RootElement());
+	}
+	const double tixml_ms = toMs(std::clock() - start, iterations);
+
+	size_t pugi_count = 0;
+	start = std::clock();
+	for (int i = 0; i < iterations; ++i)
+	{
+		// same steps as base::xml_document: one buffer, parsed in place
+		std::vector<char> data(file_data);
+		pugi::xml_parser parser(&data[0]);
+		pugi_count = walkPugi(parser.document().first_node(pugi::node_element));
+	}
+	const double pugi_ms = toMs(std::clock() - start, iterations);
+
+	std::cout << "file: " << argv[1] << " (" << file_data.size() - 1 << " bytes), " 
+			  << iterations << " iterations" << std::endl;
+	std::cout << "tinyxml: " << tixml_ms << " ms/load, " << tixml_count << " items" << std::endl;
+	std::cout << "pugixml: " << pugi_ms << " ms/load, " << pugi_count << " items" << std::endl;
+	if (pugi_ms > 0)
+		std::cout << "speedup: " << tixml_ms / pugi_ms << "x" << std::endl;
+
+	return tixml_count == pugi_count ? 0 : 2;
+}